@@ -10,6 +10,9 @@
 # DESCRIPTION
 #    csv_to_root.py parses the specified input file, ignoring all lines 
 #    starting with '#', and writes the entries of the file in a tree.
+#
+#    For large files, the native tool csv_to_columns (see
+#    stan_pwa/tools/csv_to_columns.cpp, option --root) is much faster.
 
 import argparse
 import numpy as np
@@ -0,0 +1,35 @@
+#!/bin/bash
+
+# build_rdump_writer.sh
+#
+# Builds the native R dump writer used by lib/py/utils/stan_rdump.py
+# (lib/py/utils/rdump_writer.cpp) to lib/py/utils/rdump_writer.so. It does
+# not depend on the model, so it needs to be built only once.
+#
+# Built as C++17 if the compiler supports it: the doubles are then
+# formatted with std::to_chars, much faster than the C++11 fallback.
+#
+# CAVEAT: run from anywhere inside stan_pwa.
+
+###### FUNCTIONS
+function cd_stan_pwa
+{
+  while [[ $PWD != '/' && ${PWD##*/} != 'stan_pwa' ]]; do cd ..; done
+}
+
+###### MAIN
+cd_stan_pwa
+MDECA_DIR=$PWD
+CMDSTAN_DIR=$(dirname "$MDECA_DIR")
+
+CXX=${CXX:-clang++}
+CXXFLAGS=${CXXFLAGS:-"-O3"}
+CXXFLAGS="$CXXFLAGS -pthread -fPIC -shared"
+SRC=$MDECA_DIR/lib/py/utils/rdump_writer.cpp
+LIB=$MDECA_DIR/lib/py/utils/rdump_writer.so
+
+echo "build_rdump_writer.sh: Building lib/py/utils/rdump_writer.so..."
+$CXX $CXXFLAGS -std=c++17 -I $CMDSTAN_DIR $SRC -o $LIB 2> /dev/null \
+  || $CXX $CXXFLAGS -std=c++11 -I $CMDSTAN_DIR $SRC -o $LIB || exit 1
+
+echo "build_rdump_writer.sh: Done."
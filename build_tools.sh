@@ -0,0 +1,58 @@
+#!/bin/bash
+
+# build_tools.sh [TOOL...]
+#
+# Builds the native tools stan_pwa/tools/<TOOL>.cpp (default: all of them)
+# against the model currently linked by relink_model.sh. The executables
+# are saved in build/<TOOL>.
+#
+# CAVEAT: run from the model folder.
+
+###### FUNCTIONS
+function cd_stan_pwa
+{
+  while [[ $PWD != '/' && ${PWD##*/} != 'stan_pwa' ]]; do cd ..; done
+}
+
+###### MAIN
+# Define locations of necessary files
+MODEL_DIR=$PWD
+cd_stan_pwa
+MDECA_DIR=$PWD
+CMDSTAN_DIR=$(dirname "$MDECA_DIR")
+cd $MODEL_DIR
+
+# Libraries shipped with CmdStan
+STAN=$(ls -d $CMDSTAN_DIR/stan_2.9.0)
+MATH=$(ls -d $STAN/lib/stan_math_*)
+EIGEN=$(ls -d $MATH/lib/eigen_* | head -n 1)
+BOOST=$(ls -d $MATH/lib/boost_* | head -n 1)
+
+CXX=${CXX:-clang++}
+CXXFLAGS=${CXXFLAGS:-"-O3 -march=native"}
+CXXFLAGS="$CXXFLAGS -std=c++11 -pthread -DBOOST_RESULT_OF_USE_TR1 -DBOOST_NO_DECLTYPE -DBOOST_DISABLE_ASSERTS -DEIGEN_NO_DEBUG"
+INCLUDES="-I $CMDSTAN_DIR -I $STAN/src -isystem $MATH -isystem $EIGEN -isystem $BOOST"
+
+# Optional ROOT output (tools using STAN_PWA_WITH_ROOT, e.g. csv_to_columns)
+if command -v root-config > /dev/null 2>&1
+  then
+    ROOT_FLAGS="-DSTAN_PWA_WITH_ROOT $(root-config --cflags --libs)"
+fi
+
+mkdir -p build
+
+if [ $# -eq 0 ]
+  then
+    TOOLS=$(ls $MDECA_DIR/tools/*.cpp | xargs -n 1 basename | sed 's/\.cpp$//')
+  else
+    TOOLS=$@
+fi
+
+for TOOL in $TOOLS; do
+    echo "build_tools.sh: Building build/$TOOL..."
+    FLAGS=""
+    grep -q STAN_PWA_WITH_ROOT $MDECA_DIR/tools/$TOOL.cpp && FLAGS=$ROOT_FLAGS
+    $CXX $CXXFLAGS $INCLUDES $MDECA_DIR/tools/$TOOL.cpp $FLAGS -o build/$TOOL || exit 1
+done
+
+echo "build_tools.sh: Done."
@@ -8,6 +8,10 @@
 # output/generated_data.root.
 #
 # CAVEAT: run from the model folder.
+#
+# For large samples, use the native generator build/generate_events
+# instead (independent events, multi-threaded; see build_tools.sh and
+# stan_pwa/tools/generate_events.cpp).
 
 ###### FUNCTIONS
 function cd_stan_pwa
@@ -66,6 +66,26 @@ add("norm",DOUBLE_T,expr_type(VECTOR_T,1U),expr_type(MATRIX_T,1U), VECTOR_T, VEC
 // Model-dependent with background, background only
 add("norm_background",DOUBLE_T, VECTOR_T, VECTOR_T);
 
+/* pwa_loglik
+ *
+ * Returns sum over all events of log(f_genfit / norm), with analytic
+ * gradient (replaces the event loop in the fitting model)
+ */
+add("pwa_loglik",DOUBLE_T,expr_type(VECTOR_T,2U),expr_type(VECTOR_T,1U),expr_type(MATRIX_T,1U));
+// Same, on packed outer products of the amplitudes (lib/py/utils/hermitian.py)
+add("pwa_loglik_packed",DOUBLE_T,expr_type(MATRIX_T,1U),expr_type(VECTOR_T,1U),expr_type(MATRIX_T,1U));
+// Same, multi-threaded (STAN_PWA_NUM_THREADS)
+add("pwa_loglik_threaded",DOUBLE_T,expr_type(VECTOR_T,2U),expr_type(VECTOR_T,1U),expr_type(MATRIX_T,1U));
+// Same, on the amplitudes of the event store STAN_PWA_EVENT_STORE (tools/event_store.cpp)
+add("pwa_loglik_mapped",DOUBLE_T,expr_type(VECTOR_T,1U),expr_type(MATRIX_T,1U));
+add("num_mapped_events",INT_T); // number of events in the event store
+// Same, with the floating resonances of the model (MyFloating) for the
+// parameters p; the normalization integral is computed on the points of
+// the event store STAN_PWA_NORM_STORE
+add("pwa_loglik_floating",DOUBLE_T,expr_type(VECTOR_T,1U),VECTOR_T);
+add("num_floating_resonances",INT_T); // number of floating resonances
+add("num_floating_params",INT_T); // number of their parameters (size of p)
+
 // Binned models
 add("norm_bin",DOUBLE_T,expr_type(VECTOR_T,1U),expr_type(VECTOR_T,1U),expr_type(VECTOR_T,1U),VECTOR_T,VECTOR_T,expr_type(MATRIX_T,1U), expr_type(MATRIX_T,1U), expr_type(MATRIX_T,1U),expr_type(MATRIX_T,1U),VECTOR_T, VECTOR_T);
 
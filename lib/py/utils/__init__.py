@@ -1,6 +1,8 @@
 __all__ = []
 
+from columns import *
 from convert import *
+from hermitian import *
 from mcint import *
 from path import *
 from save import *
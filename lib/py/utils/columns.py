@@ -0,0 +1,37 @@
+# Read the binary columnar tables written by the native tools
+# (stan_pwa/src/io/columns.hpp, e.g. tools/csv_to_columns.cpp).
+
+import numpy as np
+import struct
+
+
+def read_columns(filename):
+    """
+    Returns the table in filename as a dict of numpy arrays, one per
+    column name (e.g. 'lp__', 'y.1', ...).
+    """
+    with open(filename, 'rb') as f:
+        magic, version, header_size, num_rows, num_cols, block_rows, \
+            byte_order = struct.unpack('=8sIIQQQQ', f.read(48))
+        if magic != b'SPWACOL\0':
+            raise IOError('{0} is not a columnar table'.format(filename))
+        if byte_order != 0x0102030405060708 or version != 1:
+            raise IOError('{0}: unsupported version or byte order'
+                          .format(filename))
+        names = []
+        for c in range(num_cols):
+            n, = struct.unpack('=I', f.read(4))
+            names.append(f.read(n).decode())
+        f.seek(header_size)
+
+        blocks = [[] for c in range(num_cols)]
+        while True:
+            head = f.read(8)
+            if len(head) < 8:
+                break
+            n, = struct.unpack('=Q', head)
+            for c in range(num_cols):
+                blocks[c].append(np.fromfile(f, dtype=np.float64, count=n))
+
+    return dict((names[c], np.concatenate(blocks[c]) if blocks[c]
+                 else np.zeros(0)) for c in range(num_cols))
@@ -0,0 +1,34 @@
+# Precompute the outer products of the event amplitudes for the fitting.
+
+import numpy as np
+
+
+def packed_index(i, j, n_res):
+    """
+    Row of the element (i,j), i <= j, of the upper triangle of an
+    n_res x n_res matrix, packed row by row (same as in
+    src/likelihood/packed_hermitian.hpp).
+    """
+    return i * n_res - i * (i - 1) / 2 + (j - i)
+
+
+def pack_hermitian(amplitude_vector_data):
+    """
+    Returns the packed Hermitian matrices H_d = conj(A_d) A_d^T.
+
+    Takes the amplitudes in the layout of the fitting data,
+    amplitude_vector_data[d, 0, r] = Re(A_r) and
+    amplitude_vector_data[d, 1, r] = Im(A_r) of event d, and returns an
+    array H of shape (2, P, D), P = R (R + 1) / 2, such that H[0] and
+    H[1] are the real and imaginary parts of the upper triangles of all
+    H_d, one column per event. Pass it to STAN as 'matrix[P, D] H[2]'
+    and use pwa_loglik_packed(H, theta, I) in the fitting model.
+    """
+    A = np.asarray(amplitude_vector_data, dtype=float)
+    n_res = A.shape[2]
+    A_c = A[:, 0, :] + 1j * A[:, 1, :]
+
+    rows, cols = np.triu_indices(n_res)
+    H_c = np.conj(A_c[:, rows]) * A_c[:, cols]
+
+    return np.asarray([H_c.real.T, H_c.imag.T])
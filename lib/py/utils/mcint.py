@@ -199,6 +199,9 @@ def integral_of_tensor_product_w_pts(func, y_data, n_pts, volume):
         I[i,j] = int A_i(y) * A_j(y) dy.
     The points y_1 .. y_d consist of a list of variables: y_i = [m_1, .. m_n].
 
+    For large point samples, use the native tool
+    stan_pwa/tools/normalization_integral.cpp instead (see build_tools.sh).
+
     Parameters
     ----------
     func : function
@@ -0,0 +1,92 @@
+// rdump_writer.cpp
+//
+// C interface of stan_pwa/src/io/rdump_writer.hpp for stan_rdump.py
+// (loaded with ctypes). Built to lib/py/utils/rdump_writer.so by
+// build_rdump_writer.sh; stan_rdump.py falls back to pure Python if the
+// library is missing.
+//
+// All functions return 0 on success and -1 on failure (the file could
+// not be opened or written).
+
+#include <cstddef> // size_t, ptrdiff_t
+#include <fstream>
+#include <new> // nothrow
+#include <vector>
+
+#include <stan_pwa/src/io/rdump_writer.hpp>
+
+namespace {
+
+  struct rdump_file {
+    std::ofstream out;
+    stan_pwa::io::rdump_writer writer;
+
+    rdump_file(const char* path, bool threaded) :
+      out(path, std::ios::binary), writer(out, threaded) {};
+  };
+
+  template <typename T>
+  int write_array(void* handle, const char* name, const T* data, int ndim,
+                  const long long* shape, const long long* strides) {
+    rdump_file* f = static_cast<rdump_file*>(handle);
+    std::vector<size_t> s(shape, shape + ndim);
+    std::vector<ptrdiff_t> st(strides, strides + ndim);
+    try {
+      f->writer.write_array(name, data, s, st);
+    } catch (...) {
+      return -1;
+    }
+    return f->out ? 0 : -1;
+  }
+
+}
+
+extern "C" {
+
+  ///> Opens path for writing; returns 0 on failure
+  void* stan_pwa_rdump_open(const char* path, int threaded) {
+    rdump_file* f = new (std::nothrow) rdump_file(path, threaded != 0);
+    if (f != 0 && !f->out) {
+      delete f;
+      return 0;
+    }
+    return f;
+  }
+
+  int stan_pwa_rdump_int(void* handle, const char* name, long long x) {
+    rdump_file* f = static_cast<rdump_file*>(handle);
+    f->writer.write(name, x);
+    return f->out ? 0 : -1;
+  }
+
+  int stan_pwa_rdump_real(void* handle, const char* name, double x) {
+    rdump_file* f = static_cast<rdump_file*>(handle);
+    f->writer.write(name, x);
+    return f->out ? 0 : -1;
+  }
+
+  ///> Array of the given shape; strides in elements (numpy order)
+  int stan_pwa_rdump_int_array(void* handle, const char* name,
+                               const long long* data, int ndim,
+                               const long long* shape,
+                               const long long* strides) {
+    return write_array(handle, name, data, ndim, shape, strides);
+  }
+
+  int stan_pwa_rdump_real_array(void* handle, const char* name,
+                                const double* data, int ndim,
+                                const long long* shape,
+                                const long long* strides) {
+    return write_array(handle, name, data, ndim, shape, strides);
+  }
+
+  ///> Flushes and closes the file
+  int stan_pwa_rdump_close(void* handle) {
+    rdump_file* f = static_cast<rdump_file*>(handle);
+    f->out.close();
+    const int res = f->out ? 0 : -1;
+    delete f;
+    return res;
+  }
+
+}
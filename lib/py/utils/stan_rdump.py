@@ -9,6 +9,7 @@
 #                                                                             #
 ###############################################################################
 
+import ctypes
 import numpy as np
 import os
 import ROOT
@@ -46,6 +47,9 @@ def stan_rdump(data, filename):
     Dump a dictionary with model data into a file using the R dump format that
     Stan supports.
 
+    Uses the native streaming writer (rdump_writer.so, see
+    _native_rdump) if it is built, the pure Python version else.
+
     Parameters
     ----------
     data : dict
@@ -54,7 +58,78 @@ def stan_rdump(data, filename):
     #for name in data:
     #    if not is_legal_stan_vname(name):
     #        raise ValueError("Variable name {} is not allowed in Stan".format(name))
+    if _native_library() is not None:
+        _native_rdump(data, filename)
+        return
     with open(filename, 'w') as f:
         f.write(_dict_to_rdump(data))
 
 # END OF GITHUB STAN CODE #####################################################
+
+
+_native = []
+
+
+def _native_library():
+    """
+    Returns the native writer (lib/py/utils/rdump_writer.so, built by
+    build_rdump_writer.sh) loaded with ctypes, or None if it is not built.
+    """
+    if not _native:
+        path = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                            'rdump_writer.so')
+        lib = None
+        if os.path.exists(path):
+            lib = ctypes.CDLL(path)
+            lib.stan_pwa_rdump_open.restype = ctypes.c_void_p
+            lib.stan_pwa_rdump_open.argtypes = [ctypes.c_char_p, ctypes.c_int]
+            lib.stan_pwa_rdump_int.argtypes = [
+                ctypes.c_void_p, ctypes.c_char_p, ctypes.c_longlong]
+            lib.stan_pwa_rdump_real.argtypes = [
+                ctypes.c_void_p, ctypes.c_char_p, ctypes.c_double]
+            array_args = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_void_p,
+                          ctypes.c_int, ctypes.c_void_p, ctypes.c_void_p]
+            lib.stan_pwa_rdump_int_array.argtypes = array_args
+            lib.stan_pwa_rdump_real_array.argtypes = array_args
+            lib.stan_pwa_rdump_close.argtypes = [ctypes.c_void_p]
+        _native.append(lib)
+    return _native[0]
+
+
+def _native_rdump(data, filename, threaded=True):
+    """
+    Same as stan_rdump, with the native streaming writer: the arrays are
+    formatted from their buffers (any strides, no copies in Fortran
+    order), with the shortest round-trip representation of every value,
+    in chunks on STAN_PWA_NUM_THREADS threads if threaded.
+    """
+    lib = _native_library()
+    f = lib.stan_pwa_rdump_open(filename.encode(), int(threaded))
+    if not f:
+        raise IOError("cannot open {0}".format(filename))
+    try:
+        for name, value in data.items():
+            value = np.asarray(value)
+            if value.dtype == np.bool_ or np.issubdtype(value.dtype, np.integer):
+                value, dtype = value.astype(np.int64, copy=False), 'int'
+            else:
+                value, dtype = value.astype(np.float64, copy=False), 'real'
+
+            if value.ndim == 0:
+                if dtype == 'int':
+                    err = lib.stan_pwa_rdump_int(f, name.encode(), int(value))
+                else:
+                    err = lib.stan_pwa_rdump_real(f, name.encode(), float(value))
+            else:
+                shape = np.asarray(value.shape, dtype=np.int64)
+                strides = np.asarray(value.strides, dtype=np.int64) \
+                    // value.itemsize
+                write = lib.stan_pwa_rdump_int_array if dtype == 'int' \
+                    else lib.stan_pwa_rdump_real_array
+                err = write(f, name.encode(), value.ctypes.data, value.ndim,
+                            shape.ctypes.data, strides.ctypes.data)
+            if err != 0:
+                raise IOError("cannot write {0} to {1}".format(name, filename))
+    finally:
+        if lib.stan_pwa_rdump_close(f) != 0:
+            raise IOError("cannot write {0}".format(filename))
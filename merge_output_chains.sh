@@ -8,6 +8,12 @@
 #   to a single file
 #    *    output/output.csv
 #   and translates the latter one to output/output.root
+#
+#   If build/merge_chains is built (see build_tools.sh), the files are
+#   merged in one pass, in the same order, to output/output.csv and to
+#   output/output.root if merge_chains was built with ROOT (else by
+#   csv_to_root.py as before); the columnar table output/output.col is
+#   written as well, and the convergence of theta is printed.
 
 ###### FUNCTIONS
 function cd_stan_pwa
@@ -22,6 +28,19 @@ cd_stan_pwa
 MDECA_DIR=$(pwd)
 cd $MODEL_DIR
 
+# Merge natively, with convergence diagnostics
+if [ -x build/merge_chains ]
+  then
+    ROOT_OPTION=""
+    build/merge_chains --has_root && ROOT_OPTION="--root"
+    build/merge_chains --csv $ROOT_OPTION output/output.col output/output?.csv || exit $?
+    if [ -z "$ROOT_OPTION" ]
+      then
+        $MDECA_DIR/bin/csv_to_root.py $MODEL_DIR/output/output.csv $MODEL_DIR/output/output.root
+    fi
+    exit $?
+fi
+
 # Merge
 grep lp__ output/output1.csv > output/output.csv
 sed '/^[#l]/d'  output/output?.csv >> output/output.csv
@@ -7,42 +7,62 @@ namespace mc = stan_pwa::complex;
 
 namespace stan_pwa {
 
+  template <typename... Res>
   template <typename T>
-  C_t<T> Model::amplitude(unsigned int i, const Var_t<T>& y) {
-    return this->amplitudes_[i].value(y);
+  C_t<T> Model<Res...>::amplitude(unsigned int i, const Var_t<T>& y) {
+    return resonance_list::amplitude(this->amplitudes_, i, y);
   };
 
 
+  template <typename... Res>
   template <typename T>
-  CV_t<T> Model::amplitude_vector(const Var_t<T>& y) {
-    CV_t<T> res(2, (Eigen::Matrix<T,Eigen::Dynamic,1> (this->num_res_)));
-    for (unsigned int i = 0; i < this->num_res_; i++) {
-      res[i] = this->amplitude(i,y);
-    }
-    return res;
+  CV_t<T> Model<Res...>::amplitude_vector(const Var_t<T>& y) {
+    return resonance_list::amplitude_vector(this->amplitudes_, y);
   };
 
 
+  template <typename... Res>
   template <typename T>
-  C_t<T> Model::amplitude_sym(unsigned int i, const Var_t<T>& y) {
-    return this->amplitudes_[i].value_sym(y);
+  C_t<T> Model<Res...>::amplitude_sym(unsigned int i, const Var_t<T>& y) {
+    return resonance_list::amplitude_sym(this->amplitudes_, i, y);
   };
 
 
+  template <typename... Res>
   template <typename T>
-  CV_t<T> Model::amplitude_vector_sym(const Var_t<T>& y) {
-    CV_t<T> res(2, (Eigen::Matrix<T,Eigen::Dynamic,1> (this->num_res_)));
-    for (int i = 0; i < this->num_res_; i++) {
-      res[i] = this_amplitude_sym(i,y);
-    }
-    return res;
+  CV_t<T> Model<Res...>::amplitude_vector_sym(const Var_t<T>& y) {
+    return resonance_list::amplitude_vector_sym(this->amplitudes_, y);
   };
 
 
+  template <typename... Res>
+  void Model<Res...>::amplitude_batch(const Eigen::MatrixXd& y,
+				      resonance_list::soa_matrix& re,
+				      resonance_list::soa_matrix& im) {
+    resonance_list::amplitude_batch(this->amplitudes_, this->sym_flag_,
+				    y, re, im);
+  };
+
+
+  template <typename... Res>
+  uint64_t Model<Res...>::hash() {
+    return resonance_list::model_hash(this->amplitudes_, this->num_var_,
+				      this->sym_flag_);
+  };
+
+
+  template <typename... Res>
+  integrate::normalization
+  Model<Res...>::integral(integrate::integral_store& store, double volume) {
+    return store.integral(this->amplitudes_, this->sym_flag_, volume);
+  };
+
+
+  template <typename... Res>
   template <typename T0, typename T1>
   typename boost::math::tools::promote_args<T0,T1>::type ///> return scalar
   //Model::f_genfit(const CV_t<T0>& amp, const CV_t<T1>& theta) {
-  Model::f_genfit(const std::vector<Eigen::Matrix<T0, Eigen::Dynamic, 1> >& A_r,
+  Model<Res...>::f_genfit(const std::vector<Eigen::Matrix<T0, Eigen::Dynamic, 1> >& A_r,
       const std::vector<Eigen::Matrix<T1, Eigen::Dynamic, 1> >& theta) {
 
       return mc::scalar::abs2(
@@ -51,15 +71,18 @@ namespace stan_pwa {
   };
 
 
+  template <typename... Res>
   template <typename T0, typename T1>
   typename boost::math::tools::promote_args<T0,T1>::type
-  Model::norm(const CV_t<T0>& theta, const CV_t<T0>& I) {
+  Model<Res...>::norm(const CV_t<T0>& theta,
+      const std::vector<Eigen::Matrix<T1, Eigen::Dynamic, Eigen::Dynamic> >& I) {
       typename boost::math::tools::promote_args<T0,T1>::type res = 0;
       // I * theta holder, real and imaginary part
       typename boost::math::tools::promote_args<T0,T1>::type tmp[2];
 
-      for (int i = 0; i < NUM_RES; i++) {
-	for (int j = 0; j < NUM_RES; j++) {
+      const int R = theta[0].rows();
+      for (int i = 0; i < R; i++) {
+	for (int j = 0; j < R; j++) {
 	  // Complex multiplication
 	  tmp[0] = I[0](i,j) * theta[0](j) - I[1](i,j) * theta[1](j);
 	  tmp[1] = I[0](i,j) * theta[1](j) + I[1](i,j) * theta[0](j);
@@ -73,6 +96,32 @@ namespace stan_pwa {
       return res;
   };
 
+
+  template <typename... Res>
+  template <typename T0, typename T1, typename T2>
+  typename boost::math::tools::promote_args<T0,T1,T2>::type
+  Model<Res...>::pwa_loglik(const std::vector<CV_t<T0> >& A_r, const CV_t<T1>& theta,
+      const std::vector<Eigen::Matrix<T2, Eigen::Dynamic, Eigen::Dynamic> >& I) {
+      // Analytic gradient if A_r and I are data (see src/likelihood.hpp)
+      return stan_pwa::likelihood::pwa_loglik(A_r, theta, I);
+  };
+
+
+  template <typename... Res>
+  template <typename T>
+  T Model<Res...>::pwa_loglik_packed(const std::vector<Eigen::MatrixXd>& H,
+      const CV_t<T>& theta, const std::vector<Eigen::MatrixXd>& I) {
+      return stan_pwa::likelihood::pwa_loglik_packed(H, theta, I);
+  };
+
+
+  template <typename... Res>
+  template <typename T>
+  T Model<Res...>::pwa_loglik_threaded(const std::vector<CV_t<double> >& A_r,
+      const CV_t<T>& theta, const std::vector<Eigen::MatrixXd>& I) {
+      return stan_pwa::likelihood::pwa_loglik_threaded(A_r, theta, I);
+  };
+
 } // end of pwa_stan
 
 #endif
@@ -1,28 +1,38 @@
 #ifndef PWA_STAN__SRC__MODEL_DEF_HPP
 #define PWA_STAN__SRC__MODEL_DEF_HPP
 
+#include <cstdint> // uint64_t
+#include <tuple>
 #include <vector>
 #include <stan/math/prim/mat/fun/Eigen.hpp>
 #include <boost/math/tools/promotion.hpp>
-#include <boost/any.hpp>
 
 #include <stan_pwa/src/structures.hpp>
+#include <stan_pwa/src/integrate/integral_store.hpp>
+#include <stan_pwa/src/likelihood.hpp>
+#include <stan_pwa/src/resonance_list.hpp>
 #include <stan_pwa/src/typedefs.h>
 
 namespace stan_pwa {
 
   /**
    * This class wraps together multiple resonances to single PWA model.
+   *
+   * The resonances are kept in a std::tuple with their own types, so the
+   * loops over them are unrolled at compile time
+   * (see stan_pwa/src/resonance_list.hpp).
+   *
+   * @tparam Res Types of the resonances, e.g. resonances::breit_wigner
    */
+  template <typename... Res>
   class Model {
   public:
     ///> Set number of variables: 2 for 3-body-decay, 5 for 4-body-decay.
-    Model(unsigned int num_var, bool sym_flag, 
-	  std::vector<resonances::resonance_base_3> amplitudes) : 
+    Model(unsigned int num_var, bool sym_flag, const Res&... amplitudes) : 
+      num_res_(sizeof...(Res)),
       num_var_(num_var), 
-      num_res_(amplitudes.size()),
       sym_flag_(sym_flag),
-      amplitudes_(amplitudes)
+      amplitudes_(amplitudes...)
     {};
     ~Model() {};
 
@@ -41,6 +51,11 @@ namespace stan_pwa {
     template <typename T>
     CV_t<T> amplitude_vector_sym(const Var_t<T>&);
 
+    ///> Values of all resonances (symmetrized if sym_flag) for the events
+    ///> in the rows of y; re(i, n), im(i, n) for resonance i and event n
+    void amplitude_batch(const Eigen::MatrixXd&, resonance_list::soa_matrix&,
+			 resonance_list::soa_matrix&);
+
     ///> Combines vectors and amplitudes to (un-normalized) likelihood fct
     template <typename T0, typename T1>
     typename boost::math::tools::promote_args<T0,T1>::type ///> return scalar
@@ -51,7 +66,35 @@ namespace stan_pwa {
     ///> Calculates the normalization integral for the fitting
     template <typename T0, typename T1>
     typename boost::math::tools::promote_args<T0,T1>::type
-    norm(const CV_t<T0>&, const CV_t<T0>&);
+    norm(const CV_t<T0>&,
+	 const std::vector<Eigen::Matrix<T1, Eigen::Dynamic, Eigen::Dynamic> >&);
+
+    ///> Fused log-likelihood sum_d log(f_genfit(A_d, theta) / norm(theta, I))
+    ///> with analytic gradient (one autodiff node for all events)
+    template <typename T0, typename T1, typename T2>
+    typename boost::math::tools::promote_args<T0,T1,T2>::type
+    pwa_loglik(const std::vector<CV_t<T0> >&, const CV_t<T1>&,
+	       const std::vector<Eigen::Matrix<T2, Eigen::Dynamic, Eigen::Dynamic> >&);
+
+    ///> Same as above, on the packed outer products conj(A_d) A_d^T
+    template <typename T>
+    T pwa_loglik_packed(const std::vector<Eigen::MatrixXd>&, const CV_t<T>&,
+			const std::vector<Eigen::MatrixXd>&);
+
+    ///> Same as pwa_loglik, the event sum split over STAN_PWA_NUM_THREADS
+    ///> threads (result independent of the number of threads)
+    template <typename T>
+    T pwa_loglik_threaded(const std::vector<CV_t<double> >&, const CV_t<T>&,
+			  const std::vector<Eigen::MatrixXd>&);
+
+    ///> Fingerprint of the resonances, num_var and sym_flag
+    ///> (see stan_pwa/src/resonance_list/fingerprint.hpp)
+    uint64_t hash();
+
+    ///> Normalization integral over the sample of the store, reusing the
+    ///> amplitude columns and pair sums in it
+    ///> (see stan_pwa/src/integrate/integral_store.hpp)
+    integrate::normalization integral(integrate::integral_store&, double);
 
     // get_num_res
     int get_num_res() {return num_res_;}
@@ -69,11 +112,24 @@ namespace stan_pwa {
     ///>  whether the model must be symmetrized or not
     bool sym_flag_;
 
-    ///> Vector containing PWA amplitude functions
-    std::vector<resonances::resonance_base_3> amplitudes_;
+    ///> PWA amplitude functions
+    std::tuple<Res...> amplitudes_;
   };
 
 
+  /**
+   * Model<Res...> make_model(num_var, sym_flag, resonances...)
+   *
+   * Creates a model from its resonances; the resonance types are
+   * deduced from the arguments.
+   */
+  template <typename... Res>
+  inline Model<Res...>
+  make_model(unsigned int num_var, bool sym_flag, const Res&... amplitudes) {
+    return Model<Res...>(num_var, sym_flag, amplitudes...);
+  }
+
+
 } // end of stan_pwa
 #endif
 
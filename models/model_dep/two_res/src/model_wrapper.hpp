@@ -1,25 +1,29 @@
 #ifndef STAN_PWA__SRC__MODEL_WRAPPER_HPP
 #define STAN_PWA__SRC__MODEL_WRAPPER_HPP
 
+#include <cstdlib> // atof, getenv
+#include <stdexcept> // domain_error
+#include <string>
+
 #include "model_def.hpp"
+#include "model.cpp"
 #include "model_inst.hpp"
+
+#include <stan_pwa/src/io/event_store.hpp>
 // Wrap user's input in model_inst.hpp to Stan-usable form
 
 namespace stan {
   namespace math {
 
-    template <typename T>
-    stan_pwa::Wrapper<T> ModelWrapper(stan_pwa::sym_flag,
-				      stan_pwa::amp_ptr<T>,
-				      stan_pwa::amp_vector_ptr<T>);
-
     template <typename T>
     inline
     std::vector<typename boost::math::tools::promote_arg<T>::type>
     amplitude(const unsigned int &res_id, 
 	      const Eigen::Matrix<T, Eigen::Dynamic,1>& y) 
     {
-      return (stan_pwa::MyModel.*stan_pwa::amp_ptr<T>)(res_id, y);
+      if (stan_pwa::MyModel.get_sym_flag())
+	return stan_pwa::MyModel.amplitude_sym(res_id, y);
+      return stan_pwa::MyModel.amplitude(res_id, y);
     }
 
 
@@ -28,7 +32,23 @@ namespace stan {
     std::vector<Eigen::Matrix<typename boost::math::tools::promote_args<T0>::type, Eigen::Dynamic, 1> >
     amplitude_vector(const Eigen::Matrix<T0, Eigen::Dynamic,1>& y) 
     {
-      return (stan_pwa::MyModel.*stan_pwa::amp_vector_ptr<T0>)(y);
+      if (stan_pwa::MyModel.get_sym_flag())
+	return stan_pwa::MyModel.amplitude_vector_sym(y);
+      return stan_pwa::MyModel.amplitude_vector(y);
+    }
+
+
+    /**
+     * Amplitudes of all resonances for the events in the rows of y
+     * (N x num_variables()), as a structure of arrays: re(i, n), im(i, n)
+     * for resonance i and event n (see stan_pwa/src/resonance_list/batch.hpp).
+     */
+    inline void
+    amplitude_batch(const Eigen::MatrixXd& y,
+		    stan_pwa::resonance_list::soa_matrix& re,
+		    stan_pwa::resonance_list::soa_matrix& im)
+    {
+      stan_pwa::MyModel.amplitude_batch(y, re, im);
     }
 
 
@@ -50,6 +70,196 @@ namespace stan {
     }
 
 
+    template <typename T0, typename T1, typename T2>
+    typename boost::math::tools::promote_args<T0,T1,T2>::type
+    pwa_loglik(const std::vector<std::vector<Eigen::Matrix<T0, Eigen::Dynamic, 1> > >& A_r,
+	       const std::vector<Eigen::Matrix<T1, Eigen::Dynamic, 1> >& theta,
+	       const std::vector<Eigen::Matrix<T2, Eigen::Dynamic, Eigen::Dynamic> >& I) {
+      return stan_pwa::MyModel.pwa_loglik(A_r, theta, I);
+    }
+
+
+    template <typename T>
+    inline T
+    pwa_loglik_packed(const std::vector<Eigen::MatrixXd>& H,
+		      const std::vector<Eigen::Matrix<T, Eigen::Dynamic, 1> >& theta,
+		      const std::vector<Eigen::MatrixXd>& I) {
+      return stan_pwa::MyModel.pwa_loglik_packed(H, theta, I);
+    }
+
+
+    template <typename T>
+    inline T
+    pwa_loglik_threaded(const std::vector<std::vector<Eigen::VectorXd> >& A_r,
+			const std::vector<Eigen::Matrix<T, Eigen::Dynamic, 1> >& theta,
+			const std::vector<Eigen::MatrixXd>& I) {
+      return stan_pwa::MyModel.pwa_loglik_threaded(A_r, theta, I);
+    }
+
+
+    /**
+     * Checks the event store named by the environment variable name
+     * against the model: it must have num_resonances() amplitudes and
+     * the model hash.
+     */
+    inline const stan_pwa::io::mapped_event_store&
+    checked_event_store(const stan_pwa::io::mapped_event_store& store,
+			const char* name) {
+      if (store.num_res() != (size_t)stan_pwa::MyModel.get_num_res())
+	throw std::domain_error(std::string(name) + ": the event store has "
+				"another number of resonances");
+      if (store.model_hash() != stan_pwa::MyModel.hash())
+	throw std::domain_error(std::string(name) + ": the event store was "
+				"written for another model");
+      return store;
+    }
+
+    ///> Value of the environment variable name, default if it is not set
+    inline const char* env_or(const char* name, const char* path) {
+      const char* value = std::getenv(name);
+      return value != 0 ? value : path;
+    }
+
+
+    /**
+     * Measured events: the event store (see stan_pwa/src/io/event_store.hpp)
+     * named by the environment variable STAN_PWA_EVENT_STORE (default:
+     * amplitudes.pwa), mapped on the first call.
+     */
+    inline const stan_pwa::io::mapped_event_store&
+    event_store() {
+      static const stan_pwa::io::mapped_event_store
+	store(env_or("STAN_PWA_EVENT_STORE", "amplitudes.pwa"));
+      // Checked once (the model hash evaluates every resonance)
+      static const stan_pwa::io::mapped_event_store&
+	checked = checked_event_store(store, "STAN_PWA_EVENT_STORE");
+      return checked;
+    }
+
+
+    ///> Amplitudes of the measured events, mapped from the event store
+    inline const stan_pwa::likelihood::column_events&
+    mapped_amplitudes() {
+      static const stan_pwa::likelihood::column_events events(
+	event_store().size(), event_store().num_res(), event_store().re(0),
+	event_store().im(0));
+      return events;
+    }
+
+
+    /**
+     * Same as pwa_loglik_threaded, for the amplitudes in the event store
+     * (used in place, without parsing them as data).
+     */
+    template <typename T>
+    inline T
+    pwa_loglik_mapped(const std::vector<Eigen::Matrix<T, Eigen::Dynamic, 1> >& theta,
+		      const std::vector<Eigen::MatrixXd>& I) {
+      return stan_pwa::likelihood::pwa_loglik_columns(mapped_amplitudes(),
+						      theta, I);
+    }
+
+
+    ///> Events, normalization and sizes of the fit with MyFloating
+    typedef stan_pwa::likelihood::floating_fit<decltype(stan_pwa::MyFloating)>
+    my_floating_fit;
+
+    ///> Dalitz plot variables y.1, y.2 of an event store
+    inline const double*
+    store_variable(const stan_pwa::io::mapped_event_store& store, size_t v,
+		   const char* name) {
+      if (store.header().V < 2)
+	throw std::domain_error(std::string(name) + ": the event store has "
+				"no Dalitz plot variables");
+      return store.y(v);
+    }
+
+    /**
+     * Measured events with the floating resonances MyFloating (see
+     * model_inst.hpp): the events of the event store STAN_PWA_EVENT_STORE
+     * with the amplitudes of MyModel, and those of MyFloating for the
+     * last parameters.
+     */
+    inline my_floating_fit::events&
+    floating_events() {
+      static my_floating_fit::events events(
+	mapped_amplitudes(),
+	store_variable(event_store(), 0, "STAN_PWA_EVENT_STORE"),
+	store_variable(event_store(), 1, "STAN_PWA_EVENT_STORE"),
+	stan_pwa::MyModel.get_sym_flag(), stan_pwa::MyFloating);
+      return events;
+    }
+
+    /**
+     * Normalization integral with the floating resonances, on the points
+     * of the event store named by STAN_PWA_NORM_STORE (default:
+     * normalization.pwa), written by stan_pwa/tools/event_store.cpp for
+     * points uniformly distributed over a phase space of volume
+     * STAN_PWA_NORM_VOLUME (default: 1; it only shifts the
+     * log-likelihood by a constant).
+     */
+    inline my_floating_fit::norm&
+    floating_norm() {
+      static const stan_pwa::io::mapped_event_store
+	store(env_or("STAN_PWA_NORM_STORE", "normalization.pwa"));
+      // Checked once, as in event_store()
+      static const stan_pwa::io::mapped_event_store&
+	checked = checked_event_store(store, "STAN_PWA_NORM_STORE");
+      static my_floating_fit::norm I(
+	stan_pwa::likelihood::column_events(checked.size(), checked.num_res(),
+					    checked.re(0), checked.im(0)),
+	store_variable(checked, 0, "STAN_PWA_NORM_STORE"),
+	store_variable(checked, 1, "STAN_PWA_NORM_STORE"), 0,
+	std::atof(env_or("STAN_PWA_NORM_VOLUME", "1")) / checked.size(),
+	stan_pwa::MyModel.get_sym_flag(), stan_pwa::MyFloating);
+      return I;
+    }
+
+    /**
+     * Log-likelihood of the events of the event store with the floating
+     * resonances for the parameters p (see
+     * stan_pwa/src/likelihood/floating_norm.hpp); theta runs over the
+     * resonances of MyModel, then those of MyFloating.
+     */
+    template <typename T1, typename T2>
+    inline typename boost::math::tools::promote_args<T1,T2>::type
+    pwa_loglik_floating(const std::vector<Eigen::Matrix<T1, Eigen::Dynamic, 1> >& theta,
+			const Eigen::Matrix<T2, Eigen::Dynamic, 1>& p) {
+      return stan_pwa::likelihood::pwa_loglik_floating(floating_events(),
+						       floating_norm(),
+						       theta, p);
+    }
+
+    inline int num_floating_resonances() {
+      return my_floating_fit::num_res;
+    }
+
+    inline int num_floating_params() {
+      return my_floating_fit::num_params;
+    }
+
+
+    ///> Number of events in the event store
+    inline int num_mapped_events() {
+      return mapped_amplitudes().size();
+    }
+
+
+    ///> Fingerprint of the model, stored in the event store
+    inline uint64_t model_hash() {
+      return stan_pwa::MyModel.hash();
+    }
+
+
+    ///> Normalization integral of the model over the sample of the store
+    ///> (see stan_pwa/src/integrate/integral_store.hpp)
+    inline stan_pwa::integrate::normalization
+    stored_normalization_integral(stan_pwa::integrate::integral_store& store,
+				  double volume) {
+      return stan_pwa::MyModel.integral(store, volume);
+    }
+
+
     inline int num_resonances() {
       return stan_pwa::MyModel.get_num_res();
     }
@@ -1,4 +1,6 @@
+#include<algorithm> // copy
 #include<iostream>
+#include<stdexcept> // invalid_argument
 
 #include <boost/python/module.hpp>
 #include <boost/python/def.hpp>
@@ -44,13 +46,55 @@ namespace stan {
 	  std::cout << "Something's wrong here - dimension mismatch.";
 
         // Return a flatten version of res - an std::vector
-        std::vector<double> std_res(2*NUM_RES);
-        for (int i=0; i < NUM_RES ; i++) {
+        const int num_res = res[0].rows();
+        std::vector<double> std_res(2*num_res);
+        for (int i=0; i < num_res ; i++) {
 	  std_res[2*i] = res[0](i,0);
           std_res[2*i + 1] = res[1](i,0);
         }
         return std_res;
      }
+
+
+    /**
+     * vector _A_cv_batch_py_wrapper(y_len, list)
+     *
+     * Batch version of _A_cv_py_wrapper: the python list holds N events
+     * of y_len variables each (event after event). Returns the amplitudes
+     * as a structure of arrays, all real parts (resonance after
+     * resonance, N values each) followed by all imaginary parts.
+     * Raises ValueError unless y_len > 0 divides the length of the list.
+     */
+     inline
+     std::vector<double>
+     _A_cv_batch_py_wrapper(int y_len, boost::python::list mapping) {
+
+        // Raised as ValueError in python
+        const int len = boost::python::len(mapping);
+        if (y_len <= 0)
+          throw std::invalid_argument("A_cv_batch: the number of variables "
+                                      "per event must be positive");
+        if (len % y_len != 0)
+          throw std::invalid_argument("A_cv_batch: the length of the list "
+                                      "is not a multiple of the number of "
+                                      "variables per event");
+
+        const int N = len / y_len;
+        Eigen::MatrixXd y(N, y_len);
+        for (int n = 0; n < N; n++) {
+          for (int i = 0; i < y_len; i++)
+            y(n, i) = boost::python::extract<double>(mapping[n * y_len + i]);
+        }
+
+        stan_pwa::resonance_list::soa_matrix re, im;
+        amplitude_batch(y, re, im);
+
+        std::vector<double> std_res(re.size() + im.size());
+        std::copy(re.data(), re.data() + re.size(), std_res.begin());
+        std::copy(im.data(), im.data() + im.size(),
+                  std_res.begin() + re.size());
+        return std_res;
+     }
   }
 }
 
@@ -62,6 +106,7 @@ BOOST_PYTHON_MODULE(model)
         .def(vector_indexing_suite<std::vector<double> >() );
 
     def("A_cv", stan::math::_A_cv_py_wrapper, args("x","y"));
+    def("A_cv_batch", stan::math::_A_cv_batch_py_wrapper, args("x","y"));
     def("num_resonances", stan::math::num_resonances);
     def("num_variables", stan::math::num_variables);
 }
@@ -33,6 +33,6 @@ rm $MDECA_DIR/src/model_wrapper.hpp
 
 
 ln -s $MODEL_DIR/src/model_def.hpp $MDECA_DIR/src/model_def.hpp
-#ln -s $MODEL_DIR/src/model.cpp $MDECA_DIR/src/model.cpp
+ln -s $MODEL_DIR/src/model.cpp $MDECA_DIR/src/model.cpp
 ln -s $MODEL_DIR/src/model_inst.hpp $MDECA_DIR/src/model_inst.hpp
 ln -s $MODEL_DIR/src/model_wrapper.hpp $MDECA_DIR/src/model_wrapper.hpp
@@ -4,6 +4,7 @@
 #include <stan_pwa/src/complex/scalar.hpp>
 #include <stan_pwa/src/complex/vector.hpp>
 #include <stan_pwa/src/complex/matrix.hpp>
+#include <stan_pwa/src/complex/number.hpp>
 
 /*
  *  Introduce complex number operations in a STAN-friendly way.
@@ -33,8 +34,14 @@
  *    Since no new types/classes are really introduced, all distinction between
  *    complex objects is implemented via namespaces. 
  *
+ *    The one exception is complex::number<T> (see number.hpp), which is
+ *    never passed to STAN: it is used inside the form factors and
+ *    resonances to avoid a heap allocation for every temporary complex
+ *    number, and converted to a complex_scalar at the STAN boundary.
+ *
  *  FUNCTIONS
- *    Are currently listed in particular files - scalar.hpp, vector.hpp, matrix.hpp.
+ *    Are currently listed in particular files - scalar.hpp, vector.hpp, matrix.hpp,
+ *    number.hpp.
  */
 
 #endif
@@ -0,0 +1,260 @@
+#ifndef STAN_PWA__SRC__COMPLEX__NUMBER_HPP
+#define STAN_PWA__SRC__COMPLEX__NUMBER_HPP
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+#include <boost/math/tools/promotion.hpp>
+#include <boost/utility/enable_if.hpp>
+#include <vector>
+
+/*
+ *  Fixed-size complex value type for the internal computations.
+ *
+ *  DESCRIPTION
+ *    The STAN-facing complex scalar (see stan_pwa/src/complex.hpp) is a
+ *    std::vector<T> of length 2, i.e. every temporary complex number
+ *    costs one heap allocation. Inside the form factors and resonances we
+ *    do not need to talk to STAN, so there we use complex::number<T>
+ *    instead: two members of type T, no allocation, cheap to copy. T is
+ *    double or stan::math::var (or anything else supporting +,-,*,/).
+ *
+ *    Convert at the STAN boundary with to_vector / from_vector.
+ *
+ *  FUNCTIONS
+ *    number(re, im), operators +, -, *, / (number and real operands)
+ *    scalar abs2(number)
+ *    number conj(number)
+ *    number inverse(number)
+ *    complex_scalar to_vector(number)
+ *    number from_vector(complex_scalar)
+ */
+
+
+namespace stan_pwa {
+namespace complex {
+
+  /**
+   * Complex number z = re + i * im.
+   *
+   * @tparam T Scalar type
+   */
+  template <typename T>
+  struct number {
+    T re;
+    T im;
+
+    number() : re(0.0), im(0.0) {};
+    number(const T& _re) : re(_re), im(0.0) {};
+    number(const T& _re, const T& _im) : re(_re), im(_im) {};
+
+    ///> Promotion, e.g. number<double> -> number<var>
+    template <typename T1>
+    number(const number<T1>& z) : re(z.re), im(z.im) {};
+
+    template <typename T1>
+    number& operator+=(const number<T1>& z) {
+      re += z.re;
+      im += z.im;
+      return *this;
+    }
+
+    template <typename T1>
+    number& operator-=(const number<T1>& z) {
+      re -= z.re;
+      im -= z.im;
+      return *this;
+    }
+
+    template <typename T1>
+    number& operator*=(const number<T1>& z) {
+      T tmp = re * z.re - im * z.im;
+      im = im * z.re + re * z.im;
+      re = tmp;
+      return *this;
+    }
+  };
+
+
+  ///> Distinguishes complex numbers from real operands in the overloads below
+  template <typename T>
+  struct is_number { static const bool value = false; };
+
+  template <typename T>
+  struct is_number<number<T> > { static const bool value = true; };
+
+
+  /**
+   * Return type of a binary operation on complex numbers.
+   */
+  template <typename T0, typename T1>
+  struct number_promote {
+    typedef number<typename boost::math::tools::promote_args<T0,T1>::type> type;
+  };
+
+
+  // Complex (+-*/) complex
+
+  template <typename T0, typename T1>
+  inline typename number_promote<T0,T1>::type
+  operator+(const number<T0>& z1, const number<T1>& z2) {
+    return typename number_promote<T0,T1>::type(z1.re + z2.re, z1.im + z2.im);
+  }
+
+  template <typename T0, typename T1>
+  inline typename number_promote<T0,T1>::type
+  operator-(const number<T0>& z1, const number<T1>& z2) {
+    return typename number_promote<T0,T1>::type(z1.re - z2.re, z1.im - z2.im);
+  }
+
+  template <typename T0, typename T1>
+  inline typename number_promote<T0,T1>::type
+  operator*(const number<T0>& z1, const number<T1>& z2) {
+    return typename number_promote<T0,T1>::type(z1.re * z2.re - z1.im * z2.im,
+                                                z1.im * z2.re + z1.re * z2.im);
+  }
+
+  template <typename T0, typename T1>
+  inline typename number_promote<T0,T1>::type
+  operator/(const number<T0>& z1, const number<T1>& z2) {
+    typedef typename boost::math::tools::promote_args<T0,T1>::type T_res;
+    const T1 norm = z2.re * z2.re + z2.im * z2.im;
+    const T_res re = (z1.re * z2.re + z1.im * z2.im) / norm;
+    const T_res im = (z1.im * z2.re - z1.re * z2.im) / norm;
+    return number<T_res>(re, im);
+  }
+
+  template <typename T>
+  inline number<T>
+  operator-(const number<T>& z) {
+    return number<T>(-z.re, -z.im);
+  }
+
+
+  // Complex (+-*/) real, real (+-*) complex
+
+  template <typename T0, typename T1>
+  inline typename boost::disable_if_c<is_number<T1>::value,
+                                      typename number_promote<T0,T1>::type>::type
+  operator+(const number<T0>& z, const T1& x) {
+    return typename number_promote<T0,T1>::type(z.re + x, z.im);
+  }
+
+  template <typename T0, typename T1>
+  inline typename boost::disable_if_c<is_number<T0>::value,
+                                      typename number_promote<T0,T1>::type>::type
+  operator+(const T0& x, const number<T1>& z) {
+    return typename number_promote<T0,T1>::type(x + z.re, z.im);
+  }
+
+  template <typename T0, typename T1>
+  inline typename boost::disable_if_c<is_number<T1>::value,
+                                      typename number_promote<T0,T1>::type>::type
+  operator-(const number<T0>& z, const T1& x) {
+    return typename number_promote<T0,T1>::type(z.re - x, z.im);
+  }
+
+  template <typename T0, typename T1>
+  inline typename boost::disable_if_c<is_number<T0>::value,
+                                      typename number_promote<T0,T1>::type>::type
+  operator-(const T0& x, const number<T1>& z) {
+    return typename number_promote<T0,T1>::type(x - z.re, -z.im);
+  }
+
+  template <typename T0, typename T1>
+  inline typename boost::disable_if_c<is_number<T1>::value,
+                                      typename number_promote<T0,T1>::type>::type
+  operator*(const number<T0>& z, const T1& x) {
+    return typename number_promote<T0,T1>::type(z.re * x, z.im * x);
+  }
+
+  template <typename T0, typename T1>
+  inline typename boost::disable_if_c<is_number<T0>::value,
+                                      typename number_promote<T0,T1>::type>::type
+  operator*(const T0& x, const number<T1>& z) {
+    return typename number_promote<T0,T1>::type(x * z.re, x * z.im);
+  }
+
+  template <typename T0, typename T1>
+  inline typename boost::disable_if_c<is_number<T1>::value,
+                                      typename number_promote<T0,T1>::type>::type
+  operator/(const number<T0>& z, const T1& x) {
+    return typename number_promote<T0,T1>::type(z.re / x, z.im / x);
+  }
+
+
+  /**
+   * scalar abs2(number)
+   *
+   * Square magnitude of a complex number, re**2 + im**2.
+   *
+   * @tparam T Scalar type
+   */
+  template <typename T>
+  inline T
+  abs2(const number<T>& z) {
+    return z.re * z.re + z.im * z.im;
+  }
+
+
+  /**
+   * number conj(number)
+   *
+   * Complex conjugate.
+   *
+   * @tparam T Scalar type
+   */
+  template <typename T>
+  inline number<T>
+  conj(const number<T>& z) {
+    return number<T>(z.re, -z.im);
+  }
+
+
+  /**
+   * number inverse(number)
+   *
+   * Inverse of a complex number, 1/z.
+   *
+   * @tparam T Scalar type
+   */
+  template <typename T>
+  inline number<T>
+  inverse(const number<T>& z) {
+    const T norm = z.re * z.re + z.im * z.im;
+    return number<T>(z.re / norm, -z.im / norm);
+  }
+
+
+  /**
+   * complex_scalar to_vector(number)
+   *
+   * Adapter to the STAN representation of a complex scalar.
+   *
+   * @tparam T Scalar type
+   */
+  template <typename T>
+  inline std::vector<T>
+  to_vector(const number<T>& z) {
+    std::vector<T> res(2);
+    res[0] = z.re;
+    res[1] = z.im;
+    return res;
+  }
+
+
+  /**
+   * number from_vector(complex_scalar)
+   *
+   * Adapter from the STAN representation of a complex scalar.
+   *
+   * @tparam T Scalar type
+   */
+  template <typename T>
+  inline number<T>
+  from_vector(const std::vector<T>& v) {
+    return number<T>(v[0], v[1]);
+  }
+
+}
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef STAN_PWA__SRC__DIAGNOSTICS_HPP
+#define STAN_PWA__SRC__DIAGNOSTICS_HPP
+
+#include <stan_pwa/src/diagnostics/chain.hpp>
+#include <stan_pwa/src/diagnostics/convergence.hpp>
+#include <stan_pwa/src/diagnostics/fft.hpp>
+
+/*
+ *  Convergence diagnostics of MCMC chains, computed in one pass.
+ *
+ *  DESCRIPTION
+ *    chain_stats collects the draws of one parameter of one chain as they
+ *    are read, without storing them: mean and variance of the chain and
+ *    of its halves (Welford), and the autocovariances up to a maximal
+ *    lag, by FFT correlation of chunks of draws. The memory is
+ *    O(max_lag + chunk) per parameter and chain, independent of the
+ *    length of the chain.
+ *
+ *    split_rhat and ess combine the statistics of several chains to the
+ *    split potential scale reduction factor and the effective sample
+ *    size as reported by CmdStan's stansummary. Used by
+ *    tools/merge_chains.cpp.
+ *
+ *  FUNCTIONS
+ *    Are currently listed in particular files - chain.hpp, convergence.hpp,
+ *    fft.hpp.
+ */
+
+#endif
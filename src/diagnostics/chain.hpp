@@ -0,0 +1,223 @@
+#ifndef STAN_PWA__SRC__DIAGNOSTICS__CHAIN_HPP
+#define STAN_PWA__SRC__DIAGNOSTICS__CHAIN_HPP
+
+#include <algorithm> // min
+#include <complex>
+#include <cstddef> // size_t
+#include <vector>
+
+#include <stan_pwa/src/diagnostics/fft.hpp>
+
+/*
+ *  Streaming statistics of one parameter in one chain.
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/diagnostics.hpp
+ *
+ *  FUNCTIONS
+ *    void moments::add(x)
+ *    void moments::add(moments)
+ *    void chain_stats::add(x, n)
+ *    moments chain_stats::half(i)
+ *    vector<double> chain_stats::autocovariance()
+ */
+
+namespace stan_pwa {
+namespace diagnostics {
+
+  /**
+   * Count, mean and sum of squared deviations (Welford), mergeable
+   * (Chan et al.).
+   */
+  struct moments {
+    double n;
+    double mean;
+    double m2;
+
+    moments() : n(0), mean(0), m2(0) {};
+
+    void add(double x) {
+      n += 1;
+      const double delta = x - mean;
+      mean += delta / n;
+      m2 += delta * (x - mean);
+    }
+
+    void add(const moments& other) {
+      if (other.n == 0)
+        return;
+      const double total = n + other.n;
+      const double delta = other.mean - mean;
+      mean += delta * other.n / total;
+      m2 += other.m2 + delta * delta * n * other.n / total;
+      n = total;
+    }
+
+    ///> Sample variance (n - 1 in the denominator)
+    double variance() const { return n > 1 ? m2 / (n - 1) : 0.0; }
+  };
+
+
+  /**
+   * Statistics of the draws of one parameter in one chain, updated
+   * chunk by chunk in one pass:
+   *
+   *  - the moments of blocks of draws, to split the chain into halves at
+   *    the end (split R-hat) at the block boundary closest to the
+   *    middle. There are at most 2 max_blocks blocks: when they are
+   *    full, neighbouring blocks are merged and the block size doubles,
+   *    so the split is off the middle by at most n / (2 max_blocks);
+   *
+   *  - the autocovariances for the lags 0 .. max_lag. The lagged
+   *    products sum_t y_t y_{t-k} are accumulated for every chunk of
+   *    fft_chunk draws and the max_lag draws before it by one FFT
+   *    correlation; only the first and the last max_lag draws are kept
+   *    besides the current chunk. The draws are shifted by the first one
+   *    against cancellation.
+   */
+  class chain_stats {
+  public:
+    ///> Number of blocks of the split, see above
+    static const size_t max_blocks = 1024;
+
+    explicit chain_stats(size_t max_lag, size_t fft_chunk = 4096) :
+      L_(max_lag), B_(std::max(fft_chunk, max_lag)),
+      N_(fft_size(L_ + B_)), n_(0), shift_(0), total_(0),
+      prod_(L_ + 1, 0.0), window_(L_, 0.0), block_size_(1) {};
+
+    ///> Adds n draws
+    void add(const double* x, size_t n) {
+      for (size_t i = 0; i < n; i++) {
+        if (n_ == 0)
+          shift_ = x[i];
+        const double y = x[i] - shift_;
+
+        if (blocks_.empty() || blocks_.back().n == block_size_)
+          new_block();
+        blocks_.back().add(x[i]);
+
+        if (head_.size() < L_)
+          head_.push_back(y);
+        total_ += y;
+        chunk_.push_back(y);
+        n_++;
+        if (chunk_.size() == B_)
+          flush();
+      }
+    }
+
+    ///> Number of draws
+    size_t size() const { return n_; }
+
+    ///> Moments of all draws
+    moments all() const {
+      moments res;
+      for (size_t b = 0; b < blocks_.size(); b++)
+        res.add(blocks_[b]);
+      return res;
+    }
+
+    ///> Moments of the first (i = 0) or second (i = 1) half
+    moments half(int i) const {
+      size_t split = 0;
+      double count = 0;
+      for (; split < blocks_.size(); split++) {
+        if (2 * (count + blocks_[split].n / 2) > n_)
+          break;
+        count += blocks_[split].n;
+      }
+      moments res;
+      for (size_t b = (i == 0 ? 0 : split);
+           b < (i == 0 ? split : blocks_.size()); b++)
+        res.add(blocks_[b]);
+      return res;
+    }
+
+    /**
+     * Autocovariances (1/n) sum_t (x_t - mean)(x_{t+k} - mean) for
+     * k = 0 .. min(max_lag, n - 1).
+     */
+    std::vector<double> autocovariance() {
+      flush();
+      const size_t K = n_ == 0 ? 0 : std::min(L_, n_ - 1) + 1;
+      const double mu = n_ > 0 ? total_ / n_ : 0.0;
+
+      // Sums of the first k and of the last k (shifted) draws
+      std::vector<double> res(K);
+      double first = 0;
+      double last = 0;
+      for (size_t k = 0; k < K; k++) {
+        if (k > 0) {
+          first += head_[k - 1];
+          last += window_[L_ - k];
+        }
+        const double a = total_ - last;  // sum_{t < n - k} y_t
+        const double b = total_ - first; // sum_{t >= k} y_t
+        res[k] = (prod_[k] - mu * (a + b) + (n_ - k) * mu * mu) / n_;
+      }
+      return res;
+    }
+
+  private:
+    ///> Starts a block, merging pairs of blocks if there are too many
+    void new_block() {
+      if (blocks_.size() == 2 * max_blocks) {
+        for (size_t b = 0; b < max_blocks; b++) {
+          blocks_[b] = blocks_[2 * b];
+          blocks_[b].add(blocks_[2 * b + 1]);
+        }
+        blocks_.resize(max_blocks);
+        block_size_ *= 2;
+      }
+      blocks_.push_back(moments());
+    }
+
+    ///> Adds the lagged products of the current chunk
+    void flush() {
+      const size_t b = chunk_.size();
+      if (b == 0)
+        return;
+
+      // r[m] = sum_t a[t] z[t + m], z = (window, chunk); lag k = L - m
+      std::vector<std::complex<double> > a(N_), z(N_);
+      for (size_t t = 0; t < b; t++)
+        a[t] = chunk_[t];
+      for (size_t t = 0; t < L_; t++)
+        z[t] = window_[t];
+      for (size_t t = 0; t < b; t++)
+        z[L_ + t] = chunk_[t];
+      fft(a, false);
+      fft(z, false);
+      for (size_t i = 0; i < N_; i++)
+        z[i] *= std::conj(a[i]);
+      fft(z, true);
+      for (size_t k = 0; k <= L_; k++)
+        prod_[k] += z[L_ - k].real();
+
+      // The last L draws, for the next chunk and the mean correction
+      std::vector<double> w(L_);
+      for (size_t t = 0; t < L_; t++) {
+        const size_t j = t + b; // index in (window, chunk)
+        w[t] = j < L_ ? window_[j] : chunk_[j - L_];
+      }
+      window_.swap(w);
+      chunk_.clear();
+    }
+
+    size_t L_;
+    size_t B_;
+    size_t N_;
+    size_t n_;
+    double shift_;
+    double total_;                ///> Sum of the shifted draws
+    std::vector<double> prod_;    ///> sum_t y_t y_{t-k}, k = 0 .. L
+    std::vector<double> head_;    ///> First L shifted draws
+    std::vector<double> window_;  ///> Last L shifted draws before chunk_
+    std::vector<double> chunk_;
+    std::vector<moments> blocks_;
+    double block_size_;
+  };
+
+}
+}
+#endif
@@ -0,0 +1,135 @@
+#ifndef STAN_PWA__SRC__DIAGNOSTICS__CONVERGENCE_HPP
+#define STAN_PWA__SRC__DIAGNOSTICS__CONVERGENCE_HPP
+
+#include <algorithm> // min
+#include <cmath> // sqrt
+#include <cstddef> // size_t
+#include <limits>
+#include <vector>
+
+#include <stan_pwa/src/diagnostics/chain.hpp>
+
+/*
+ *  Convergence diagnostics of several chains.
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/diagnostics.hpp
+ *
+ *  FUNCTIONS
+ *    double split_rhat(chains)
+ *    effective_sample_size ess(chains)
+ */
+
+namespace stan_pwa {
+namespace diagnostics {
+
+  /**
+   * double split_rhat(chains)
+   *
+   * Potential scale reduction factor of the chains split into halves
+   * (Gelman et al., BDA3): sqrt(var_plus / W) with the mean W of the
+   * variances of the halves, B / n the variance of their means and
+   * var_plus = (n - 1) / n W + B / n, n the length of the shortest half.
+   * NaN if there are less than 4 draws per chain.
+   */
+  inline double
+  split_rhat(const std::vector<chain_stats>& chains) {
+    std::vector<moments> halves;
+    for (size_t c = 0; c < chains.size(); c++) {
+      halves.push_back(chains[c].half(0));
+      halves.push_back(chains[c].half(1));
+    }
+
+    double n = std::numeric_limits<double>::infinity();
+    moments means;
+    double W = 0;
+    for (size_t h = 0; h < halves.size(); h++) {
+      n = std::min(n, halves[h].n);
+      means.add(halves[h].mean);
+      W += halves[h].variance() / halves.size();
+    }
+    if (halves.empty() || n < 2 || W <= 0)
+      return std::numeric_limits<double>::quiet_NaN();
+
+    const double B = n * means.variance();
+    const double var_plus = (n - 1) / n * W + B / n;
+    return std::sqrt(var_plus / W);
+  }
+
+
+  ///> Effective sample size; truncated if the autocorrelations were
+  ///> still positive at max_lag (shorter than the chains)
+  struct effective_sample_size {
+    double value;
+    bool truncated;
+  };
+
+
+  /**
+   * effective_sample_size ess(chains)
+   *
+   * Effective sample size of the chains as in Stan: with the per-chain
+   * autocovariances acov_m(t), the combined autocorrelations
+   *
+   *   rho(t) = 1 - (W - mean_m acov_m(t)) / var_plus
+   *
+   * are summed by Geyer's initial monotone sequence (pairs
+   * rho(2k) + rho(2k+1) while positive, made non-increasing), and
+   * ESS = M n / (-1 + 2 sum), n the length of the shortest chain.
+   */
+  inline effective_sample_size
+  ess(std::vector<chain_stats>& chains) {
+    const size_t M = chains.size();
+    effective_sample_size res = {std::numeric_limits<double>::quiet_NaN(),
+                                 false};
+    if (M == 0)
+      return res;
+
+    std::vector<std::vector<double> > acov(M);
+    size_t n = chains[0].size();
+    size_t K = std::numeric_limits<size_t>::max();
+    moments means;
+    double W = 0;
+    for (size_t m = 0; m < M; m++) {
+      acov[m] = chains[m].autocovariance();
+      n = std::min(n, chains[m].size());
+      K = std::min(K, acov[m].size());
+      const moments all = chains[m].all();
+      means.add(all.mean);
+      W += all.variance() / M;
+    }
+    if (n < 4 || W <= 0)
+      return res;
+
+    const double var_plus = W * (n - 1) / n + (M > 1 ? means.variance() : 0);
+    std::vector<double> rho(K);
+    for (size_t t = 0; t < K; t++) {
+      double mean_acov = 0;
+      for (size_t m = 0; m < M; m++)
+        mean_acov += acov[m][t] / M;
+      rho[t] = 1 - (W - mean_acov) / var_plus;
+    }
+    rho[0] = 1;
+
+    // Initial positive and monotone sequence of pairs
+    double sum = 0;
+    double previous = std::numeric_limits<double>::infinity();
+    size_t t = 0;
+    for (; t + 1 < K; t += 2) {
+      double pair = rho[t] + rho[t + 1];
+      if (pair < 0)
+        break;
+      pair = std::min(pair, previous);
+      sum += pair;
+      previous = pair;
+    }
+    res.truncated = (t + 1 >= K && K < n);
+
+    const double tau = -1 + 2 * sum;
+    res.value = M * n / std::max(tau, 1.0 / std::log10((double)M * n));
+    return res;
+  }
+
+}
+}
+#endif
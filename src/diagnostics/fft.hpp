@@ -0,0 +1,83 @@
+#ifndef STAN_PWA__SRC__DIAGNOSTICS__FFT_HPP
+#define STAN_PWA__SRC__DIAGNOSTICS__FFT_HPP
+
+#include <cmath> // cos, sin
+#include <complex>
+#include <cstddef> // size_t
+#include <utility> // swap
+#include <vector>
+
+/*
+ *  Fast Fourier transform.
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/diagnostics.hpp
+ *
+ *  FUNCTIONS
+ *    size_t fft_size(n)
+ *    void fft(a, inverse)
+ */
+
+namespace stan_pwa {
+namespace diagnostics {
+
+  ///> Smallest power of 2 >= n
+  inline size_t
+  fft_size(size_t n) {
+    size_t N = 1;
+    while (N < n)
+      N *= 2;
+    return N;
+  }
+
+
+  /**
+   * void fft(a, inverse)
+   *
+   * In-place radix-2 FFT of a (size a power of 2):
+   * a_k <- sum_j a_j exp(-+ 2 pi i j k / N); the inverse transform is
+   * divided by N.
+   */
+  inline void
+  fft(std::vector<std::complex<double> >& a, bool inverse) {
+    const size_t N = a.size();
+
+    // Bit-reversal permutation
+    for (size_t i = 1, j = 0; i < N; i++) {
+      size_t bit = N >> 1;
+      for (; j & bit; bit >>= 1)
+        j ^= bit;
+      j ^= bit;
+      if (i < j)
+        std::swap(a[i], a[j]);
+    }
+
+    // Roots of unity, computed directly (not by repeated products)
+    const double pi = 3.14159265358979323846;
+    std::vector<std::complex<double> > w(N / 2);
+    for (size_t k = 0; k < N / 2; k++) {
+      const double angle = (inverse ? 2 : -2) * pi * k / N;
+      w[k] = std::complex<double>(std::cos(angle), std::sin(angle));
+    }
+
+    for (size_t len = 2; len <= N; len *= 2) {
+      const size_t step = N / len;
+      for (size_t i = 0; i < N; i += len) {
+        for (size_t j = 0; j < len / 2; j++) {
+          const std::complex<double> u = a[i + j];
+          const std::complex<double> v = a[i + j + len / 2] * w[j * step];
+          a[i + j] = u + v;
+          a[i + j + len / 2] = u - v;
+        }
+      }
+    }
+
+    if (inverse) {
+      for (size_t i = 0; i < N; i++)
+        a[i] /= (double)N;
+    }
+  }
+
+}
+}
+#endif
@@ -53,8 +53,8 @@ namespace stan_pwa {
 							 m2_ab, this->a_.m, 
 							 this->b_.m);
 
-	std::vector<T> T_R = mfct::breit_wigner::value(this->R_.m,
-						       m2_ab, width);
+	std::vector<T> T_R = mc::to_vector(mfct::breit_wigner::value(this->R_.m,
+						       m2_ab, width));
 	// If the parent particle does not have spin 0, some adjustments
 	// must be performed in this Zemach function (use angular orbital
 	// momentum between P and R instead of R.J)
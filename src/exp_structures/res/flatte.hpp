@@ -47,8 +47,8 @@ namespace resonances {
 	  mfct::blatt_weisskopf(this->R.J, this->R.r2,
 				this->R.m2, this->a.m, this->b.m);
 
-	std::vector<T> T_R = mfct::flatte::value(this->R.m, m2_ab,
-						 this->G_pp, this->G_kk);
+	std::vector<T> T_R = mc::to_vector(mfct::flatte::value(this->R.m, m2_ab,
+						 this->G_pp, this->G_kk));
         T Z = mfct::zemach(this->R.J, m2_ab, m2_bc, 
 			   this->P.m, this->a, this->b, this->c);
 
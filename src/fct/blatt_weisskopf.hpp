@@ -9,6 +9,48 @@
 namespace stan_pwa {
 namespace fct {
 
+  /**
+   * Return Blatt-Weisskopf form factor for a given squared breakup
+   * momentum (e.g. taken from resonances::kinematics_3).
+   *
+   * @param J_R resonance spin
+   * @param r2_P parent Particle squared radius
+   * @param p2 squared breakup momentum
+   * @return Blatt-Weisskopf form factor
+   */
+  template <typename T>
+  inline T
+  blatt_weisskopf_p2(int J_R, double r2_P, const T& p2) {
+
+    if (J_R == 0 or J_R > 2) return 1;
+
+    const T z = p2 * r2_P;
+    if (J_R == 1) {
+      return sqrt(1.0 / (1.0 + z));
+    }
+    return sqrt(1.0 / (9.0 + 3.0 * z + z * z));
+  }
+
+
+  /**
+   * Return the logarithmic derivative d log(B) / d p2 of the
+   * Blatt-Weisskopf form factor B = blatt_weisskopf_p2(J_R, r2_P, p2).
+   *
+   * @param J_R resonance spin
+   * @param r2_P parent Particle squared radius
+   * @param p2 squared breakup momentum
+   */
+  inline double
+  blatt_weisskopf_dlog_dp2(int J_R, double r2_P, double p2) {
+    if (J_R == 0 or J_R > 2) return 0;
+    const double z = p2 * r2_P;
+    if (J_R == 1) {
+      return -0.5 * r2_P / (1.0 + z);
+    }
+    return -0.5 * r2_P * (3.0 + 2.0 * z) / (9.0 + 3.0 * z + z * z);
+  }
+
+
   /**
    * Return floating-point Blatt-Weisskopf form factor.
    *
@@ -29,17 +71,8 @@ namespace fct {
 
     if (J_R == 0 or J_R > 2) return 1;
 
-    typedef typename boost::math::tools::promote_args<T0,T1,T2>::type T;
-
-    T p2 = fct::breakup_momentum::p2(m2_ab, m_a, m_b) * r2_P;
-    if (J_R == 1) {
-      return sqrt(1.0 / (1.0 + p2));
-    }
-    if (J_R == 2) {
-      return sqrt(1.0 / (9.0 + 3.0 * p2 + p2 * p2));
-    }
-
-    return 0;
+    return blatt_weisskopf_p2(J_R, r2_P,
+                              fct::breakup_momentum::p2(m2_ab, m_a, m_b));
   }
 
 }
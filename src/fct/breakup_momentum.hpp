@@ -37,6 +37,8 @@ namespace fct {
     /**
      * Return complex breakup momentum.
      *
+     * Below threshold (p2 < 0) the momentum is purely imaginary.
+     *
      * @param m2_R decaying Particle squared mass
      * @param m_a 1st daughter mass
      * @param m_b 2nd daughter mass
@@ -44,20 +46,16 @@ namespace fct {
      */
     template <typename T0, typename T1, typename T2>
     inline
-    std::vector<typename boost::math::tools::promote_args<T0,T1,T2>::type>
+    mc::number<typename boost::math::tools::promote_args<T0,T1,T2>::type>
     complex_p(const T0& m2_R, const T1& m_a, const T2& m_b) {
 
       typedef typename boost::math::tools::promote_args<T0,T1,T2>::type T_res;
 
       T_res p2 = stan_pwa::fct::breakup_momentum::p2(m2_R, m_a, m_b);
-      std::vector<T_res> res(2);      
 
       if (p2 >= 0)
-        res = mc::scalar::complex(sqrt(p2), 0.);
-      else
-        res = mc::scalar::complex(0., sqrt(-p2));
-
-      return res;
+        return mc::number<T_res>(sqrt(p2), 0.0);
+      return mc::number<T_res>(0.0, sqrt(-p2));
     }
 
 
@@ -85,6 +83,33 @@ namespace fct {
     }
 
 
+    /**
+     * Return the derivative of the squared breakup momentum p2(m2_R,
+     * m_a, m_b) w.r.t. m2_R.
+     */
+    inline double
+    dp2_dm2_R(double m2_R, double m_a, double m_b) {
+      if (m_a == m_b) {
+        return 0.25;
+      }
+      const double s_plus = (m_a + m_b) * (m_a + m_b);
+      const double s_minus = (m_a - m_b) * (m_a - m_b);
+      return ((m2_R - s_plus) + (m2_R - s_minus)) / m2_R / 4.0
+        - p2(m2_R, m_a, m_b) / m2_R;
+    }
+
+
+    /**
+     * Return the derivative of the squared breakup momentum p2(m2_R,
+     * m_a, m_b) w.r.t. the daughter mass m_a (m_b fixed).
+     */
+    inline double
+    dp2_dm_a(double m2_R, double m_a, double m_b) {
+      return -((m_a + m_b) * (m2_R - (m_a - m_b) * (m_a - m_b)) +
+               (m_a - m_b) * (m2_R - (m_a + m_b) * (m_a + m_b))) / m2_R / 2.0;
+    }
+
+
 
   }
 }
@@ -23,15 +23,14 @@ namespace fct {
      * @return Breit-Wigner dynamical form factor
      */
     template <typename T0, typename T1, typename T2>
-    std::vector<typename boost::math::tools::promote_args<T0,T1,T2>::type>
+    inline
+    mc::number<typename boost::math::tools::promote_args<T0,T1,T2>::type>
     value(const T0& M_R, const T1& m2_ab, const T2& width_m2_ab) {
 
       typedef typename boost::math::tools::promote_args<T0,T1,T2>::type T_res;
 
-      std::vector<T_res> res(2);
-      res = mc::scalar::complex(M_R * M_R - m2_ab, - M_R * width_m2_ab);
-      return mc::scalar::inverse(res);
-
+      return mc::inverse(mc::number<T_res>(M_R * M_R - m2_ab,
+                                           - M_R * width_m2_ab));
     }
 
 
@@ -64,6 +63,47 @@ namespace fct {
     }
 
 
+    /**
+     * Constants of the relativistic width of a resonance R -> ab, which
+     * do not depend on the event: the squared breakup momentum and the
+     * Blatt-Weisskopf form factor at m2_ab = M_R**2. Computed once, in
+     * the constructor of a resonance.
+     */
+    struct width_constants {
+      double M_R; // Resonance mass
+      double W_R; // Resonance width
+      int J_R; // Resonance spin
+      double r2_R; // Resonance squared radius
+      double p2_R; // Squared breakup momentum at M_R**2
+      double F_R; // Blatt-Weisskopf form factor at M_R**2
+
+      width_constants(double _M_R, double _W_R, int _J_R, double r_R,
+                      double m_a, double m_b) :
+        M_R(_M_R), W_R(_W_R), J_R(_J_R), r2_R(r_R * r_R),
+        p2_R(mfct::breakup_momentum::p2(_M_R * _M_R, m_a, m_b)),
+        F_R(mfct::blatt_weisskopf_p2(_J_R, r_R * r_R, p2_R)) {};
+    };
+
+
+    /**
+     * Return Relativistic Breit Wigner resonance width, as above, for
+     * given m_ab = sqrt(m2_ab) and squared breakup momentum p2_ab
+     * (e.g. taken from resonances::kinematics_3). Only the terms that
+     * depend on m_ab are evaluated.
+     *
+     * @param R constants of the resonance
+     * @param m_ab Dalitz plot variable, sqrt(m2_ab)
+     * @param p2_ab squared breakup momentum at m2_ab
+     */
+    template <typename T>
+    inline T
+    relativistic_width(const width_constants& R,
+                       const T& m_ab, const T& p2_ab) {
+      const T F = mfct::blatt_weisskopf_p2(R.J_R, R.r2_R, p2_ab) / R.F_R;
+      return R.W_R * R.M_R / m_ab * pow(p2_ab / R.p2_R, R.J_R + 0.5) * F * F;
+    }
+
+
   }
 }
 }
@@ -28,30 +28,21 @@ namespace fct {
      * @return Flatte dynamical form factor
      */
     template <typename T0, typename T1, typename T2, typename T3>
-    std::vector<typename boost::math::tools::promote_args<T0,T1,T2,T3>::type>
+    inline
+    mc::number<typename boost::math::tools::promote_args<T0,T1,T2,T3>::type>
     value(const T0& M_R, const T1& m2_ab, const T2& gpp, const T3& gkk) {
 
       typedef typename boost::math::tools::promote_args<T0,T1,T2,T3>::type T_res;
-      std::vector<T_res> pp(2);
-      std::vector<T_res> kk(2);
-      std::vector<T_res> temp(2);
-
-      pp = mc::scalar::mult(mc::scalar::complex(gpp * gpp, 0.0),
-             mfct::breakup_momentum::complex_p(m2_ab, particles::pi.m, 
-					      particles::pi.m));
-
-      kk = mc::scalar::mult(mc::scalar::complex(gkk * gkk, 0.0),
-             mfct::breakup_momentum::complex_p(m2_ab, particles::k.m,
-					      particles::k.m));
-     
-      temp = mc::scalar::mult(mc::scalar::complex(0.0, 1.0), 
-				   mc::scalar::add(pp,kk));
-
-      return mc::scalar::inverse(
-        mc::scalar::subtract(
-	mc::scalar::complex(M_R*M_R - m2_ab, 0.0), 
-	mc::scalar::mult(mc::scalar::complex(2. / sqrt(m2_ab),0.0),
-			      temp)));
+
+      // i * (gpp**2 * p_pipi + gkk**2 * p_KK)
+      const mc::number<T_res> g =
+        gpp * gpp * mfct::breakup_momentum::complex_p(m2_ab, particles::pi.m,
+                                                      particles::pi.m) +
+        gkk * gkk * mfct::breakup_momentum::complex_p(m2_ab, particles::k.m,
+                                                      particles::k.m);
+      const mc::number<T_res> temp(-g.im, g.re);
+
+      return mc::inverse((M_R * M_R - m2_ab) - (2. / sqrt(m2_ab)) * temp);
     }
   }
 }
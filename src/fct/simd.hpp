@@ -0,0 +1,120 @@
+#ifndef STAN_PWA__SRC__FCT__SIMD_HPP
+#define STAN_PWA__SRC__FCT__SIMD_HPP
+
+#include <cstddef> // size_t
+
+#include <stan_pwa/src/fct/breit_wigner.hpp> // width_constants
+#include <stan_pwa/src/fct/simd/dispatch.hpp>
+#include <stan_pwa/src/fct/simd/scalar.hpp>
+#include <stan_pwa/src/fct/simd/avx2.hpp>
+#include <stan_pwa/src/fct/simd/avx512.hpp>
+
+/*
+ *  Vectorized line shapes for arrays of events (double precision).
+ *
+ *  DESCRIPTION
+ *    Same as blatt_weisskopf_p2, breit_wigner::relativistic_width,
+ *    breit_wigner::value and flatte::value, for N events at once, with
+ *    the inputs and outputs as contiguous arrays (e.g. the rows of
+ *    resonance_list::amplitude_batch).
+ *
+ *    The kernels are written once (simd/kernels.hpp) for a pack of
+ *    doubles and compiled for AVX-512 (8 events per pack), AVX2 (4) and
+ *    plain scalar code (1). The instruction set is chosen at run time
+ *    from the CPU, so the binary does not need -mavx2 and still runs on
+ *    older CPUs; STAN_PWA_SIMD=scalar|avx2|avx512 selects a lower one,
+ *    and STAN_PWA_NO_SIMD (at compile time) keeps the scalar kernels
+ *    only.
+ *
+ *    The spin only depends on the resonance, so it is tested once per
+ *    call; the loops over the events are branch-free. Below threshold
+ *    (p2 < 0) the lanes are selected with masks: the breakup momentum of
+ *    flatte becomes imaginary and the relativistic width is 0.
+ *
+ *    The powers (p2 / p2_R)**(J + 1/2) are evaluated as products and a
+ *    square root instead of pow(), so results may differ from the scalar
+ *    templates in the last bits; all instruction sets give the same
+ *    results.
+ *
+ *  FUNCTIONS
+ *    void blatt_weisskopf_p2(J_R, r2, p2, out, N, isa)
+ *    void relativistic_width(R, m_ab, p2_ab, out, N, isa)
+ *    void breit_wigner_value(M_R, m2_ab, width, re, im, N, isa)
+ *    void flatte_value(M_R, gpp, gkk, m2_ab, re, im, N, isa)
+ */
+
+#ifdef STAN_PWA_SIMD_X86
+#define STAN_PWA_SIMD_DISPATCH(isa, call)                 \
+  switch (isa) {                                          \
+  case isa_avx512: avx512_kernels::call; break;           \
+  case isa_avx2: avx2_kernels::call; break;               \
+  default: scalar_kernels::call;                          \
+  }
+#else
+#define STAN_PWA_SIMD_DISPATCH(isa, call) scalar_kernels::call;
+#endif
+
+namespace stan_pwa {
+namespace fct {
+namespace simd {
+
+  /**
+   * void blatt_weisskopf_p2(J_R, r2, p2, out, N, isa)
+   *
+   * out[n] = fct::blatt_weisskopf_p2(J_R, r2, p2[n]), n < N.
+   */
+  inline void
+  blatt_weisskopf_p2(int J_R, double r2, const double* p2, double* out,
+                     size_t N, instruction_set isa = active_isa()) {
+    STAN_PWA_SIMD_DISPATCH(isa, blatt_weisskopf_p2(J_R, r2, p2, out, N));
+  }
+
+
+  /**
+   * void relativistic_width(R, m_ab, p2_ab, out, N, isa)
+   *
+   * out[n] = breit_wigner::relativistic_width(R, m_ab[n], p2_ab[n]),
+   * or 0 if p2_ab[n] < 0.
+   */
+  inline void
+  relativistic_width(const breit_wigner::width_constants& R,
+                     const double* m_ab, const double* p2_ab, double* out,
+                     size_t N, instruction_set isa = active_isa()) {
+    STAN_PWA_SIMD_DISPATCH(isa, relativistic_width(R, m_ab, p2_ab, out, N));
+  }
+
+
+  /**
+   * void breit_wigner_value(M_R, m2_ab, width, re, im, N, isa)
+   *
+   * (re[n], im[n]) = breit_wigner::value(M_R, m2_ab[n], width[n]).
+   */
+  inline void
+  breit_wigner_value(double M_R, const double* m2_ab, const double* width,
+                     double* re, double* im, size_t N,
+                     instruction_set isa = active_isa()) {
+    STAN_PWA_SIMD_DISPATCH(isa, breit_wigner_value(M_R, m2_ab, width,
+                                                   re, im, N));
+  }
+
+
+  /**
+   * void flatte_value(M_R, gpp, gkk, m2_ab, re, im, N, isa)
+   *
+   * (re[n], im[n]) = flatte::value(M_R, m2_ab[n], gpp, gkk).
+   */
+  inline void
+  flatte_value(double M_R, double gpp, double gkk, const double* m2_ab,
+               double* re, double* im, size_t N,
+               instruction_set isa = active_isa()) {
+    STAN_PWA_SIMD_DISPATCH(isa, flatte_value(M_R, gpp, gkk, m2_ab,
+                                             re, im, N));
+  }
+
+}
+}
+}
+
+#undef STAN_PWA_SIMD_DISPATCH
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef STAN_PWA__SRC__FCT__SIMD__AVX2_HPP
+#define STAN_PWA__SRC__FCT__SIMD__AVX2_HPP
+
+#include <stan_pwa/src/fct/simd/dispatch.hpp> // STAN_PWA_SIMD_X86
+
+#ifdef STAN_PWA_SIMD_X86
+
+#include <cstddef> // size_t
+#include <immintrin.h>
+
+#include <stan_pwa/src/fct/breit_wigner.hpp> // width_constants
+#include <stan_pwa/src/flat_structures/particles.hpp> // particles::pi, k
+
+/*
+ *  Line-shape kernels, 4 events at a time (AVX2).
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/fct/simd.hpp. Compiled for AVX2 regardless of the
+ *    compiler flags; only called if the CPU supports it.
+ */
+
+// No contraction to FMA, so that all instruction sets give the same results
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#pragma STDC FP_CONTRACT OFF
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace stan_pwa {
+namespace fct {
+namespace simd {
+namespace avx2_kernels {
+
+  struct vec { __m256d v; };
+  struct mask { __m256d m; };
+  const size_t lanes = 4;
+
+  inline vec load(const double* p) { vec r = {_mm256_loadu_pd(p)}; return r; }
+  inline void store(double* p, const vec& a) { _mm256_storeu_pd(p, a.v); }
+  inline vec broadcast(double x) { vec r = {_mm256_set1_pd(x)}; return r; }
+
+  inline vec operator+(const vec& a, const vec& b) {
+    vec r = {_mm256_add_pd(a.v, b.v)}; return r;
+  }
+  inline vec operator-(const vec& a, const vec& b) {
+    vec r = {_mm256_sub_pd(a.v, b.v)}; return r;
+  }
+  inline vec operator*(const vec& a, const vec& b) {
+    vec r = {_mm256_mul_pd(a.v, b.v)}; return r;
+  }
+  inline vec operator/(const vec& a, const vec& b) {
+    vec r = {_mm256_div_pd(a.v, b.v)}; return r;
+  }
+
+  inline vec vsqrt(const vec& a) { vec r = {_mm256_sqrt_pd(a.v)}; return r; }
+  inline vec vabs(const vec& a) {
+    vec r = {_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)}; return r;
+  }
+  inline mask less(const vec& a, const vec& b) {
+    mask r = {_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ)}; return r;
+  }
+  inline vec select(const mask& m, const vec& a, const vec& b) {
+    vec r = {_mm256_blendv_pd(b.v, a.v, m.m)}; return r;
+  }
+
+#include <stan_pwa/src/fct/simd/kernels.hpp>
+
+}
+}
+}
+}
+
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT DEFAULT
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
+#endif
@@ -0,0 +1,86 @@
+#ifndef STAN_PWA__SRC__FCT__SIMD__AVX512_HPP
+#define STAN_PWA__SRC__FCT__SIMD__AVX512_HPP
+
+#include <stan_pwa/src/fct/simd/dispatch.hpp> // STAN_PWA_SIMD_X86
+
+#ifdef STAN_PWA_SIMD_X86
+
+#include <cstddef> // size_t
+#include <immintrin.h>
+
+#include <stan_pwa/src/fct/breit_wigner.hpp> // width_constants
+#include <stan_pwa/src/flat_structures/particles.hpp> // particles::pi, k
+
+/*
+ *  Line-shape kernels, 8 events at a time (AVX-512).
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/fct/simd.hpp. Compiled for AVX-512 regardless of the
+ *    compiler flags; only called if the CPU supports it.
+ */
+
+// No contraction to FMA, so that all instruction sets give the same results
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#pragma STDC FP_CONTRACT OFF
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace stan_pwa {
+namespace fct {
+namespace simd {
+namespace avx512_kernels {
+
+  struct vec { __m512d v; };
+  struct mask { __mmask8 m; };
+  const size_t lanes = 8;
+
+  inline vec load(const double* p) { vec r = {_mm512_loadu_pd(p)}; return r; }
+  inline void store(double* p, const vec& a) { _mm512_storeu_pd(p, a.v); }
+  inline vec broadcast(double x) { vec r = {_mm512_set1_pd(x)}; return r; }
+
+  inline vec operator+(const vec& a, const vec& b) {
+    vec r = {_mm512_add_pd(a.v, b.v)}; return r;
+  }
+  inline vec operator-(const vec& a, const vec& b) {
+    vec r = {_mm512_sub_pd(a.v, b.v)}; return r;
+  }
+  inline vec operator*(const vec& a, const vec& b) {
+    vec r = {_mm512_mul_pd(a.v, b.v)}; return r;
+  }
+  inline vec operator/(const vec& a, const vec& b) {
+    vec r = {_mm512_div_pd(a.v, b.v)}; return r;
+  }
+
+  inline vec vsqrt(const vec& a) {
+    vec r = {_mm512_mask_sqrt_pd(a.v, (__mmask8)0xff, a.v)}; return r;
+  }
+  inline vec vabs(const vec& a) {
+    vec r = {_mm512_abs_pd(a.v)}; return r;
+  }
+  inline mask less(const vec& a, const vec& b) {
+    mask r = {_mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ)}; return r;
+  }
+  inline vec select(const mask& m, const vec& a, const vec& b) {
+    vec r = {_mm512_mask_blend_pd(m.m, b.v, a.v)}; return r;
+  }
+
+#include <stan_pwa/src/fct/simd/kernels.hpp>
+
+}
+}
+}
+}
+
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT DEFAULT
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
+#endif
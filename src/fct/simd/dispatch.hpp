@@ -0,0 +1,95 @@
+#ifndef STAN_PWA__SRC__FCT__SIMD__DISPATCH_HPP
+#define STAN_PWA__SRC__FCT__SIMD__DISPATCH_HPP
+
+#include <cstdlib> // getenv
+#include <cstring> // strcmp
+
+/*
+ *  Instruction set of the vectorized line-shape kernels.
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/fct/simd.hpp
+ *
+ *  FUNCTIONS
+ *    instruction_set detected_isa()
+ *    instruction_set active_isa()
+ *    const char* isa_name(isa)
+ */
+
+// x86 kernels need GCC/Clang (target pragmas, __builtin_cpu_supports);
+// define STAN_PWA_NO_SIMD to use the scalar kernels only
+#if (defined(__x86_64__) || defined(__i386__))          \
+  && (defined(__GNUC__) || defined(__clang__))          \
+  && !defined(STAN_PWA_NO_SIMD)
+#define STAN_PWA_SIMD_X86
+#endif
+
+namespace stan_pwa {
+namespace fct {
+namespace simd {
+
+  ///> Instruction sets, in increasing order
+  enum instruction_set { isa_scalar = 0, isa_avx2 = 1, isa_avx512 = 2 };
+
+
+  /**
+   * instruction_set detected_isa()
+   *
+   * Best instruction set supported by the CPU (and the OS).
+   */
+  inline instruction_set
+  detected_isa() {
+#ifdef STAN_PWA_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+      return isa_avx512;
+    if (__builtin_cpu_supports("avx2"))
+      return isa_avx2;
+#endif
+    return isa_scalar;
+  }
+
+
+  /**
+   * instruction_set active_isa()
+   *
+   * Instruction set used by default: the detected one, or a lower one
+   * set in the environment variable STAN_PWA_SIMD (scalar, avx2,
+   * avx512). Determined once.
+   */
+  inline instruction_set
+  active_isa() {
+    static const instruction_set isa = [] {
+      instruction_set res = detected_isa();
+      const char* env = std::getenv("STAN_PWA_SIMD");
+      if (env != 0) {
+        instruction_set wanted = res;
+        if (std::strcmp(env, "scalar") == 0)
+          wanted = isa_scalar;
+        else if (std::strcmp(env, "avx2") == 0)
+          wanted = isa_avx2;
+        else if (std::strcmp(env, "avx512") == 0)
+          wanted = isa_avx512;
+        if (wanted < res)
+          res = wanted;
+      }
+      return res;
+    }();
+    return isa;
+  }
+
+
+  ///> Name of an instruction set, as in STAN_PWA_SIMD
+  inline const char*
+  isa_name(instruction_set isa) {
+    switch (isa) {
+    case isa_avx512: return "avx512";
+    case isa_avx2: return "avx2";
+    default: return "scalar";
+    }
+  }
+
+}
+}
+}
+#endif
@@ -0,0 +1,166 @@
+// No include guard: this file is included once per instruction set
+// (scalar.hpp, avx2.hpp, avx512.hpp), inside a namespace that defines
+//
+//   vec, mask           a pack of 'lanes' doubles and a comparison mask
+//   lanes               number of doubles in a pack
+//   load(p), store(p, v), broadcast(x)
+//   vsqrt(v), vabs(v), less(a, b), select(m, a, b)
+//   operators + - * / on vec
+//
+// and, for AVX2/AVX-512, inside a region compiled for that instruction
+// set. Do not include other headers here.
+
+  ///> Pack of the k <= lanes values at p; the missing lanes repeat p[0]
+  inline vec
+  get(const double* p, size_t k) {
+    if (k == lanes)
+      return load(p);
+    double buf[lanes];
+    for (size_t i = 0; i < lanes; i++)
+      buf[i] = p[i < k ? i : 0];
+    return load(buf);
+  }
+
+
+  ///> Stores the first k <= lanes values of v at p
+  inline void
+  put(double* p, size_t k, const vec& v) {
+    if (k == lanes) {
+      store(p, v);
+      return;
+    }
+    double buf[lanes];
+    store(buf, v);
+    for (size_t i = 0; i < k; i++)
+      p[i] = buf[i];
+  }
+
+
+  ///> Blatt-Weisskopf form factor; J is the same for all lanes
+  inline vec
+  blatt_weisskopf_p2_v(int J, const vec& r2, const vec& p2) {
+    const vec one = broadcast(1.0);
+    if (J == 0 || J > 2)
+      return one;
+    const vec z = p2 * r2;
+    if (J == 1)
+      return vsqrt(one / (one + z));
+    return vsqrt(one / (broadcast(9.0) + broadcast(3.0) * z + z * z));
+  }
+
+
+  ///> Relativistic width; 0 below threshold (p2_ab < 0)
+  inline vec
+  relativistic_width_v(const breit_wigner::width_constants& R,
+                       const vec& m_ab, const vec& p2_ab) {
+    const vec zero = broadcast(0.0);
+    const vec F = blatt_weisskopf_p2_v(R.J_R, broadcast(R.r2_R), p2_ab)
+      / broadcast(R.F_R);
+
+    // (p2_ab / p2_R)**(J + 1/2)
+    const vec x = p2_ab / broadcast(R.p2_R);
+    vec q = vsqrt(vabs(x));
+    for (int j = 0; j < R.J_R; j++)
+      q = q * x;
+
+    const vec w = broadcast(R.W_R * R.M_R) / m_ab * q * F * F;
+    return select(less(p2_ab, zero), zero, w);
+  }
+
+
+  ///> 1 / (M_R**2 - m2_ab - i M_R width)
+  inline void
+  breit_wigner_v(const vec& M_R, const vec& m2_ab, const vec& width,
+                 vec& re, vec& im) {
+    const vec a = M_R * M_R - m2_ab;
+    const vec b = M_R * width;
+    const vec norm = a * a + b * b;
+    re = a / norm;
+    im = b / norm;
+  }
+
+
+  ///> Breakup momentum into two particles of mass m; imaginary below
+  ///> threshold
+  inline void
+  complex_p_v(const vec& m2, double m, vec& re, vec& im) {
+    const vec zero = broadcast(0.0);
+    const vec p2 = m2 / broadcast(4.0) - broadcast(m * m);
+    const vec s = vsqrt(vabs(p2));
+    const mask below = less(p2, zero);
+    re = select(below, zero, s);
+    im = select(below, s, zero);
+  }
+
+
+  ///> Flatte form factor, see fct::flatte::value
+  inline void
+  flatte_v(double M_R, double gpp, double gkk, const vec& m2_ab,
+           vec& re, vec& im) {
+    vec pp_re, pp_im, kk_re, kk_im;
+    complex_p_v(m2_ab, particles::pi.m, pp_re, pp_im);
+    complex_p_v(m2_ab, particles::k.m, kk_re, kk_im);
+
+    const vec g_pp = broadcast(gpp * gpp);
+    const vec g_kk = broadcast(gkk * gkk);
+    const vec g_re = g_pp * pp_re + g_kk * kk_re;
+    const vec g_im = g_pp * pp_im + g_kk * kk_im;
+
+    // (M_R**2 - m2_ab) - 2 / m_ab * i g
+    const vec c = broadcast(2.) / vsqrt(m2_ab);
+    const vec a = (broadcast(M_R * M_R) - m2_ab) - c * (broadcast(0.0) - g_im);
+    const vec b = broadcast(0.0) - c * g_re;
+    const vec norm = a * a + b * b;
+    re = a / norm;
+    im = (broadcast(0.0) - b) / norm;
+  }
+
+
+  inline void
+  blatt_weisskopf_p2(int J_R, double r2, const double* p2, double* out,
+                     size_t N) {
+    const vec r2_v = broadcast(r2);
+    for (size_t n = 0; n < N; n += lanes) {
+      const size_t k = N - n < lanes ? N - n : lanes;
+      put(out + n, k, blatt_weisskopf_p2_v(J_R, r2_v, get(p2 + n, k)));
+    }
+  }
+
+
+  inline void
+  relativistic_width(const breit_wigner::width_constants& R,
+                     const double* m_ab, const double* p2_ab, double* out,
+                     size_t N) {
+    for (size_t n = 0; n < N; n += lanes) {
+      const size_t k = N - n < lanes ? N - n : lanes;
+      put(out + n, k,
+          relativistic_width_v(R, get(m_ab + n, k), get(p2_ab + n, k)));
+    }
+  }
+
+
+  inline void
+  breit_wigner_value(double M_R, const double* m2_ab, const double* width,
+                     double* re, double* im, size_t N) {
+    const vec M = broadcast(M_R);
+    for (size_t n = 0; n < N; n += lanes) {
+      const size_t k = N - n < lanes ? N - n : lanes;
+      vec r, i;
+      breit_wigner_v(M, get(m2_ab + n, k), get(width + n, k), r, i);
+      put(re + n, k, r);
+      put(im + n, k, i);
+    }
+  }
+
+
+  inline void
+  flatte_value(double M_R, double gpp, double gkk, const double* m2_ab,
+               double* re, double* im, size_t N) {
+    for (size_t n = 0; n < N; n += lanes) {
+      const size_t k = N - n < lanes ? N - n : lanes;
+      vec r, i;
+      flatte_v(M_R, gpp, gkk, get(m2_ab + n, k), r, i);
+      put(re + n, k, r);
+      put(im + n, k, i);
+    }
+  }
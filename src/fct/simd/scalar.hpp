@@ -0,0 +1,55 @@
+#ifndef STAN_PWA__SRC__FCT__SIMD__SCALAR_HPP
+#define STAN_PWA__SRC__FCT__SIMD__SCALAR_HPP
+
+#include <cmath> // sqrt, fabs
+#include <cstddef> // size_t
+
+#include <stan_pwa/src/fct/breit_wigner.hpp> // width_constants
+#include <stan_pwa/src/flat_structures/particles.hpp> // particles::pi, k
+
+/*
+ *  Line-shape kernels, one event at a time (fallback).
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/fct/simd.hpp
+ */
+
+// No contraction to FMA, so that all instruction sets give the same results
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace stan_pwa {
+namespace fct {
+namespace simd {
+namespace scalar_kernels {
+
+  typedef double vec;
+  typedef bool mask;
+  const size_t lanes = 1;
+
+  inline vec load(const double* p) { return *p; }
+  inline void store(double* p, const vec& v) { *p = v; }
+  inline vec broadcast(double x) { return x; }
+  inline vec vsqrt(const vec& v) { return std::sqrt(v); }
+  inline vec vabs(const vec& v) { return std::fabs(v); }
+  inline mask less(const vec& a, const vec& b) { return a < b; }
+  inline vec select(mask m, const vec& a, const vec& b) { return m ? a : b; }
+
+#include <stan_pwa/src/fct/simd/kernels.hpp>
+
+}
+}
+}
+}
+
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT DEFAULT
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
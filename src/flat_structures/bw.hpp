@@ -34,7 +34,7 @@ namespace stan_pwa {
       T width = mfct::breit_wigner::relativistic_width(R.m, R.W, R.J, R.r,
 						       m2_ab,Ext.a.m,Ext.b.m);
       
-      std::vector<T> T_R = mfct::breit_wigner::value(R.m,m2_ab,width);
+      std::vector<T> T_R = mc::to_vector(mfct::breit_wigner::value(R.m,m2_ab,width));
       // If the parent particle does not have spin 0, some adjustments
       // must be performed in this Zemach function (use angular orbital
       // momentum between P and R instead of R.J)
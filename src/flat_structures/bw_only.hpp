@@ -50,7 +50,7 @@ namespace resonances {
 							 m2_ab, this->a.m, 
 							 this->b.m);
 
-	std::vector<T> T_R = mfct::breit_wigner::value(this->R.m,m2_ab,width);
+	std::vector<T> T_R = mc::to_vector(mfct::breit_wigner::value(this->R.m,m2_ab,width));
 
 	std::vector<T> res(2);
 	res = mc::scalar::mult(F_R, T_R);
@@ -0,0 +1,34 @@
+#ifndef STAN_PWA__SRC__GENERATE_HPP
+#define STAN_PWA__SRC__GENERATE_HPP
+
+#include <stan_pwa/src/generate/phase_space.hpp>
+#include <stan_pwa/src/generate/accept_reject.hpp>
+
+/*
+ *  Direct generation of toy events.
+ *
+ *  DESCRIPTION
+ *    STAN_data_generator.stan draws events by running NUTS over y, which
+ *    gives correlated samples and costs one gradient evaluation per leap-
+ *    frog step. Here, events are drawn directly:
+ *
+ *    - phase_space.hpp: uniform points in the Dalitz plot (3-body decay,
+ *      fct::valid) or in the 5 invariant masses of a 4-body decay
+ *      (fct::valid_5d), by rejection from the enclosing box;
+ *    - accept_reject.hpp: unweighted events with density proportional to
+ *      the model, by accept-reject against a piecewise constant envelope
+ *      estimated beforehand, or weighted events.
+ *
+ *    Events are generated in blocks with one random stream per block,
+ *    on STAN_PWA_NUM_THREADS threads; the events only depend on the seed.
+ *
+ *    The executable tools/generate_events.cpp (see build_tools.sh)
+ *    generates events of the linked model and writes them in the CmdStan
+ *    output format (*.csv).
+ *
+ *  FUNCTIONS
+ *    Are currently listed in particular files - phase_space.hpp,
+ *    accept_reject.hpp.
+ */
+
+#endif
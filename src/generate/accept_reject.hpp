@@ -0,0 +1,250 @@
+#ifndef STAN_PWA__SRC__GENERATE__ACCEPT_REJECT_HPP
+#define STAN_PWA__SRC__GENERATE__ACCEPT_REJECT_HPP
+
+#include <algorithm> // max, min, upper_bound
+#include <random>
+#include <stdexcept> // domain_error
+#include <vector>
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+
+#include <stan_pwa/src/generate/phase_space.hpp>
+#include <stan_pwa/src/parallel.hpp>
+
+/*
+ *  Event generation by accept-reject against a precomputed envelope.
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/generate.hpp
+ *
+ *  FUNCTIONS
+ *    std::mt19937_64 block_rng(seed, stream, block)
+ *    void envelope::explore(density, num_points, seed)
+ *    void envelope::draw(density, rng, y, f, stats)
+ *    void generate_events(space, density, env, num_events, seed, sink)
+ */
+
+namespace stan_pwa {
+namespace generate {
+
+  ///> Number of events generated with one random stream
+  const size_t events_per_block = 16384;
+
+
+  /**
+   * std::mt19937_64 block_rng(seed, stream, block)
+   *
+   * Random engine of the block 'block' of the stream 'stream' (e.g.
+   * exploration, generation). Every block has its own engine, so the
+   * generated events depend on the seed only, not on the number of
+   * threads.
+   */
+  inline std::mt19937_64
+  block_rng(unsigned long seed, unsigned long stream, unsigned long block) {
+    std::seed_seq seq = {(unsigned int)(seed & 0xffffffffUL),
+                         (unsigned int)(seed >> 16 >> 16),
+                         (unsigned int)stream,
+                         (unsigned int)(block & 0xffffffffUL),
+                         (unsigned int)(block >> 16 >> 16)};
+    return std::mt19937_64(seq);
+  }
+
+
+  ///> Counters of a generation run
+  struct generation_stats {
+    size_t num_trials;     ///> Points drawn in the box
+    size_t num_violations; ///> Accepted points with density above envelope
+
+    generation_stats() : num_trials(0), num_violations(0) {};
+
+    void add(const generation_stats& other) {
+      num_trials += other.num_trials;
+      num_violations += other.num_violations;
+    }
+  };
+
+
+  /**
+   * Piecewise constant upper bound of the density on a grid over the
+   * first two variables (the remaining ones, for 4-body decays, span the
+   * whole box in every cell).
+   *
+   * The bound of a cell is the maximum density found in the cell and its
+   * neighbours during explore(), times a safety factor. Points with a
+   * larger density are counted as violations by draw(); if there are
+   * any, explore with more points or a larger safety factor.
+   */
+  template <typename S>
+  class envelope {
+  public:
+    envelope(const S& space, int num_cells = 50, double safety = 1.5) :
+      space_(space), n_(num_cells), safety_(safety),
+      bound_(num_cells * num_cells, 0.0), cdf_(num_cells * num_cells, 0.0)
+    {};
+
+    /**
+     * Estimates the bounds from num_points uniformly distributed
+     * points in the box.
+     *
+     * @tparam F Callable, double F(const Eigen::VectorXd&); the density
+     */
+    template <typename F>
+    void explore(const F& density, size_t num_points, unsigned long seed) {
+      const size_t num_blocks = (num_points + events_per_block - 1) / events_per_block;
+      std::vector<std::vector<double> > cell_max(num_blocks,
+                                                 std::vector<double>(n_ * n_, 0.0));
+
+      parallel::thread_pool::instance().run(num_blocks, [&](size_t k) {
+          std::mt19937_64 rng = block_rng(seed, 0, k);
+          const size_t end = std::min((k + 1) * events_per_block, num_points);
+          Eigen::VectorXd y;
+          for (size_t n = k * events_per_block; n < end; n++) {
+            if (!draw_uniform(space_, rng, y))
+              continue;
+            double& m = cell_max[k][cell(y)];
+            m = std::max(m, density(y));
+          }
+        });
+
+      std::vector<double> max(n_ * n_, 0.0);
+      for (size_t k = 0; k < num_blocks; k++) {
+        for (int c = 0; c < n_ * n_; c++)
+          max[c] = std::max(max[c], cell_max[k][c]);
+      }
+
+      // Cell bound: maximum over the cell and its neighbours
+      for (int i = 0; i < n_; i++) {
+        for (int j = 0; j < n_; j++) {
+          double m = 0.0;
+          for (int di = -1; di <= 1; di++) {
+            for (int dj = -1; dj <= 1; dj++) {
+              if (i + di >= 0 && i + di < n_ && j + dj >= 0 && j + dj < n_)
+                m = std::max(m, max[(i + di) * n_ + j + dj]);
+            }
+          }
+          bound_[i * n_ + j] = safety_ * m;
+        }
+      }
+
+      double sum = 0.0;
+      for (int c = 0; c < n_ * n_; c++) {
+        sum += bound_[c];
+        cdf_[c] = sum;
+      }
+      if (sum <= 0.0)
+        throw std::domain_error("envelope::explore: density vanishes on "
+                                "all exploration points");
+    }
+
+    /**
+     * Draws one event y with probability density proportional to
+     * density(y) and returns f = density(y).
+     */
+    template <typename F, typename RNG>
+    void draw(const F& density, RNG& rng, Eigen::VectorXd& y, double& f,
+              generation_stats& stats) const {
+      std::uniform_real_distribution<double> u(0.0, 1.0);
+      while (true) {
+        // Cell, with probability proportional to its bound
+        const int c = std::upper_bound(cdf_.begin(), cdf_.end(),
+                                       u(rng) * cdf_.back()) - cdf_.begin();
+        if (c >= n_ * n_)
+          continue;
+
+        stats.num_trials++;
+        draw_box(space_, rng, y);
+        y(0) = space_.lower(0)
+          + (c / n_ + u(rng)) * (space_.upper(0) - space_.lower(0)) / n_;
+        y(1) = space_.lower(1)
+          + (c % n_ + u(rng)) * (space_.upper(1) - space_.lower(1)) / n_;
+        if (!space_.valid(y))
+          continue;
+
+        f = density(y);
+        if (f > bound_[c])
+          stats.num_violations++;
+        if (u(rng) * bound_[c] < f)
+          return;
+      }
+    }
+
+  private:
+    int cell(const Eigen::VectorXd& y) const {
+      const int i = (y(0) - space_.lower(0)) / (space_.upper(0) - space_.lower(0)) * n_;
+      const int j = (y(1) - space_.lower(1)) / (space_.upper(1) - space_.lower(1)) * n_;
+      return std::min(i, n_ - 1) * n_ + std::min(j, n_ - 1);
+    }
+
+    const S& space_;
+    const int n_;
+    const double safety_;
+    std::vector<double> bound_;
+    std::vector<double> cdf_;
+  };
+
+
+  ///> Events of one block; weights are the densities f(y)
+  struct event_block {
+    std::vector<Eigen::VectorXd> y;
+    std::vector<double> f;
+    generation_stats stats;
+  };
+
+
+  /**
+   * void generate_events(space, density, env, num_events, seed, sink)
+   *
+   * Generates num_events events on the thread pool, in blocks of
+   * events_per_block with one random stream each, and passes the blocks
+   * to sink(const event_block&) in block order, a few blocks at a time
+   * (the memory used does not grow with num_events).
+   *
+   * With an envelope, the events are distributed with density
+   * proportional to density(y) (unweighted events). With env == 0, they
+   * are uniformly distributed over the phase space, with weights
+   * f = density(y) (weighted events).
+   *
+   * @tparam S Phase space
+   * @tparam F Callable, double F(const Eigen::VectorXd&)
+   * @tparam G Callable, void G(const event_block&)
+   */
+  template <typename S, typename F, typename G>
+  inline void
+  generate_events(const S& space, const F& density, const envelope<S>* env,
+                  size_t num_events, unsigned long seed, G& sink) {
+
+    const size_t num_blocks = (num_events + events_per_block - 1) / events_per_block;
+    const size_t blocks_per_round = 4 * parallel::thread_pool::instance().size();
+
+    for (size_t first = 0; first < num_blocks; first += blocks_per_round) {
+      const size_t num = std::min(blocks_per_round, num_blocks - first);
+      std::vector<event_block> blocks(num);
+
+      parallel::thread_pool::instance().run(num, [&](size_t i) {
+          const size_t k = first + i;
+          const size_t n = std::min((k + 1) * events_per_block, num_events)
+            - k * events_per_block;
+          std::mt19937_64 rng = block_rng(seed, 1, k);
+          event_block& b = blocks[i];
+          b.y.resize(n);
+          b.f.resize(n);
+          for (size_t e = 0; e < n; e++) {
+            if (env != 0) {
+              env->draw(density, rng, b.y[e], b.f[e], b.stats);
+            } else {
+              do {
+                b.stats.num_trials++;
+              } while (!draw_uniform(space, rng, b.y[e]));
+              b.f[e] = density(b.y[e]);
+            }
+          }
+        });
+
+      for (size_t i = 0; i < num; i++)
+        sink(blocks[i]);
+    }
+  }
+
+}
+}
+#endif
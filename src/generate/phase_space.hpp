@@ -0,0 +1,226 @@
+#ifndef STAN_PWA__SRC__GENERATE__PHASE_SPACE_HPP
+#define STAN_PWA__SRC__GENERATE__PHASE_SPACE_HPP
+
+#include <algorithm> // max
+#include <cmath> // sqrt
+#include <random>
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+
+#include <stan_pwa/src/flat_structures/particles_def.hpp> // Particle
+#include <stan_pwa/src/fct/valid.hpp>
+
+/*
+ *  Phase space regions of 3- and 4-body decays.
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/generate.hpp
+ *
+ *  FUNCTIONS
+ *    bool dalitz_space::valid(y)
+ *    void dalitz_space::m2_bc_range(m2_ab, lo, hi)
+ *    bool four_body_space::valid(y)
+ *    void four_body_space::map(u, y)
+ *    void draw_box(space, rng, y)
+ *    bool draw_uniform(space, rng, y)
+ */
+
+namespace stan_pwa {
+namespace generate {
+
+  /**
+   * Smallest box [lower, upper] containing the phase space region;
+   * derived classes add valid(y), which tells whether y is inside.
+   */
+  struct box_space {
+    Eigen::VectorXd lower;
+    Eigen::VectorXd upper;
+
+    int dim() const { return lower.rows(); }
+
+    double volume() const { return (upper - lower).prod(); }
+  };
+
+
+  /**
+   * Dalitz plot of the decay P -> a b c, y = (m2_ab, m2_bc).
+   */
+  struct dalitz_space : public box_space {
+    const double m2_P, m2_a, m2_b, m2_c;
+
+    dalitz_space(double m_P, double m_a, double m_b, double m_c) :
+      m2_P(m_P * m_P), m2_a(m_a * m_a), m2_b(m_b * m_b), m2_c(m_c * m_c)
+    {
+      lower.resize(2);
+      upper.resize(2);
+      lower << (m_a + m_b) * (m_a + m_b), (m_b + m_c) * (m_b + m_c);
+      upper << (m_P - m_c) * (m_P - m_c), (m_P - m_a) * (m_P - m_a);
+    };
+
+    bool valid(const Eigen::VectorXd& y) const {
+      return stan_pwa::fct::valid(y(0), y(1), m2_P, m2_a, m2_b, m2_c);
+    }
+
+    /**
+     * Range [lo, hi] of m2_bc in the Dalitz plot for a given m2_ab
+     * (lower(0) <= m2_ab <= upper(0)), from the energies of b and c in
+     * the rest frame of ab (as in fct::valid).
+     */
+    void m2_bc_range(double m2_ab, double& lo, double& hi) const {
+      const double m_ab = std::sqrt(m2_ab);
+      const double E_b = (m2_ab - m2_a + m2_b) / 2. / m_ab;
+      const double E_c = (m2_P - m2_ab - m2_c) / 2. / m_ab;
+      const double P_b = std::sqrt(std::max(E_b * E_b - m2_b, 0.0));
+      const double P_c = std::sqrt(std::max(E_c * E_c - m2_c, 0.0));
+      lo = m2_b + m2_c + 2. * (E_b * E_c - P_b * P_c);
+      hi = m2_b + m2_c + 2. * (E_b * E_c + P_b * P_c);
+    }
+  };
+
+
+  /**
+   * Phase space of the decay P -> a b c d,
+   * y = (m2_12, m2_14, m2_23, m2_34, m2_13) as in fct::valid_5d.
+   */
+  struct four_body_space : public box_space {
+    const Particle P, a, b, c, d;
+
+    four_body_space(double m_P, double m_a, double m_b, double m_c, double m_d) :
+      P(m_P, 0., 0), a(m_a, 0., 0), b(m_b, 0., 0), c(m_c, 0., 0), d(m_d, 0., 0)
+    {
+      lower.resize(5);
+      upper.resize(5);
+      lower << (m_a + m_b) * (m_a + m_b), (m_a + m_d) * (m_a + m_d),
+        (m_b + m_c) * (m_b + m_c), (m_c + m_d) * (m_c + m_d),
+        (m_a + m_c) * (m_a + m_c);
+      upper << (m_P - m_c - m_d) * (m_P - m_c - m_d),
+        (m_P - m_b - m_c) * (m_P - m_b - m_c),
+        (m_P - m_a - m_d) * (m_P - m_a - m_d),
+        (m_P - m_a - m_b) * (m_P - m_a - m_b),
+        (m_P - m_b - m_d) * (m_P - m_b - m_d);
+    };
+
+    bool valid(const Eigen::VectorXd& y) const {
+      return stan_pwa::fct::valid_5d(y(0), y(1), y(2), y(3), y(4),
+                                     P, a, b, c, d);
+    }
+
+    /**
+     * Maps u in [0, 1]^5 to a physical point y of the phase space (not
+     * uniformly distributed): u gives m_ab, m_abc and the angles of the
+     * decays P -> (abc) d, (abc) -> (ab) c and (ab) -> a b, and y is
+     * computed from the four-momenta. Unlike valid(), which also accepts
+     * some unphysical points, every invariant mass of a subset of a b c d
+     * is then above its threshold.
+     */
+    void map(const double* u, Eigen::VectorXd& y) const {
+      const double pi = 3.14159265358979323846;
+      const double m_ab = a.m + b.m + u[0] * (P.m - c.m - d.m - a.m - b.m);
+      const double m_abc = m_ab + c.m + u[1] * (P.m - d.m - m_ab - c.m);
+
+      // P -> (abc) d along z, in the rest frame of P
+      const double p_d = momentum(P.m, m_abc, d.m);
+      double p4_d[4] = {std::sqrt(d.m2 + p_d * p_d), 0., 0., -p_d};
+
+      // (abc) -> (ab) c at the polar angle acos(cos_abc), in the rest
+      // frame of abc
+      const double cos_abc = 2. * u[2] - 1.;
+      const double sin_abc = std::sqrt(1. - cos_abc * cos_abc);
+      const double q = momentum(m_abc, m_ab, c.m);
+      double p4_ab[4] = {std::sqrt(m_ab * m_ab + q * q), q * sin_abc, 0.,
+                         q * cos_abc};
+      double p4_c[4] = {std::sqrt(c.m2 + q * q), -q * sin_abc, 0.,
+                        -q * cos_abc};
+
+      // (ab) -> a b in the rest frame of ab
+      const double cos_ab = 2. * u[3] - 1.;
+      const double sin_ab = std::sqrt(1. - cos_ab * cos_ab);
+      const double phi = 2. * pi * u[4];
+      const double k = momentum(m_ab, a.m, b.m);
+      const double n[3] = {sin_ab * std::cos(phi), sin_ab * std::sin(phi),
+                           cos_ab};
+      double p4_a[4] = {std::sqrt(a.m2 + k * k), k * n[0], k * n[1], k * n[2]};
+      double p4_b[4] = {std::sqrt(b.m2 + k * k), -k * n[0], -k * n[1],
+                        -k * n[2]};
+
+      // a, b to the rest frame of abc, then a, b, c to the one of P
+      boost(p4_a, p4_ab);
+      boost(p4_b, p4_ab);
+      const double p4_abc[4] = {std::sqrt(m_abc * m_abc + p_d * p_d), 0., 0.,
+                                p_d};
+      boost(p4_a, p4_abc);
+      boost(p4_b, p4_abc);
+      boost(p4_c, p4_abc);
+
+      y.resize(5);
+      y << mass2(p4_a, p4_b), mass2(p4_a, p4_d), mass2(p4_b, p4_c),
+        mass2(p4_c, p4_d), mass2(p4_a, p4_c);
+    }
+
+  private:
+    ///> Momentum of the products of the decay M -> m1 m2 in its rest frame
+    static double momentum(double M, double m1, double m2) {
+      const double s = (M * M - (m1 + m2) * (m1 + m2))
+        * (M * M - (m1 - m2) * (m1 - m2));
+      return std::sqrt(std::max(s, 0.0)) / (2. * M);
+    }
+
+    ///> Boosts p from the rest frame of a system to the frame where the
+    ///> system has the four-momentum s
+    static void boost(double* p, const double* s) {
+      const double m = std::sqrt(s[0] * s[0] - s[1] * s[1] - s[2] * s[2]
+                                 - s[3] * s[3]);
+      const double sp = s[1] * p[1] + s[2] * p[2] + s[3] * p[3];
+      const double f = (sp / (s[0] + m) + p[0]) / m;
+      p[0] = (s[0] * p[0] + sp) / m;
+      for (int i = 1; i < 4; i++)
+        p[i] += f * s[i];
+    }
+
+    ///> Invariant mass squared of p + q
+    static double mass2(const double* p, const double* q) {
+      const double E = p[0] + q[0];
+      const double x = p[1] + q[1], y = p[2] + q[2], z = p[3] + q[3];
+      return E * E - x * x - y * y - z * z;
+    }
+  };
+
+
+  /**
+   * void draw_box(space, rng, y)
+   *
+   * Draws y uniformly in the box of the phase space.
+   *
+   * @tparam S Phase space (dalitz_space, four_body_space)
+   * @tparam RNG Random engine, e.g. std::mt19937_64
+   */
+  template <typename S, typename RNG>
+  inline void
+  draw_box(const S& space, RNG& rng, Eigen::VectorXd& y) {
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    y.resize(space.dim());
+    for (int i = 0; i < space.dim(); i++)
+      y(i) = space.lower(i) + u(rng) * (space.upper(i) - space.lower(i));
+  }
+
+
+  /**
+   * bool draw_uniform(space, rng, y)
+   *
+   * Draws y uniformly in the box of the phase space and returns whether
+   * it is inside the phase space; the accepted points are uniformly
+   * distributed over the phase space.
+   *
+   * @tparam S Phase space (dalitz_space, four_body_space)
+   * @tparam RNG Random engine, e.g. std::mt19937_64
+   */
+  template <typename S, typename RNG>
+  inline bool
+  draw_uniform(const S& space, RNG& rng, Eigen::VectorXd& y) {
+    draw_box(space, rng, y);
+    return space.valid(y);
+  }
+
+}
+}
+#endif
@@ -0,0 +1,47 @@
+#ifndef STAN_PWA__SRC__INTEGRATE_HPP
+#define STAN_PWA__SRC__INTEGRATE_HPP
+
+#include <stan_pwa/src/integrate/kahan.hpp>
+#include <stan_pwa/src/integrate/normalization.hpp>
+#include <stan_pwa/src/integrate/integral_store.hpp>
+#include <stan_pwa/src/integrate/integral_cache.hpp>
+#include <stan_pwa/src/integrate/sobol.hpp>
+#include <stan_pwa/src/integrate/qmc.hpp>
+#include <stan_pwa/src/integrate/vegas.hpp>
+
+/*
+ *  Numerical integration over the phase space.
+ *
+ *  DESCRIPTION
+ *    Native replacements for the Monte Carlo integrals of
+ *    lib/py/utils/mcint.py. The amplitudes are evaluated in C++ on
+ *    several threads (STAN_PWA_NUM_THREADS), partial sums use Kahan
+ *    summation and are combined in a fixed order, so the results do not
+ *    depend on the number of threads.
+ *
+ *    The executable tools/normalization_integral.cpp (see build_tools.sh)
+ *    computes the normalization matrix I of the linked model and writes it
+ *    in the *.data.R format read by STAN_amplitude_fitting. With a store
+ *    directory, the amplitudes of every resonance and the sums of every
+ *    pair of resonances are kept on disk and reused by the next models
+ *    over the same sample (see integral_store.hpp); with a cache
+ *    directory, every I computed is kept and read again by later runs
+ *    with the same model and sample (see integral_cache.hpp).
+ *
+ *    For 3-body decays, tools/qmc_normalization_integral.cpp computes I
+ *    without a sample, from scrambled Sobol points mapped onto the
+ *    Dalitz plot (see sobol.hpp, qmc.hpp); its error falls nearly as
+ *    1/N instead of 1/sqrt(N) for smooth amplitudes. With narrow
+ *    resonances, and for 4-body decays,
+ *    tools/vegas_normalization_integral.cpp draws the points from an
+ *    adaptive VEGAS grid that follows the peaks of the amplitudes (see
+ *    vegas.hpp), until a given relative error of every element of I is
+ *    reached.
+ *
+ *  FUNCTIONS
+ *    Are currently listed in particular files - kahan.hpp,
+ *    normalization.hpp, integral_store.hpp, integral_cache.hpp, sobol.hpp,
+ *    qmc.hpp, vegas.hpp.
+ */
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef STAN_PWA__SRC__INTEGRATE__INTEGRAL_CACHE_HPP
+#define STAN_PWA__SRC__INTEGRATE__INTEGRAL_CACHE_HPP
+
+#include <cstdint> // uint32_t, uint64_t
+#include <string>
+#include <vector>
+
+#include <fcntl.h> // open
+#include <sys/file.h> // flock
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close, fsync, pread
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+
+#include <stan_pwa/src/integrate/normalization.hpp>
+#include <stan_pwa/src/io/binary_file.hpp>
+#include <stan_pwa/src/resonance_list/fingerprint.hpp> // fnv1a
+
+/*
+ *  Persistent cache of normalization integrals.
+ *
+ *  DESCRIPTION
+ *    The normalization matrix I depends only on the resonances of the
+ *    model, the symmetrization, the Monte Carlo sample and the volume.
+ *    integral_cache keeps every I computed in a directory, in a file
+ *    named by the hash of these inputs (integral_key), so that a later
+ *    run with the same inputs reads it instead of integrating again:
+ *
+ *      <key>.I     I and its standard errors
+ *      <key>.lock  lock file of the entry
+ *
+ *    The resonances enter through resonance_list::model_hash, which
+ *    fingerprints their values (and so their masses, widths, spins and
+ *    radii) and the symmetrization flag; the sample through its hash
+ *    (see integrate::sample_hash).
+ *
+ *    get(key, R, compute) reads the entry if it exists; otherwise it
+ *    takes an exclusive lock (flock) on <key>.lock, checks again, calls
+ *    compute() and writes the entry to a temporary file that is renamed
+ *    to <key>.I (see stan_pwa/src/io/binary_file.hpp). Parallel jobs
+ *    with the same key thus compute I once, the others wait for the lock
+ *    and read the result; readers see either no entry or a complete one.
+ *
+ *    Layout of <key>.I (native byte order, checked by byte_order):
+ *
+ *      offset  size      field
+ *           0     8      magic "SPWAINT\0"
+ *           8     4      version (integral_cache_version)
+ *          12     4      size of the header (64)
+ *          16     8      R, number of resonances
+ *          24     8      N, number of points
+ *          32     8      key
+ *          40     8      byte_order
+ *          48    16      reserved (0)
+ *          64  8 R R     Re(I), column-major
+ *              8 R R     Im(I)
+ *              8 R R     standard errors of Re(I)
+ *              8 R R     standard errors of Im(I)
+ *
+ *  FUNCTIONS
+ *    uint64_t integral_key(model_hash, sample_hash, volume)
+ *    bool integral_cache::load(key, R, res)
+ *    void integral_cache::store(key, res)
+ *    normalization integral_cache::get(key, R, compute)
+ */
+
+namespace stan_pwa {
+namespace integrate {
+
+  const char integral_cache_magic[8] = {'S', 'P', 'W', 'A', 'I', 'N', 'T',
+                                        '\0'};
+  const uint32_t integral_cache_version = 1;
+
+
+  ///> Header of a cache entry (the first 64 bytes)
+  struct integral_cache_header {
+    io::binary_tag tag;
+    uint64_t R;
+    uint64_t N;
+    uint64_t key;
+    uint64_t byte_order;
+    uint64_t reserved[2];
+
+    integral_cache_header(uint64_t _R, uint64_t _N, uint64_t _key) :
+      tag(integral_cache_magic, integral_cache_version,
+          sizeof(integral_cache_header)),
+      R(_R), N(_N), key(_key), byte_order(io::native_byte_order) {
+      reserved[0] = reserved[1] = 0;
+    };
+
+    ///> Size of the file in bytes
+    uint64_t file_size() const { return tag.header_size + 4 * 8 * R * R; }
+  };
+
+
+  /**
+   * uint64_t integral_key(model_hash, sample_hash, volume)
+   *
+   * Key of the normalization integral of a model (with its
+   * symmetrization, see resonance_list::model_hash) over a sample of
+   * the given volume.
+   */
+  inline uint64_t
+  integral_key(uint64_t model_hash, uint64_t sample_hash, double volume) {
+    const uint64_t head[2] = {model_hash, sample_hash};
+    return resonance_list::fnv1a(&volume, sizeof(volume),
+                                 resonance_list::fnv1a(head, sizeof(head)));
+  }
+
+
+  /**
+   * Directory of cached normalization integrals (see above). Errors
+   * throw std::domain_error; an unreadable entry counts as missing.
+   */
+  class integral_cache {
+  public:
+    ///> @param dir Directory of the cache (must exist)
+    explicit integral_cache(const std::string& dir) : dir_(dir) {};
+
+    /**
+     * Reads the entry of key, for R resonances, to res. Returns false if
+     * there is none (or it is incomplete or of another size).
+     */
+    bool load(uint64_t key, size_t R, normalization& res) const {
+      const int fd = ::open(path(key, ".I").c_str(), O_RDONLY);
+      if (fd < 0)
+        return false;
+      integral_cache_header h(0, 0, 0);
+      struct stat st;
+      bool ok = ::fstat(fd, &st) == 0
+        && ::pread(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h)
+        && io::check_tag(h.tag, integral_cache_magic, integral_cache_version,
+                         sizeof(h), h.byte_order, "a cached integral").empty()
+        && h.key == key && h.R == R
+        && h.file_size() == (uint64_t)st.st_size;
+      if (ok) {
+        res.num_points = h.N;
+        res.I.assign(2, Eigen::MatrixXd(R, R));
+        res.err.assign(2, Eigen::MatrixXd(R, R));
+        Eigen::MatrixXd* m[4] = {&res.I[0], &res.I[1], &res.err[0],
+                                 &res.err[1]};
+        const size_t n = 8 * R * R;
+        for (int k = 0; k < 4 && ok; k++)
+          ok = ::pread(fd, m[k]->data(), n, h.tag.header_size + k * n)
+            == (ssize_t)n;
+      }
+      ::close(fd);
+      return ok;
+    }
+
+    ///> Writes res as the entry of key (atomically, by rename)
+    void store(uint64_t key, const normalization& res) const {
+      const size_t R = res.I[0].rows();
+      const integral_cache_header h(R, res.num_points, key);
+      const std::string final_path = path(key, ".I");
+      std::string tmp;
+      const int fd = io::create_temp(final_path, tmp, "integral_cache");
+      const Eigen::MatrixXd* m[4] = {&res.I[0], &res.I[1], &res.err[0],
+                                     &res.err[1]};
+      bool ok = io::write_all(fd, &h, sizeof(h));
+      for (int k = 0; k < 4 && ok; k++)
+        ok = io::write_all(fd, m[k]->data(), 8 * R * R);
+      if (!ok || ::fsync(fd) != 0) {
+        io::discard_temp(tmp);
+        io::throw_errno("integral_cache", "cannot write", tmp, fd);
+      }
+      ::close(fd);
+      io::publish_temp(tmp, final_path, true, "integral_cache");
+    }
+
+    /**
+     * normalization get(key, R, compute)
+     *
+     * The entry of key if it exists; otherwise compute(), which is
+     * stored under key. Only one process computes a missing entry at a
+     * time (see above).
+     *
+     * @tparam F Callable, normalization F()
+     */
+    template <typename F>
+    normalization get(uint64_t key, size_t R, const F& compute) const {
+      normalization res;
+      if (load(key, R, res))
+        return res;
+
+      const std::string lock_path = path(key, ".lock");
+      const int fd = ::open(lock_path.c_str(), O_RDWR | O_CREAT, 0644);
+      if (fd < 0)
+        io::throw_errno("integral_cache", "cannot create", lock_path);
+      if (::flock(fd, LOCK_EX) != 0)
+        io::throw_errno("integral_cache", "cannot lock", lock_path, fd);
+      try {
+        // Computed by another process in the meantime?
+        if (!load(key, R, res)) {
+          res = compute();
+          store(key, res);
+        }
+      } catch (...) {
+        ::close(fd); // releases the lock
+        throw;
+      }
+      ::close(fd);
+      return res;
+    }
+
+  private:
+    std::string path(uint64_t key, const char* suffix) const {
+      return dir_ + "/" + io::hex(key) + suffix;
+    }
+
+    std::string dir_;
+  };
+
+}
+}
+#endif
@@ -0,0 +1,401 @@
+#ifndef STAN_PWA__SRC__INTEGRATE__INTEGRAL_STORE_HPP
+#define STAN_PWA__SRC__INTEGRATE__INTEGRAL_STORE_HPP
+
+#include <algorithm> // min
+#include <cstdint> // uint64_t
+#include <cstring> // memcmp
+#include <map>
+#include <memory> // unique_ptr
+#include <stdexcept> // domain_error
+#include <string>
+#include <tuple>
+#include <utility> // pair
+#include <vector>
+
+#include <fcntl.h> // open
+#include <unistd.h> // access, close, pread, write
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+
+#include <stan_pwa/src/integrate/kahan.hpp>
+#include <stan_pwa/src/integrate/normalization.hpp>
+#include <stan_pwa/src/io/amplitude_column.hpp>
+#include <stan_pwa/src/io/binary_file.hpp>
+#include <stan_pwa/src/parallel.hpp>
+#include <stan_pwa/src/resonance_list/batch.hpp>
+#include <stan_pwa/src/resonance_list/fingerprint.hpp>
+#include <stan_pwa/src/resonance_list/unroll.hpp>
+
+/*
+ *  On-disk store of the amplitude columns and normalization integrals of
+ *  the resonances of a Monte Carlo sample.
+ *
+ *  DESCRIPTION
+ *    During model building, resonances are added to a model one at a
+ *    time, and the normalization matrix I is computed again over the
+ *    same sample for every combination. integral_store keeps, in a
+ *    directory,
+ *
+ *      <sample>-<resonance>.col  the values of a resonance at the points
+ *                                (see stan_pwa/src/io/amplitude_column.hpp)
+ *      <sample>.pairs            the sums over the points of
+ *                                conj(A_i) A_j for pairs of resonances
+ *
+ *    where <sample> is the hash of the points (sample_hash) and
+ *    <resonance> the fingerprint of the resonance
+ *    (resonance_list::resonance_hash, which includes the symmetrization),
+ *    both in hexadecimal. integral(resonances, sym, volume) maps the
+ *    columns found, computes the missing ones, and sums only the pairs
+ *    that are not in the store yet: adding a resonance to a model costs
+ *    one column and one new row of I, whatever the order of the
+ *    resonances.
+ *
+ *    The sums use Kahan summation over chunks of points on the thread
+ *    pool, added in a fixed order, as in normalization_integral (the
+ *    results agree up to rounding).
+ *
+ *    Layout of <sample>.pairs (native byte order, checked by byte_order):
+ *
+ *      offset  size      field
+ *           0     8      magic "SPWAPRS\0"
+ *           8     4      version (pair_store_version)
+ *          12     4      size of the header (64)
+ *          16     8      N, number of points
+ *          24     8      sample hash
+ *          32     8      byte_order
+ *          40    24      reserved (0)
+ *          64  64 K      K records (pair_record), appended
+ *
+ *    Columns are published by rename, the pair file is created by link
+ *    and the records are appended with one write each, so that parallel
+ *    jobs can share a store; a record may then be stored twice.
+ *
+ *  FUNCTIONS
+ *    uint64_t sample_hash(y, num_var, N)
+ *    integral_store(dir, y, num_var, N)
+ *    normalization integral_store::integral(resonances, sym, volume)
+ */
+
+namespace stan_pwa {
+namespace integrate {
+
+  const char pair_store_magic[8] = {'S', 'P', 'W', 'A', 'P', 'R', 'S', '\0'};
+  const uint32_t pair_store_version = 1;
+
+
+  ///> Header of a pair file (the first 64 bytes)
+  struct pair_store_header {
+    io::binary_tag tag;
+    uint64_t N;
+    uint64_t sample_hash;
+    uint64_t byte_order;
+    uint64_t reserved[3];
+
+    pair_store_header(uint64_t _N, uint64_t s_hash) :
+      tag(pair_store_magic, pair_store_version, sizeof(pair_store_header)),
+      N(_N), sample_hash(s_hash), byte_order(io::native_byte_order) {
+      reserved[0] = reserved[1] = reserved[2] = 0;
+    };
+  };
+
+
+  ///> Sums over the sample of conj(A_i) A_j for the resonances with the
+  ///> fingerprints hash_i, hash_j (see set_element in normalization.hpp)
+  struct pair_record {
+    uint64_t hash_i;
+    uint64_t hash_j;
+    uint64_t reserved[2];
+    double re;
+    double im;
+    double re2;
+    double im2;
+  };
+
+
+  /**
+   * uint64_t sample_hash(y, num_var, N)
+   *
+   * Hash of the exact values of N points, y[v][n] for variable v and
+   * point n.
+   */
+  inline uint64_t
+  sample_hash(const double* const* y, size_t num_var, size_t N) {
+    const uint64_t head[2] = {num_var, N};
+    uint64_t h = resonance_list::fnv1a(head, sizeof(head));
+    for (size_t v = 0; v < num_var; v++)
+      h = resonance_list::fnv1a(y[v], N * sizeof(double), h);
+    return h;
+  }
+
+
+  /**
+   * Store of amplitude columns and pair sums for one sample (see above).
+   * The points are not copied; they must outlive the store.
+   */
+  class integral_store {
+  public:
+    /**
+     * @param dir Directory of the store (must exist)
+     * @param y Points, y[v][n] for variable v and point n
+     */
+    integral_store(const std::string& dir, const double* const* y,
+                   size_t num_var, size_t N) :
+      dir_(dir), y_(y, y + num_var), N_(N),
+      hash_(integrate::sample_hash(y, num_var, N)),
+      columns_computed_(0), pairs_computed_(0) {};
+
+    size_t size() const { return N_; }
+    uint64_t sample_hash() const { return hash_; }
+
+    ///> Numbers of columns and pairs computed by the last integral()
+    size_t columns_computed() const { return columns_computed_; }
+    size_t pairs_computed() const { return pairs_computed_; }
+
+    /**
+     * normalization integral(resonances, sym, volume)
+     *
+     * I[i,j] = volume / N * sum_n conj(A_i(y_n)) A_j(y_n) and its
+     * standard errors (as normalization_integral), from the store;
+     * missing columns and pairs are computed and added to the store.
+     */
+    template <typename... Res>
+    normalization
+    integral(std::tuple<Res...>& resonances, bool sym, double volume) {
+      const int R = sizeof...(Res);
+      columns_computed_ = 0;
+      pairs_computed_ = 0;
+
+      // Columns
+      std::vector<uint64_t> hashes;
+      std::vector<std::unique_ptr<io::mapped_amplitude_column> > cols;
+      load_columns f = { this, sym, hashes, cols };
+      resonance_list::for_each(resonances, f);
+
+      // Pairs in the store, then the missing ones (i <= j)
+      std::map<std::pair<uint64_t, uint64_t>, pair_record> stored;
+      read_pairs(stored);
+      std::vector<std::pair<int, int> > missing;
+      for (int i = 0; i < R; i++) {
+        for (int j = i; j < R; j++) {
+          pair_record p;
+          if (!find(stored, hashes[i], hashes[j], p))
+            missing.push_back(std::make_pair(i, j));
+        }
+      }
+      const std::vector<pair_record> added = sum_pairs(cols, hashes, missing);
+      append_pairs(added);
+      pairs_computed_ = added.size();
+      for (size_t k = 0; k < added.size(); k++)
+        stored[std::make_pair(added[k].hash_i, added[k].hash_j)] = added[k];
+
+      // Matrix
+      normalization res;
+      res.num_points = N_;
+      res.I.assign(2, Eigen::MatrixXd::Zero(R, R));
+      res.err.assign(2, Eigen::MatrixXd::Zero(R, R));
+      if (N_ == 0)
+        return res;
+      for (int i = 0; i < R; i++) {
+        for (int j = i; j < R; j++) {
+          pair_record p = pair_record();
+          find(stored, hashes[i], hashes[j], p);
+          set_element(res, i, j, p.re, p.im, p.re2, p.im2, volume);
+        }
+      }
+      return res;
+    }
+
+  private:
+    ///> Maps or computes the column of every resonance of a list
+    struct load_columns {
+      integral_store* self;
+      const bool sym;
+      std::vector<uint64_t>& hashes;
+      std::vector<std::unique_ptr<io::mapped_amplitude_column> >& cols;
+
+      template <typename R>
+      void operator()(size_t, R& r) {
+        const uint64_t h = resonance_list::resonance_hash(r, sym);
+        hashes.push_back(h);
+        cols.push_back(self->column(r, sym, h));
+      }
+    };
+
+    ///> Existing column of r, or a new one
+    template <typename R>
+    std::unique_ptr<io::mapped_amplitude_column>
+    column(R& r, bool sym, uint64_t h) {
+      const std::string path = dir_ + "/" + io::hex(hash_) + "-" + io::hex(h)
+        + ".col";
+      try {
+        return std::unique_ptr<io::mapped_amplitude_column>(
+          new io::mapped_amplitude_column(path, N_, h, hash_));
+      } catch (const std::domain_error&) {
+        // Missing or invalid: (re)computed below
+      }
+
+      std::unique_ptr<io::mapped_amplitude_column> col(
+        new io::mapped_amplitude_column(
+          path, io::amplitude_column_header(N_, h, hash_)));
+      double* re = col->column(0);
+      double* im = col->column(1);
+
+      typedef typename resonance_list::batch_type<R>::type B;
+      const size_t num_chunks = (N_ + points_per_chunk - 1) / points_per_chunk;
+      parallel::thread_pool::instance().run(num_chunks, [&](size_t c) {
+          const size_t begin = c * points_per_chunk;
+          const size_t n = std::min(points_per_chunk, N_ - begin);
+          std::vector<const double*> y(y_.size());
+          for (size_t v = 0; v < y_.size(); v++)
+            y[v] = y_[v] + begin;
+          const B b(y.data(), n, r, sym);
+          if (sym)
+            resonance_list::batch_values<true>(r, b, n, re + begin,
+                                               im + begin);
+          else
+            resonance_list::batch_values<false>(r, b, n, re + begin,
+                                                im + begin);
+        });
+
+      col->commit();
+      columns_computed_++;
+      return col;
+    }
+
+    ///> Sums of the missing pairs (i, j) over all points
+    std::vector<pair_record>
+    sum_pairs(const std::vector<std::unique_ptr<io::mapped_amplitude_column> >& cols,
+              const std::vector<uint64_t>& hashes,
+              const std::vector<std::pair<int, int> >& missing) const {
+      const size_t P = missing.size();
+      std::vector<pair_record> res(P);
+      const size_t num_chunks = (N_ + points_per_chunk - 1) / points_per_chunk;
+      if (P == 0 || num_chunks == 0)
+        return res;
+
+      std::vector<tensor_sums> partial(num_chunks, tensor_sums(P));
+      parallel::thread_pool::instance().run(num_chunks, [&](size_t c) {
+          tensor_sums& s = partial[c];
+          const size_t begin = c * points_per_chunk;
+          const size_t end = std::min(begin + points_per_chunk, N_);
+          for (size_t k = 0; k < P; k++) {
+            const io::mapped_amplitude_column& a = *cols[missing[k].first];
+            const io::mapped_amplitude_column& b = *cols[missing[k].second];
+            for (size_t n = begin; n < end; n++) {
+              const double h_re = a.re()[n] * b.re()[n] + a.im()[n] * b.im()[n];
+              const double h_im = a.re()[n] * b.im()[n] - a.im()[n] * b.re()[n];
+              s.re[k].add(h_re);
+              s.im[k].add(h_im);
+              s.re2[k].add(h_re * h_re);
+              s.im2[k].add(h_im * h_im);
+            }
+          }
+        });
+
+      // Pairwise reduction; partial[0] holds the total at the end
+      for (size_t stride = 1; stride < num_chunks; stride *= 2) {
+        for (size_t c = 0; c + stride < num_chunks; c += 2 * stride)
+          partial[c].add(partial[c + stride]);
+      }
+
+      for (size_t k = 0; k < P; k++) {
+        pair_record& p = res[k];
+        p.hash_i = hashes[missing[k].first];
+        p.hash_j = hashes[missing[k].second];
+        p.reserved[0] = p.reserved[1] = 0;
+        p.re = partial[0].re[k].value();
+        p.im = partial[0].im[k].value();
+        p.re2 = partial[0].re2[k].value();
+        p.im2 = partial[0].im2[k].value();
+      }
+      return res;
+    }
+
+    ///> Record of (h_i, h_j), possibly stored as (h_j, h_i)
+    static bool
+    find(const std::map<std::pair<uint64_t, uint64_t>, pair_record>& stored,
+         uint64_t h_i, uint64_t h_j, pair_record& p) {
+      std::map<std::pair<uint64_t, uint64_t>, pair_record>::const_iterator it
+        = stored.find(std::make_pair(h_i, h_j));
+      if (it != stored.end()) {
+        p = it->second;
+        return true;
+      }
+      it = stored.find(std::make_pair(h_j, h_i));
+      if (it == stored.end())
+        return false;
+      // sum conj(A_j) A_i = conj(sum conj(A_i) A_j)
+      p = it->second;
+      std::swap(p.hash_i, p.hash_j);
+      p.im = -p.im;
+      return true;
+    }
+
+    std::string pairs_path() const {
+      return dir_ + "/" + io::hex(hash_) + ".pairs";
+    }
+
+    ///> Reads the records of the pair file, if any
+    void
+    read_pairs(std::map<std::pair<uint64_t, uint64_t>, pair_record>& stored)
+      const {
+      const int fd = ::open(pairs_path().c_str(), O_RDONLY);
+      if (fd < 0)
+        return;
+      const pair_store_header expected(N_, hash_);
+      pair_store_header h(0, 0);
+      if (::pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)
+          || std::memcmp(&h, &expected, sizeof(h)) != 0) {
+        ::close(fd);
+        throw std::domain_error("integral_store: " + pairs_path()
+                                + " is not a pair file of this sample");
+      }
+      pair_record p;
+      for (off_t pos = sizeof(h);
+           ::pread(fd, &p, sizeof(p), pos) == (ssize_t)sizeof(p);
+           pos += sizeof(p))
+        stored[std::make_pair(p.hash_i, p.hash_j)] = p;
+      ::close(fd);
+    }
+
+    ///> Appends records to the pair file, which is created if needed
+    void append_pairs(const std::vector<pair_record>& records) const {
+      if (records.empty())
+        return;
+      const std::string path = pairs_path();
+      if (::access(path.c_str(), F_OK) != 0)
+        create_pairs(path);
+
+      const int fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+      if (fd < 0)
+        io::throw_errno("integral_store", "cannot open", path);
+      const size_t n = records.size() * sizeof(pair_record);
+      if (::write(fd, records.data(), n) != (ssize_t)n)
+        io::throw_errno("integral_store", "cannot write", path, fd);
+      ::close(fd);
+    }
+
+    ///> Creates the pair file with its header (atomically, by link)
+    void create_pairs(const std::string& path) const {
+      std::string tmp;
+      const int fd = io::create_temp(path, tmp, "integral_store");
+      const pair_store_header h(N_, hash_);
+      if (!io::write_all(fd, &h, sizeof(h))) {
+        io::discard_temp(tmp);
+        io::throw_errno("integral_store", "cannot write", tmp, fd);
+      }
+      ::close(fd);
+      io::publish_temp(tmp, path, false, "integral_store");
+    }
+
+    std::string dir_;
+    std::vector<const double*> y_;
+    size_t N_;
+    uint64_t hash_;
+    size_t columns_computed_;
+    size_t pairs_computed_;
+  };
+
+}
+}
+#endif
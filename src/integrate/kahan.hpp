@@ -0,0 +1,47 @@
+#ifndef STAN_PWA__SRC__INTEGRATE__KAHAN_HPP
+#define STAN_PWA__SRC__INTEGRATE__KAHAN_HPP
+
+/*
+ *  Compensated (Kahan) summation.
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/integrate.hpp
+ *
+ *  FUNCTIONS
+ *    void kahan_sum::add(x)
+ *    void kahan_sum::add(kahan_sum)
+ *    double kahan_sum::value()
+ */
+
+namespace stan_pwa {
+namespace integrate {
+
+  /**
+   * Running sum with a correction term for the lost low-order bits,
+   * so that the rounding error does not grow with the number of terms.
+   */
+  struct kahan_sum {
+    double sum;
+    double c; ///> Negative of the lost part
+
+    kahan_sum() : sum(0.0), c(0.0) {};
+
+    void add(double x) {
+      const double y = x - c;
+      const double t = sum + y;
+      c = (t - sum) - y;
+      sum = t;
+    }
+
+    ///> Adds another partial sum (e.g. of another chunk)
+    void add(const kahan_sum& other) {
+      add(other.sum);
+      add(-other.c);
+    }
+
+    double value() const { return sum - c; }
+  };
+
+}
+}
+#endif
@@ -0,0 +1,222 @@
+#ifndef STAN_PWA__SRC__INTEGRATE__NORMALIZATION_HPP
+#define STAN_PWA__SRC__INTEGRATE__NORMALIZATION_HPP
+
+#include <algorithm> // min, max
+#include <cmath> // sqrt
+#include <vector>
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+
+#include <stan_pwa/src/integrate/kahan.hpp>
+#include <stan_pwa/src/likelihood/packed_hermitian.hpp> // packed_index
+#include <stan_pwa/src/parallel.hpp>
+#include <stan_pwa/src/typedefs.h>
+
+/*
+ *  Monte Carlo normalization integral of a PWA model.
+ *
+ *  DESCRIPTION
+ *    For phase space points y_1 .. y_N and the amplitudes A(y) of the
+ *    model, computes the R x R complex matrix
+ *
+ *      I[i,j] = volume / N * sum_n conj(A_i(y_n)) A_j(y_n),
+ *
+ *    as needed by norm(theta, I), together with the standard error of
+ *    every element (real and imaginary part separately).
+ *
+ *    The points are split into chunks of fixed size, which are evaluated
+ *    on the thread pool (see stan_pwa/src/parallel.hpp). Each chunk sums
+ *    with Kahan summation, the chunks are added pairwise in a fixed
+ *    order. Only the upper triangle is summed, the lower one follows from
+ *    I[j,i] = conj(I[i,j]).
+ *
+ *    I is the complex conjugate of the matrix returned by
+ *    integral_of_tensor_product_w_pts in lib/py/utils/mcint.py, whose
+ *    element [i,j] is int A_i(y) conj(A_j(y)) dy.
+ *
+ *    The points are given either as vectors or by columns, y[v][n] for
+ *    variable v and point n (as in an integral_store).
+ *
+ *  FUNCTIONS
+ *    void set_element(normalization, i, j, re, im, re2, im2, volume)
+ *    normalization normalization_sum(amplitude_vector, N, point, volume)
+ *    normalization normalization_integral(amplitude_vector, points, volume)
+ *    normalization normalization_integral(amplitude_vector, y, num_var, N,
+ *                                         volume)
+ */
+
+namespace stan_pwa {
+namespace integrate {
+
+  ///> Number of phase space points per chunk
+  const size_t points_per_chunk = 4096;
+
+
+  ///> Result of normalization_integral
+  struct normalization {
+    std::vector<Eigen::MatrixXd> I;   ///> I[0] real, I[1] imaginary part
+    std::vector<Eigen::MatrixXd> err; ///> Standard errors of I[0], I[1]
+    size_t num_points;
+  };
+
+
+  /**
+   * Sums of conj(A_i) A_j and of its square over a chunk of points,
+   * for the packed upper triangle (see likelihood/packed_hermitian.hpp).
+   */
+  struct tensor_sums {
+    std::vector<kahan_sum> re, im, re2, im2;
+
+    explicit tensor_sums(int P = 0) : re(P), im(P), re2(P), im2(P) {};
+
+    void add(const tensor_sums& other) {
+      for (size_t k = 0; k < re.size(); k++) {
+        re[k].add(other.re[k]);
+        im[k].add(other.im[k]);
+        re2[k].add(other.re2[k]);
+        im2[k].add(other.im2[k]);
+      }
+    }
+  };
+
+
+  /**
+   * Sets I[i,j] and I[j,i] (i <= j) of res to the mean of conj(A_i) A_j
+   * over res.num_points points, scaled by the volume, and their standard
+   * errors, from the sums of conj(A_i) A_j (re, im) and of the squares of
+   * its real and imaginary parts (re2, im2).
+   */
+  inline void
+  set_element(normalization& res, int i, int j, double re, double im,
+              double re2, double im2, double volume) {
+    const double n = res.num_points;
+    const double m_re = re / n;
+    const double m_im = im / n;
+    const double v_re = std::max(re2 / n - m_re * m_re, 0.0);
+    const double v_im = std::max(im2 / n - m_im * m_im, 0.0);
+
+    res.I[0](i,j) = res.I[0](j,i) = volume * m_re;
+    if (i != j) {
+      res.I[1](i,j) = volume * m_im;
+      res.I[1](j,i) = -volume * m_im;
+    }
+
+    res.err[0](i,j) = res.err[0](j,i) = volume * std::sqrt(v_re / n);
+    res.err[1](i,j) = res.err[1](j,i) = volume * std::sqrt(v_im / n);
+  }
+
+
+  /**
+   * normalization normalization_sum(amplitude_vector, N, point, volume)
+   *
+   * Monte Carlo estimate of I[i,j] = int conj(A_i(y)) A_j(y) dy over the
+   * N points point(n, y) (n < N), which returns point n, e.g. in its
+   * scratch vector y.
+   */
+  template <typename F, typename G>
+  inline normalization
+  normalization_sum(const F& amplitude_vector, size_t N, const G& point,
+                    double volume) {
+
+    normalization res;
+    res.num_points = N;
+    Eigen::VectorXd y;
+    const int R = N > 0 ? amplitude_vector(point(0, y))[0].rows() : 0;
+    const int P = R * (R + 1) / 2;
+
+    res.I.assign(2, Eigen::MatrixXd::Zero(R, R));
+    res.err.assign(2, Eigen::MatrixXd::Zero(R, R));
+    if (N == 0)
+      return res;
+
+    const size_t num_chunks = (N + points_per_chunk - 1) / points_per_chunk;
+    std::vector<tensor_sums> partial(num_chunks, tensor_sums(P));
+
+    parallel::thread_pool::instance().run(num_chunks, [&](size_t c) {
+        tensor_sums& s = partial[c];
+        Eigen::VectorXd y;
+        const size_t end = std::min((c + 1) * points_per_chunk, N);
+        for (size_t n = c * points_per_chunk; n < end; n++) {
+          const CV_t<double> A = amplitude_vector(point(n, y));
+          int k = 0;
+          for (int i = 0; i < R; i++) {
+            for (int j = i; j < R; j++, k++) {
+              const double h_re = A[0](i) * A[0](j) + A[1](i) * A[1](j);
+              const double h_im = A[0](i) * A[1](j) - A[1](i) * A[0](j);
+              s.re[k].add(h_re);
+              s.im[k].add(h_im);
+              s.re2[k].add(h_re * h_re);
+              s.im2[k].add(h_im * h_im);
+            }
+          }
+        }
+      });
+
+    // Pairwise reduction; partial[0] holds the total at the end
+    for (size_t stride = 1; stride < num_chunks; stride *= 2) {
+      for (size_t c = 0; c + stride < num_chunks; c += 2 * stride)
+        partial[c].add(partial[c + stride]);
+    }
+
+    for (int i = 0; i < R; i++) {
+      for (int j = i; j < R; j++) {
+        const int k = likelihood::packed_index(i, j, R);
+        set_element(res, i, j, partial[0].re[k].value(),
+                    partial[0].im[k].value(), partial[0].re2[k].value(),
+                    partial[0].im2[k].value(), volume);
+      }
+    }
+    return res;
+  }
+
+
+  /**
+   * normalization normalization_integral(amplitude_vector, points, volume)
+   *
+   * Monte Carlo estimate of I[i,j] = int conj(A_i(y)) A_j(y) dy.
+   *
+   * @tparam F Callable, CV_t<double> F(const Eigen::VectorXd&); must be
+   *           safe to call from several threads (e.g. amplitude_vector)
+   * @param points Phase space points, uniformly distributed
+   * @param volume Volume of the phase space
+   */
+  template <typename F>
+  inline normalization
+  normalization_integral(const F& amplitude_vector,
+                         const std::vector<Eigen::VectorXd>& points,
+                         double volume) {
+    return normalization_sum(
+      amplitude_vector, points.size(),
+      [&](size_t n, Eigen::VectorXd&) -> const Eigen::VectorXd& {
+        return points[n];
+      },
+      volume);
+  }
+
+
+  /**
+   * normalization normalization_integral(amplitude_vector, y, num_var, N,
+   *                                      volume)
+   *
+   * As above, for the N points given by columns, y[v][n] for variable
+   * v < num_var and point n; each point is gathered into a vector on the
+   * thread that evaluates it.
+   */
+  template <typename F>
+  inline normalization
+  normalization_integral(const F& amplitude_vector, const double* const* y,
+                         size_t num_var, size_t N, double volume) {
+    return normalization_sum(
+      amplitude_vector, N,
+      [&](size_t n, Eigen::VectorXd& p) -> const Eigen::VectorXd& {
+        p.resize(num_var);
+        for (size_t v = 0; v < num_var; v++)
+          p(v) = y[v][n];
+        return p;
+      },
+      volume);
+  }
+
+}
+}
+#endif
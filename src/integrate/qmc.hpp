@@ -0,0 +1,201 @@
+#ifndef STAN_PWA__SRC__INTEGRATE__QMC_HPP
+#define STAN_PWA__SRC__INTEGRATE__QMC_HPP
+
+#include <algorithm> // min
+#include <cmath> // cos, sin, sqrt
+#include <stdexcept> // domain_error
+#include <vector>
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+
+#include <stan_pwa/src/generate/accept_reject.hpp> // block_rng
+#include <stan_pwa/src/generate/phase_space.hpp> // dalitz_space
+#include <stan_pwa/src/integrate/kahan.hpp>
+#include <stan_pwa/src/integrate/normalization.hpp>
+#include <stan_pwa/src/integrate/sobol.hpp>
+#include <stan_pwa/src/likelihood/packed_hermitian.hpp> // packed_index
+#include <stan_pwa/src/parallel.hpp>
+#include <stan_pwa/src/typedefs.h>
+
+/*
+ *  Quasi-Monte Carlo normalization integral over the Dalitz plot.
+ *
+ *  DESCRIPTION
+ *    normalization_integral averages over random points of the box
+ *    around the phase space; the points outside are wasted and the error
+ *    falls as 1/sqrt(N). Here, the points u of a scrambled Sobol sequence
+ *    (see sobol.hpp) in the unit square are mapped onto the Dalitz plot
+ *    itself,
+ *
+ *      m2_ab = ab_lo + (ab_hi - ab_lo) t(u_0),
+ *      m2_bc = bc_lo(m2_ab) + (bc_hi(m2_ab) - bc_lo(m2_ab)) u_1,
+ *
+ *    with the exact limits of m2_bc for every m2_ab
+ *    (dalitz_space::m2_bc_range), so that no point is rejected, and
+ *
+ *      I[i,j] = int w(u) conj(A_i(y(u))) A_j(y(u)) du
+ *
+ *    with the Jacobian w(u) = (ab_hi - ab_lo) t'(u_0) (bc_hi - bc_lo).
+ *    The width bc_hi - bc_lo goes as the square root of the distance to
+ *    the ends of the m2_ab range; t(u) = (1 - cos(pi u)) / 2 makes the
+ *    integrand smooth there, which the Sobol points need to converge
+ *    faster than random ones.
+ *
+ *    The integral is estimated by num_replicas independently scrambled
+ *    copies of the first num_points points of the sequence (randomized
+ *    QMC): I is the mean of their estimates, and its standard error
+ *    follows from their spread. For smooth amplitudes the error falls
+ *    nearly as 1/num_points; use a power of 2 for num_points.
+ *
+ *    The chunks of points of all replicas are evaluated on the thread
+ *    pool with Kahan summation, and added pairwise in a fixed order per
+ *    replica. The scrambles only depend on the seed, so the result does
+ *    not depend on the number of threads.
+ *
+ *  FUNCTIONS
+ *    double dalitz_map(space, u, y)
+ *    normalization qmc_normalization_integral(amplitude_vector, space,
+ *                                             num_points, num_replicas, seed)
+ */
+
+namespace stan_pwa {
+namespace integrate {
+
+  /**
+   * double dalitz_map(space, u, y)
+   *
+   * Maps u in the unit square to the point y = (m2_ab, m2_bc) of the
+   * Dalitz plot (see above) and returns the Jacobian w(u).
+   */
+  inline double
+  dalitz_map(const generate::dalitz_space& space, const double* u,
+             Eigen::VectorXd& y) {
+    const double pi = 3.14159265358979323846;
+    const double ab_range = space.upper(0) - space.lower(0);
+    y.resize(2);
+    y(0) = space.lower(0) + ab_range * 0.5 * (1.0 - std::cos(pi * u[0]));
+    double lo, hi;
+    space.m2_bc_range(y(0), lo, hi);
+    y(1) = lo + (hi - lo) * u[1];
+    return ab_range * 0.5 * pi * std::sin(pi * u[0]) * (hi - lo);
+  }
+
+
+  /**
+   * normalization qmc_normalization_integral(amplitude_vector, space,
+   *                                          num_points, num_replicas, seed)
+   *
+   * Randomized quasi-Monte Carlo estimate of
+   * I[i,j] = int conj(A_i(y)) A_j(y) dy over the Dalitz plot (see above),
+   * from num_replicas >= 2 replicas of num_points points each.
+   *
+   * @tparam F Callable, CV_t<double> F(const Eigen::VectorXd&); must be
+   *           safe to call from several threads (e.g. amplitude_vector)
+   */
+  template <typename F>
+  inline normalization
+  qmc_normalization_integral(const F& amplitude_vector,
+                             const generate::dalitz_space& space,
+                             size_t num_points, size_t num_replicas,
+                             unsigned long seed) {
+
+    if (num_replicas < 2)
+      throw std::domain_error("qmc_normalization_integral: at least 2 "
+                              "replicas are needed for the errors");
+    if (num_points == 0 || num_points > 4294967296ULL)
+      throw std::domain_error("qmc_normalization_integral: the number of "
+                              "points must be in 1 .. 2^32");
+
+    // Scrambles of the replicas (stream 2 of the seed, see block_rng)
+    std::vector<scrambled_sobol> sobol;
+    for (size_t r = 0; r < num_replicas; r++) {
+      std::mt19937_64 rng = generate::block_rng(seed, 2, r);
+      sobol.push_back(scrambled_sobol(2, rng));
+    }
+
+    Eigen::VectorXd y0;
+    const double u0[2] = {0.5, 0.5};
+    dalitz_map(space, u0, y0);
+    const int R = amplitude_vector(y0)[0].rows();
+    const int P = R * (R + 1) / 2;
+
+    const size_t chunks_per_replica = (num_points + points_per_chunk - 1)
+      / points_per_chunk;
+    const size_t num_chunks = num_replicas * chunks_per_replica;
+    std::vector<std::vector<kahan_sum> > partial(num_chunks);
+
+    parallel::thread_pool::instance().run(num_chunks, [&](size_t c) {
+        std::vector<kahan_sum>& s = partial[c];
+        s.resize(2 * P);
+        const scrambled_sobol& sequence = sobol[c / chunks_per_replica];
+        const size_t begin = (c % chunks_per_replica) * points_per_chunk;
+        const size_t end = std::min(begin + points_per_chunk, num_points);
+        double u[2];
+        Eigen::VectorXd y(2);
+        for (size_t n = begin; n < end; n++) {
+          sequence.point(n, u);
+          const double w = dalitz_map(space, u, y);
+          const CV_t<double> A = amplitude_vector(y);
+          int k = 0;
+          for (int i = 0; i < R; i++) {
+            for (int j = i; j < R; j++, k++) {
+              s[2 * k].add(w * (A[0](i) * A[0](j) + A[1](i) * A[1](j)));
+              s[2 * k + 1].add(w * (A[0](i) * A[1](j) - A[1](i) * A[0](j)));
+            }
+          }
+        }
+      });
+
+    // Pairwise reduction per replica; partial[r * chunks_per_replica]
+    // holds the total of replica r at the end
+    for (size_t r = 0; r < num_replicas; r++) {
+      std::vector<kahan_sum>* p = &partial[r * chunks_per_replica];
+      for (size_t stride = 1; stride < chunks_per_replica; stride *= 2) {
+        for (size_t c = 0; c + stride < chunks_per_replica; c += 2 * stride) {
+          for (int k = 0; k < 2 * P; k++)
+            p[c][k].add(p[c + stride][k]);
+        }
+      }
+    }
+
+    normalization res;
+    res.num_points = num_points * num_replicas;
+    res.I.assign(2, Eigen::MatrixXd::Zero(R, R));
+    res.err.assign(2, Eigen::MatrixXd::Zero(R, R));
+
+    // Mean and standard error of the estimates of the replicas
+    const double K = num_replicas;
+    for (int i = 0; i < R; i++) {
+      for (int j = i; j < R; j++) {
+        const int k = likelihood::packed_index(i, j, R);
+        double m[2], err[2];
+        for (int part = 0; part < 2; part++) {
+          std::vector<double> e(num_replicas);
+          kahan_sum sum;
+          for (size_t r = 0; r < num_replicas; r++) {
+            e[r] = partial[r * chunks_per_replica][2 * k + part].value()
+              / num_points;
+            sum.add(e[r]);
+          }
+          m[part] = sum.value() / K;
+          kahan_sum sum2;
+          for (size_t r = 0; r < num_replicas; r++)
+            sum2.add((e[r] - m[part]) * (e[r] - m[part]));
+          err[part] = std::sqrt(sum2.value() / (K - 1) / K);
+        }
+
+        res.I[0](i,j) = res.I[0](j,i) = m[0];
+        if (i != j) {
+          res.I[1](i,j) = m[1];
+          res.I[1](j,i) = -m[1];
+        }
+        res.err[0](i,j) = res.err[0](j,i) = err[0];
+        res.err[1](i,j) = res.err[1](j,i) = err[1];
+      }
+    }
+    return res;
+  }
+
+}
+}
+#endif
@@ -0,0 +1,153 @@
+#ifndef STAN_PWA__SRC__INTEGRATE__SOBOL_HPP
+#define STAN_PWA__SRC__INTEGRATE__SOBOL_HPP
+
+#include <cstdint> // uint32_t
+#include <random>
+#include <stdexcept> // domain_error
+#include <vector>
+
+/*
+ *  Scrambled Sobol sequences in up to 8 dimensions.
+ *
+ *  DESCRIPTION
+ *    The Sobol sequence (with the direction numbers of Joe and Kuo,
+ *    "Constructing Sobol sequences with better two-dimensional
+ *    projections", 2008) fills the unit cube far more evenly than
+ *    random points: for smooth integrands, the error of the mean over
+ *    N = 2^m points falls almost as 1/N instead of 1/sqrt(N).
+ *
+ *    The points are randomized by a random linear matrix scramble and a
+ *    random digital shift (Matousek, "On the L2-discrepancy for
+ *    anchored boxes", 1998): every point is then uniformly distributed
+ *    over the cube, while the whole set keeps the structure of the
+ *    sequence. Means over independently scrambled copies (replicas) are
+ *    independent, unbiased estimates of the integral, whose spread gives
+ *    its error (see qmc.hpp).
+ *
+ *    Point n is computed from n directly (in Gray code order), so chunks
+ *    of points can be generated on different threads.
+ *
+ *  FUNCTIONS
+ *    scrambled_sobol(dim)
+ *    scrambled_sobol(dim, rng)
+ *    void scrambled_sobol::point(n, u)
+ */
+
+namespace stan_pwa {
+namespace integrate {
+
+  /**
+   * Points of a Sobol sequence in [0,1)^dim, scrambled by a random
+   * engine or not (see above).
+   */
+  class scrambled_sobol {
+  public:
+    static const int max_dim = 8;
+    static const int num_bits = 32;
+
+    ///> Sobol sequence without scrambling
+    explicit scrambled_sobol(int dim) : dim_(dim), v_(), shift_(dim, 0) {
+      direction_numbers();
+    };
+
+    /**
+     * Sobol sequence scrambled with random numbers from rng
+     *
+     * @tparam RNG Random engine, e.g. std::mt19937_64
+     */
+    template <typename RNG>
+    scrambled_sobol(int dim, RNG& rng) : dim_(dim), v_(), shift_(dim) {
+      direction_numbers();
+      std::uniform_int_distribution<uint32_t> bits;
+      for (int d = 0; d < dim_; d++) {
+        // Lower triangular matrix with unit diagonal; row k gives bit k
+        // (counted from the most significant one) of the scrambled point
+        uint32_t L[num_bits];
+        for (int k = 0; k < num_bits; k++) {
+          const uint32_t diagonal = 1U << (num_bits - 1 - k);
+          const uint32_t above = k == 0 ? 0 : ~((diagonal << 1) - 1);
+          L[k] = diagonal | (bits(rng) & above);
+        }
+        for (int j = 0; j < num_bits; j++) {
+          const uint32_t v = v_[d * num_bits + j];
+          uint32_t w = 0;
+          for (int k = 0; k < num_bits; k++) {
+            if (parity(L[k] & v))
+              w |= 1U << (num_bits - 1 - k);
+          }
+          v_[d * num_bits + j] = w;
+        }
+        shift_[d] = bits(rng);
+      }
+    };
+
+    int dim() const { return dim_; }
+
+    /**
+     * Writes point n of the sequence (n < 2^32) to u[0] .. u[dim - 1],
+     * all in (0,1).
+     */
+    void point(uint32_t n, double* u) const {
+      const uint32_t gray = n ^ (n >> 1);
+      for (int d = 0; d < dim_; d++) {
+        uint32_t x = shift_[d];
+        const uint32_t* v = &v_[d * num_bits];
+        for (uint32_t g = gray; g != 0; g >>= 1, v++) {
+          if (g & 1)
+            x ^= *v;
+        }
+        u[d] = (x + 0.5) * (1.0 / 4294967296.0);
+      }
+    }
+
+  private:
+    ///> Direction numbers v_[d * num_bits + k] of the Sobol sequence
+    void direction_numbers() {
+      if (dim_ < 1 || dim_ > max_dim)
+        throw std::domain_error("scrambled_sobol: dimension must be in "
+                                "1 .. 8");
+      // Joe-Kuo (new-joe-kuo-6.21201): degree s, coefficients a, m_1..m_s
+      static const int s[max_dim] = {0, 1, 2, 3, 3, 4, 4, 5};
+      static const uint32_t a[max_dim] = {0, 0, 1, 1, 2, 1, 4, 2};
+      static const uint32_t m_init[max_dim][5] = {
+        {0, 0, 0, 0, 0}, {1, 0, 0, 0, 0}, {1, 3, 0, 0, 0}, {1, 3, 1, 0, 0},
+        {1, 1, 1, 0, 0}, {1, 1, 3, 3, 0}, {1, 3, 5, 13, 0},
+        {1, 1, 5, 5, 17}};
+
+      v_.assign(dim_ * num_bits, 0);
+      for (int k = 0; k < num_bits; k++)
+        v_[k] = 1U << (num_bits - 1 - k);
+      for (int d = 1; d < dim_; d++) {
+        uint32_t m[num_bits];
+        for (int k = 0; k < num_bits; k++) {
+          if (k < s[d]) {
+            m[k] = m_init[d][k];
+          } else {
+            m[k] = m[k - s[d]] ^ (m[k - s[d]] << s[d]);
+            for (int j = 1; j < s[d]; j++) {
+              if ((a[d] >> (s[d] - 1 - j)) & 1)
+                m[k] ^= m[k - j] << j;
+            }
+          }
+          v_[d * num_bits + k] = m[k] << (num_bits - 1 - k);
+        }
+      }
+    }
+
+    static bool parity(uint32_t x) {
+      x ^= x >> 16;
+      x ^= x >> 8;
+      x ^= x >> 4;
+      x ^= x >> 2;
+      x ^= x >> 1;
+      return x & 1;
+    }
+
+    int dim_;
+    std::vector<uint32_t> v_;
+    std::vector<uint32_t> shift_;
+  };
+
+}
+}
+#endif
@@ -0,0 +1,403 @@
+#ifndef STAN_PWA__SRC__INTEGRATE__VEGAS_HPP
+#define STAN_PWA__SRC__INTEGRATE__VEGAS_HPP
+
+#include <algorithm> // max, min
+#include <cmath> // log, pow, sqrt
+#include <random>
+#include <stdexcept> // domain_error
+#include <vector>
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+
+#include <stan_pwa/src/generate/accept_reject.hpp> // block_rng
+#include <stan_pwa/src/generate/phase_space.hpp>
+#include <stan_pwa/src/integrate/kahan.hpp>
+#include <stan_pwa/src/integrate/normalization.hpp>
+#include <stan_pwa/src/likelihood/packed_hermitian.hpp> // packed_index
+#include <stan_pwa/src/parallel.hpp>
+#include <stan_pwa/src/typedefs.h>
+
+/*
+ *  Adaptive (VEGAS) normalization integral for narrow resonances.
+ *
+ *  DESCRIPTION
+ *    With narrow resonances such as omega_782, almost all of
+ *    conj(A_i) A_j sits in a thin band of the phase space, which uniform
+ *    points rarely hit. VEGAS (G. P. Lepage, J. Comput. Phys. 27 (1978)
+ *    192) draws the points from a density that follows the integrand:
+ *    every axis of the box around the phase space is split into
+ *    num_bins bins of equal probability, and the bins are moved after
+ *    every iteration so that they become narrow where the integrand is
+ *    large (e.g. at the peak of a resonance in its m2). Points outside
+ *    of the phase space (space.valid) count as zero.
+ *
+ *    The grid follows the driver g(y) = sum_i |A_i(y)|^2 / I[i,i], in
+ *    which every resonance has the same weight, however small its
+ *    integral. Each iteration draws points_per_iteration points, in
+ *    chunks with their own random streams on the thread pool, and gives
+ *    an independent estimate I_t of I with errors err_t. After
+ *    warmup_iterations iterations, which only adapt the grid, the
+ *    estimates are combined as
+ *
+ *      I   = sum_t w_t I_t / sum_t w_t,
+ *      err = sqrt(sum_t w_t^2 err_t^2) / sum_t w_t,
+ *
+ *    with w_t the inverse relative variance of the driver integral in
+ *    iteration t; the same weight for all elements keeps I hermitian
+ *    and positive semi-definite. The iterations stop when the error of
+ *    every element is at most rel_tol sqrt(I[i,i] I[j,j]) (the bound of
+ *    |I[i,j]|, which also measures elements close to 0), or after
+ *    max_iterations.
+ *
+ *    The points only depend on the seed, and the sums are added in a
+ *    fixed order: the result does not depend on the number of threads.
+ *
+ *  FUNCTIONS
+ *    vegas_grid(lower, upper, num_bins)
+ *    double vegas_grid::map(u, y, bin)
+ *    void vegas_grid::refine(d, alpha)
+ *    normalization vegas_normalization_integral(amplitude_vector, space,
+ *                                               options, info)
+ */
+
+namespace stan_pwa {
+namespace integrate {
+
+  /**
+   * Separable VEGAS grid over the box [lower, upper]: num_bins bins per
+   * axis, each of probability 1 / num_bins.
+   */
+  class vegas_grid {
+  public:
+    vegas_grid(const Eigen::VectorXd& lower, const Eigen::VectorXd& upper,
+               int num_bins) :
+      dim_(lower.rows()), num_bins_(num_bins), x_(dim_ * (num_bins + 1))
+    {
+      for (int d = 0; d < dim_; d++) {
+        for (int k = 0; k <= num_bins_; k++)
+          edge(d, k) = lower(d) + (upper(d) - lower(d)) * k / num_bins_;
+      }
+    };
+
+    int dim() const { return dim_; }
+    int num_bins() const { return num_bins_; }
+
+    ///> Edge k (0 .. num_bins) of axis d
+    double edge(int d, int k) const { return x_[d * (num_bins_ + 1) + k]; }
+
+    /**
+     * Maps u in [0,1)^dim to the point y of the box, writes the bin of
+     * every axis to bin[0 .. dim - 1] and returns the Jacobian (the
+     * inverse of the density of y).
+     */
+    double map(const double* u, Eigen::VectorXd& y, int* bin) const {
+      double jacobian = 1.0;
+      for (int d = 0; d < dim_; d++) {
+        const double t = u[d] * num_bins_;
+        const int k = std::min((int)t, num_bins_ - 1);
+        const double width = edge(d, k + 1) - edge(d, k);
+        y(d) = edge(d, k) + (t - k) * width;
+        jacobian *= num_bins_ * width;
+        bin[d] = k;
+      }
+      return jacobian;
+    }
+
+    /**
+     * void refine(d, alpha)
+     *
+     * Moves the edges so that every bin gets the same share of the
+     * (smoothed, damped) sums d[axis * num_bins + k] of (g * jacobian)^2
+     * over the points of bin k; alpha (usually 0.5 .. 2) sets how fast
+     * the grid adapts. Axes without any sum are kept.
+     */
+    void refine(const std::vector<double>& d, double alpha) {
+      std::vector<double> r(num_bins_);
+      std::vector<double> x_new(num_bins_ + 1);
+      for (int a = 0; a < dim_; a++) {
+        const double* s = &d[a * num_bins_];
+
+        // Smoothing over neighbouring bins
+        double total = 0.0;
+        for (int k = 0; k < num_bins_; k++) {
+          const int lo = std::max(k - 1, 0);
+          const int hi = std::min(k + 1, num_bins_ - 1);
+          double sum = 0.0;
+          for (int j = lo; j <= hi; j++)
+            sum += s[j];
+          r[k] = sum / (hi - lo + 1);
+          total += r[k];
+        }
+        if (!(total > 0.0))
+          continue;
+
+        // Damping; bins without points keep a small width, so that no
+        // part of the box is dropped
+        double r_total = 0.0;
+        for (int k = 0; k < num_bins_; k++) {
+          const double f = std::max(r[k] / total, 1e-12);
+          r[k] = f >= 1.0 ? 1.0 : std::pow((f - 1.0) / std::log(f), alpha);
+          r_total += r[k];
+        }
+
+        // New edges, with r_total / num_bins in every bin
+        const double delta = r_total / num_bins_;
+        double acc = 0.0;
+        int k = -1;
+        x_new[0] = edge(a, 0);
+        for (int i = 1; i < num_bins_; i++) {
+          while (acc < delta && k < num_bins_ - 1)
+            acc += r[++k];
+          acc -= delta;
+          x_new[i] = edge(a, k + 1)
+            - (edge(a, k + 1) - edge(a, k)) * std::max(acc, 0.0) / r[k];
+        }
+        x_new[num_bins_] = edge(a, num_bins_);
+        for (int i = 0; i <= num_bins_; i++)
+          edge(a, i) = x_new[i];
+      }
+    }
+
+  private:
+    double& edge(int d, int k) { return x_[d * (num_bins_ + 1) + k]; }
+
+    int dim_;
+    int num_bins_;
+    std::vector<double> x_;
+  };
+
+
+  ///> Parameters of vegas_normalization_integral
+  struct vegas_options {
+    size_t points_per_iteration;
+    size_t warmup_iterations; ///> Iterations that only adapt the grid
+    size_t max_iterations;    ///> Including the warmup iterations
+    int num_bins;             ///> Bins per axis
+    double alpha;             ///> Damping of the grid refinement
+    double rel_tol;           ///> Target error, relative to sqrt(I_ii I_jj)
+    unsigned long seed;
+
+    vegas_options() :
+      points_per_iteration(1000000), warmup_iterations(3),
+      max_iterations(50), num_bins(100), alpha(1.5), rel_tol(1e-3), seed(1)
+    {};
+  };
+
+
+  ///> Course of a run of vegas_normalization_integral
+  struct vegas_info {
+    size_t iterations;  ///> Iterations done, including the warmup
+    bool converged;     ///> Whether rel_tol was reached
+    double max_rel_err; ///> Largest error relative to sqrt(I_ii I_jj)
+    double chi2_dof;    ///> Spread of I[i,i] over the combined iterations
+
+    vegas_info() : iterations(0), converged(false), max_rel_err(0.0),
+                   chi2_dof(0.0) {};
+  };
+
+
+  /**
+   * normalization vegas_normalization_integral(amplitude_vector, space,
+   *                                            options, info)
+   *
+   * Adaptive Monte Carlo estimate of I[i,j] = int conj(A_i(y)) A_j(y) dy
+   * over the phase space (see above). num_points of the result counts
+   * all points drawn, including the warmup; info receives the number of
+   * iterations, whether rel_tol was reached, the largest relative error
+   * and the chi^2 per degree of freedom of the estimates of I[i,i] in
+   * the combined iterations (much larger than 1: the warmup was too
+   * short).
+   *
+   * @tparam F Callable, CV_t<double> F(const Eigen::VectorXd&); must be
+   *           safe to call from several threads (e.g. amplitude_vector)
+   * @tparam S Phase space (generate::dalitz_space, four_body_space)
+   */
+  template <typename F, typename S>
+  inline normalization
+  vegas_normalization_integral(const F& amplitude_vector, const S& space,
+                               const vegas_options& options,
+                               vegas_info& info) {
+
+    const size_t N = options.points_per_iteration;
+    if (N < 2 || options.num_bins < 1
+        || options.max_iterations <= options.warmup_iterations)
+      throw std::domain_error("vegas_normalization_integral: need at least "
+                              "2 points, 1 bin and 1 iteration after the "
+                              "warmup");
+
+    const int D = space.dim();
+    const int B = options.num_bins;
+    const int R = amplitude_vector(0.5 * (space.lower + space.upper))[0]
+      .rows();
+    const int P = R * (R + 1) / 2;
+
+    vegas_grid grid(space.lower, space.upper, B);
+    Eigen::VectorXd scale = Eigen::VectorXd::Ones(R); // 1 / I[i,i]
+
+    ///> Sums of a chunk of points
+    struct chunk_sums {
+      tensor_sums h;              // of w conj(A_i) A_j
+      kahan_sum g, g2;            // of w g and (w g)^2
+      std::vector<double> d;      // (w g)^2 per axis and bin
+    };
+
+    // Combined estimates: sum_t w_t I_t and sum_t w_t^2 err_t^2
+    std::vector<double> c_re(P, 0.0), c_im(P, 0.0);
+    std::vector<double> c_var_re(P, 0.0), c_var_im(P, 0.0);
+    double c_w = 0.0;
+    // I[i,i] and its error in the combined iterations, for chi2_dof
+    std::vector<Eigen::VectorXd> diag, diag_err;
+
+    normalization res;
+    res.num_points = 0;
+    res.I.assign(2, Eigen::MatrixXd::Zero(R, R));
+    res.err.assign(2, Eigen::MatrixXd::Zero(R, R));
+    info = vegas_info();
+
+    const size_t num_chunks = (N + points_per_chunk - 1) / points_per_chunk;
+    for (size_t t = 0; t < options.max_iterations; t++) {
+      std::vector<chunk_sums> partial(num_chunks);
+
+      parallel::thread_pool::instance().run(num_chunks, [&](size_t c) {
+          chunk_sums& s = partial[c];
+          s.h = tensor_sums(P);
+          s.d.assign(D * B, 0.0);
+          std::mt19937_64 rng = generate::block_rng(options.seed, 3,
+                                                    t * num_chunks + c);
+          std::uniform_real_distribution<double> uniform(0.0, 1.0);
+          std::vector<double> u(D);
+          std::vector<int> bin(D);
+          Eigen::VectorXd y(D);
+          const size_t end = std::min((c + 1) * points_per_chunk, N);
+          for (size_t n = c * points_per_chunk; n < end; n++) {
+            for (int d = 0; d < D; d++)
+              u[d] = uniform(rng);
+            const double w = grid.map(u.data(), y, bin.data());
+            if (!space.valid(y))
+              continue; // Adds 0 to all sums
+            const CV_t<double> A = amplitude_vector(y);
+            double g = 0.0;
+            int k = 0;
+            for (int i = 0; i < R; i++) {
+              g += scale(i) * (A[0](i) * A[0](i) + A[1](i) * A[1](i));
+              for (int j = i; j < R; j++, k++) {
+                const double h_re = w * (A[0](i) * A[0](j)
+                                         + A[1](i) * A[1](j));
+                const double h_im = w * (A[0](i) * A[1](j)
+                                         - A[1](i) * A[0](j));
+                s.h.re[k].add(h_re);
+                s.h.im[k].add(h_im);
+                s.h.re2[k].add(h_re * h_re);
+                s.h.im2[k].add(h_im * h_im);
+              }
+            }
+            const double wg = w * g;
+            s.g.add(wg);
+            s.g2.add(wg * wg);
+            for (int d = 0; d < D; d++)
+              s.d[d * B + bin[d]] += wg * wg;
+          }
+        });
+
+      // Pairwise reduction; partial[0] holds the total at the end
+      for (size_t stride = 1; stride < num_chunks; stride *= 2) {
+        for (size_t c = 0; c + stride < num_chunks; c += 2 * stride) {
+          chunk_sums& s = partial[c];
+          const chunk_sums& o = partial[c + stride];
+          s.h.add(o.h);
+          s.g.add(o.g);
+          s.g2.add(o.g2);
+          for (int k = 0; k < D * B; k++)
+            s.d[k] += o.d[k];
+        }
+      }
+      const chunk_sums& s = partial[0];
+      res.num_points += N;
+      info.iterations = t + 1;
+
+      // Estimate of this iteration
+      normalization it;
+      it.num_points = N;
+      it.I.assign(2, Eigen::MatrixXd::Zero(R, R));
+      it.err.assign(2, Eigen::MatrixXd::Zero(R, R));
+      for (int i = 0; i < R; i++) {
+        for (int j = i; j < R; j++) {
+          const int k = likelihood::packed_index(i, j, R);
+          set_element(it, i, j, s.h.re[k].value(), s.h.im[k].value(),
+                      s.h.re2[k].value(), s.h.im2[k].value(), 1.0);
+        }
+      }
+      const double G = s.g.value() / N;
+      const double G_var = std::max(s.g2.value() / N - G * G, 0.0) / N;
+
+      if (t >= options.warmup_iterations && G > 0.0 && G_var > 0.0) {
+        const double w = G * G / G_var;
+        for (int i = 0; i < R; i++) {
+          for (int j = i; j < R; j++) {
+            const int k = likelihood::packed_index(i, j, R);
+            c_re[k] += w * it.I[0](i,j);
+            c_im[k] += w * it.I[1](i,j);
+            c_var_re[k] += w * w * it.err[0](i,j) * it.err[0](i,j);
+            c_var_im[k] += w * w * it.err[1](i,j) * it.err[1](i,j);
+          }
+        }
+        c_w += w;
+        diag.push_back(it.I[0].diagonal());
+        diag_err.push_back(it.err[0].diagonal());
+
+        // Combined result and its largest relative error
+        info.max_rel_err = 0.0;
+        for (int i = 0; i < R; i++) {
+          for (int j = i; j < R; j++) {
+            const int k = likelihood::packed_index(i, j, R);
+            res.I[0](i,j) = res.I[0](j,i) = c_re[k] / c_w;
+            if (i != j) {
+              res.I[1](i,j) = c_im[k] / c_w;
+              res.I[1](j,i) = -c_im[k] / c_w;
+            }
+            res.err[0](i,j) = res.err[0](j,i) = std::sqrt(c_var_re[k]) / c_w;
+            res.err[1](i,j) = res.err[1](j,i) = std::sqrt(c_var_im[k]) / c_w;
+          }
+        }
+        for (int i = 0; i < R; i++) {
+          for (int j = i; j < R; j++) {
+            const double bound = std::sqrt(res.I[0](i,i) * res.I[0](j,j));
+            for (int part = 0; part < 2; part++) {
+              const double e = bound > 0.0 ? res.err[part](i,j) / bound : 0.0;
+              info.max_rel_err = std::max(info.max_rel_err, e);
+            }
+          }
+        }
+        info.converged = info.max_rel_err <= options.rel_tol;
+
+        // Spread of the iterations around the combined I[i,i]
+        info.chi2_dof = 0.0;
+        if (diag.size() > 1) {
+          for (size_t c = 0; c < diag.size(); c++) {
+            for (int i = 0; i < R; i++) {
+              if (diag_err[c](i) > 0.0) {
+                const double z = (diag[c](i) - res.I[0](i,i))
+                  / diag_err[c](i);
+                info.chi2_dof += z * z;
+              }
+            }
+          }
+          info.chi2_dof /= R * (diag.size() - 1.0);
+        }
+        if (info.converged)
+          break;
+      }
+
+      // Adapt the grid and the driver to this iteration
+      grid.refine(s.d, options.alpha);
+      for (int i = 0; i < R; i++) {
+        if (it.I[0](i,i) > 0.0)
+          scale(i) = 1.0 / it.I[0](i,i);
+      }
+    }
+    return res;
+  }
+
+}
+}
+#endif
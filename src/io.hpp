@@ -0,0 +1,29 @@
+#ifndef STAN_PWA__SRC__IO_HPP
+#define STAN_PWA__SRC__IO_HPP
+
+#include <stan_pwa/src/io/amplitude_column.hpp>
+#include <stan_pwa/src/io/binary_file.hpp>
+#include <stan_pwa/src/io/columns.hpp>
+#include <stan_pwa/src/io/event_store.hpp>
+#include <stan_pwa/src/io/rdump.hpp>
+#include <stan_pwa/src/io/rdump_writer.hpp>
+#include <stan_pwa/src/io/stan_csv.hpp>
+
+/*
+ *  Input and output in the file formats of CmdStan.
+ *
+ *  DESCRIPTION
+ *    Reading of the CmdStan output (*.csv) and writing of STAN data
+ *    (*.data.R), for the native tools in stan_pwa/tools; a binary
+ *    columnar format for large outputs, a binary store of events and
+ *    amplitudes that is memory-mapped by the fit instead of being parsed,
+ *    and memory-mapped amplitude columns of single resonances, with the
+ *    header and temporary file handling they share.
+ *
+ *  FUNCTIONS
+ *    Are currently listed in particular files - amplitude_column.hpp,
+ *    binary_file.hpp, columns.hpp, event_store.hpp, rdump.hpp,
+ *    rdump_writer.hpp, stan_csv.hpp.
+ */
+
+#endif
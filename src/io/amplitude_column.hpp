@@ -0,0 +1,210 @@
+#ifndef STAN_PWA__SRC__IO__AMPLITUDE_COLUMN_HPP
+#define STAN_PWA__SRC__IO__AMPLITUDE_COLUMN_HPP
+
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t, uint64_t
+#include <cstring> // memcpy
+#include <stdexcept> // domain_error
+#include <string>
+
+#include <fcntl.h> // open
+#include <sys/mman.h> // mmap, msync
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close, pread, unlink
+
+#include <stan_pwa/src/io/binary_file.hpp>
+
+/*
+ *  Binary column of the amplitudes of one resonance (*.col), memory-mapped.
+ *
+ *  DESCRIPTION
+ *    The values of a single resonance at the N points of a Monte Carlo
+ *    sample, so that the columns of a model can be kept on disk and
+ *    reused by other models with the same resonance and the same sample
+ *    (see stan_pwa/src/integrate/integral_store.hpp).
+ *
+ *    Layout (native byte order, checked by byte_order):
+ *
+ *      offset  size      field
+ *           0     8      magic "SPWAAMP\0"
+ *           8     4      version (amplitude_column_version)
+ *          12     4      size of the header (64)
+ *          16     8      N, number of points
+ *          24     8      resonance hash (resonance_list::resonance_hash)
+ *          32     8      sample hash
+ *          40     8      byte_order
+ *          48    16      reserved (0)
+ *          64   8 N      Re(A) at the N points
+ *               8 N      Im(A) at the N points
+ *
+ *    A new column is written to a temporary file next to the final one,
+ *    and renamed to it by commit() (see binary_file.hpp): readers (e.g.
+ *    parallel jobs) see either no file or a complete one.
+ *
+ *  FUNCTIONS
+ *    mapped_amplitude_column(path, N, resonance_hash, sample_hash)
+ *    mapped_amplitude_column(path, header)
+ *    void mapped_amplitude_column::commit()
+ */
+
+namespace stan_pwa {
+namespace io {
+
+  const char amplitude_column_magic[8] = {'S', 'P', 'W', 'A', 'A', 'M', 'P',
+                                          '\0'};
+  const uint32_t amplitude_column_version = 1;
+
+
+  ///> Header of an amplitude column (the first 64 bytes of the file)
+  struct amplitude_column_header {
+    binary_tag tag;
+    uint64_t N;
+    uint64_t resonance_hash;
+    uint64_t sample_hash;
+    uint64_t byte_order;
+    uint64_t reserved[2];
+
+    ///> Header of a new column
+    amplitude_column_header(uint64_t _N, uint64_t r_hash, uint64_t s_hash) :
+      tag(amplitude_column_magic, amplitude_column_version,
+          sizeof(amplitude_column_header)),
+      N(_N), resonance_hash(r_hash), sample_hash(s_hash),
+      byte_order(native_byte_order) {
+      reserved[0] = reserved[1] = 0;
+    };
+
+    amplitude_column_header() : amplitude_column_header(0, 0, 0) {};
+
+    ///> Size of the file in bytes
+    uint64_t file_size() const { return tag.header_size + 16 * N; }
+  };
+
+
+  /**
+   * Amplitude column mapped into memory.
+   *
+   * mapped_amplitude_column(path, N, resonance_hash, sample_hash) maps an
+   * existing column read-only, after checking that its header matches;
+   * mapped_amplitude_column(path, header) creates a temporary column,
+   * mapped writable, to be filled through column() and published under
+   * path by commit() (it is removed if not committed). Errors throw
+   * std::domain_error. The mapping lives as long as the object.
+   */
+  class mapped_amplitude_column {
+  public:
+    mapped_amplitude_column(const std::string& path, uint64_t N,
+                            uint64_t r_hash, uint64_t s_hash) :
+      path_(path), data_(0), size_(0), writable_(false)
+    {
+      const int fd = ::open(path.c_str(), O_RDONLY);
+      if (fd < 0)
+        throw_errno("amplitude_column", "cannot open", path_);
+      struct stat st;
+      if (::fstat(fd, &st) != 0)
+        throw_errno("amplitude_column", "cannot stat", path_, fd);
+      if (::pread(fd, &header_, sizeof(header_), 0)
+          != (ssize_t)sizeof(header_)) {
+        ::close(fd);
+        throw std::domain_error("amplitude_column: " + path + " is too short");
+      }
+      std::string error = check(header_, st.st_size);
+      if (error.empty() && (header_.N != N || header_.resonance_hash != r_hash
+                            || header_.sample_hash != s_hash))
+        error = "belongs to another resonance or sample";
+      if (!error.empty()) {
+        ::close(fd);
+        throw std::domain_error("amplitude_column: " + path + " " + error);
+      }
+      map(fd, st.st_size);
+    };
+
+    mapped_amplitude_column(const std::string& path,
+                            const amplitude_column_header& header) :
+      path_(path), header_(header), data_(0), size_(0), writable_(true)
+    {
+      size_ = header_.file_size();
+      data_ = map_temp(path, size_, tmp_path_, "amplitude_column");
+      std::memcpy(data_, &header_, sizeof(header_));
+    };
+
+    ~mapped_amplitude_column() {
+      if (data_ != 0)
+        ::munmap(data_, size_);
+      if (writable_)
+        ::unlink(tmp_path_.c_str());
+    };
+
+    const amplitude_column_header& header() const { return header_; }
+
+    ///> Number of points
+    size_t size() const { return header_.N; }
+
+    const double* re() const { return columns(); }
+    const double* im() const { return columns() + header_.N; }
+
+    ///> Writable column c of a new file (0: Re(A), 1: Im(A))
+    double* column(size_t c) {
+      check_writable();
+      return const_cast<double*>(columns()) + c * header_.N;
+    }
+
+    /**
+     * Publishes a new column under its path (an existing file is
+     * replaced); the mapping stays valid, read-only from now on.
+     */
+    void commit() {
+      check_writable();
+      if (::msync(data_, size_, MS_SYNC) != 0)
+        throw_errno("amplitude_column", "cannot write", tmp_path_);
+      writable_ = false;
+      publish_temp(tmp_path_, path_, true, "amplitude_column");
+    }
+
+  private:
+    mapped_amplitude_column(const mapped_amplitude_column&);
+    mapped_amplitude_column& operator=(const mapped_amplitude_column&);
+
+    ///> Reason why h does not describe a valid file of the given size
+    static std::string
+    check(const amplitude_column_header& h, uint64_t size) {
+      const std::string error =
+        check_tag(h.tag, amplitude_column_magic, amplitude_column_version,
+                  sizeof(amplitude_column_header), h.byte_order,
+                  "an amplitude column");
+      if (error.empty() && h.file_size() != size)
+        return "has a wrong size";
+      return error;
+    }
+
+    void check_writable() const {
+      if (!writable_)
+        throw std::domain_error("amplitude_column: " + path_
+                                + " is read-only");
+    }
+
+    ///> Maps the file read-only; the descriptor is not needed afterwards
+    void map(int fd, size_t size) {
+      void* p = ::mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+      if (p == MAP_FAILED)
+        throw_errno("amplitude_column", "cannot map", path_, fd);
+      ::close(fd);
+      data_ = p;
+      size_ = size;
+    }
+
+    const double* columns() const {
+      return reinterpret_cast<const double*>(
+        static_cast<const char*>(data_) + header_.tag.header_size);
+    }
+
+    std::string path_;
+    std::string tmp_path_;
+    amplitude_column_header header_;
+    void* data_;
+    size_t size_;
+    bool writable_;
+  };
+
+}
+}
+#endif
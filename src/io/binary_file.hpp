@@ -0,0 +1,210 @@
+#ifndef STAN_PWA__SRC__IO__BINARY_FILE_HPP
+#define STAN_PWA__SRC__IO__BINARY_FILE_HPP
+
+#include <cerrno>
+#include <cstdint> // uint32_t, uint64_t
+#include <cstdio> // rename, snprintf
+#include <cstdlib> // mkstemp
+#include <cstring> // memcmp, memcpy, strerror
+#include <stdexcept> // domain_error
+#include <string>
+#include <vector>
+
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fchmod
+#include <unistd.h> // close, ftruncate, link, unlink, write
+
+/*
+ *  Common parts of the binary files of stan_pwa.
+ *
+ *  DESCRIPTION
+ *    The binary files (event stores, amplitude columns, columnar tables,
+ *    pair files and cached integrals) all start with
+ *
+ *      offset  size      field
+ *           0     8      magic, e.g. "SPWAEVT\0"
+ *           8     4      version
+ *          12     4      size of the header in bytes (a multiple of 8)
+ *
+ *    (binary_tag) and store native_byte_order in their header, so that a
+ *    file written on a machine with another byte order is rejected.
+ *
+ *    New files are written to a temporary file next to the final one and
+ *    published by rename or link (publish_temp): readers, e.g. parallel
+ *    jobs, see either no file or a complete one. The temporary name is
+ *    made unique by mkstemp, so that jobs on several nodes sharing a
+ *    directory (e.g. over NFS) do not write to the same file.
+ *
+ *  FUNCTIONS
+ *    binary_tag(magic, version, header_size)
+ *    std::string check_tag(tag, magic, version, header_size, byte_order,
+ *                          kind)
+ *    std::string hex(h)
+ *    void throw_errno(who, what, path, fd)
+ *    int create_temp(path, tmp, who)
+ *    void* map_temp(path, size, tmp, who)
+ *    void discard_temp(tmp)
+ *    bool write_all(fd, data, size)
+ *    void publish_temp(tmp, path, replace, who)
+ */
+
+namespace stan_pwa {
+namespace io {
+
+  ///> Stored in the headers, to detect files of another byte order
+  const uint64_t native_byte_order = 0x0102030405060708ULL;
+
+
+  ///> First 16 bytes of the header of a binary file
+  struct binary_tag {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+
+    binary_tag(const char* _magic, uint32_t _version, uint32_t _header_size) :
+      version(_version), header_size(_header_size) {
+      std::memcpy(magic, _magic, sizeof(magic));
+    };
+  };
+
+
+  /**
+   * std::string check_tag(tag, magic, version, header_size, byte_order,
+   *                       kind)
+   *
+   * Reason why a file with this tag and byte_order is not a file of the
+   * given kind (e.g. "an event store") with this magic and version and a
+   * header of at least header_size bytes; empty if it is one.
+   */
+  inline std::string
+  check_tag(const binary_tag& tag, const char* magic, uint32_t version,
+            uint32_t header_size, uint64_t byte_order, const char* kind) {
+    if (std::memcmp(tag.magic, magic, sizeof(tag.magic)) != 0)
+      return std::string("is not ") + kind;
+    if (byte_order != native_byte_order)
+      return "was written with another byte order";
+    if (tag.version != version)
+      return "has an unsupported version";
+    if (tag.header_size < header_size || tag.header_size % 8 != 0)
+      return "has a wrong size";
+    return std::string();
+  }
+
+
+  ///> h in hexadecimal, 16 digits (e.g. for file names)
+  inline std::string hex(uint64_t h) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)h);
+    return buf;
+  }
+
+
+  /**
+   * void throw_errno(who, what, path, fd)
+   *
+   * Throws std::domain_error "who: what path: <message of errno>",
+   * closing fd (if >= 0) first.
+   */
+  inline void throw_errno(const std::string& who, const std::string& what,
+                          const std::string& path, int fd = -1) {
+    const int err = errno;
+    if (fd >= 0)
+      ::close(fd);
+    throw std::domain_error(who + ": " + what + " " + path + ": "
+                            + std::strerror(err));
+  }
+
+
+  ///> Removes the temporary file tmp, keeping errno (e.g. for throw_errno)
+  inline void discard_temp(const std::string& tmp) {
+    const int err = errno;
+    ::unlink(tmp.c_str());
+    errno = err;
+  }
+
+
+  /**
+   * int create_temp(path, tmp, who)
+   *
+   * Creates an empty temporary file path.XXXXXX in the directory of
+   * path, with a unique name (mkstemp) and mode 0644; sets tmp to its
+   * name and returns a descriptor open for reading and writing.
+   */
+  inline int create_temp(const std::string& path, std::string& tmp,
+                         const std::string& who) {
+    std::vector<char> name(path.begin(), path.end());
+    const char suffix[] = ".XXXXXX";
+    name.insert(name.end(), suffix, suffix + sizeof(suffix));
+    const int fd = ::mkstemp(name.data());
+    if (fd < 0)
+      throw_errno(who, "cannot create a temporary file for", path);
+    tmp = name.data();
+    // mkstemp creates the file readable by the owner only
+    if (::fchmod(fd, 0644) != 0) {
+      discard_temp(tmp);
+      throw_errno(who, "cannot create", tmp, fd);
+    }
+    return fd;
+  }
+
+
+  /**
+   * void* map_temp(path, size, tmp, who)
+   *
+   * Creates a temporary file of size bytes for path (see create_temp)
+   * and maps it writable and shared; sets tmp to its name. The file is
+   * removed on error.
+   */
+  inline void* map_temp(const std::string& path, size_t size,
+                        std::string& tmp, const std::string& who) {
+    const int fd = create_temp(path, tmp, who);
+    void* p = ::ftruncate(fd, size) == 0
+      ? ::mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+      : MAP_FAILED;
+    if (p == MAP_FAILED) {
+      discard_temp(tmp);
+      throw_errno(who, "cannot map", tmp, fd);
+    }
+    ::close(fd);
+    return p;
+  }
+
+
+  ///> Writes size bytes of data to fd; false on error
+  inline bool write_all(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+      const ssize_t n = ::write(fd, p, size);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      p += n;
+      size -= n;
+    }
+    return true;
+  }
+
+
+  /**
+   * void publish_temp(tmp, path, replace, who)
+   *
+   * Publishes the complete temporary file tmp (see create_temp) under
+   * path: by rename if replace, replacing an existing file; otherwise by
+   * link, keeping an existing file (e.g. written by a parallel job). tmp
+   * is removed in any case; errors throw std::domain_error.
+   */
+  inline void publish_temp(const std::string& tmp, const std::string& path,
+                           bool replace, const std::string& who) {
+    const bool ok = replace
+      ? std::rename(tmp.c_str(), path.c_str()) == 0
+      : ::link(tmp.c_str(), path.c_str()) == 0 || errno == EEXIST;
+    if (!ok || !replace)
+      discard_temp(tmp);
+    if (!ok)
+      throw_errno(who, "cannot create", path);
+  }
+
+}
+}
+#endif
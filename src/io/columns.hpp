@@ -0,0 +1,255 @@
+#ifndef STAN_PWA__SRC__IO__COLUMNS_HPP
+#define STAN_PWA__SRC__IO__COLUMNS_HPP
+
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t, uint64_t
+#include <fstream>
+#include <stdexcept> // domain_error
+#include <string>
+#include <vector>
+
+#include <unistd.h> // close
+
+#include <stan_pwa/src/io/binary_file.hpp>
+
+/*
+ *  Binary columnar tables (*.col), e.g. of draws or generated events.
+ *
+ *  DESCRIPTION
+ *    A table of named columns of doubles, written in one pass with
+ *    bounded memory: the rows are collected in blocks of up to
+ *    block_rows rows and every block is stored column by column, so a
+ *    column of a block is contiguous (as in the row groups of Parquet).
+ *
+ *    Layout (native byte order, checked by byte_order):
+ *
+ *      magic "SPWACOL\0" (8 bytes), version (uint32), size of the header
+ *      in bytes (uint32, a multiple of 8), number of rows (uint64),
+ *      number of columns C (uint64), block_rows (uint64), byte_order
+ *      (uint64), then C names (uint32 length and the characters), padded
+ *      with zeros to the size of the header;
+ *
+ *      then the blocks: number of rows n of the block (uint64), followed
+ *      by the C columns of n doubles each.
+ *
+ *    The table is written to a temporary file next to the final one and
+ *    renamed to it when it is closed, with the number of rows in the
+ *    header (see binary_file.hpp); a table that is not closed is removed.
+ *    lib/py/utils/columns.py reads the tables into numpy arrays.
+ *
+ *  FUNCTIONS
+ *    column_writer(path, names, block_rows)
+ *    void column_writer::append(rows, n)
+ *    void column_writer::close()
+ *    column_reader(path)
+ *    size_t column_reader::read(block)
+ */
+
+namespace stan_pwa {
+namespace io {
+
+  const char columns_magic[8] = {'S', 'P', 'W', 'A', 'C', 'O', 'L', '\0'};
+  const uint32_t columns_version = 1;
+
+
+  /**
+   * Writer of a columnar table.
+   *
+   * append(rows, n) adds n rows given row by row (rows[r * C + c], as
+   * read by stan_csv_reader); full blocks are written at once. close()
+   * writes the last block and the number of rows, and publishes the
+   * table under path; a writer destroyed before close() (e.g. by an
+   * exception) removes the partial file.
+   * Errors throw std::domain_error.
+   */
+  class column_writer {
+  public:
+    column_writer(const std::string& path,
+                  const std::vector<std::string>& names,
+                  size_t block_rows = 65536) :
+      path_(path), C_(names.size()), block_rows_(block_rows), num_rows_(0),
+      in_block_(0), block_(names.size() * block_rows)
+    {
+      ::close(create_temp(path, tmp_path_, "column_writer"));
+      out_.open(tmp_path_.c_str(), std::ios::binary | std::ios::trunc);
+      if (!out_) {
+        discard_temp(tmp_path_);
+        throw std::domain_error("column_writer: cannot open " + tmp_path_);
+      }
+
+      uint64_t size = 8 + 4 + 4 + 4 * 8;
+      for (size_t c = 0; c < C_; c++)
+        size += 4 + names[c].size();
+      header_size_ = (size + 7) / 8 * 8;
+
+      put(binary_tag(columns_magic, columns_version, header_size_));
+      put<uint64_t>(0); // number of rows, see close()
+      put<uint64_t>(C_);
+      put<uint64_t>(block_rows_);
+      put<uint64_t>(native_byte_order);
+      for (size_t c = 0; c < C_; c++) {
+        put<uint32_t>(names[c].size());
+        out_.write(names[c].data(), names[c].size());
+      }
+      const char zeros[8] = {0};
+      out_.write(zeros, header_size_ - size);
+      check();
+    };
+
+    ///> Without close(), the table is incomplete: the file is removed
+    ~column_writer() {
+      if (out_.is_open()) {
+        out_.close();
+        discard_temp(tmp_path_);
+      }
+    };
+
+    size_t num_cols() const { return C_; }
+
+    ///> Number of rows appended so far
+    uint64_t num_rows() const { return num_rows_; }
+
+    void append(const double* rows, size_t n) {
+      for (size_t r = 0; r < n; r++) {
+        for (size_t c = 0; c < C_; c++)
+          block_[c * block_rows_ + in_block_] = rows[r * C_ + c];
+        if (++in_block_ == block_rows_)
+          flush();
+      }
+      num_rows_ += n;
+    }
+
+    void close() {
+      if (!out_.is_open())
+        return;
+      flush();
+      out_.seekp(16);
+      put<uint64_t>(num_rows_);
+      check();
+      out_.close();
+      if (!out_) {
+        discard_temp(tmp_path_);
+        throw std::domain_error("column_writer: cannot write " + tmp_path_);
+      }
+      publish_temp(tmp_path_, path_, true, "column_writer");
+    }
+
+  private:
+    template <typename T>
+    void put(T x) {
+      out_.write(reinterpret_cast<const char*>(&x), sizeof(x));
+    }
+
+    void flush() {
+      if (in_block_ == 0)
+        return;
+      put<uint64_t>(in_block_);
+      for (size_t c = 0; c < C_; c++)
+        out_.write(reinterpret_cast<const char*>(&block_[c * block_rows_]),
+                   in_block_ * sizeof(double));
+      in_block_ = 0;
+      check();
+    }
+
+    void check() {
+      if (!out_)
+        throw std::domain_error("column_writer: cannot write " + tmp_path_);
+    }
+
+    std::string path_;
+    std::string tmp_path_;
+    std::ofstream out_;
+    const size_t C_;
+    const size_t block_rows_;
+    uint64_t header_size_;
+    uint64_t num_rows_;
+    size_t in_block_;
+    std::vector<double> block_; ///> Column c at c * block_rows_
+  };
+
+
+  /**
+   * Reader of a columnar table, block by block.
+   *
+   * read(block) reads the next block into block (one vector per column)
+   * and returns its number of rows, 0 at the end of the table.
+   */
+  class column_reader {
+  public:
+    explicit column_reader(const std::string& path) :
+      path_(path), in_(path.c_str(), std::ios::binary)
+    {
+      binary_tag tag(columns_magic, 0, 0);
+      in_.read(reinterpret_cast<char*>(&tag), sizeof(tag));
+      if (!in_)
+        fail("is not a columnar table");
+      num_rows_ = get<uint64_t>();
+      const uint64_t C = get<uint64_t>();
+      get<uint64_t>(); // block_rows
+      const uint64_t byte_order = get<uint64_t>();
+      const std::string error = check_tag(tag, columns_magic, columns_version,
+                                          8 + 4 + 4 + 4 * 8, byte_order,
+                                          "a columnar table");
+      if (!error.empty())
+        fail(error);
+      for (uint64_t c = 0; c < C && in_; c++) {
+        std::string name(get<uint32_t>(), '\0');
+        if (!name.empty())
+          in_.read(&name[0], name.size());
+        names_.push_back(name);
+      }
+      in_.seekg(tag.header_size);
+      if (!in_)
+        fail("is too short");
+    };
+
+    const std::vector<std::string>& names() const { return names_; }
+
+    ///> Number of rows, as stored in the header
+    uint64_t num_rows() const { return num_rows_; }
+
+    ///> Index of the column 'name', -1 if there is none
+    int column(const std::string& name) const {
+      for (size_t i = 0; i < names_.size(); i++) {
+        if (names_[i] == name)
+          return i;
+      }
+      return -1;
+    }
+
+    size_t read(std::vector<std::vector<double> >& block) {
+      block.resize(names_.size());
+      uint64_t n;
+      in_.read(reinterpret_cast<char*>(&n), sizeof(n));
+      if (in_.gcount() == 0 && in_.eof())
+        return 0;
+      for (size_t c = 0; c < names_.size(); c++) {
+        block[c].resize(n);
+        in_.read(reinterpret_cast<char*>(block[c].data()), n * sizeof(double));
+      }
+      if (!in_)
+        fail("is truncated");
+      return n;
+    }
+
+  private:
+    template <typename T>
+    T get() {
+      T x = 0;
+      in_.read(reinterpret_cast<char*>(&x), sizeof(x));
+      return x;
+    }
+
+    void fail(const std::string& what) const {
+      throw std::domain_error("column_reader: " + path_ + " " + what);
+    }
+
+    std::string path_;
+    std::ifstream in_;
+    uint64_t num_rows_;
+    std::vector<std::string> names_;
+  };
+
+}
+}
+#endif
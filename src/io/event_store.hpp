@@ -0,0 +1,226 @@
+#ifndef STAN_PWA__SRC__IO__EVENT_STORE_HPP
+#define STAN_PWA__SRC__IO__EVENT_STORE_HPP
+
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t, uint64_t
+#include <cstring> // memcpy
+#include <stdexcept> // domain_error
+#include <string>
+
+#include <fcntl.h> // open
+#include <sys/mman.h> // mmap, msync
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close, pread, unlink
+
+#include <stan_pwa/src/io/binary_file.hpp>
+
+/*
+ *  Binary columnar store of events and amplitudes (*.pwa), memory-mapped.
+ *
+ *  DESCRIPTION
+ *    An alternative to passing amplitude_vector_data[D,2] in the R dump
+ *    format: CmdStan parses R dumps number by number, which dominates the
+ *    start-up for millions of events. The store is mapped into memory
+ *    instead (POSIX mmap) and the likelihood reads the amplitudes in
+ *    place; pages are loaded by the OS on first access and shared by all
+ *    processes mapping the same file (e.g. parallel chains).
+ *
+ *    Layout (native byte order, checked by byte_order):
+ *
+ *      offset  size      field
+ *           0     8      magic "SPWAEVT\0"
+ *           8     4      version (event_store_version)
+ *          12     4      size of the header (64)
+ *          16     8      D, number of events
+ *          24     8      R, number of resonances
+ *          32     8      V, number of variables stored (0: none)
+ *          40     8      model hash (resonance_list::model_hash)
+ *          48     8      byte_order
+ *          56     8      reserved (0)
+ *          64  8 D V     y.1 .. y.V, one column of D doubles each
+ *               8 D R    Re(A_1) .. Re(A_R), one column each
+ *               8 D R    Im(A_1) .. Im(A_R), one column each
+ *
+ *    The amplitude columns are the rows of resonance_list::amplitude_batch
+ *    for all D events, one after the other.
+ *
+ *    A new store is written to a temporary file next to the final one,
+ *    and renamed to it by commit() (see binary_file.hpp): a fit that maps
+ *    the old store is not disturbed, and readers see either no store or
+ *    a complete one.
+ *
+ *  FUNCTIONS
+ *    mapped_event_store(path)
+ *    mapped_event_store(path, header)
+ *    void mapped_event_store::commit()
+ */
+
+namespace stan_pwa {
+namespace io {
+
+  const char event_store_magic[8] = {'S', 'P', 'W', 'A', 'E', 'V', 'T', '\0'};
+  const uint32_t event_store_version = 1;
+
+
+  ///> Header of an event store (the first 64 bytes of the file)
+  struct event_store_header {
+    binary_tag tag;
+    uint64_t D;
+    uint64_t R;
+    uint64_t V;
+    uint64_t model_hash;
+    uint64_t byte_order;
+    uint64_t reserved;
+
+    ///> Header of a new store
+    event_store_header(uint64_t _D, uint64_t _R, uint64_t _V, uint64_t hash) :
+      tag(event_store_magic, event_store_version, sizeof(event_store_header)),
+      D(_D), R(_R), V(_V), model_hash(hash), byte_order(native_byte_order),
+      reserved(0) {};
+
+    event_store_header() : event_store_header(0, 0, 0, 0) {};
+
+    ///> Size of the file in bytes
+    uint64_t file_size() const {
+      return tag.header_size + 8 * D * (V + 2 * R);
+    }
+  };
+
+
+  /**
+   * Event store mapped into memory.
+   *
+   * mapped_event_store(path) maps an existing store read-only, after
+   * checking its header and size; mapped_event_store(path, header)
+   * creates a temporary store of the given size, mapped writable, whose
+   * columns are filled through column() and published under path by
+   * commit() (it is removed if not committed). Errors throw
+   * std::domain_error. The mapping lives as long as the object.
+   */
+  class mapped_event_store {
+  public:
+    explicit mapped_event_store(const std::string& path) :
+      path_(path), data_(0), size_(0), writable_(false)
+    {
+      const int fd = ::open(path.c_str(), O_RDONLY);
+      if (fd < 0)
+        throw_errno("event_store", "cannot open", path_);
+      struct stat st;
+      if (::fstat(fd, &st) != 0)
+        throw_errno("event_store", "cannot stat", path_, fd);
+      if (::pread(fd, &header_, sizeof(header_), 0)
+          != (ssize_t)sizeof(header_)) {
+        ::close(fd);
+        throw std::domain_error("event_store: " + path + " is too short");
+      }
+      const std::string error = check(header_, st.st_size);
+      if (!error.empty()) {
+        ::close(fd);
+        throw std::domain_error("event_store: " + path + " " + error);
+      }
+      map(fd, st.st_size);
+    };
+
+    mapped_event_store(const std::string& path,
+                       const event_store_header& header) :
+      path_(path), header_(header), data_(0), size_(0), writable_(true)
+    {
+      size_ = header_.file_size();
+      data_ = map_temp(path, size_, tmp_path_, "event_store");
+      std::memcpy(data_, &header_, sizeof(header_));
+    };
+
+    ~mapped_event_store() {
+      if (data_ != 0)
+        ::munmap(data_, size_);
+      if (writable_)
+        ::unlink(tmp_path_.c_str());
+    };
+
+    const event_store_header& header() const { return header_; }
+
+    ///> Number of events
+    size_t size() const { return header_.D; }
+
+    size_t num_res() const { return header_.R; }
+
+    size_t num_var() const { return header_.V; }
+
+    uint64_t model_hash() const { return header_.model_hash; }
+
+    ///> Column of the variable y.(v+1)
+    const double* y(size_t v) const { return columns() + v * header_.D; }
+
+    ///> Column of Re(A_r); the R columns follow each other
+    const double* re(size_t r) const {
+      return columns() + (header_.V + r) * header_.D;
+    }
+
+    ///> Column of Im(A_r)
+    const double* im(size_t r) const {
+      return columns() + (header_.V + header_.R + r) * header_.D;
+    }
+
+    ///> Writable column c (y.1 .. y.V, Re(A_1) .. Re(A_R), Im(A_1) ..)
+    double* column(size_t c) {
+      check_writable();
+      return const_cast<double*>(columns()) + c * header_.D;
+    }
+
+    /**
+     * Publishes a new store under its path (an existing file is
+     * replaced); the mapping stays valid, read-only from now on.
+     */
+    void commit() {
+      check_writable();
+      if (::msync(data_, size_, MS_SYNC) != 0)
+        throw_errno("event_store", "cannot write", tmp_path_);
+      writable_ = false;
+      publish_temp(tmp_path_, path_, true, "event_store");
+    }
+
+  private:
+    mapped_event_store(const mapped_event_store&);
+    mapped_event_store& operator=(const mapped_event_store&);
+
+    ///> Reason why h does not describe a valid file of the given size
+    static std::string check(const event_store_header& h, uint64_t size) {
+      const std::string error =
+        check_tag(h.tag, event_store_magic, event_store_version,
+                  sizeof(event_store_header), h.byte_order, "an event store");
+      if (error.empty() && h.file_size() != size)
+        return "has a wrong size";
+      return error;
+    }
+
+    void check_writable() const {
+      if (!writable_)
+        throw std::domain_error("event_store: " + path_ + " is read-only");
+    }
+
+    ///> Maps the file read-only; the descriptor is not needed afterwards
+    void map(int fd, size_t size) {
+      void* p = ::mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+      if (p == MAP_FAILED)
+        throw_errno("event_store", "cannot map", path_, fd);
+      ::close(fd);
+      data_ = p;
+      size_ = size;
+    }
+
+    const double* columns() const {
+      return reinterpret_cast<const double*>(
+        static_cast<const char*>(data_) + header_.tag.header_size);
+    }
+
+    std::string path_;
+    std::string tmp_path_;
+    event_store_header header_;
+    void* data_;
+    size_t size_;
+    bool writable_;
+  };
+
+}
+}
+#endif
@@ -0,0 +1,58 @@
+#ifndef STAN_PWA__SRC__IO__RDUMP_HPP
+#define STAN_PWA__SRC__IO__RDUMP_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+
+#include <stan_pwa/src/io/rdump_writer.hpp> // format_value
+
+/*
+ *  Writing STAN data in the R dump format (*.data.R).
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/io.hpp
+ *
+ *  FUNCTIONS
+ *    void write_rdump_array(out, name, matrix[K])
+ */
+
+namespace stan_pwa {
+namespace io {
+
+  /**
+   * void write_rdump_array(out, name, matrix[K])
+   *
+   * Writes the array of K matrices of equal size R x C, as declared in
+   * STAN by 'matrix[R, C] name[K]', e.g. the normalization matrix I[2].
+   * R stores the values in column-major order with .Dim = c(K, R, C),
+   * i.e. the array index runs fastest. The values are written with
+   * the fewest digits that read back exactly (see format_value).
+   */
+  inline void
+  write_rdump_array(std::ostream& out, const std::string& name,
+                    const std::vector<Eigen::MatrixXd>& M) {
+
+    const size_t K = M.size();
+    const int R = K > 0 ? M[0].rows() : 0;
+    const int C = K > 0 ? M[0].cols() : 0;
+
+    char buf[value_chars];
+    out << name << " <-\nstructure(c(";
+    for (int c = 0; c < C; c++) {
+      for (int r = 0; r < R; r++) {
+        for (size_t k = 0; k < K; k++) {
+          if (c + r + k > 0)
+            out << ", ";
+          out.write(buf, format_value(M[k](r,c), buf) - buf);
+        }
+      }
+    }
+    out << "), .Dim = c(" << K << ", " << R << ", " << C << "))\n";
+  }
+
+}
+}
+#endif
@@ -0,0 +1,266 @@
+#ifndef STAN_PWA__SRC__IO__RDUMP_WRITER_HPP
+#define STAN_PWA__SRC__IO__RDUMP_WRITER_HPP
+
+#include <algorithm> // min, find_if
+#include <climits> // INT_MAX
+#include <cmath> // signbit
+#include <cstddef> // size_t, ptrdiff_t
+#include <cstdio> // snprintf
+#include <cstdlib> // strtod
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv> // to_chars
+#endif
+#endif
+
+#include <stan_pwa/src/parallel.hpp>
+
+/*
+ *  Streaming writer of STAN data in the R dump format (*.data.R).
+ *
+ *  DESCRIPTION
+ *    Writes scalars and arrays straight from contiguous buffers, without
+ *    building the text of a whole array in memory. R stores arrays in
+ *    column-major order (first index fastest); the buffers may have any
+ *    strides (e.g. row-major numpy arrays), the values are visited in R
+ *    order.
+ *
+ *    Arrays are formatted in chunks of chunk_values values; with
+ *    threading, the chunks of one round (one per thread of
+ *    parallel::thread_pool) are formatted concurrently and written in
+ *    order, so at most (number of threads) x chunk_values values are
+ *    held as text at any time, and the file does not depend on the
+ *    number of threads.
+ *
+ *    Doubles are written with the fewest digits that read back to the
+ *    same value (std::to_chars with C++17, else the shortest of %.15g,
+ *    %.16g, %.17g that round-trips); integral values up to INT_MAX in
+ *    magnitude are written as integers, larger ones and -0.0 with a
+ *    '.0' so that STAN does not read them as int; infinities and NaN
+ *    as Inf, -Inf, NaN.
+ *
+ *  FUNCTIONS
+ *    char* format_value(x, p)
+ *    rdump_writer(out, threaded)
+ *    void rdump_writer::write(name, x)
+ *    void rdump_writer::write_array(name, data, shape, strides)
+ *    void rdump_writer::write_array(name, data, shape)
+ */
+
+namespace stan_pwa {
+namespace io {
+
+  ///> Buffer size sufficient for format_value
+  const size_t value_chars = 32;
+
+
+  /**
+   * char* format_value(x, p)
+   *
+   * Writes x to p (at least value_chars bytes) and returns the end of
+   * the text (not terminated).
+   */
+  inline char*
+  format_value(long long x, char* p) {
+    char digits[24];
+    unsigned long long u = x < 0 ? 0ULL - (unsigned long long)x : x;
+    int n = 0;
+    do {
+      digits[n++] = '0' + u % 10;
+      u /= 10;
+    } while (u != 0);
+    if (x < 0)
+      *p++ = '-';
+    while (n > 0)
+      *p++ = digits[--n];
+    return p;
+  }
+
+  inline char*
+  format_value(int x, char* p) {
+    return format_value((long long)x, p);
+  }
+
+  inline char*
+  format_value(double x, char* p) {
+    if (x != x) {
+      *p++ = 'N'; *p++ = 'a'; *p++ = 'N';
+      return p;
+    }
+    if (x - x != 0) {
+      if (x < 0)
+        *p++ = '-';
+      *p++ = 'I'; *p++ = 'n'; *p++ = 'f';
+      return p;
+    }
+    if (x <= INT_MAX && x >= -INT_MAX && x == (double)(long long)x
+        && !(x == 0 && std::signbit(x)))
+      return format_value((long long)x, p);
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    char* end = std::to_chars(p, p + value_chars, x).ptr;
+#else
+    int n = 0;
+    for (int precision = 15; precision <= 17; precision++) {
+      n = std::snprintf(p, value_chars, "%.*g", precision, x);
+      if (precision == 17 || std::strtod(p, 0) == x)
+        break;
+    }
+    char* end = p + n;
+#endif
+    // STAN reads numbers without '.' or exponent as int: -0.0 and
+    // integral values beyond INT_MAX get a '.0'
+    if (std::find_if(p, end, [](char c) {
+          return c == '.' || c == 'e' || c == 'E';
+        }) == end) {
+      *end++ = '.';
+      *end++ = '0';
+    }
+    return end;
+  }
+
+
+  /**
+   * Writer of a *.data.R file.
+   *
+   * write(name, x) writes a scalar, write_array(name, data, shape, ...)
+   * an array as declared in STAN by e.g. 'vector[R] name[D,2]' (shape
+   * (D, 2, R)); one-dimensional arrays are written as c(...), others as
+   * structure(c(...), .Dim = c(...)).
+   */
+  class rdump_writer {
+  public:
+    ///> Number of values per chunk
+    static const size_t chunk_values = 16384;
+
+    explicit rdump_writer(std::ostream& out, bool threaded = true) :
+      out_(out), threaded_(threaded) {};
+
+    template <typename T>
+    void write(const std::string& name, T x) {
+      char buf[value_chars];
+      out_ << name << " <- ";
+      out_.write(buf, format_value(x, buf) - buf);
+      out_ << "\n";
+    }
+
+    /**
+     * Writes the array of the given shape; the element with the indices
+     * (i_0, i_1, ...) is data[i_0 strides[0] + i_1 strides[1] + ...]
+     * (strides in elements, may be negative).
+     *
+     * @tparam T double, long long or int
+     */
+    template <typename T>
+    void write_array(const std::string& name, const T* data,
+                     const std::vector<size_t>& shape,
+                     const std::vector<ptrdiff_t>& strides) {
+      size_t size = 1;
+      for (size_t k = 0; k < shape.size(); k++)
+        size *= shape[k];
+
+      out_ << name << " <-\n";
+      if (shape.size() > 1)
+        out_ << "structure(";
+      if (size == 0 && shape.size() <= 1)
+        out_ << (is_integer(data) ? "integer(0)" : "double(0)");
+      else
+        out_ << "c(";
+
+      const size_t num_chunks = (size + chunk_values - 1) / chunk_values;
+      const size_t round = threaded_
+        ? parallel::thread_pool::instance().size() : 1;
+      std::vector<std::string> text(round);
+      for (size_t first = 0; first < num_chunks; first += round) {
+        const size_t n = std::min(round, num_chunks - first);
+        const std::function<void(size_t)> format = [&](size_t c) {
+          format_chunk(data, shape, strides, size, first + c, text[c]);
+        };
+        if (threaded_)
+          parallel::thread_pool::instance().run(n, format);
+        else
+          format(0);
+        for (size_t c = 0; c < n; c++)
+          out_.write(text[c].data(), text[c].size());
+      }
+
+      if (size > 0 || shape.size() > 1)
+        out_ << ")";
+      if (shape.size() > 1) {
+        out_ << ", .Dim = c(";
+        for (size_t k = 0; k < shape.size(); k++)
+          out_ << (k > 0 ? ", " : "") << shape[k];
+        out_ << "))";
+      }
+      out_ << "\n";
+    }
+
+    ///> Same as above, for a column-major contiguous buffer
+    template <typename T>
+    void write_array(const std::string& name, const T* data,
+                     const std::vector<size_t>& shape) {
+      std::vector<ptrdiff_t> strides(shape.size());
+      ptrdiff_t stride = 1;
+      for (size_t k = 0; k < shape.size(); k++) {
+        strides[k] = stride;
+        stride *= (ptrdiff_t)shape[k];
+      }
+      write_array(name, data, shape, strides);
+    }
+
+  private:
+    static bool is_integer(const double*) { return false; }
+    static bool is_integer(const long long*) { return true; }
+    static bool is_integer(const int*) { return true; }
+
+    ///> Text of the values of chunk c in R order, ", "-separated
+    template <typename T>
+    static void format_chunk(const T* data, const std::vector<size_t>& shape,
+                             const std::vector<ptrdiff_t>& strides,
+                             size_t size, size_t c, std::string& text) {
+      const size_t begin = c * chunk_values;
+      const size_t end = std::min(begin + chunk_values, size);
+      const size_t dims = shape.size();
+
+      // Indices and offset of the first value
+      std::vector<size_t> index(dims);
+      ptrdiff_t offset = 0;
+      size_t rest = begin;
+      for (size_t k = 0; k < dims; k++) {
+        index[k] = rest % shape[k];
+        rest /= shape[k];
+        offset += (ptrdiff_t)index[k] * strides[k];
+      }
+
+      text.resize((end - begin) * (value_chars + 2));
+      char* p = &text[0];
+      for (size_t i = begin; i < end; i++) {
+        if (i > 0) {
+          *p++ = ',';
+          *p++ = ' ';
+        }
+        p = format_value(data[offset], p);
+
+        // Next index, first one fastest
+        for (size_t k = 0; k < dims; k++) {
+          offset += strides[k];
+          if (++index[k] < shape[k])
+            break;
+          offset -= (ptrdiff_t)shape[k] * strides[k];
+          index[k] = 0;
+        }
+      }
+      text.resize(p - &text[0]);
+    }
+
+    std::ostream& out_;
+    const bool threaded_;
+  };
+
+}
+}
+#endif
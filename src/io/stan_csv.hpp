@@ -0,0 +1,194 @@
+#ifndef STAN_PWA__SRC__IO__STAN_CSV_HPP
+#define STAN_PWA__SRC__IO__STAN_CSV_HPP
+
+#include <algorithm> // min
+#include <cstdlib> // strtod
+#include <functional>
+#include <istream>
+#include <sstream>
+#include <stdexcept> // domain_error
+#include <string>
+#include <vector>
+
+#include <stan_pwa/src/parallel.hpp>
+
+/*
+ *  Reading CmdStan output files (*.csv).
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/io.hpp
+ *
+ *  FUNCTIONS
+ *    stan_csv read_stan_csv(in)
+ *    int stan_csv::column(name)
+ *    stan_csv_reader(in, threaded)
+ *    size_t stan_csv_reader::read(rows, max_rows)
+ */
+
+namespace stan_pwa {
+namespace io {
+
+  ///> Column names and the rows of values of a CmdStan output file
+  struct stan_csv {
+    std::vector<std::string> header;
+    std::vector<std::vector<double> > rows;
+
+    ///> Index of the column 'name' (e.g. "y.1"), -1 if there is none
+    int column(const std::string& name) const {
+      for (size_t i = 0; i < header.size(); i++) {
+        if (header[i] == name)
+          return i;
+      }
+      return -1;
+    }
+  };
+
+
+  ///> Whether a line of a CmdStan output file holds no values
+  ///> (configuration, adaptation info, timing, empty lines)
+  inline bool
+  is_comment(const std::string& line) {
+    return line.empty() || line[0] == '#' || line[0] == ' '
+      || line[0] == '\r';
+  }
+
+
+  ///> Splits the line of column names
+  inline std::vector<std::string>
+  parse_header(const std::string& line) {
+    std::vector<std::string> res;
+    std::stringstream ss(line);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+      if (!name.empty() && name[name.size() - 1] == '\r')
+        name.erase(name.size() - 1);
+      res.push_back(name);
+    }
+    return res;
+  }
+
+
+  /**
+   * Parses the comma-separated values of line to row[0] .. row[n - 1];
+   * returns false if the line does not hold exactly n numbers.
+   */
+  inline bool
+  parse_row(const std::string& line, double* row, size_t n) {
+    const char* p = line.c_str();
+    size_t i = 0;
+    while (*p != '\0' && *p != '\r') {
+      char* end;
+      const double x = std::strtod(p, &end);
+      if (end == p || i == n)
+        return false;
+      row[i++] = x;
+      p = (*end == ',') ? end + 1 : end;
+    }
+    return i == n;
+  }
+
+
+  /**
+   * stan_csv read_stan_csv(in)
+   *
+   * Parses a CmdStan output file: lines starting with '#' (configuration,
+   * adaptation info, timing) and empty lines are skipped, the first other
+   * line holds the column names, all following ones the values.
+   */
+  inline stan_csv
+  read_stan_csv(std::istream& in) {
+    stan_csv res;
+    std::string line;
+    while (std::getline(in, line)) {
+      if (is_comment(line))
+        continue;
+      if (res.header.empty()) {
+        res.header = parse_header(line);
+        continue;
+      }
+      std::vector<double> row(res.header.size());
+      if (!parse_row(line, row.data(), row.size()))
+        throw std::domain_error("read_stan_csv: cannot parse '" + line + "'");
+      res.rows.push_back(row);
+    }
+    return res;
+  }
+
+
+  /**
+   * Reader of a CmdStan output file in blocks of rows, for files too
+   * large to be held in memory.
+   *
+   * The constructor reads the column names; read(rows, max_rows) then
+   * reads up to max_rows rows (skipping comments, e.g. the adaptation
+   * info between the warmup and the draws) into rows, row by row
+   * (rows[r * num_cols() + c]), and returns their number, 0 at the end
+   * of the file. With threaded, the lines of a block are parsed on the
+   * threads of parallel::thread_pool.
+   */
+  class stan_csv_reader {
+  public:
+    explicit stan_csv_reader(std::istream& in, bool threaded = true) :
+      in_(in), threaded_(threaded)
+    {
+      std::string line;
+      while (std::getline(in_, line)) {
+        if (!is_comment(line)) {
+          header_ = parse_header(line);
+          return;
+        }
+      }
+      throw std::domain_error("stan_csv_reader: no column names");
+    };
+
+    const std::vector<std::string>& header() const { return header_; }
+
+    size_t num_cols() const { return header_.size(); }
+
+    size_t read(std::vector<double>& rows, size_t max_rows) {
+      if (lines_.size() < max_rows)
+        lines_.resize(max_rows);
+      size_t n = 0;
+      while (n < max_rows && std::getline(in_, lines_[n])) {
+        if (!is_comment(lines_[n]))
+          n++;
+      }
+
+      const size_t C = header_.size();
+      rows.resize(n * C);
+      const size_t lines_per_task = 4096;
+      const size_t num_tasks = (n + lines_per_task - 1) / lines_per_task;
+      std::vector<size_t> bad(num_tasks, n);
+      const std::function<void(size_t)> parse = [&](size_t t) {
+        const size_t end = std::min(n, (t + 1) * lines_per_task);
+        for (size_t i = t * lines_per_task; i < end; i++) {
+          if (!parse_row(lines_[i], &rows[i * C], C)) {
+            bad[t] = i;
+            return;
+          }
+        }
+      };
+      if (threaded_)
+        parallel::thread_pool::instance().run(num_tasks, parse);
+      else
+        for (size_t t = 0; t < num_tasks; t++)
+          parse(t);
+
+      for (size_t t = 0; t < num_tasks; t++) {
+        if (bad[t] < n)
+          throw std::domain_error("stan_csv_reader: cannot parse '"
+                                  + lines_[bad[t]] + "'");
+      }
+      return n;
+    }
+
+  private:
+    std::istream& in_;
+    const bool threaded_;
+    std::vector<std::string> header_;
+    std::vector<std::string> lines_; ///> Text of the current block
+  };
+
+}
+}
+#endif
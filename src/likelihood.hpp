@@ -0,0 +1,32 @@
+#ifndef STAN_PWA__SRC__LIKELIHOOD_HPP
+#define STAN_PWA__SRC__LIKELIHOOD_HPP
+
+#include <stan_pwa/src/likelihood/unbinned.hpp>
+#include <stan_pwa/src/likelihood/packed_hermitian.hpp>
+#include <stan_pwa/src/likelihood/parallel.hpp>
+#include <stan_pwa/src/likelihood/columnar.hpp>
+#include <stan_pwa/src/likelihood/floating.hpp>
+#include <stan_pwa/src/likelihood/floating_norm.hpp>
+
+/*
+ *  Fused likelihood functions for the parameter fitting.
+ *
+ *  DESCRIPTION
+ *    The fitting model (STAN_amplitude_fitting.stan) needs
+ *
+ *      log L(theta) = sum_d log( f_genfit(A_d, theta) / norm(theta, I) ),
+ *
+ *    where A_d are the (fixed) amplitude vectors of the measured events.
+ *    Written in STAN this builds D x R autodiff nodes on every gradient
+ *    evaluation. The functions here evaluate the whole sum in double
+ *    precision together with its analytic gradient w.r.t. Re(theta) and
+ *    Im(theta), and return it as a single STAN variable with precomputed
+ *    partials; the memory used on the autodiff stack is O(R).
+ *
+ *  FUNCTIONS
+ *    Are currently listed in particular files - unbinned.hpp,
+ *    packed_hermitian.hpp, parallel.hpp, columnar.hpp, floating.hpp,
+ *    floating_norm.hpp.
+ */
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef STAN_PWA__SRC__LIKELIHOOD__COLUMNAR_HPP
+#define STAN_PWA__SRC__LIKELIHOOD__COLUMNAR_HPP
+
+#include <algorithm> // min
+#include <cmath> // log
+#include <stdexcept> // domain_error
+#include <vector>
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+
+#include <stan_pwa/src/likelihood/parallel.hpp>
+#include <stan_pwa/src/likelihood/unbinned.hpp>
+#include <stan_pwa/src/typedefs.h>
+
+/*
+ *  Unbinned PWA log-likelihood on amplitudes stored by columns.
+ *
+ *  DESCRIPTION
+ *    The amplitudes are given as one contiguous column of D values per
+ *    resonance, for the real and for the imaginary parts, as written by
+ *    resonance_list::amplitude_batch and stored in io::mapped_event_store.
+ *    They are used in place, without copying them to the STAN layout.
+ *
+ *    The event sum runs over blocks of events: for every resonance, a
+ *    loop over the events of the block (contiguous in memory) adds
+ *    theta_r A_dr to the sums S_d, and likewise for the gradient.
+ *
+ *  FUNCTIONS
+ *    scalar event_sum(column_events, begin, end, theta, grad_re, grad_im)
+ *    scalar pwa_loglik_columns(column_events, complex_vector, complex_matrix)
+ */
+
+namespace stan_pwa {
+namespace likelihood {
+
+  /**
+   * Read-only view of amplitudes stored by columns: Re(A_dr) is
+   * re[r * stride + d], Im(A_dr) is im[r * stride + d].
+   */
+  struct column_events {
+    column_events(size_t D, size_t R, const double* re, const double* im,
+                  size_t stride) :
+      D_(D), R_(R), re_(re), im_(im), stride_(stride) {};
+
+    ///> Columns following each other (stride D)
+    column_events(size_t D, size_t R, const double* re, const double* im) :
+      column_events(D, R, re, im, D) {};
+
+    size_t size() const { return D_; }
+    size_t num_res() const { return R_; }
+    const double* re_column(size_t r) const { return re_ + r * stride_; }
+    const double* im_column(size_t r) const { return im_ + r * stride_; }
+
+  private:
+    size_t D_;
+    size_t R_;
+    const double* re_;
+    const double* im_;
+    size_t stride_;
+  };
+
+
+  ///> Number of events per block of the column-wise event sum
+  const size_t column_block = 256;
+
+
+  /**
+   * scalar event_sum(column_events, begin, end, theta, grad_re, grad_im)
+   *
+   * Same as event_sum for the STAN layout (see unbinned.hpp).
+   */
+  inline double
+  event_sum(const column_events& events, size_t begin, size_t end,
+            const CV_t<double>& theta,
+            Eigen::VectorXd& grad_re, Eigen::VectorXd& grad_im) {
+
+    const int R = theta[0].rows();
+    const double* t_re = theta[0].data();
+    const double* t_im = theta[1].data();
+
+    double s_re[column_block];
+    double s_im[column_block];
+    double w[column_block];
+
+    double res = 0.0;
+    for (size_t b = begin; b < end; b += column_block) {
+      const size_t n = std::min(column_block, end - b);
+
+      for (size_t i = 0; i < n; i++) {
+        s_re[i] = 0.0;
+        s_im[i] = 0.0;
+      }
+      for (int r = 0; r < R; r++) {
+        const double* a_re = events.re_column(r) + b;
+        const double* a_im = events.im_column(r) + b;
+        for (size_t i = 0; i < n; i++) {
+          s_re[i] += t_re[r] * a_re[i] - t_im[r] * a_im[i];
+          s_im[i] += t_re[r] * a_im[i] + t_im[r] * a_re[i];
+        }
+      }
+
+      for (size_t i = 0; i < n; i++) {
+        const double f = s_re[i] * s_re[i] + s_im[i] * s_im[i];
+        res += std::log(f);
+        w[i] = 2.0 / f;
+      }
+
+      for (int r = 0; r < R; r++) {
+        const double* a_re = events.re_column(r) + b;
+        const double* a_im = events.im_column(r) + b;
+        double g_re = 0.0;
+        double g_im = 0.0;
+        for (size_t i = 0; i < n; i++) {
+          g_re += w[i] * (s_re[i] * a_re[i] + s_im[i] * a_im[i]);
+          g_im += w[i] * (s_im[i] * a_re[i] - s_re[i] * a_im[i]);
+        }
+        grad_re(r) += g_re;
+        grad_im(r) += g_im;
+      }
+    }
+    return res;
+  }
+
+
+  /**
+   * scalar pwa_loglik_columns(column_events, complex_vector, complex_matrix)
+   *
+   * Same as pwa_loglik_threaded, on amplitudes stored by columns.
+   *
+   * @tparam T Scalar type of theta
+   */
+  template <typename T>
+  inline T
+  pwa_loglik_columns(const column_events& A, const CV_t<T>& theta,
+                     const std::vector<Eigen::MatrixXd>& I) {
+
+    check_sizes(theta, I);
+    const int R = theta[0].rows();
+    if (A.num_res() != (size_t)R)
+      throw std::domain_error("pwa_loglik: size mismatch of amplitudes "
+                              "and theta");
+
+    const double D = A.size();
+    const CV_t<double> theta_d = value_of(theta);
+
+    Eigen::VectorXd grad_re = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd grad_im = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd norm_grad_re = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd norm_grad_im = Eigen::VectorXd::Zero(R);
+
+    const double sum = event_sum_parallel(A, theta_d, grad_re, grad_im);
+    const double N = norm(theta_d, I, norm_grad_re, norm_grad_im);
+
+    grad_re -= D / N * norm_grad_re;
+    grad_im -= D / N * norm_grad_im;
+
+    return precomputed(sum - D * std::log(N), theta, grad_re, grad_im);
+  }
+
+}
+}
+#endif
@@ -0,0 +1,509 @@
+#ifndef STAN_PWA__SRC__LIKELIHOOD__FLOATING_HPP
+#define STAN_PWA__SRC__LIKELIHOOD__FLOATING_HPP
+
+#include <algorithm> // min, copy
+#include <cmath> // log
+#include <limits> // quiet_NaN
+#include <stdexcept> // domain_error
+#include <tuple>
+#include <vector>
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+#include <stan/math/rev/core.hpp> // var, precomputed_gradients
+#include <boost/math/tools/promotion.hpp>
+
+#include <stan_pwa/src/complex.hpp>
+#include <stan_pwa/src/likelihood/columnar.hpp>
+#include <stan_pwa/src/likelihood/parallel.hpp>
+#include <stan_pwa/src/likelihood/unbinned.hpp>
+#include <stan_pwa/src/parallel.hpp>
+#include <stan_pwa/src/resonance_list/unroll.hpp>
+#include <stan_pwa/src/structures/three_body/kinematics.hpp>
+#include <stan_pwa/src/typedefs.h>
+
+/*
+ *  Unbinned PWA event sum with floating resonance parameters.
+ *
+ *  DESCRIPTION
+ *    The amplitudes of the resonances with fixed parameters are computed
+ *    once, those of the floating resonances (see
+ *    stan_pwa/src/structures/three_body/floating.hpp) depend on the
+ *    parameters p and change during the fit. floating_events keeps both
+ *    by columns (see columnar.hpp), the floating ones after the fixed
+ *    ones, together with dA / dp for every floating column. The
+ *    normalization integral for the same parameters is kept by
+ *    floating_norm (see floating_norm.hpp).
+ *
+ *    update(p) re-evaluates only the resonances whose parameters changed
+ *    since the last call: within a leapfrog step of the sampler, most
+ *    evaluations change all of them, but fits with fixed parameters or
+ *    repeated evaluations at the same point (e.g. by the optimizer) skip
+ *    the work.
+ *
+ *    With S = sum_r theta_r A_r and f = |S|^2, the gradient w.r.t. the
+ *    parameter p_j of the resonance r is
+ *
+ *      d log f / dp_j = 2 / f Re(conj(S) theta_r dA_r / dp_j).
+ *
+ *  FUNCTIONS
+ *    bool floating_column<R>::update(p, re, im)
+ *    size_t floating_events<Res...>::update(p)
+ *    scalar event_sum(floating_events, begin, end, theta, grad_re, grad_im, grad_p)
+ *    scalar event_sum_parallel(floating_events, theta, grad_re, grad_im, grad_p)
+ *    scalar pwa_event_sum_floating(floating_events, complex_vector, vector)
+ */
+
+namespace stan_pwa {
+namespace likelihood {
+
+  /**
+   * Amplitudes of one floating resonance for fixed events, and their
+   * derivatives w.r.t. the parameters, for the last parameters given.
+   *
+   * @tparam R Floating resonance (see floating.hpp)
+   */
+  template <typename R>
+  class floating_column {
+  public:
+    static const int num_params = R::num_params;
+
+    floating_column(const R& res, const double* m2_ab, const double* m2_bc,
+                    size_t D, bool sym) :
+      res_(res), D_(D), sym_(sym), evaluations_(0),
+      d_re_(num_params * D), d_im_(num_params * D)
+    {
+      k_.reserve(D);
+      for (size_t d = 0; d < D; d++)
+        k_.push_back(resonances::kinematics_3<double>(m2_ab[d], m2_bc[d],
+                                                      res.P, res.a, res.b,
+                                                      res.c));
+      if (sym) {
+        k_sym_.reserve(D);
+        for (size_t d = 0; d < D; d++)
+          k_sym_.push_back(k_[d].swapped(res.P, res.a, res.b, res.c));
+      }
+      for (int j = 0; j < num_params; j++)
+        p_[j] = std::numeric_limits<double>::quiet_NaN();
+    };
+
+    /**
+     * Evaluates the amplitudes (to re, im) and their derivatives for the
+     * parameters p, unless p is the same as at the last call.
+     * Returns whether the amplitudes were evaluated.
+     */
+    bool update(const double* p, double* re, double* im) {
+      bool same = true;
+      for (int j = 0; j < num_params; j++)
+        same = same && p[j] == p_[j];
+      if (same)
+        return false;
+
+      const size_t num_chunks = (D_ + chunk_size - 1) / chunk_size;
+      parallel::thread_pool::instance().run(num_chunks, [&](size_t c) {
+          const size_t begin = c * chunk_size;
+          const size_t end = std::min(begin + chunk_size, D_);
+          mc::number<double> dA[num_params];
+          for (size_t d = begin; d < end; d++) {
+            const mc::number<double> a = sym_ ?
+              res_.complex_value_sym(k_[d], k_sym_[d], p, dA) :
+              res_.complex_value(k_[d], p, dA);
+            re[d] = a.re;
+            im[d] = a.im;
+            for (int j = 0; j < num_params; j++) {
+              d_re_[j * D_ + d] = dA[j].re;
+              d_im_[j * D_ + d] = dA[j].im;
+            }
+          }
+        });
+
+      for (int j = 0; j < num_params; j++)
+        p_[j] = p[j];
+      evaluations_++;
+      return true;
+    }
+
+    ///> Derivatives of the amplitudes w.r.t. p_j, one per event
+    const double* d_re(int j) const { return d_re_.data() + j * D_; }
+    const double* d_im(int j) const { return d_im_.data() + j * D_; }
+
+    ///> Number of times the amplitudes were evaluated
+    size_t evaluations() const { return evaluations_; }
+
+  private:
+    const R res_;
+    size_t D_;
+    bool sym_;
+    size_t evaluations_;
+    double p_[num_params]; // Parameters of the last evaluation
+    std::vector<resonances::kinematics_3<double> > k_;
+    std::vector<resonances::kinematics_3<double> > k_sym_;
+    std::vector<double> d_re_;
+    std::vector<double> d_im_;
+  };
+
+
+  /**
+   * Events of a fit with floating resonances: the amplitudes of R_0 fixed
+   * resonances (copied once) and of the floating resonances Res...,
+   * stored by columns in this order; theta runs over all of them.
+   *
+   * The parameters of the floating resonances are given as one vector:
+   * those of the first floating resonance, then those of the second, ...
+   * Not copyable (the columns stay in place).
+   */
+  template <typename... Res>
+  class floating_events {
+  public:
+    /**
+     * @param fixed Amplitudes of the fixed resonances for the D events
+     * @param m2_ab, m2_bc Dalitz plot variables of the D events
+     * @param sym Whether the floating amplitudes are symmetrized
+     */
+    floating_events(const column_events& fixed, const double* m2_ab,
+                    const double* m2_bc, bool sym, const Res&... res) :
+      floating_events(fixed, m2_ab, m2_bc, sym, std::make_tuple(res...)) {};
+
+    ///> Same as above, with the floating resonances in a tuple
+    floating_events(const column_events& fixed, const double* m2_ab,
+                    const double* m2_bc, bool sym,
+                    const std::tuple<Res...>& res) :
+      floating_events(fixed, m2_ab, m2_bc, sym, res,
+                      typename resonance_list::make_indices<
+                        sizeof...(Res)>::type()) {};
+
+    size_t size() const { return D_; }
+    size_t num_res() const { return R_fixed_ + sizeof...(Res); }
+    size_t num_fixed() const { return R_fixed_; }
+    size_t num_params() const { return param_res_.size(); }
+
+    ///> All amplitudes, for the last parameters given to update
+    column_events columns() const {
+      return column_events(D_, num_res(), re_.data(), im_.data());
+    }
+
+    ///> Resonance (index in theta) of the parameter q
+    size_t param_res(size_t q) const { return param_res_[q]; }
+
+    ///> Derivatives of the amplitudes of param_res(q) w.r.t. p_q
+    const double* d_re(size_t q) const { return d_re_[q]; }
+    const double* d_im(size_t q) const { return d_im_[q]; }
+
+    /**
+     * Evaluates the floating amplitudes for the parameters p (of size
+     * num_params()). Returns the number of resonances re-evaluated.
+     */
+    size_t update(const double* p) {
+      updated_.clear();
+      evaluate e = { this, p, 0 };
+      resonance_list::for_each(columns_, e);
+      return updated_.size();
+    }
+
+    ///> Resonances (indices in theta) re-evaluated by the last update
+    const std::vector<size_t>& updated() const { return updated_; }
+
+    ///> Total number of evaluations of the floating amplitudes
+    size_t evaluations() {
+      count_evaluations c = { 0 };
+      resonance_list::for_each(columns_, c);
+      return c.count;
+    }
+
+  private:
+    floating_events(const floating_events&);
+    floating_events& operator=(const floating_events&);
+
+    template <size_t... I>
+    floating_events(const column_events& fixed, const double* m2_ab,
+                    const double* m2_bc, bool sym,
+                    const std::tuple<Res...>& res,
+                    resonance_list::indices<I...>) :
+      D_(fixed.size()), R_fixed_(fixed.num_res()),
+      columns_(floating_column<Res>(std::get<I>(res), m2_ab, m2_bc,
+                                    fixed.size(), sym)...)
+    {
+      const size_t R = num_res();
+      re_.assign(R * D_, 0.0);
+      im_.assign(R * D_, 0.0);
+      for (size_t r = 0; r < R_fixed_; r++) {
+        std::copy(fixed.re_column(r), fixed.re_column(r) + D_,
+                  re_.begin() + r * D_);
+        std::copy(fixed.im_column(r), fixed.im_column(r) + D_,
+                  im_.begin() + r * D_);
+      }
+      collect c = { this };
+      resonance_list::for_each(columns_, c);
+    };
+
+    // Indexes the parameters and their derivative columns
+    struct collect {
+      floating_events* self;
+      template <typename C>
+      void operator()(size_t i, C& col) {
+        for (int j = 0; j < C::num_params; j++) {
+          self->param_res_.push_back(self->R_fixed_ + i);
+          self->d_re_.push_back(col.d_re(j));
+          self->d_im_.push_back(col.d_im(j));
+        }
+      }
+    };
+
+    struct evaluate {
+      floating_events* self;
+      const double* p;
+      size_t offset;
+      template <typename C>
+      void operator()(size_t i, C& col) {
+        const size_t r = self->R_fixed_ + i;
+        if (col.update(p + offset, self->re_.data() + r * self->D_,
+                       self->im_.data() + r * self->D_))
+          self->updated_.push_back(r);
+        offset += C::num_params;
+      }
+    };
+
+    struct count_evaluations {
+      size_t count;
+      template <typename C>
+      void operator()(size_t, C& col) { count += col.evaluations(); }
+    };
+
+    size_t D_;
+    size_t R_fixed_;
+    std::tuple<floating_column<Res>...> columns_;
+    std::vector<double> re_;
+    std::vector<double> im_;
+    std::vector<size_t> param_res_;
+    std::vector<const double*> d_re_;
+    std::vector<const double*> d_im_;
+    std::vector<size_t> updated_;
+  };
+
+
+  /**
+   * scalar event_sum(floating_events, begin, end, theta, grad_re, grad_im, grad_p)
+   *
+   * Same as event_sum for column_events (see columnar.hpp), and adds the
+   * derivatives w.r.t. the parameters of the floating resonances to
+   * grad_p (see above).
+   */
+  template <typename... Res>
+  inline double
+  event_sum(const floating_events<Res...>& events, size_t begin, size_t end,
+            const CV_t<double>& theta,
+            Eigen::VectorXd& grad_re, Eigen::VectorXd& grad_im,
+            Eigen::VectorXd& grad_p) {
+
+    const int R = theta[0].rows();
+    const double* t_re = theta[0].data();
+    const double* t_im = theta[1].data();
+    const column_events A = events.columns();
+
+    double s_re[column_block];
+    double s_im[column_block];
+    double w[column_block];
+
+    double res = 0.0;
+    for (size_t b = begin; b < end; b += column_block) {
+      const size_t n = std::min(column_block, end - b);
+
+      for (size_t i = 0; i < n; i++) {
+        s_re[i] = 0.0;
+        s_im[i] = 0.0;
+      }
+      for (int r = 0; r < R; r++) {
+        const double* a_re = A.re_column(r) + b;
+        const double* a_im = A.im_column(r) + b;
+        for (size_t i = 0; i < n; i++) {
+          s_re[i] += t_re[r] * a_re[i] - t_im[r] * a_im[i];
+          s_im[i] += t_re[r] * a_im[i] + t_im[r] * a_re[i];
+        }
+      }
+
+      for (size_t i = 0; i < n; i++) {
+        const double f = s_re[i] * s_re[i] + s_im[i] * s_im[i];
+        res += std::log(f);
+        w[i] = 2.0 / f;
+      }
+
+      for (int r = 0; r < R; r++) {
+        const double* a_re = A.re_column(r) + b;
+        const double* a_im = A.im_column(r) + b;
+        double g_re = 0.0;
+        double g_im = 0.0;
+        for (size_t i = 0; i < n; i++) {
+          g_re += w[i] * (s_re[i] * a_re[i] + s_im[i] * a_im[i]);
+          g_im += w[i] * (s_im[i] * a_re[i] - s_re[i] * a_im[i]);
+        }
+        grad_re(r) += g_re;
+        grad_im(r) += g_im;
+      }
+
+      // Re(conj(S) theta_r dA) = Re(conj(S) dA) Re(theta_r)
+      //                          - Im(conj(S) dA) Im(theta_r)
+      for (size_t q = 0; q < events.num_params(); q++) {
+        const size_t r = events.param_res(q);
+        const double* d_re = events.d_re(q) + b;
+        const double* d_im = events.d_im(q) + b;
+        double g_re = 0.0;
+        double g_im = 0.0;
+        for (size_t i = 0; i < n; i++) {
+          g_re += w[i] * (s_re[i] * d_re[i] + s_im[i] * d_im[i]);
+          g_im += w[i] * (s_re[i] * d_im[i] - s_im[i] * d_re[i]);
+        }
+        grad_p(q) += t_re[r] * g_re - t_im[r] * g_im;
+      }
+    }
+    return res;
+  }
+
+
+  ///> Contribution of one chunk of events, with the parameters
+  struct floating_partial_sum : public partial_sum {
+    Eigen::VectorXd grad_p;
+
+    void add(const floating_partial_sum& other) {
+      partial_sum::add(other);
+      grad_p += other.grad_p;
+    }
+  };
+
+
+  /**
+   * scalar event_sum_parallel(floating_events, theta, grad_re, grad_im, grad_p)
+   *
+   * Same as event_sum_parallel (see parallel.hpp), with the derivatives
+   * w.r.t. the parameters; the result does not depend on the number of
+   * threads.
+   */
+  template <typename... Res>
+  inline double
+  event_sum_parallel(const floating_events<Res...>& events,
+                     const CV_t<double>& theta,
+                     Eigen::VectorXd& grad_re, Eigen::VectorXd& grad_im,
+                     Eigen::VectorXd& grad_p) {
+
+    const int R = theta[0].rows();
+    const int P = events.num_params();
+    const size_t num_events = events.size();
+    const size_t num_chunks = (num_events + chunk_size - 1) / chunk_size;
+    if (num_chunks == 0)
+      return 0.0;
+
+    std::vector<floating_partial_sum> partial(num_chunks);
+    parallel::thread_pool::instance().run(num_chunks, [&](size_t c) {
+        floating_partial_sum& p = partial[c];
+        p.grad_re = Eigen::VectorXd::Zero(R);
+        p.grad_im = Eigen::VectorXd::Zero(R);
+        p.grad_p = Eigen::VectorXd::Zero(P);
+        const size_t begin = c * chunk_size;
+        const size_t end = std::min(begin + chunk_size, num_events);
+        p.value = event_sum(events, begin, end, theta, p.grad_re, p.grad_im,
+                            p.grad_p);
+      });
+
+    for (size_t stride = 1; stride < num_chunks; stride *= 2) {
+      for (size_t c = 0; c + stride < num_chunks; c += 2 * stride)
+        partial[c].add(partial[c + stride]);
+    }
+
+    grad_re += partial[0].grad_re;
+    grad_im += partial[0].grad_im;
+    grad_p += partial[0].grad_p;
+    return partial[0].value;
+  }
+
+
+  /**
+   * Wraps the value and gradient computed in double precision to the
+   * return type, for theta and the parameters p (see precomputed in
+   * unbinned.hpp).
+   */
+  inline void
+  push_operand(double, double, std::vector<stan::math::var>&,
+               std::vector<double>&) {}
+
+  inline void
+  push_operand(const stan::math::var& x, double g,
+               std::vector<stan::math::var>& operands,
+               std::vector<double>& gradients) {
+    operands.push_back(x);
+    gradients.push_back(g);
+  }
+
+  inline void
+  to_result(double val, const std::vector<stan::math::var>&,
+            const std::vector<double>&, double& res) {
+    res = val;
+  }
+
+  inline void
+  to_result(double val, const std::vector<stan::math::var>& operands,
+            const std::vector<double>& gradients, stan::math::var& res) {
+    res = stan::math::precomputed_gradients(val, operands, gradients);
+  }
+
+  template <typename T1, typename T2>
+  inline typename boost::math::tools::promote_args<T1,T2>::type
+  precomputed(double val, const CV_t<T1>& theta,
+              const Eigen::Matrix<T2, Eigen::Dynamic, 1>& p,
+              const Eigen::VectorXd& grad_re, const Eigen::VectorXd& grad_im,
+              const Eigen::VectorXd& grad_p) {
+    const int R = theta[0].rows();
+    std::vector<stan::math::var> operands;
+    std::vector<double> gradients;
+    for (int r = 0; r < R; r++) {
+      push_operand(theta[0](r), grad_re(r), operands, gradients);
+      push_operand(theta[1](r), grad_im(r), operands, gradients);
+    }
+    for (int q = 0; q < p.rows(); q++)
+      push_operand(p(q), grad_p(q), operands, gradients);
+
+    typename boost::math::tools::promote_args<T1,T2>::type res;
+    to_result(val, operands, gradients, res);
+    return res;
+  }
+
+
+  /**
+   * scalar pwa_event_sum_floating(floating_events, complex_vector, vector)
+   *
+   * Updates the floating amplitudes for the parameters p and returns
+   * sum_d log f_genfit(A_d, theta) as a single variable with precomputed
+   * partials w.r.t. theta and p. The normalization, which depends on p
+   * through the integrals of the floating amplitudes, is not included.
+   *
+   * @tparam T1,T2 Scalar types of theta and p
+   */
+  template <typename T1, typename T2, typename... Res>
+  inline typename boost::math::tools::promote_args<T1,T2>::type
+  pwa_event_sum_floating(floating_events<Res...>& events, const CV_t<T1>& theta,
+                         const Eigen::Matrix<T2, Eigen::Dynamic, 1>& p) {
+
+    const int R = theta[0].rows();
+    if (theta.size() != 2 || theta[1].rows() != R ||
+        events.num_res() != (size_t)R)
+      throw std::domain_error("pwa_loglik: size mismatch of amplitudes "
+                              "and theta");
+    if ((size_t)p.rows() != events.num_params())
+      throw std::domain_error("pwa_loglik: size mismatch of the floating "
+                              "parameters");
+
+    const CV_t<double> theta_d = value_of(theta);
+    Eigen::VectorXd p_d(p.rows());
+    for (int q = 0; q < p.rows(); q++)
+      p_d(q) = likelihood::value_of(p(q));
+    events.update(p_d.data());
+
+    Eigen::VectorXd grad_re = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd grad_im = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd grad_p = Eigen::VectorXd::Zero(p.rows());
+
+    const double sum = event_sum_parallel(events, theta_d, grad_re, grad_im,
+                                          grad_p);
+    return precomputed(sum, theta, p, grad_re, grad_im, grad_p);
+  }
+
+}
+}
+#endif
@@ -0,0 +1,342 @@
+#ifndef STAN_PWA__SRC__LIKELIHOOD__FLOATING_NORM_HPP
+#define STAN_PWA__SRC__LIKELIHOOD__FLOATING_NORM_HPP
+
+#include <algorithm> // min
+#include <cmath> // log
+#include <stdexcept> // domain_error
+#include <tuple>
+#include <vector>
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+#include <boost/math/tools/promotion.hpp>
+
+#include <stan_pwa/src/likelihood/columnar.hpp>
+#include <stan_pwa/src/likelihood/floating.hpp>
+#include <stan_pwa/src/likelihood/parallel.hpp>
+#include <stan_pwa/src/likelihood/unbinned.hpp>
+#include <stan_pwa/src/parallel.hpp>
+#include <stan_pwa/src/typedefs.h>
+
+/*
+ *  Normalization integral for fits with floating resonance parameters.
+ *
+ *  DESCRIPTION
+ *    With floating resonances (see floating.hpp), the normalization
+ *    matrix I depends on their parameters p and cannot be computed
+ *    offline. floating_norm keeps a Monte Carlo sample y_1 .. y_N with
+ *    generation weights w_n in memory, with the amplitudes of the fixed
+ *    resonances and the cached amplitudes of the floating ones (a
+ *    floating_events of the sample), and estimates
+ *
+ *      I[i,j] = scale * sum_n w_n conj(A_i(y_n)) A_j(y_n).
+ *
+ *    For points uniformly distributed over a phase space of volume V,
+ *    w_n = 1 and scale = V / N (as in integrate::normalization_integral);
+ *    for points drawn from a density g, w_n = 1 / g(y_n) and
+ *    scale = 1 / N.
+ *
+ *    The block of the fixed resonances is computed once. update(p)
+ *    re-evaluates the floating resonances whose parameters changed, and
+ *    recomputes only their rows and columns of I, together with
+ *
+ *      J_q[i] = dI[i,r] / dp_q = scale * sum_n w_n conj(A_i) dA_r / dp_q
+ *
+ *    for the parameters q of the resonance r, where A_i or A_r changed.
+ *    The sums run over chunks of points on the thread pool and are added
+ *    in a fixed order, so the result does not depend on the number of
+ *    threads. With I hermitian,
+ *
+ *      dN / dp_q = 2 Re(theta_r sum_i conj(theta_i) J_q[i])
+ *
+ *    for N = Re(theta^H I theta), at the cost of O(R) per parameter.
+ *
+ *  FUNCTIONS
+ *    size_t floating_norm<Res...>::update(p)
+ *    scalar floating_norm<Res...>::value(theta, grad_re, grad_im, grad_p)
+ *    floating_fit<std::tuple<Res...> >
+ *    scalar pwa_loglik_floating(floating_events, floating_norm, complex_vector, vector)
+ */
+
+namespace stan_pwa {
+namespace likelihood {
+
+  /**
+   * Monte Carlo normalization integral I of a model with the floating
+   * resonances Res... (see above). The parameters p are ordered as for
+   * floating_events<Res...>.
+   */
+  template <typename... Res>
+  class floating_norm {
+  public:
+    /**
+     * @param fixed Amplitudes of the fixed resonances at the N points
+     * @param m2_ab, m2_bc Dalitz plot variables of the N points
+     * @param weights Generation weights of the points (0: all 1)
+     * @param scale Factor of the weighted sums (see above)
+     * @param sym Whether the floating amplitudes are symmetrized
+     */
+    floating_norm(const column_events& fixed, const double* m2_ab,
+                  const double* m2_bc, const double* weights, double scale,
+                  bool sym, const Res&... res) :
+      floating_norm(fixed, m2_ab, m2_bc, weights, scale, sym,
+                    std::make_tuple(res...)) {};
+
+    ///> Same as above, with the floating resonances in a tuple
+    floating_norm(const column_events& fixed, const double* m2_ab,
+                  const double* m2_bc, const double* weights, double scale,
+                  bool sym, const std::tuple<Res...>& res) :
+      mc_(fixed, m2_ab, m2_bc, sym, res), scale_(scale),
+      w_(weights != 0 ? std::vector<double>(weights, weights + fixed.size())
+         : std::vector<double>(fixed.size(), 1.0)),
+      I_(2, Eigen::MatrixXd::Zero(mc_.num_res(), mc_.num_res())),
+      J_re_(Eigen::MatrixXd::Zero(mc_.num_res(), mc_.num_params())),
+      J_im_(Eigen::MatrixXd::Zero(mc_.num_res(), mc_.num_params()))
+    {
+      // Block of the fixed resonances
+      std::vector<entry> entries;
+      for (size_t r = 0; r < mc_.num_fixed(); r++) {
+        const entry e = { 0, A().re_column(r), A().im_column(r), r, -1 };
+        for (size_t i = 0; i <= r; i++) {
+          entries.push_back(e);
+          entries.back().i = i;
+        }
+      }
+      integrate(entries);
+    };
+
+    size_t size() const { return mc_.size(); }
+    size_t num_res() const { return mc_.num_res(); }
+    size_t num_params() const { return mc_.num_params(); }
+
+    ///> Normalization matrix (I[0] real, I[1] imaginary part)
+    const std::vector<Eigen::MatrixXd>& I() const { return I_; }
+
+    /**
+     * Updates I for the parameters p (see above); must be called before
+     * the first use of I. Returns the number of resonances re-evaluated.
+     */
+    size_t update(const double* p) {
+      const size_t n = mc_.update(p);
+      if (n == 0)
+        return 0;
+
+      const size_t R = num_res();
+      std::vector<bool> changed(R, false);
+      for (size_t k = 0; k < n; k++)
+        changed[mc_.updated()[k]] = true;
+
+      std::vector<entry> entries;
+      for (size_t k = 0; k < n; k++) {
+        const size_t r = mc_.updated()[k];
+        for (size_t i = 0; i < R; i++) {
+          if (!changed[i] || i <= r) {
+            const entry e = { i, A().re_column(r), A().im_column(r), r, -1 };
+            entries.push_back(e);
+          }
+        }
+      }
+      for (size_t q = 0; q < num_params(); q++) {
+        const size_t r = mc_.param_res(q);
+        for (size_t i = 0; i < R; i++) {
+          if (changed[r] || changed[i]) {
+            const entry e = { i, mc_.d_re(q), mc_.d_im(q), r, (int)q };
+            entries.push_back(e);
+          }
+        }
+      }
+      integrate(entries);
+      return n;
+    }
+
+    /**
+     * scalar value(theta, grad_re, grad_im, grad_p)
+     *
+     * Returns N = Re(theta^H I theta) (see norm in unbinned.hpp) and adds
+     * its derivatives w.r.t. Re(theta), Im(theta) and p to grad_re,
+     * grad_im and grad_p.
+     */
+    double value(const CV_t<double>& theta, Eigen::VectorXd& grad_re,
+                 Eigen::VectorXd& grad_im, Eigen::VectorXd& grad_p) const {
+      // c_q = sum_i conj(theta_i) J_q[i]
+      const Eigen::VectorXd c_re = J_re_.transpose() * theta[0]
+        + J_im_.transpose() * theta[1];
+      const Eigen::VectorXd c_im = J_im_.transpose() * theta[0]
+        - J_re_.transpose() * theta[1];
+      for (size_t q = 0; q < num_params(); q++) {
+        const size_t r = mc_.param_res(q);
+        grad_p(q) += 2 * (theta[0](r) * c_re(q) - theta[1](r) * c_im(q));
+      }
+      return norm(theta, I_, grad_re, grad_im);
+    }
+
+    ///> Total number of evaluations of the floating amplitudes
+    size_t evaluations() { return mc_.evaluations(); }
+
+  private:
+    floating_norm(const floating_norm&);
+    floating_norm& operator=(const floating_norm&);
+
+    ///> Element sum_n w_n conj(A_i) x of I (q = -1, x = A_r) or of J_q
+    struct entry {
+      size_t i;
+      const double* x_re;
+      const double* x_im;
+      size_t r;
+      int q;
+    };
+
+    column_events A() const { return mc_.columns(); }
+
+    ///> Computes the entries and stores them in I or J
+    void integrate(const std::vector<entry>& entries) {
+      const size_t E = entries.size();
+      const size_t N = size();
+      const size_t num_chunks = (N + chunk_size - 1) / chunk_size;
+      if (E == 0 || num_chunks == 0)
+        return;
+
+      const column_events cols = A();
+      const double* w = w_.data();
+      std::vector<std::vector<double> > partial(num_chunks);
+      parallel::thread_pool::instance().run(num_chunks, [&](size_t c) {
+          std::vector<double>& s = partial[c];
+          s.resize(2 * E);
+          const size_t begin = c * chunk_size;
+          const size_t end = std::min(begin + chunk_size, N);
+          for (size_t k = 0; k < E; k++) {
+            const entry& e = entries[k];
+            const double* a_re = cols.re_column(e.i);
+            const double* a_im = cols.im_column(e.i);
+            double s_re = 0.0;
+            double s_im = 0.0;
+            for (size_t n = begin; n < end; n++) {
+              s_re += w[n] * (a_re[n] * e.x_re[n] + a_im[n] * e.x_im[n]);
+              s_im += w[n] * (a_re[n] * e.x_im[n] - a_im[n] * e.x_re[n]);
+            }
+            s[2 * k] = s_re;
+            s[2 * k + 1] = s_im;
+          }
+        });
+
+      // Pairwise reduction; partial[0] holds the total at the end
+      for (size_t stride = 1; stride < num_chunks; stride *= 2) {
+        for (size_t c = 0; c + stride < num_chunks; c += 2 * stride) {
+          for (size_t k = 0; k < 2 * E; k++)
+            partial[c][k] += partial[c + stride][k];
+        }
+      }
+
+      for (size_t k = 0; k < E; k++) {
+        const entry& e = entries[k];
+        const double s_re = scale_ * partial[0][2 * k];
+        const double s_im = scale_ * partial[0][2 * k + 1];
+        if (e.q < 0) {
+          I_[0](e.i, e.r) = I_[0](e.r, e.i) = s_re;
+          I_[1](e.i, e.r) = s_im;
+          I_[1](e.r, e.i) = -s_im;
+        } else {
+          J_re_(e.i, e.q) = s_re;
+          J_im_(e.i, e.q) = s_im;
+        }
+      }
+    }
+
+    floating_events<Res...> mc_;
+    double scale_;
+    std::vector<double> w_;
+    std::vector<Eigen::MatrixXd> I_;
+    Eigen::MatrixXd J_re_; // J_q[i] = J_re_(i,q) + i J_im_(i,q)
+    Eigen::MatrixXd J_im_;
+  };
+
+
+  ///> Number of parameters of the floating resonances Res...
+  template <typename... Res>
+  struct floating_num_params {
+    static const int value = 0;
+  };
+
+  template <typename R, typename... Res>
+  struct floating_num_params<R, Res...> {
+    static const int value = R::num_params
+      + floating_num_params<Res...>::value;
+  };
+
+
+  /**
+   * Types of a fit with the floating resonances of the tuple Tuple (e.g.
+   * std::tuple<resonances::floating_breit_wigner>, as declared in
+   * model_inst.hpp): its events, its normalization integral, and the
+   * numbers of floating resonances and parameters.
+   */
+  template <typename Tuple>
+  struct floating_fit;
+
+  template <typename... Res>
+  struct floating_fit<std::tuple<Res...> > {
+    typedef floating_events<Res...> events;
+    typedef floating_norm<Res...> norm;
+    static const int num_res = sizeof...(Res);
+    static const int num_params = floating_num_params<Res...>::value;
+  };
+
+
+  /**
+   * scalar pwa_loglik_floating(floating_events, floating_norm, complex_vector, vector)
+   *
+   * Same as pwa_loglik_columns for a model with floating resonances:
+   * updates the amplitudes of the events and the normalization integral
+   * for the parameters p, and returns
+   *
+   *   sum_d log( f_genfit(A_d, theta) / norm(theta, I(p)) )
+   *
+   * as a single variable with precomputed partials w.r.t. theta and p.
+   *
+   * @tparam T1,T2 Scalar types of theta and p
+   */
+  template <typename T1, typename T2, typename... Res>
+  inline typename boost::math::tools::promote_args<T1,T2>::type
+  pwa_loglik_floating(floating_events<Res...>& events,
+                      floating_norm<Res...>& I, const CV_t<T1>& theta,
+                      const Eigen::Matrix<T2, Eigen::Dynamic, 1>& p) {
+
+    const int R = theta[0].rows();
+    if (theta.size() != 2 || theta[1].rows() != R ||
+        events.num_res() != (size_t)R || I.num_res() != (size_t)R)
+      throw std::domain_error("pwa_loglik: size mismatch of amplitudes, "
+                              "theta and I");
+    if ((size_t)p.rows() != events.num_params())
+      throw std::domain_error("pwa_loglik: size mismatch of the floating "
+                              "parameters");
+
+    const double D = events.size();
+    const CV_t<double> theta_d = value_of(theta);
+    Eigen::VectorXd p_d(p.rows());
+    for (int q = 0; q < p.rows(); q++)
+      p_d(q) = likelihood::value_of(p(q));
+    events.update(p_d.data());
+    I.update(p_d.data());
+
+    Eigen::VectorXd grad_re = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd grad_im = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd grad_p = Eigen::VectorXd::Zero(p.rows());
+    Eigen::VectorXd norm_grad_re = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd norm_grad_im = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd norm_grad_p = Eigen::VectorXd::Zero(p.rows());
+
+    const double sum = event_sum_parallel(events, theta_d, grad_re, grad_im,
+                                          grad_p);
+    const double N = I.value(theta_d, norm_grad_re, norm_grad_im,
+                             norm_grad_p);
+
+    grad_re -= D / N * norm_grad_re;
+    grad_im -= D / N * norm_grad_im;
+    grad_p -= D / N * norm_grad_p;
+
+    return precomputed(sum - D * std::log(N), theta, p, grad_re, grad_im,
+                       grad_p);
+  }
+
+}
+}
+#endif
@@ -0,0 +1,191 @@
+#ifndef STAN_PWA__SRC__LIKELIHOOD__PACKED_HERMITIAN_HPP
+#define STAN_PWA__SRC__LIKELIHOOD__PACKED_HERMITIAN_HPP
+
+#include <cmath> // log
+#include <stdexcept> // domain_error
+#include <vector>
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+
+#include <stan_pwa/src/likelihood/unbinned.hpp>
+#include <stan_pwa/src/typedefs.h>
+
+/*
+ *  Unbinned PWA log-likelihood on precomputed outer products.
+ *
+ *  DESCRIPTION
+ *    For fixed amplitudes A_d of event d,
+ *
+ *      f_genfit(A_d, theta) = |sum_r theta_r A_dr|^2
+ *                           = sum_{i,j} conj(theta_i) theta_j H_d[i,j],
+ *
+ *    with the Hermitian matrix H_d[i,j] = conj(A_di) A_dj. We store the
+ *    upper triangle (i <= j) of every H_d, P = R (R + 1) / 2 entries,
+ *    as two P x D matrices (real and imaginary parts, one column per
+ *    event). The entry (i,j) is stored in row packed_index(i, j, R).
+ *
+ *    For given theta, f_genfit of all events is then the matrix-vector
+ *    product f = H_re^T a + H_im^T b with coefficient vectors a, b of
+ *    length P built from theta once per evaluation, and the gradient is
+ *    obtained from H_re (1/f) and H_im (1/f).
+ *
+ *    In STAN, the cache is passed as data 'matrix[P, D] H[2]'; it can be
+ *    produced with lib/py/utils/hermitian.py or pack_hermitian below.
+ *
+ *  FUNCTIONS
+ *    int packed_index(i, j, R)
+ *    complex_matrix pack_hermitian(complex_vector[D])
+ *    scalar pwa_loglik_packed(complex_matrix, complex_vector, complex_matrix)
+ */
+
+namespace stan_pwa {
+namespace likelihood {
+
+  /**
+   * Row of the element (i,j), i <= j, of the upper triangle of an RxR
+   * matrix, packed row by row.
+   */
+  inline int
+  packed_index(int i, int j, int R) {
+    return i * R - i * (i - 1) / 2 + (j - i);
+  }
+
+
+  /**
+   * complex_matrix pack_hermitian(complex_vector[D])
+   *
+   * Returns the packed upper triangles of conj(A_d) A_d^T for all events,
+   * as a pair of P x D matrices (real part, imaginary part).
+   *
+   * @param A Amplitudes in the STAN layout (vector[R] A[D,2])
+   */
+  inline std::vector<Eigen::MatrixXd>
+  pack_hermitian(const std::vector<CV_t<double> >& A) {
+
+    const int D = A.size();
+    const int R = D > 0 ? A[0][0].rows() : 0;
+    const int P = R * (R + 1) / 2;
+
+    std::vector<Eigen::MatrixXd> H(2, Eigen::MatrixXd(P, D));
+    for (int d = 0; d < D; d++) {
+      const double* a_re = A[d][0].data();
+      const double* a_im = A[d][1].data();
+      double* h_re = H[0].col(d).data();
+      double* h_im = H[1].col(d).data();
+
+      int k = 0;
+      for (int i = 0; i < R; i++) {
+        for (int j = i; j < R; j++, k++) {
+          h_re[k] = a_re[i] * a_re[j] + a_im[i] * a_im[j];
+          h_im[k] = a_re[i] * a_im[j] - a_im[i] * a_re[j];
+        }
+      }
+    }
+    return H;
+  }
+
+
+  /**
+   * scalar event_sum_packed(H, theta, grad_re, grad_im)
+   *
+   * Returns sum_d log f_genfit(A_d, theta), evaluated on the packed
+   * outer products H, and adds its derivatives w.r.t. Re(theta),
+   * Im(theta) to grad_re, grad_im.
+   */
+  inline double
+  event_sum_packed(const std::vector<Eigen::MatrixXd>& H,
+                   const CV_t<double>& theta,
+                   Eigen::VectorXd& grad_re, Eigen::VectorXd& grad_im) {
+
+    const int R = theta[0].rows();
+    const int P = R * (R + 1) / 2;
+    const double* t_re = theta[0].data();
+    const double* t_im = theta[1].data();
+
+    // f = H_re^T a + H_im^T b, where for i < j
+    //   a + i b = 2 conj(conj(theta_i) theta_j)  [ 2 Re(p H) = a H_re + b H_im ]
+    // and for i == j
+    //   a = |theta_i|^2, b = 0.
+    Eigen::VectorXd a(P);
+    Eigen::VectorXd b(P);
+    int k = 0;
+    for (int i = 0; i < R; i++) {
+      a(k) = t_re[i] * t_re[i] + t_im[i] * t_im[i];
+      b(k) = 0.0;
+      k++;
+      for (int j = i + 1; j < R; j++, k++) {
+        a(k) = 2.0 * (t_re[i] * t_re[j] + t_im[i] * t_im[j]);
+        b(k) = -2.0 * (t_re[i] * t_im[j] - t_im[i] * t_re[j]);
+      }
+    }
+
+    const Eigen::VectorXd f = H[0].transpose() * a + H[1].transpose() * b;
+    const Eigen::VectorXd f_inv = f.cwiseInverse();
+
+    double res = 0.0;
+    for (int d = 0; d < f.rows(); d++)
+      res += std::log(f(d));
+
+    // d/da, d/db of sum_d log f_d
+    const Eigen::VectorXd g_a = H[0] * f_inv;
+    const Eigen::VectorXd g_b = H[1] * f_inv;
+
+    // Chain rule to Re(theta), Im(theta)
+    k = 0;
+    for (int i = 0; i < R; i++) {
+      grad_re(i) += 2.0 * t_re[i] * g_a(k);
+      grad_im(i) += 2.0 * t_im[i] * g_a(k);
+      k++;
+      for (int j = i + 1; j < R; j++, k++) {
+        grad_re(i) += 2.0 * (t_re[j] * g_a(k) - t_im[j] * g_b(k));
+        grad_im(i) += 2.0 * (t_im[j] * g_a(k) + t_re[j] * g_b(k));
+        grad_re(j) += 2.0 * (t_re[i] * g_a(k) + t_im[i] * g_b(k));
+        grad_im(j) += 2.0 * (t_im[i] * g_a(k) - t_re[i] * g_b(k));
+      }
+    }
+    return res;
+  }
+
+
+  /**
+   * scalar pwa_loglik_packed(complex_matrix, complex_vector, complex_matrix)
+   *
+   * Same as pwa_loglik, but takes the packed outer products
+   * (see pack_hermitian) instead of the amplitudes.
+   *
+   * @tparam T Scalar type of theta
+   */
+  template <typename T>
+  inline T
+  pwa_loglik_packed(const std::vector<Eigen::MatrixXd>& H,
+                    const CV_t<T>& theta,
+                    const std::vector<Eigen::MatrixXd>& I) {
+
+    const int R = theta[0].rows();
+    const int P = R * (R + 1) / 2;
+    if (H.size() != 2 || H[0].rows() != P || H[1].rows() != P ||
+        H[0].cols() != H[1].cols())
+      throw std::domain_error("pwa_loglik_packed: size mismatch of the "
+                              "packed amplitudes and theta");
+    check_sizes(std::vector<CV_t<double> >(), theta, I);
+
+    const double D = H[0].cols();
+    const CV_t<double> theta_d = value_of(theta);
+
+    Eigen::VectorXd grad_re = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd grad_im = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd norm_grad_re = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd norm_grad_im = Eigen::VectorXd::Zero(R);
+
+    const double sum = event_sum_packed(H, theta_d, grad_re, grad_im);
+    const double N = norm(theta_d, I, norm_grad_re, norm_grad_im);
+
+    grad_re -= D / N * norm_grad_re;
+    grad_im -= D / N * norm_grad_im;
+
+    return precomputed(sum - D * std::log(N), theta, grad_re, grad_im);
+  }
+
+}
+}
+#endif
@@ -0,0 +1,129 @@
+#ifndef STAN_PWA__SRC__LIKELIHOOD__PARALLEL_HPP
+#define STAN_PWA__SRC__LIKELIHOOD__PARALLEL_HPP
+
+#include <algorithm> // min
+#include <cmath> // log
+#include <vector>
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+
+#include <stan_pwa/src/likelihood/unbinned.hpp>
+#include <stan_pwa/src/parallel.hpp>
+#include <stan_pwa/src/typedefs.h>
+
+/*
+ *  Multi-threaded unbinned PWA log-likelihood.
+ *
+ *  DESCRIPTION
+ *    The events are split into chunks of fixed size (chunk_size). Each
+ *    chunk computes its part of the event sum and of the gradient in
+ *    double precision, on the threads of parallel::thread_pool. The
+ *    partial results are then added pairwise, (0+1) (2+3) ..., then
+ *    (01+23) ..., always in the same order. The chunk boundaries and the
+ *    order of the additions only depend on the number of events, so the
+ *    result is bit-for-bit the same for any number of threads.
+ *
+ *  FUNCTIONS
+ *    scalar event_sum_parallel(events, theta, grad_re, grad_im)
+ *    scalar pwa_loglik_threaded(complex_vector[D], complex_vector, complex_matrix)
+ */
+
+namespace stan_pwa {
+namespace likelihood {
+
+  ///> Number of events per chunk
+  const size_t chunk_size = 2048;
+
+
+  ///> Contribution of one chunk of events
+  struct partial_sum {
+    double value;
+    Eigen::VectorXd grad_re;
+    Eigen::VectorXd grad_im;
+
+    void add(const partial_sum& other) {
+      value += other.value;
+      grad_re += other.grad_re;
+      grad_im += other.grad_im;
+    }
+  };
+
+
+  /**
+   * scalar event_sum_parallel(events, theta, grad_re, grad_im)
+   *
+   * Same as event_sum over all events, computed chunk-wise on the
+   * thread pool and combined with a fixed-order tree reduction.
+   *
+   * @tparam E Event container (see stan_events)
+   */
+  template <typename E>
+  inline double
+  event_sum_parallel(const E& events, const CV_t<double>& theta,
+                     Eigen::VectorXd& grad_re, Eigen::VectorXd& grad_im) {
+
+    const int R = theta[0].rows();
+    const size_t num_events = events.size();
+    const size_t num_chunks = (num_events + chunk_size - 1) / chunk_size;
+    if (num_chunks == 0)
+      return 0.0;
+
+    std::vector<partial_sum> partial(num_chunks);
+    parallel::thread_pool::instance().run(num_chunks, [&](size_t c) {
+        partial_sum& p = partial[c];
+        p.grad_re = Eigen::VectorXd::Zero(R);
+        p.grad_im = Eigen::VectorXd::Zero(R);
+        const size_t begin = c * chunk_size;
+        const size_t end = std::min(begin + chunk_size, num_events);
+        p.value = event_sum(events, begin, end, theta, p.grad_re, p.grad_im);
+      });
+
+    // Pairwise reduction; partial[0] holds the total at the end
+    for (size_t stride = 1; stride < num_chunks; stride *= 2) {
+      for (size_t c = 0; c + stride < num_chunks; c += 2 * stride)
+        partial[c].add(partial[c + stride]);
+    }
+
+    grad_re += partial[0].grad_re;
+    grad_im += partial[0].grad_im;
+    return partial[0].value;
+  }
+
+
+  /**
+   * scalar pwa_loglik_threaded(complex_vector[D], complex_vector, complex_matrix)
+   *
+   * Multi-threaded version of pwa_loglik. The value does not depend on
+   * the number of threads (see above).
+   *
+   * @tparam T Scalar type of theta
+   */
+  template <typename T>
+  inline T
+  pwa_loglik_threaded(const std::vector<CV_t<double> >& A, const CV_t<T>& theta,
+                      const std::vector<Eigen::MatrixXd>& I) {
+
+    check_sizes(A, theta, I);
+
+    const int R = theta[0].rows();
+    const double D = A.size();
+    const CV_t<double> theta_d = value_of(theta);
+
+    Eigen::VectorXd grad_re = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd grad_im = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd norm_grad_re = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd norm_grad_im = Eigen::VectorXd::Zero(R);
+
+    const double sum = event_sum_parallel(stan_events(A), theta_d,
+                                          grad_re, grad_im);
+    const double N = norm(theta_d, I, norm_grad_re, norm_grad_im);
+
+    grad_re -= D / N * norm_grad_re;
+    grad_im -= D / N * norm_grad_im;
+
+    return precomputed(sum - D * std::log(N), theta, grad_re, grad_im);
+  }
+
+}
+}
+#endif
@@ -0,0 +1,290 @@
+#ifndef STAN_PWA__SRC__LIKELIHOOD__UNBINNED_HPP
+#define STAN_PWA__SRC__LIKELIHOOD__UNBINNED_HPP
+
+#include <cmath> // log
+#include <stdexcept> // domain_error
+#include <vector>
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+#include <stan/math/rev/core.hpp> // var, precomputed_gradients
+
+#include <stan_pwa/src/complex.hpp>
+#include <stan_pwa/src/typedefs.h>
+
+/*
+ *  Unbinned PWA log-likelihood with analytic gradient.
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/likelihood.hpp
+ *
+ *  FUNCTIONS
+ *    scalar event_sum(events, begin, end, theta, grad_re, grad_im)
+ *    scalar norm(theta, I, grad_re, grad_im)
+ *    scalar pwa_loglik(complex_vector[D], complex_vector, complex_matrix)
+ */
+
+namespace mc = stan_pwa::complex;
+
+namespace stan_pwa {
+namespace likelihood {
+
+  /**
+   * Read-only view of amplitude data in the STAN layout
+   * (vector[R] amplitude_vector_data[D,2]).
+   *
+   * Any other event container may be passed to event_sum, as long as it
+   * provides size(), and re(d), im(d) returning pointers to the R real
+   * and imaginary parts of the amplitudes of event d.
+   */
+  struct stan_events {
+    stan_events(const std::vector<CV_t<double> >& A) : A_(A) {};
+
+    size_t size() const { return A_.size(); }
+    const double* re(size_t d) const { return A_[d][0].data(); }
+    const double* im(size_t d) const { return A_[d][1].data(); }
+
+  private:
+    const std::vector<CV_t<double> >& A_;
+  };
+
+
+  inline double value_of(double x) { return x; }
+  inline double value_of(const stan::math::var& x) { return x.val(); }
+
+
+  /**
+   * complex_vector value_of(complex_vector)
+   *
+   * Double-valued copy of theta.
+   *
+   * @tparam T Scalar type
+   */
+  template <typename T>
+  inline CV_t<double>
+  value_of(const CV_t<T>& theta) {
+    const int R = theta[0].rows();
+    CV_t<double> res(2, Eigen::VectorXd(R));
+    for (int r = 0; r < R; r++) {
+      res[0](r) = likelihood::value_of(theta[0](r));
+      res[1](r) = likelihood::value_of(theta[1](r));
+    }
+    return res;
+  }
+
+
+  /**
+   * scalar event_sum(events, begin, end, theta, grad_re, grad_im)
+   *
+   * Returns sum_{d = begin}^{end - 1} log |sum_r theta_r A_dr|^2 and adds
+   * its derivatives w.r.t. Re(theta_r), Im(theta_r) to grad_re, grad_im.
+   *
+   * With S = sum_r theta_r A_r and f = |S|^2:
+   *   df / dRe(theta_r) = 2 Re(conj(S) A_r),
+   *   df / dIm(theta_r) = 2 Im(S conj(A_r)).
+   *
+   * @tparam E Event container (see stan_events)
+   */
+  template <typename E>
+  inline double
+  event_sum(const E& events, size_t begin, size_t end,
+            const CV_t<double>& theta,
+            Eigen::VectorXd& grad_re, Eigen::VectorXd& grad_im) {
+
+    const int R = theta[0].rows();
+    const double* t_re = theta[0].data();
+    const double* t_im = theta[1].data();
+
+    double res = 0.0;
+    for (size_t d = begin; d < end; d++) {
+      const double* a_re = events.re(d);
+      const double* a_im = events.im(d);
+
+      double s_re = 0.0;
+      double s_im = 0.0;
+      for (int r = 0; r < R; r++) {
+        s_re += t_re[r] * a_re[r] - t_im[r] * a_im[r];
+        s_im += t_re[r] * a_im[r] + t_im[r] * a_re[r];
+      }
+
+      const double f = s_re * s_re + s_im * s_im;
+      res += std::log(f);
+
+      const double w = 2.0 / f;
+      for (int r = 0; r < R; r++) {
+        grad_re(r) += w * (s_re * a_re[r] + s_im * a_im[r]);
+        grad_im(r) += w * (s_im * a_re[r] - s_re * a_im[r]);
+      }
+    }
+    return res;
+  }
+
+
+  /**
+   * scalar norm(theta, I, grad_re, grad_im)
+   *
+   * Returns N = Re(theta^H I theta), as Model::norm does, and adds its
+   * derivatives w.r.t. Re(theta), Im(theta) to grad_re, grad_im.
+   *
+   * With u = I theta and w = theta^H I:
+   *   dN / dRe(theta_k) = Re(u_k) + Re(w_k),
+   *   dN / dIm(theta_k) = Im(u_k) - Im(w_k).
+   */
+  inline double
+  norm(const CV_t<double>& theta,
+       const std::vector<Eigen::MatrixXd>& I,
+       Eigen::VectorXd& grad_re, Eigen::VectorXd& grad_im) {
+
+    const Eigen::VectorXd u_re = I[0] * theta[0] - I[1] * theta[1];
+    const Eigen::VectorXd u_im = I[0] * theta[1] + I[1] * theta[0];
+    const Eigen::VectorXd w_re = I[0].transpose() * theta[0]
+      + I[1].transpose() * theta[1];
+    const Eigen::VectorXd w_im = I[1].transpose() * theta[0]
+      - I[0].transpose() * theta[1];
+
+    grad_re += u_re + w_re;
+    grad_im += u_im - w_im;
+
+    return theta[0].dot(u_re) + theta[1].dot(u_im);
+  }
+
+
+  /**
+   * Checks that theta and I describe the same number of resonances.
+   */
+  template <typename T1, typename T2>
+  inline void
+  check_sizes(const CV_t<T1>& theta,
+              const std::vector<Eigen::Matrix<T2, Eigen::Dynamic,
+                                              Eigen::Dynamic> >& I) {
+    const int R = theta[0].rows();
+    if (theta.size() != 2 || theta[1].rows() != R || I.size() != 2 ||
+        I[0].rows() != R || I[0].cols() != R ||
+        I[1].rows() != R || I[1].cols() != R)
+      throw std::domain_error("pwa_loglik: size mismatch of theta and I");
+  }
+
+
+  /**
+   * Checks that the amplitudes, theta and I describe the same number
+   * of resonances.
+   */
+  template <typename T0, typename T1, typename T2>
+  inline void
+  check_sizes(const std::vector<CV_t<T0> >& A, const CV_t<T1>& theta,
+              const std::vector<Eigen::Matrix<T2, Eigen::Dynamic,
+                                              Eigen::Dynamic> >& I) {
+    check_sizes(theta, I);
+    const int R = theta[0].rows();
+    for (size_t d = 0; d < A.size(); d++) {
+      if (A[d].size() != 2 || A[d][0].rows() != R || A[d][1].rows() != R)
+        throw std::domain_error("pwa_loglik: size mismatch of amplitudes "
+                                "and theta");
+    }
+  }
+
+
+  /**
+   * Wraps the value and gradient computed in double precision to the
+   * return type. For double theta only the value is needed.
+   */
+  inline double
+  precomputed(double val, const CV_t<double>& theta,
+              const Eigen::VectorXd& grad_re,
+              const Eigen::VectorXd& grad_im) {
+    return val;
+  }
+
+  inline stan::math::var
+  precomputed(double val, const CV_t<stan::math::var>& theta,
+              const Eigen::VectorXd& grad_re,
+              const Eigen::VectorXd& grad_im) {
+    const int R = theta[0].rows();
+    std::vector<stan::math::var> operands;
+    std::vector<double> gradients;
+    operands.reserve(2 * R);
+    gradients.reserve(2 * R);
+    for (int r = 0; r < R; r++) {
+      operands.push_back(theta[0](r));
+      gradients.push_back(grad_re(r));
+      operands.push_back(theta[1](r));
+      gradients.push_back(grad_im(r));
+    }
+    return stan::math::precomputed_gradients(val, operands, gradients);
+  }
+
+
+  /**
+   * scalar pwa_loglik(complex_vector[D], complex_vector, complex_matrix)
+   *
+   * Returns sum_d log( f_genfit(A_d, theta) / norm(theta, I) ) as a single
+   * variable with precomputed partials w.r.t. theta.
+   *
+   * @tparam T Scalar type of theta
+   */
+  template <typename T>
+  inline T
+  pwa_loglik(const std::vector<CV_t<double> >& A, const CV_t<T>& theta,
+             const std::vector<Eigen::MatrixXd>& I) {
+
+    check_sizes(A, theta, I);
+
+    const int R = theta[0].rows();
+    const double D = A.size();
+    const CV_t<double> theta_d = value_of(theta);
+
+    Eigen::VectorXd grad_re = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd grad_im = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd norm_grad_re = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd norm_grad_im = Eigen::VectorXd::Zero(R);
+
+    const double sum = event_sum(stan_events(A), 0, A.size(), theta_d,
+                                 grad_re, grad_im);
+    const double N = norm(theta_d, I, norm_grad_re, norm_grad_im);
+
+    // d/dtheta (sum - D log N)
+    grad_re -= D / N * norm_grad_re;
+    grad_im -= D / N * norm_grad_im;
+
+    return precomputed(sum - D * std::log(N), theta, grad_re, grad_im);
+  }
+
+
+  /**
+   * scalar pwa_loglik(complex_vector[D], complex_vector, complex_matrix)
+   *
+   * General version for non-constant amplitudes or normalization matrix.
+   * Evaluated with plain autodiff (as in the loop of the STAN model).
+   *
+   * @tparam T0,T1,T2 Scalar types
+   */
+  template <typename T0, typename T1, typename T2>
+  inline
+  typename boost::math::tools::promote_args<T0,T1,T2>::type
+  pwa_loglik(const std::vector<CV_t<T0> >& A, const CV_t<T1>& theta,
+             const std::vector<Eigen::Matrix<T2, Eigen::Dynamic,
+                                             Eigen::Dynamic> >& I) {
+
+    typedef typename boost::math::tools::promote_args<T0,T1,T2>::type T_res;
+
+    check_sizes(A, theta, I);
+
+    const int R = theta[0].rows();
+    T_res N = 0;
+    for (int i = 0; i < R; i++) {
+      for (int j = 0; j < R; j++) {
+        N += theta[0](i) * (I[0](i,j) * theta[0](j) - I[1](i,j) * theta[1](j))
+          + theta[1](i) * (I[0](i,j) * theta[1](j) + I[1](i,j) * theta[0](j));
+      }
+    }
+
+    T_res res = 0;
+    for (size_t d = 0; d < A.size(); d++) {
+      res += log(mc::scalar::abs2(mc::vector::sum(mc::vector::mult(A[d], theta))));
+    }
+
+    return res - (double)A.size() * log(N);
+  }
+
+}
+}
+#endif
@@ -0,0 +1,23 @@
+#ifndef STAN_PWA__SRC__PARALLEL_HPP
+#define STAN_PWA__SRC__PARALLEL_HPP
+
+#include <stan_pwa/src/parallel/thread_pool.hpp>
+
+/*
+ *  Multi-threading helpers.
+ *
+ *  DESCRIPTION
+ *    A fixed pool of worker threads that runs a number of independent
+ *    tasks (e.g. chunks of events) and returns when all of them are done.
+ *    The results must be stored per task by the caller and combined in a
+ *    fixed order afterwards, so that the outcome does not depend on the
+ *    number of threads or on the scheduling (chains stay reproducible).
+ *
+ *    The number of threads is taken from the environment variable
+ *    STAN_PWA_NUM_THREADS; if it is not set, all available cores are used.
+ *
+ *  FUNCTIONS
+ *    Are currently listed in particular files - thread_pool.hpp.
+ */
+
+#endif
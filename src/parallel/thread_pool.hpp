@@ -0,0 +1,206 @@
+#ifndef STAN_PWA__SRC__PARALLEL__THREAD_POOL_HPP
+#define STAN_PWA__SRC__PARALLEL__THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstdlib> // getenv, atoi
+#include <exception> // exception_ptr
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ *  Fixed-size pool of worker threads.
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/parallel.hpp
+ *
+ *  FUNCTIONS
+ *    int num_threads()
+ *    thread_pool& thread_pool::instance()
+ *    void thread_pool::run(num_tasks, task)
+ */
+
+namespace stan_pwa {
+namespace parallel {
+
+  /**
+   * int num_threads()
+   *
+   * Number of worker threads: STAN_PWA_NUM_THREADS if set, the number
+   * of available cores else.
+   */
+  inline int
+  num_threads() {
+    const char* env = std::getenv("STAN_PWA_NUM_THREADS");
+    if (env != 0 && std::atoi(env) > 0)
+      return std::atoi(env);
+    const int n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+  }
+
+
+  /**
+   * Pool of worker threads, created once and kept alive.
+   *
+   * run(num_tasks, task) calls task(i) for i = 0 .. num_tasks - 1, each
+   * exactly once, and returns when all calls have finished. Tasks are
+   * handed out in increasing order, but may finish in any order; the
+   * calling thread works on the tasks as well.
+   *
+   * If a task throws, the tasks not yet started are skipped, and run
+   * rethrows the first exception once the running ones have finished.
+   * A task may call run itself (e.g. a parallel integral inside a
+   * parallel loop): the nested tasks then run on the calling thread.
+   */
+  class thread_pool {
+  public:
+    explicit thread_pool(int num_threads) :
+      task_(0), num_tasks_(0), next_task_(0), num_done_(0), error_(),
+      generation_(0), stop_(false)
+    {
+      for (int i = 1; i < num_threads; i++)
+        workers_.push_back(std::thread(&thread_pool::work, this));
+    };
+
+    ~thread_pool() {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      wake_.notify_all();
+      for (size_t i = 0; i < workers_.size(); i++)
+        workers_[i].join();
+    };
+
+    ///> Pool shared by all likelihood evaluations
+    static thread_pool& instance() {
+      static thread_pool pool(stan_pwa::parallel::num_threads());
+      return pool;
+    }
+
+    int size() const { return workers_.size() + 1; }
+
+    void run(size_t num_tasks, const std::function<void(size_t)>& task) {
+      if (num_tasks == 0)
+        return;
+      if (workers_.empty() || num_tasks == 1 || in_pool()) {
+        for (size_t i = 0; i < num_tasks; i++)
+          task(i);
+        return;
+      }
+
+      // One run at a time (e.g. several STAN threads sharing the pool)
+      std::unique_lock<std::mutex> run_lock(run_mutex_);
+      const run_guard guard(*this);
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        task_ = &task;
+        num_tasks_ = num_tasks;
+        next_task_ = 0;
+        num_done_ = 0;
+        error_ = std::exception_ptr();
+        generation_++;
+      }
+      wake_.notify_all();
+
+      work_on_tasks();
+
+      std::exception_ptr error;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (num_done_ < num_tasks_)
+          done_.wait(lock);
+        error.swap(error_);
+      }
+      if (error)
+        std::rethrow_exception(error);
+    }
+
+  private:
+    thread_pool(const thread_pool&);
+    thread_pool& operator=(const thread_pool&);
+
+    ///> Whether the current thread is running tasks of the pool
+    static bool& in_pool() {
+      static thread_local bool flag = false;
+      return flag;
+    }
+
+    ///> Marks the calling thread as in the pool for the duration of a
+    ///> run, and clears the task when the run ends (also by exception)
+    struct run_guard {
+      thread_pool& pool;
+
+      explicit run_guard(thread_pool& _pool) : pool(_pool) {
+        in_pool() = true;
+      };
+
+      ~run_guard() {
+        std::unique_lock<std::mutex> lock(pool.mutex_);
+        pool.task_ = 0;
+        in_pool() = false;
+      };
+    };
+
+    // Take tasks until there are none left; after an exception, the
+    // remaining tasks count as done without being started
+    void work_on_tasks() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (task_ != 0 && next_task_ < num_tasks_) {
+        const size_t i = next_task_++;
+        const std::function<void(size_t)>* task = task_;
+        lock.unlock();
+        std::exception_ptr error;
+        try {
+          (*task)(i);
+        } catch (...) {
+          error = std::current_exception();
+        }
+        lock.lock();
+        num_done_++;
+        if (error) {
+          if (!error_)
+            error_ = error;
+          num_done_ += num_tasks_ - next_task_;
+          next_task_ = num_tasks_;
+        }
+        if (num_done_ == num_tasks_)
+          done_.notify_all();
+      }
+    }
+
+    void work() {
+      in_pool() = true;
+      unsigned long seen = 0;
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          while (!stop_ && generation_ == seen)
+            wake_.wait(lock);
+          if (stop_)
+            return;
+          seen = generation_;
+        }
+        work_on_tasks();
+      }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::mutex run_mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+
+    const std::function<void(size_t)>* task_;
+    size_t num_tasks_;
+    size_t next_task_;
+    size_t num_done_;
+    std::exception_ptr error_; ///> First exception of the current run
+    unsigned long generation_;
+    bool stop_;
+  };
+
+}
+}
+#endif
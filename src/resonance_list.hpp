@@ -0,0 +1,31 @@
+#ifndef STAN_PWA__SRC__RESONANCE_LIST_HPP
+#define STAN_PWA__SRC__RESONANCE_LIST_HPP
+
+#include <stan_pwa/src/resonance_list/unroll.hpp>
+#include <stan_pwa/src/resonance_list/amplitudes.hpp>
+#include <stan_pwa/src/resonance_list/batch.hpp>
+#include <stan_pwa/src/resonance_list/fingerprint.hpp>
+
+/*
+ *  Resonances of a model as a std::tuple.
+ *
+ *  DESCRIPTION
+ *    The resonances of a model have different types (breit_wigner,
+ *    flatte, ...), each with its own templated value(). Stored in a
+ *    std::vector of the base class, they are sliced and value() can not
+ *    be dispatched. Instead, the model keeps them in a
+ *    std::tuple<Res...>; the loops over the resonances are unrolled at
+ *    compile time, so every resonance is evaluated through its own type,
+ *    without virtual calls or pointers to members, and the calls can be
+ *    inlined.
+ *
+ *    For 3-body decays, the kinematics of an event that do not depend on
+ *    the resonance (validity, m_ab, breakup momenta) are evaluated once
+ *    and shared by all resonances (see make_event in amplitudes.hpp).
+ *
+ *  FUNCTIONS
+ *    Are currently listed in particular files - unroll.hpp,
+ *    amplitudes.hpp, batch.hpp, fingerprint.hpp.
+ */
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef STAN_PWA__SRC__RESONANCE_LIST__AMPLITUDES_HPP
+#define STAN_PWA__SRC__RESONANCE_LIST__AMPLITUDES_HPP
+
+#include <tuple>
+#include <type_traits> // is_base_of
+#include <vector>
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+
+#include <stan_pwa/src/resonance_list/unroll.hpp>
+#include <stan_pwa/src/structures/three_body/base.hpp>
+#include <stan_pwa/src/structures/three_body/kinematics.hpp>
+#include <stan_pwa/src/typedefs.h>
+
+/*
+ *  Amplitudes of a list of resonances of different types.
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/resonance_list.hpp
+ *
+ *  FUNCTIONS
+ *    event make_event(resonances, y, sym)
+ *    complex_scalar value(resonance, event)
+ *    complex_scalar value_sym(resonance, event)
+ *    complex_vector amplitude_vector(resonances, y)
+ *    complex_vector amplitude_vector_sym(resonances, y)
+ *    complex_scalar amplitude(resonances, i, y)
+ *    complex_scalar amplitude_sym(resonances, i, y)
+ */
+
+namespace stan_pwa {
+namespace resonance_list {
+
+  ///> Number of variables of a resonance: 2 for 3-body, 5 for 4-body decays
+  template <typename R>
+  struct is_three_body {
+    static const bool value =
+      std::is_base_of<stan_pwa::resonances::resonance_base_3, R>::value;
+  };
+
+
+  ///> Whether the 3-body resonances r and s have the same kinematics,
+  ///> i.e. the same masses of P, a, b, c
+  inline bool
+  shares_kinematics(const stan_pwa::resonances::resonance_base_3& r,
+                    const stan_pwa::resonances::resonance_base_3& s) {
+    return r.P.m == s.P.m
+      && r.a.m == s.a.m && r.b.m == s.b.m && r.c.m == s.c.m;
+  }
+
+
+  /**
+   * Event of a 3-body decay: y = (m2_ab, m2_bc) and the kinematics shared
+   * by the resonances (see structures/three_body/kinematics.hpp), built
+   * once per event from the particles P, a, b, c of the first resonance.
+   * k_sym holds the kinematics at (m2_bc, m2_ab), for value_sym.
+   */
+  template <typename T>
+  struct three_body_event {
+    typedef stan_pwa::resonances::kinematics_3<T> kinematics;
+
+    const Var_t<T>& y;
+    const stan_pwa::resonances::resonance_base_3& first;
+    const kinematics k;
+    const kinematics k_sym;
+
+    three_body_event(const Var_t<T>& _y,
+                     const stan_pwa::resonances::resonance_base_3& r,
+                     bool sym) :
+      y(_y), first(r), k(y(0), y(1), r.P, r.a, r.b, r.c),
+      k_sym(sym ? k.swapped(r.P, r.a, r.b, r.c) : k) {};
+
+    ///> Whether k applies to r, i.e. r decays as the first resonance
+    bool shared_by(const stan_pwa::resonances::resonance_base_3& r) const {
+      return shares_kinematics(r, first);
+    }
+  };
+
+
+  ///> Event of a 4-body decay, y = (m2_12, m2_14, m2_23, m2_34, m2_13)
+  template <typename T>
+  struct four_body_event {
+    const Var_t<T>& y;
+
+    template <typename R>
+    four_body_event(const Var_t<T>& _y, const R&, bool) : y(_y) {};
+  };
+
+
+  ///> Event type of a list of resonances, by its first resonance
+  template <typename T, typename... Res>
+  struct event_type {
+    typedef typename std::tuple_element<0, std::tuple<Res...> >::type first;
+    typedef typename std::conditional<is_three_body<first>::value,
+                                      three_body_event<T>,
+                                      four_body_event<T> >::type type;
+  };
+
+
+  /**
+   * event make_event(resonances, y, sym)
+   *
+   * Event at y for the resonances; the 3-body kinematics are evaluated
+   * here, once for all resonances (and k_sym only if sym).
+   */
+  template <typename T, typename... Res>
+  inline typename event_type<T, Res...>::type
+  make_event(std::tuple<Res...>& resonances, const Var_t<T>& y, bool sym) {
+    return typename event_type<T, Res...>::type(y, std::get<0>(resonances),
+                                                sym);
+  }
+
+
+  /**
+   * complex_scalar value(resonance, event)
+   *
+   * Evaluates a resonance at an event, from the shared kinematics for
+   * 3-body and from y(0) .. y(4) for 4-body resonances. A 3-body
+   * resonance with other particles than the first resonance of the list
+   * evaluates its own kinematics.
+   */
+  template <typename R, typename T>
+  inline C_t<T>
+  value(R& res, const three_body_event<T>& e) {
+    if (e.shared_by(res))
+      return res.value(e.k);
+    return res.value(e.y(0), e.y(1));
+  }
+
+  template <typename R, typename T>
+  inline C_t<T>
+  value(R& res, const four_body_event<T>& e) {
+    return res.value(e.y(0), e.y(1), e.y(2), e.y(3), e.y(4));
+  }
+
+
+  /**
+   * complex_scalar value_sym(resonance, event)
+   *
+   * Same as value, symmetrized.
+   */
+  template <typename R, typename T>
+  inline C_t<T>
+  value_sym(R& res, const three_body_event<T>& e) {
+    if (e.shared_by(res))
+      return res.value_sym(e.k, e.k_sym);
+    return res.value_sym(e.y(0), e.y(1));
+  }
+
+  template <typename R, typename T>
+  inline C_t<T>
+  value_sym(R& res, const four_body_event<T>& e) {
+    return res.value_sym(e.y(0), e.y(1), e.y(2), e.y(3), e.y(4));
+  }
+
+
+  ///> Writes the value of every resonance to res[0](i), res[1](i)
+  template <typename T, bool Sym, typename E>
+  struct fill_amplitudes {
+    const E& e;
+    CV_t<T>& res;
+
+    template <typename R>
+    inline void operator()(size_t i, R& r) {
+      const C_t<T> a = Sym ? value_sym(r, e) : value(r, e);
+      res[0](i) = a[0];
+      res[1](i) = a[1];
+    }
+  };
+
+
+  ///> Value of the i-th resonance
+  template <typename T, bool Sym, typename E>
+  struct select_amplitude {
+    const E& e;
+    const size_t index;
+    C_t<T> res;
+
+    template <typename R>
+    inline void operator()(size_t i, R& r) {
+      if (i == index)
+        res = Sym ? value_sym(r, e) : value(r, e);
+    }
+  };
+
+
+  /**
+   * complex_vector amplitude_vector(resonances, y)
+   *
+   * Values of all resonances at y. The event (for 3-body decays, the
+   * kinematics of y) is evaluated once and shared by the resonances.
+   *
+   * @tparam T Scalar type
+   * @tparam Res Resonance types
+   */
+  template <typename T, typename... Res>
+  inline CV_t<T>
+  amplitude_vector(std::tuple<Res...>& resonances, const Var_t<T>& y) {
+    typedef typename event_type<T, Res...>::type E;
+    const E e = make_event(resonances, y, false);
+    CV_t<T> res(2, Eigen::Matrix<T, Eigen::Dynamic, 1>(sizeof...(Res)));
+    fill_amplitudes<T, false, E> f = {e, res};
+    for_each(resonances, f);
+    return res;
+  }
+
+
+  /**
+   * complex_vector amplitude_vector_sym(resonances, y)
+   *
+   * Symmetrized values of all resonances at y.
+   */
+  template <typename T, typename... Res>
+  inline CV_t<T>
+  amplitude_vector_sym(std::tuple<Res...>& resonances, const Var_t<T>& y) {
+    typedef typename event_type<T, Res...>::type E;
+    const E e = make_event(resonances, y, true);
+    CV_t<T> res(2, Eigen::Matrix<T, Eigen::Dynamic, 1>(sizeof...(Res)));
+    fill_amplitudes<T, true, E> f = {e, res};
+    for_each(resonances, f);
+    return res;
+  }
+
+
+  /**
+   * complex_scalar amplitude(resonances, i, y)
+   *
+   * Value of the i-th resonance at y (index known at run time only).
+   */
+  template <typename T, typename... Res>
+  inline C_t<T>
+  amplitude(std::tuple<Res...>& resonances, size_t i, const Var_t<T>& y) {
+    typedef typename event_type<T, Res...>::type E;
+    const E e = make_event(resonances, y, false);
+    select_amplitude<T, false, E> f = {e, i, C_t<T>(2, 0.0)};
+    for_each(resonances, f);
+    return f.res;
+  }
+
+
+  /**
+   * complex_scalar amplitude_sym(resonances, i, y)
+   *
+   * Symmetrized value of the i-th resonance at y.
+   */
+  template <typename T, typename... Res>
+  inline C_t<T>
+  amplitude_sym(std::tuple<Res...>& resonances, size_t i, const Var_t<T>& y) {
+    typedef typename event_type<T, Res...>::type E;
+    const E e = make_event(resonances, y, true);
+    select_amplitude<T, true, E> f = {e, i, C_t<T>(2, 0.0)};
+    for_each(resonances, f);
+    return f.res;
+  }
+
+}
+}
+#endif
@@ -0,0 +1,384 @@
+#ifndef STAN_PWA__SRC__RESONANCE_LIST__BATCH_HPP
+#define STAN_PWA__SRC__RESONANCE_LIST__BATCH_HPP
+
+#include <cmath> // sqrt
+#include <cstddef> // size_t
+#include <tuple>
+#include <type_traits> // conditional
+#include <vector>
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+
+#include <stan_pwa/src/complex.hpp>
+#include <stan_pwa/src/resonance_list/amplitudes.hpp> // is_three_body
+#include <stan_pwa/src/resonance_list/unroll.hpp>
+#include <stan_pwa/src/fct.hpp>
+#include <stan_pwa/src/fct/simd.hpp>
+#include <stan_pwa/src/structures/three_body/bw.hpp>
+#include <stan_pwa/src/structures/three_body/bw_only.hpp>
+#include <stan_pwa/src/structures/three_body/flatte.hpp>
+#include <stan_pwa/src/structures/three_body/kinematics.hpp>
+#include <stan_pwa/src/typedefs.h>
+
+/*
+ *  Amplitudes of a list of resonances for whole arrays of events.
+ *
+ *  DESCRIPTION
+ *    The events are given as one contiguous array per variable,
+ *    y[v][n] for variable v (m2_ab, m2_bc for 3-body decays; m2_12,
+ *    m2_14, m2_23, m2_34, m2_13 for 4-body decays) and event n. The
+ *    amplitudes are written as a structure of arrays,
+ *
+ *      re[i * N + n], im[i * N + n]
+ *
+ *    for resonance i and event n. The loop over the resonances is the
+ *    outer one: for every resonance, a loop over all events with the
+ *    value of the resonance inlined, without allocations (complex_value
+ *    returns a complex::number on the stack).
+ *
+ *    For 3-body decays, the kinematics of all events (see
+ *    structures/three_body/kinematics.hpp) are evaluated once per batch
+ *    and shared by the resonances, as in amplitude_vector. They are
+ *    stored as columns (kinematics_columns): one array of m_ab, one of
+ *    p2_ab, etc. The line shapes of breit_wigner, breit_wigner_only and
+ *    flatte are evaluated column by column with the vectorized kernels
+ *    of fct/simd.hpp, and multiplied with the angular parts at the end;
+ *    the other resonances are evaluated event by event.
+ *
+ *  FUNCTIONS
+ *    void amplitude_batch(resonances, sym, y, N, re, im)
+ *    void amplitude_batch(resonances, sym, y, re, im)
+ */
+
+namespace stan_pwa {
+namespace resonance_list {
+
+  ///> Amplitudes of a batch, one row per resonance, one column per event
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+                        Eigen::RowMajor> soa_matrix;
+
+
+  /**
+   * Kinematics of N events of the decay P -> abc (see kinematics_3),
+   * one contiguous array per member. Invalid events hold
+   * m_ab = p2_ab = p2_Pc = 1, so that the line shapes stay finite; their
+   * amplitudes are set to 0 afterwards.
+   */
+  struct kinematics_columns {
+    const double* m2_ab;
+    const double* m2_bc;
+    std::vector<char> valid;
+    std::vector<double> m_ab;
+    std::vector<double> p2_ab;
+    std::vector<double> p2_Pc;
+
+    kinematics_columns() : m2_ab(0), m2_bc(0) {};
+
+    /**
+     * Kinematics at (m2_ab[n], m2_bc[n]); the validity check is taken
+     * from valid_ab if not null.
+     */
+    kinematics_columns(const double* _m2_ab, const double* _m2_bc, size_t N,
+                       const stan_pwa::resonances::resonance_base_3& r,
+                       const char* valid_ab = 0) :
+      m2_ab(_m2_ab), m2_bc(_m2_bc), valid(N), m_ab(N, 1.0), p2_ab(N, 1.0),
+      p2_Pc(N, 1.0)
+    {
+      for (size_t n = 0; n < N; n++) {
+        valid[n] = valid_ab != 0 ? valid_ab[n]
+          : mfct::valid(m2_ab[n], m2_bc[n], r.P.m2, r.a.m2, r.b.m2, r.c.m2);
+        if (valid[n])
+          m_ab[n] = sqrt(m2_ab[n]);
+      }
+      for (size_t n = 0; n < N; n++) {
+        if (valid[n]) {
+          p2_ab[n] = mfct::breakup_momentum::p2(m2_ab[n], r.a.m, r.b.m);
+          p2_Pc[n] = mfct::breakup_momentum::p2(r.P.m2, m_ab[n], r.c.m);
+        }
+      }
+    };
+
+    ///> Kinematics of event n
+    stan_pwa::resonances::kinematics_3<double> at(size_t n) const {
+      return stan_pwa::resonances::kinematics_3<double>(m2_ab[n], m2_bc[n],
+                                                        valid[n], m_ab[n],
+                                                        p2_ab[n], p2_Pc[n]);
+    }
+  };
+
+
+  ///> Events of a batch of 3-body decays, with their kinematics
+  struct three_body_batch {
+    const double* m2_ab;
+    const double* m2_bc;
+    const stan_pwa::resonances::resonance_base_3& first;
+    const kinematics_columns k;
+    const kinematics_columns k_sym; ///> At (m2_bc, m2_ab); empty if not symmetrized
+    mutable std::vector<double> work; ///> Scratch columns of the line shapes
+
+    three_body_batch(const double* const* y, size_t N,
+                     const stan_pwa::resonances::resonance_base_3& r,
+                     bool sym) :
+      m2_ab(y[0]), m2_bc(y[1]), first(r), k(y[0], y[1], N, r),
+      // For m_a == m_c the Dalitz plot is symmetric (see
+      // kinematics_3::swapped), and the validity check is reused
+      k_sym(sym ? kinematics_columns(y[1], y[0], N, r,
+                                     r.a.m == r.c.m ? k.valid.data() : 0)
+            : kinematics_columns()),
+      work((sym ? 5 : 3) * N) {};
+
+    bool shared_by(const stan_pwa::resonances::resonance_base_3& r) const {
+      return shares_kinematics(r, first);
+    }
+  };
+
+
+  ///> Events of a batch of 4-body decays
+  struct four_body_batch {
+    const double* const* y;
+
+    template <typename R>
+    four_body_batch(const double* const* _y, size_t, const R&, bool) :
+      y(_y) {};
+  };
+
+
+  ///> Batch type of a list of resonances, by its first resonance
+  template <typename... Res>
+  struct batch_type {
+    typedef typename std::tuple_element<0, std::tuple<Res...> >::type first;
+    typedef typename std::conditional<is_three_body<first>::value,
+                                      three_body_batch,
+                                      four_body_batch>::type type;
+  };
+
+
+  ///> Values of a 3-body resonance for the kinematics k, event by event
+  template <typename R>
+  inline void
+  column_values(R& r, const kinematics_columns& k, size_t N,
+                double* re, double* im, double*) {
+    for (size_t n = 0; n < N; n++) {
+      const complex::number<double> a = r.complex_value(k.at(n));
+      re[n] = a.re;
+      im[n] = a.im;
+    }
+  }
+
+
+  ///> Multiplies the line shapes (re, im) by the Zemach angular part of
+  ///> resonance r, and sets the invalid events to 0
+  inline void
+  angular_columns(const stan_pwa::resonances::resonance_base_3& r, int J,
+                  const kinematics_columns& k, size_t N,
+                  double* re, double* im) {
+    for (size_t n = 0; n < N; n++) {
+      if (k.valid[n]) {
+        const double Z = mfct::zemach(J, k.m2_ab[n], k.m2_bc[n], r.P.m,
+                                      r.a, r.b, r.c);
+        re[n] *= Z;
+        im[n] *= Z;
+      } else {
+        re[n] = 0.0;
+        im[n] = 0.0;
+      }
+    }
+  }
+
+
+  ///> Values of breit_wigner for the kinematics k, column by column
+  inline void
+  column_values(stan_pwa::resonances::breit_wigner& r,
+                const kinematics_columns& k, size_t N,
+                double* re, double* im, double* work) {
+    double* F_P = work;
+    double* F_R = work + N;
+    double* width = work + 2 * N;
+    mfct::simd::blatt_weisskopf_p2(r.R.J, r.P.r2, k.p2_Pc.data(), F_P, N);
+    mfct::simd::blatt_weisskopf_p2(r.R.J, r.R.r2, k.p2_ab.data(), F_R, N);
+    mfct::simd::relativistic_width(r.width_pole, k.m_ab.data(),
+                                   k.p2_ab.data(), width, N);
+    mfct::simd::breit_wigner_value(r.R.m, k.m2_ab, width, re, im, N);
+    const double F_pole = r.F_P_pole * r.width_pole.F_R;
+    for (size_t n = 0; n < N; n++) {
+      const double F = F_P[n] * F_R[n] / F_pole;
+      re[n] *= F;
+      im[n] *= F;
+    }
+    angular_columns(r, r.R.J, k, N, re, im);
+  }
+
+
+  ///> Values of breit_wigner_only for the kinematics k, column by column
+  inline void
+  column_values(stan_pwa::resonances::breit_wigner_only& r,
+                const kinematics_columns& k, size_t N,
+                double* re, double* im, double* work) {
+    double* F_R = work;
+    double* width = work + N;
+    mfct::simd::blatt_weisskopf_p2(r.R.J, r.R.r2, k.p2_ab.data(), F_R, N);
+    mfct::simd::relativistic_width(r.width_pole, k.m_ab.data(),
+                                   k.p2_ab.data(), width, N);
+    mfct::simd::breit_wigner_value(r.R.m, k.m2_ab, width, re, im, N);
+    for (size_t n = 0; n < N; n++) {
+      const double F = F_R[n] / r.width_pole.F_R;
+      re[n] = k.valid[n] ? F * re[n] : 0.0;
+      im[n] = k.valid[n] ? F * im[n] : 0.0;
+    }
+  }
+
+
+  ///> Values of flatte for the kinematics k, column by column
+  inline void
+  column_values(stan_pwa::resonances::flatte& r,
+                const kinematics_columns& k, size_t N,
+                double* re, double* im, double* work) {
+    double* F_P = work;
+    double* F_R = work + N;
+    mfct::simd::blatt_weisskopf_p2(r.R.J, r.P.r2, k.p2_Pc.data(), F_P, N);
+    mfct::simd::blatt_weisskopf_p2(r.R.J, r.R.r2, k.p2_ab.data(), F_R, N);
+    mfct::simd::flatte_value(r.R.m, r.G_pp, r.G_kk, k.m2_ab, re, im, N);
+    const double F_pole = r.F_P_pole * r.F_R_pole;
+    for (size_t n = 0; n < N; n++) {
+      const double F = F_P[n] * F_R[n] / F_pole;
+      re[n] *= F;
+      im[n] *= F;
+    }
+    angular_columns(r, r.R.J, k, N, re, im);
+  }
+
+
+  ///> Whether complex_value_sym(k, k_sym) of R is complex_value(k) +
+  ///> complex_value(k_sym), so that the columns can be added
+  template <typename R>
+  struct sym_is_sum { static const bool value = false; };
+
+  template <>
+  struct sym_is_sum<stan_pwa::resonances::breit_wigner> {
+    static const bool value = true;
+  };
+
+  template <>
+  struct sym_is_sum<stan_pwa::resonances::breit_wigner_only> {
+    static const bool value = true;
+  };
+
+  template <>
+  struct sym_is_sum<stan_pwa::resonances::flatte> {
+    static const bool value = true;
+  };
+
+
+  ///> Values of one resonance for all events of a 3-body batch
+  template <bool Sym, typename R>
+  inline void
+  batch_values(R& r, const three_body_batch& b, size_t N,
+               double* re, double* im) {
+    if (b.shared_by(r) && (!Sym || sym_is_sum<R>::value)) {
+      column_values(r, b.k, N, re, im, b.work.data());
+      if (Sym) {
+        double* re_sym = b.work.data() + 3 * N;
+        double* im_sym = b.work.data() + 4 * N;
+        column_values(r, b.k_sym, N, re_sym, im_sym, b.work.data());
+        for (size_t n = 0; n < N; n++) {
+          re[n] += re_sym[n];
+          im[n] += im_sym[n];
+        }
+      }
+    } else if (b.shared_by(r)) {
+      for (size_t n = 0; n < N; n++) {
+        const complex::number<double> a
+          = r.complex_value_sym(b.k.at(n), b.k_sym.at(n));
+        re[n] = a.re;
+        im[n] = a.im;
+      }
+    } else {
+      for (size_t n = 0; n < N; n++) {
+        const C_t<double> a = Sym ? r.value_sym(b.m2_ab[n], b.m2_bc[n])
+          : r.value(b.m2_ab[n], b.m2_bc[n]);
+        re[n] = a[0];
+        im[n] = a[1];
+      }
+    }
+  }
+
+
+  ///> Values of one resonance for all events of a 4-body batch
+  template <bool Sym, typename R>
+  inline void
+  batch_values(R& r, const four_body_batch& b, size_t N,
+               double* re, double* im) {
+    const double* const* y = b.y;
+    for (size_t n = 0; n < N; n++) {
+      const complex::number<double> a = Sym
+        ? r.complex_value_sym(y[0][n], y[1][n], y[2][n], y[3][n], y[4][n])
+        : r.complex_value(y[0][n], y[1][n], y[2][n], y[3][n], y[4][n]);
+      re[n] = a.re;
+      im[n] = a.im;
+    }
+  }
+
+
+  ///> Writes the values of the i-th resonance to row i of re, im
+  template <bool Sym, typename B>
+  struct fill_batch {
+    const B& b;
+    const size_t N;
+    double* re;
+    double* im;
+
+    template <typename R>
+    inline void operator()(size_t i, R& r) {
+      batch_values<Sym>(r, b, N, re + i * N, im + i * N);
+    }
+  };
+
+
+  /**
+   * void amplitude_batch(resonances, sym, y, N, re, im)
+   *
+   * Values (symmetrized if sym) of all resonances for N events.
+   *
+   * @param y Variables, y[v][n] for variable v and event n
+   * @param re Real parts, re[i * N + n] for resonance i (R * N values)
+   * @param im Imaginary parts, as re
+   */
+  template <typename... Res>
+  inline void
+  amplitude_batch(std::tuple<Res...>& resonances, bool sym,
+                  const double* const* y, size_t N, double* re, double* im) {
+    typedef typename batch_type<Res...>::type B;
+    const B b(y, N, std::get<0>(resonances), sym);
+    if (sym) {
+      fill_batch<true, B> f = {b, N, re, im};
+      for_each(resonances, f);
+    } else {
+      fill_batch<false, B> f = {b, N, re, im};
+      for_each(resonances, f);
+    }
+  }
+
+
+  /**
+   * void amplitude_batch(resonances, sym, y, re, im)
+   *
+   * Same as above, for the events in the columns of y (N x num_var, so
+   * every variable is contiguous); re and im are resized to R x N.
+   */
+  template <typename... Res>
+  inline void
+  amplitude_batch(std::tuple<Res...>& resonances, bool sym,
+                  const Eigen::MatrixXd& y, soa_matrix& re, soa_matrix& im) {
+    std::vector<const double*> cols(y.cols());
+    for (int v = 0; v < y.cols(); v++)
+      cols[v] = y.col(v).data();
+
+    re.resize(sizeof...(Res), y.rows());
+    im.resize(sizeof...(Res), y.rows());
+    amplitude_batch(resonances, sym, cols.data(), y.rows(),
+                    re.data(), im.data());
+  }
+
+}
+}
+#endif
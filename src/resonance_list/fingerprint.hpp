@@ -0,0 +1,191 @@
+#ifndef STAN_PWA__SRC__RESONANCE_LIST__FINGERPRINT_HPP
+#define STAN_PWA__SRC__RESONANCE_LIST__FINGERPRINT_HPP
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <cstdio> // snprintf
+#include <cstring> // strlen
+#include <tuple>
+#include <type_traits> // integral_constant
+
+#include <stan/math/prim/mat/fun/Eigen.hpp>
+
+#include <stan_pwa/src/generate/phase_space.hpp> // four_body_space
+#include <stan_pwa/src/resonance_list/amplitudes.hpp> // is_three_body
+#include <stan_pwa/src/resonance_list/unroll.hpp>
+#include <stan_pwa/src/typedefs.h>
+
+/*
+ *  Fingerprints of resonances and models.
+ *
+ *  DESCRIPTION
+ *    Data derived from a model (amplitudes of events, normalization
+ *    integrals) is only valid for the resonances it was computed with.
+ *    To recognize them without a description of every resonance type,
+ *    a resonance is identified by its values: it is evaluated on a fixed
+ *    grid of probe points, and the values, rounded to 10 significant
+ *    digits (so that the last bits of libm do not matter), are hashed
+ *    with 64-bit FNV-1a. Resonances with other masses, widths, spins or
+ *    line shapes give other fingerprints.
+ *
+ *    For 3-body resonances, the probe points cover the Dalitz plot of
+ *    the resonance (8 x 8 points); for 4-body resonances, they are 64
+ *    physical points of its phase space, mapped by
+ *    generate::four_body_space::map from a fixed xorshift sequence
+ *    (rather than a std:: distribution, so that the points are the same
+ *    with every standard library); points where the resonance is NaN
+ *    (e.g. rounding at the edges of the phase space) are skipped, so
+ *    that they do not make different resonances look alike.
+ *
+ *  FUNCTIONS
+ *    uint64_t fnv1a(data, n, h)
+ *    uint64_t hash_double(x, h)
+ *    uint64_t resonance_hash(resonance, sym, h)
+ *    uint64_t model_hash(resonances, num_var, sym)
+ */
+
+namespace stan_pwa {
+namespace resonance_list {
+
+  ///> Initial value of the 64-bit FNV-1a hash
+  const uint64_t fnv_offset = 14695981039346656037ULL;
+
+
+  /**
+   * uint64_t fnv1a(data, n, h)
+   *
+   * Continues the FNV-1a hash h with the n bytes at data.
+   */
+  inline uint64_t
+  fnv1a(const void* data, size_t n, uint64_t h = fnv_offset) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; i++) {
+      h ^= p[i];
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+
+  /**
+   * uint64_t hash_double(x, h)
+   *
+   * Continues the hash h with x rounded to 10 significant digits; all
+   * NaNs and both zeros hash the same.
+   */
+  inline uint64_t
+  hash_double(double x, uint64_t h) {
+    char buf[32];
+    if (x != x)
+      std::snprintf(buf, sizeof(buf), "nan");
+    else
+      std::snprintf(buf, sizeof(buf), "%.9e", x == 0.0 ? 0.0 : x);
+    return fnv1a(buf, std::strlen(buf), h);
+  }
+
+
+  ///> Number of probe points per axis of the Dalitz plot
+  const int probe_grid = 8;
+
+
+  ///> Hashes the values of a 3-body resonance on a grid over its
+  ///> Dalitz plot
+  template <typename R>
+  inline uint64_t
+  probe(R& r, bool sym, uint64_t h, std::true_type) {
+    const double ab_min = (r.a.m + r.b.m) * (r.a.m + r.b.m);
+    const double ab_max = (r.P.m - r.c.m) * (r.P.m - r.c.m);
+    const double bc_min = (r.b.m + r.c.m) * (r.b.m + r.c.m);
+    const double bc_max = (r.P.m - r.a.m) * (r.P.m - r.a.m);
+    for (int i = 0; i < probe_grid; i++) {
+      const double m2_ab = ab_min + (i + 0.5) / probe_grid * (ab_max - ab_min);
+      for (int j = 0; j < probe_grid; j++) {
+        const double m2_bc = bc_min
+          + (j + 0.5) / probe_grid * (bc_max - bc_min);
+        const C_t<double> a = sym ? r.value_sym(m2_ab, m2_bc)
+          : r.value(m2_ab, m2_bc);
+        h = hash_double(a[1], hash_double(a[0], h));
+      }
+    }
+    return h;
+  }
+
+
+  ///> Largest number of points tried for the probes of a 4-body resonance
+  const int probe_max_tries = 4096;
+
+
+  ///> Hashes the values of a 4-body resonance at fixed points inside
+  ///> its phase space, skipping the points where it is NaN
+  template <typename R>
+  inline uint64_t
+  probe(R& r, bool sym, uint64_t h, std::false_type) {
+    const generate::four_body_space space(r.P.m, r.a.m, r.b.m, r.c.m,
+                                          r.d.m);
+    uint64_t state = 88172645463325252ULL; // xorshift64
+    Eigen::VectorXd y(5);
+    int n = 0;
+    for (int k = 0; k < probe_max_tries && n < probe_grid * probe_grid; k++) {
+      double u[5];
+      for (int v = 0; v < 5; v++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        u[v] = (state >> 11) * (1.0 / 9007199254740992.0);
+      }
+      space.map(u, y);
+      const C_t<double> a = sym ? r.value_sym(y(0), y(1), y(2), y(3), y(4))
+        : r.value(y(0), y(1), y(2), y(3), y(4));
+      if (a[0] != a[0] || a[1] != a[1])
+        continue;
+      h = hash_double(a[1], hash_double(a[0], h));
+      n++;
+    }
+    return h;
+  }
+
+
+  /**
+   * uint64_t resonance_hash(resonance, sym, h)
+   *
+   * Fingerprint of one resonance (symmetrized if sym), continuing h.
+   */
+  template <typename R>
+  inline uint64_t
+  resonance_hash(R& r, bool sym, uint64_t h = fnv_offset) {
+    return probe(r, sym, h,
+                 std::integral_constant<bool, is_three_body<R>::value>());
+  }
+
+
+  ///> Chains the fingerprints of the resonances of a list
+  struct chain_hash {
+    const bool sym;
+    uint64_t h;
+
+    template <typename R>
+    inline void operator()(size_t, R& r) {
+      h = resonance_hash(r, sym, h);
+    }
+  };
+
+
+  /**
+   * uint64_t model_hash(resonances, num_var, sym)
+   *
+   * Fingerprint of a model: its number of variables and resonances, the
+   * symmetrization flag, and the fingerprints of the resonances in
+   * their order.
+   */
+  template <typename... Res>
+  inline uint64_t
+  model_hash(std::tuple<Res...>& resonances, unsigned int num_var, bool sym) {
+    const uint64_t head[3] = {num_var, sizeof...(Res), sym ? 1u : 0u};
+    chain_hash f = {sym, fnv1a(head, sizeof(head))};
+    for_each(resonances, f);
+    return f.h;
+  }
+
+}
+}
+#endif
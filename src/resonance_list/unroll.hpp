@@ -0,0 +1,75 @@
+#ifndef STAN_PWA__SRC__RESONANCE_LIST__UNROLL_HPP
+#define STAN_PWA__SRC__RESONANCE_LIST__UNROLL_HPP
+
+#include <cstddef> // size_t
+#include <tuple>
+
+/*
+ *  Compile-time loop over the elements of a std::tuple.
+ *
+ *  DESCRIPTION
+ *    See stan_pwa/src/resonance_list.hpp
+ *
+ *  FUNCTIONS
+ *    void for_each(tuple, f)
+ *    make_indices<N>::type
+ */
+
+namespace stan_pwa {
+namespace resonance_list {
+
+  /**
+   * Calls f(I, std::get<I>(t)) for I = First .. Last - 1. The recursion
+   * is resolved by the compiler; each call is made on the exact type of
+   * the element and may be inlined.
+   */
+  template <size_t First, size_t Last>
+  struct unroll {
+    template <typename Tuple, typename F>
+    static inline void apply(Tuple& t, F& f) {
+      f(First, std::get<First>(t));
+      unroll<First + 1, Last>::apply(t, f);
+    }
+  };
+
+  template <size_t Last>
+  struct unroll<Last, Last> {
+    template <typename Tuple, typename F>
+    static inline void apply(Tuple&, F&) {}
+  };
+
+
+  /**
+   * void for_each(tuple, f)
+   *
+   * Calls f(i, std::get<i>(t)) for every element of the tuple t.
+   *
+   * @tparam F Functor with a templated operator()(size_t, Element&)
+   */
+  template <typename F, typename... Res>
+  inline void
+  for_each(std::tuple<Res...>& t, F& f) {
+    unroll<0, sizeof...(Res)>::apply(t, f);
+  }
+
+
+  /**
+   * make_indices<N>::type
+   *
+   * The type indices<0, 1, ..., N - 1> (std::index_sequence of C++14),
+   * to expand std::get<I>(t)... over the elements of a tuple t.
+   */
+  template <size_t... I>
+  struct indices {};
+
+  template <size_t N, size_t... I>
+  struct make_indices : make_indices<N - 1, N - 1, I...> {};
+
+  template <size_t... I>
+  struct make_indices<0, I...> {
+    typedef indices<I...> type;
+  };
+
+}
+}
+#endif
@@ -32,8 +32,8 @@ namespace resonances {
     double phi; // phase between rho and omega
 
     // Default constructor
-    P_RhoRho_abcd(particle _P, particle _a, particle _b,
-		    particle _c, particle _d) :
+    P_RhoRho_abcd(Particle _P, Particle _a, Particle _b,
+		    Particle _c, Particle _d) :
       resonance_base_4(_P,_a, _b, _c, _d)
       // TODO: constructor
       {
@@ -71,7 +71,7 @@ namespace resonances {
       T_res Dp_rho = p    * particles::rho_770.r * sqrt( 2. / (pow(p    * particles::rho_770.r, 2) + 1.) );
       T_res Dq_rho = q_12 * particles::rho_770.r * sqrt( 2. / (pow(q_12 * particles::rho_770.r, 2) + 1.) );
       T_res rho_rho = 1. / particles::rho_770.m * sqrt( particles::rho_770.m2 - 4.*a.m*b.m);
-      std::vector<T_res> BW_rho_12 = Dp_rho * particles::rho_770.m * W_rho / rho_rho * Dp_rho / Dq_rho *
+      stan_pwa::complex::number<T_res> BW_rho_12 = Dp_rho * particles::rho_770.m * W_rho / rho_rho * Dp_rho / Dq_rho *
           fct::breit_wigner::value(particles::rho_770.m, m2_12, T_res_relativistic_width_rho_12);
 
       T_res_relativistic_width_omega_12 = fct::relativistic_width(particles::omega.m, W_omega, 1, particles::omega.r,
@@ -79,7 +79,7 @@ namespace resonances {
       T_res Dp_omega = p    * particles::omega.r * sqrt( 2. / (pow(p    * particles::omega.r, 2) + 1.) );
       T_res Dq_omega = q_12 * particles::omega.r * sqrt( 2. / (pow(q_12 * particles::omega.r, 2) + 1.) );
       T_res rho_omega = 1. / particles::omega.m * sqrt( particles::omega.m2 - 4.*a.m*b.m);
-      std::vector<T_res> BW_omega_12 = Dp * particles::omega.m * W_omega / rho_omega * Dp / Dq_omega *
+      stan_pwa::complex::number<T_res> BW_omega_12 = Dp * particles::omega.m * W_omega / rho_omega * Dp / Dq_omega *
           fct::breit_wigner::value(particles::omega.m, m2_12, T_res_relativistic_width_omega_12);
 
 
@@ -36,15 +36,15 @@ namespace resonances {
     const int l_1; // Orbital angular momentum between R_1 and d
     const int l_2; // Orbital angular momentum between R_2 and c
     const int l_3; // Orbital angular momentum between a and b
-    const particle R; // resonance
+    const Particle R; // resonance
     const double W_R; // Width of the resonance
  
 
     // Default constructor
-    P_R1d_R2cd_abcd(particle _P, particle _a, particle _b, 
-		    particle _c, particle _d,
+    P_R1d_R2cd_abcd(Particle _P, Particle _a, Particle _b, 
+		    Particle _c, Particle _d,
 		    int _l_1, int _l_2, int _l_3,  
-		    particle _R_1, particle _R_2,
+		    Particle _R_1, Particle _R_2,
 		    double _W_R_1, double _W_R_2) : 
       resonance_base_4(_P,_a, _b, _c, _d), 
       l_1(_l_1), l_2(_l_2), l_3(_l_3),
@@ -2,7 +2,7 @@
 #define STAN_PWA__SRC__STRUCTURES__FOUR_BODY__BASE_HPP
 
 
-#include <stan_pwa/src/structures/particles_def.hpp> // Particles
+#include <stan_pwa/src/flat_structures/particles_def.hpp> // Particle
 
 namespace stan_pwa {
 namespace resonances {
@@ -10,15 +10,15 @@ namespace resonances {
   struct resonance_base_4 // Base struct for the 4 particle decay
   {
 
-    // Particle masses and radii are stored in the structure 'particle'
-    const particle P; // Parent particle
-    const particle a; // Final state particles a,b,c,d
-    const particle b;
-    const particle c;
-    const particle d;
+    // Particle masses and radii are stored in the structure 'Particle'
+    const Particle P; // Parent particle
+    const Particle a; // Final state particles a,b,c,d
+    const Particle b;
+    const Particle c;
+    const Particle d;
 
-    resonance_base_4(particle _P, particle _a, particle _b,
-		     particle _c, particle _d) :
+    resonance_base_4(Particle _P, Particle _a, Particle _b,
+		     Particle _c, Particle _d) :
       P(_P), a(_a), b(_b), c(_c), d(_d) {};
   };
 
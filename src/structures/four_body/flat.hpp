@@ -15,8 +15,8 @@ namespace resonances {
 struct flat_4 : resonances::resonance_base_4
 {
   // Constructor
-  flat_4(particle _P,
-      particle _a, particle _b, particle _c, particle _d) :
+  flat_4(Particle _P,
+      Particle _a, Particle _b, Particle _c, Particle _d) :
         resonance_base_4(_P, _a, _b, _c, _d) {};
 
   template <typename T0, typename T1, typename T2, typename T3, typename T4>
@@ -1,6 +1,7 @@
 #ifndef STAN_PWA__SRC__STRUCTURES__FOUR_BODY_RESONANCES_HPP
 #define STAN_PWA__SRC__STRUCTURES__FOUR_BODY_RESONANCES_HPP
 
+#include <stan_pwa/src/flat_structures/particles.hpp>
 #include <stan_pwa/src/structures/resonances_def.hpp>
 namespace mresonances = stan_pwa::resonances;
 
@@ -36,27 +37,69 @@ namespace resonances {
                particles::f0_500, // = sigma
                0.1, 0.550);
 
-  // R1 R2 decays
-  mresonances::P_R1R2_abcd D_rho_rho(particles::D0,
+  // R1 R2 decays, one amplitude per polarization
+  mresonances::P_R1R2_abcd D_rho_rho_parallel(particles::D0,
                particles::pi, particles::pi,
                particles::pi, particles::pi,
                1, 1, 1,
                particles::rho_770, particles::rho_770,
-               0.1491, 0.1491);
+               0.1491, 0.1491, mresonances::polarization::parallel);
 
-  mresonances::P_R1R2_abcd D_omega_omega(particles::D0,
+  mresonances::P_R1R2_abcd D_rho_rho_perpendicular(particles::D0,
+               particles::pi, particles::pi,
+               particles::pi, particles::pi,
+               1, 1, 1,
+               particles::rho_770, particles::rho_770,
+               0.1491, 0.1491, mresonances::polarization::perpendicular);
+
+  mresonances::P_R1R2_abcd D_rho_rho_longitudinal(particles::D0,
+               particles::pi, particles::pi,
+               particles::pi, particles::pi,
+               1, 1, 1,
+               particles::rho_770, particles::rho_770,
+               0.1491, 0.1491, mresonances::polarization::longitudinal);
+
+  mresonances::P_R1R2_abcd D_omega_omega_parallel(particles::D0,
+               particles::pi, particles::pi,
+               particles::pi, particles::pi,
+               1, 1, 1,
+               particles::omega_782, particles::omega_782,
+               0.00849, 0.00849, mresonances::polarization::parallel);
+
+  mresonances::P_R1R2_abcd D_omega_omega_perpendicular(particles::D0,
                particles::pi, particles::pi,
                particles::pi, particles::pi,
                1, 1, 1,
                particles::omega_782, particles::omega_782,
-               0.00849, 0.00849);
+               0.00849, 0.00849, mresonances::polarization::perpendicular);
+
+  mresonances::P_R1R2_abcd D_omega_omega_longitudinal(particles::D0,
+               particles::pi, particles::pi,
+               particles::pi, particles::pi,
+               1, 1, 1,
+               particles::omega_782, particles::omega_782,
+               0.00849, 0.00849, mresonances::polarization::longitudinal);
+
+  mresonances::P_R1R2_abcd D_rho_omega_parallel(particles::D0,
+               particles::pi, particles::pi,
+               particles::pi, particles::pi,
+               1, 1, 1,
+               particles::rho_770, particles::omega_782,
+               0.1491, 0.00849, mresonances::polarization::parallel);
+
+  mresonances::P_R1R2_abcd D_rho_omega_perpendicular(particles::D0,
+               particles::pi, particles::pi,
+               particles::pi, particles::pi,
+               1, 1, 1,
+               particles::rho_770, particles::omega_782,
+               0.1491, 0.00849, mresonances::polarization::perpendicular);
 
-  mresonances::P_R1R2_abcd D_rho_omega(particles::D0,
+  mresonances::P_R1R2_abcd D_rho_omega_longitudinal(particles::D0,
                particles::pi, particles::pi,
                particles::pi, particles::pi,
                1, 1, 1,
                particles::rho_770, particles::omega_782,
-               0.1491, 0.00849);
+               0.1491, 0.00849, mresonances::polarization::longitudinal);
 
 }
 } 
@@ -6,6 +6,8 @@
 #include <stan_pwa/src/structures/three_body/bw.hpp>
 #include <stan_pwa/src/structures/three_body/bw_only.hpp>
 #include <stan_pwa/src/structures/three_body/flatte.hpp>
+#include <stan_pwa/src/structures/three_body/tabulated.hpp>
+#include <stan_pwa/src/structures/three_body/floating.hpp>
 
 // 4-body-decay-resonances
 #include <stan_pwa/src/structures/four_body/flat.hpp>
@@ -1,5 +1,5 @@
-#ifndef STAN_PWA__SRC__STRUCTURESaoue__THREE_BODY__BW_HPP
-#define STAN_PWA__SRC__STRUCTURESaoeu__THREE_BODY__BW_HPP
+#ifndef STAN_PWA__SRC__STRUCTURES__THREE_BODY__BW_HPP
+#define STAN_PWA__SRC__STRUCTURES__THREE_BODY__BW_HPP
 
 
 #include <cmath> // sqrt
@@ -7,6 +7,7 @@
 #include <stan_pwa/src/complex.hpp>
 #include <stan_pwa/src/fct.hpp>
 #include <stan_pwa/src/structures/three_body/base.hpp>
+#include <stan_pwa/src/structures/three_body/kinematics.hpp>
 namespace mc = stan_pwa::complex;
 namespace mfct = stan_pwa::fct;
 namespace mresonances = stan_pwa::resonances;
@@ -22,55 +23,76 @@ namespace resonances {
     const Particle R; // "Resonance = Particle + width"
     const double W; // Width of the resonance
 
+    // Constant parts of the form factors, at m_ab = R.m
+    const double F_P_pole; // Blatt-Weisskopf P -> Rc
+    const mfct::breit_wigner::width_constants width_pole; // R -> ab
+
     breit_wigner(Particle _P, Particle _a, Particle _b, Particle _c, 
 		 Particle _R, double _W) :
-      resonance_base_3(_P, _a, _b, _c), R(_R), W(_W) {};
+      resonance_base_3(_P, _a, _b, _c), R(_R), W(_W),
+      F_P_pole(mfct::blatt_weisskopf(_R.J, _P.r2, _P.m2, _R.m, _c.m)),
+      width_pole(_R.m, _W, _R.J, _R.r, _a.m, _b.m) {};
 
 
-    // Evaluates the resonance at the given point in the Dalitz plot
-    // for the decay P -> ABC (not symmetrized)
+    // Evaluates the resonance for the kinematics k of an event
+    // of the decay P -> ABC (not symmetrized)
+    template <typename T>
+    mc::number<T>
+    complex_value(const kinematics_3<T>& k) 
+    {
+      if (k.valid)
+        return this->angular(k) * this->line_shape(k);
+      else
+	return mc::number<T>();
+    }
+
+    // Part of the amplitude that depends on m2_ab only (form factors and
+    // Breit-Wigner), for valid kinematics k (see tabulated.hpp)
+    template <typename T>
+    mc::number<T>
+    line_shape(const kinematics_3<T>& k) 
+    {
+      // Form factor P -> Rc
+      T F_P = mfct::blatt_weisskopf_p2(this->R.J, this->P.r2, k.p2_Pc) /
+	this->F_P_pole;
+
+      // Form factor R -> ab
+      T F_R = mfct::blatt_weisskopf_p2(this->R.J, this->R.r2, k.p2_ab)/
+	this->width_pole.F_R;
+
+      T width = mfct::breit_wigner::relativistic_width(this->width_pole,
+						       k.m_ab, k.p2_ab);
+
+      return F_P * F_R * mfct::breit_wigner::value(this->R.m, k.m2_ab, width);
+    }
+
+    // Angular part of the amplitude, for valid kinematics k.
+    // If the parent Particle does not have spin 0, some adjustments
+    // must be performed in this Zemach function (use angular orbital
+    // momentum between P and R instead of R.J)
+    template <typename T>
+    T
+    angular(const kinematics_3<T>& k) 
+    {
+      return mfct::zemach(this->R.J, k.m2_ab, k.m2_bc, 
+			  this->P.m, this->a, this->b, this->c);
+    }
+
+    // Same as above, as a complex scalar (see stan_pwa/src/complex.hpp)
     template <typename T>
     std::vector<T>
-    value(const T& m2_ab, const T& m2_bc) 
+    value(const kinematics_3<T>& k) 
     {
+      return mc::to_vector(this->complex_value(k));
+    }
 
-      if (mfct::valid(m2_ab, m2_bc, 
-		      this->P, this->a, this->b, this->c) == true) {
-
-	T m_ab = sqrt(m2_ab);
-
-        // Form factor P -> Rc
-        T F_P = mfct::blatt_weisskopf(this->R.J, this->P.r2, 
-				      this->P.m2, m_ab, this->c.m) /
-	  mfct::blatt_weisskopf(this->R.J, this->P.r2, 
-				this->P.m2, this->R.m, this->c.m);
-
-        // Form factor R -> ab
-        T F_R = mfct::blatt_weisskopf(this->R.J, this->R.r2, 
-				      m2_ab, this->a.m, this->b.m)/
-                mfct::blatt_weisskopf(this->R.J, this->R.r2, 
-				      this->R.m2, this->a.m, this->b.m);
-
-        T width = mfct::breit_wigner::relativistic_width(this->R.m, this->W,
-							 this->R.J, this->R.r,
-							 m2_ab, this->a.m, 
-							 this->b.m);
-
-	std::vector<T> T_R = mfct::breit_wigner::value(this->R.m,m2_ab,width);
-	// If the parent Particle does not have spin 0, some adjustments
-	// must be performed in this Zemach function (use angular orbital
-	// momentum between P and R instead of R.J)
-        T Z = mfct::zemach(this->R.J, m2_ab, m2_bc, 
-			   this->P.m, this->a, this->b, this->c);
-
-	std::vector<T> res(2);
-	res = mc::scalar::mult(F_P * F_R * Z, T_R);
-        return res;
-      }
-      else {
-	std::vector<T> res(2, 0.0);
-        return res;
-      }
+    // Same as above, for given Dalitz plot variables
+    template <typename T>
+    std::vector<T>
+    value(const T& m2_ab, const T& m2_bc) 
+    {
+      return this->value(kinematics_3<T>(m2_ab, m2_bc, this->P, this->a,
+					 this->b, this->c));
     }
 
 
@@ -80,8 +102,27 @@ namespace resonances {
     inline
     std::vector<T>
     value_sym(const T& m2_ab, const T& m2_bc) {
-      return mc::scalar::add(this->value(m2_ab, m2_bc),
-			     this->value(m2_bc, m2_ab));
+      const kinematics_3<T> k(m2_ab, m2_bc, this->P, this->a, this->b,
+			      this->c);
+      return this->value_sym(k, k.swapped(this->P, this->a, this->b,
+					  this->c));
+    }
+
+
+    // Same as above; k_sym holds the kinematics with m2_ab <-> m2_bc
+    // (see kinematics_3::swapped)
+    template <typename T>
+    inline
+    mc::number<T>
+    complex_value_sym(const kinematics_3<T>& k, const kinematics_3<T>& k_sym) {
+      return this->complex_value(k) + this->complex_value(k_sym);
+    }
+
+    template <typename T>
+    inline
+    std::vector<T>
+    value_sym(const kinematics_3<T>& k, const kinematics_3<T>& k_sym) {
+      return mc::to_vector(this->complex_value_sym(k, k_sym));
     }
 
   };
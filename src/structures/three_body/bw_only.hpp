@@ -7,6 +7,7 @@
 #include <stan_pwa/src/complex.hpp>
 #include <stan_pwa/src/fct.hpp>
 #include <stan_pwa/src/structures/three_body/base.hpp>
+#include <stan_pwa/src/structures/three_body/kinematics.hpp>
 namespace mc = stan_pwa::complex;
 namespace mfct = stan_pwa::fct;
 namespace mresonances = stan_pwa::resonances;
@@ -19,47 +20,69 @@ namespace resonances {
   struct breit_wigner_only : public mresonances::resonance_base_3
   {
     // A BW resonance has the same properties as a particle, and a width
-    const particle R; // "Resonance = particle + width"
+    const Particle R; // "Resonance = particle + width"
     const double W; // Width of the resonance
 
-    breit_wigner_only(particle _P, particle _a, particle _b, particle _c, 
-		 particle _R, double _W) :
-      resonance_base_3(_P, _a, _b, _c), R(_R), W(_W) {};
+    // Constant parts of the form factor R -> ab, at m_ab = R.m
+    const mfct::breit_wigner::width_constants width_pole;
 
+    breit_wigner_only(Particle _P, Particle _a, Particle _b, Particle _c, 
+		 Particle _R, double _W) :
+      resonance_base_3(_P, _a, _b, _c), R(_R), W(_W),
+      width_pole(_R.m, _W, _R.J, _R.r, _a.m, _b.m) {};
 
-    // Evaluates the resonance at the given point in the Dalitz plot
-    // for the decay P -> ABC (not symmetrized)
+
+    // Evaluates the resonance for the kinematics k of an event
+    // of the decay P -> ABC (not symmetrized)
     template <typename T>
-    std::vector<T>
-    value(const T& m2_ab, const T& m2_bc) 
+    mc::number<T>
+    complex_value(const kinematics_3<T>& k) 
     {
+      if (k.valid)
+        return this->line_shape(k);
+      else
+	return mc::number<T>();
+    }
 
-      if (mfct::valid(m2_ab, m2_bc, 
-		      this->P, this->a, this->b, this->c) == true) {
+    // Part of the amplitude that depends on m2_ab only (here all of it),
+    // for valid kinematics k (see tabulated.hpp)
+    template <typename T>
+    mc::number<T>
+    line_shape(const kinematics_3<T>& k) 
+    {
+      // Form factor R -> ab
+      T F_R = mfct::blatt_weisskopf_p2(this->R.J, this->R.r2, k.p2_ab)/
+	this->width_pole.F_R;
 
-	T m_ab = sqrt(m2_ab);
+      T width = mfct::breit_wigner::relativistic_width(this->width_pole,
+						       k.m_ab, k.p2_ab);
 
-        // Form factor R -> ab
-        T F_R = mfct::blatt_weisskopf(this->R.J, this->R.r2, 
-				      m2_ab, this->a.m, this->b.m)/
-                mfct::blatt_weisskopf(this->R.J, this->R.r2, 
-				      this->R.m2, this->a.m, this->b.m);
+      return F_R * mfct::breit_wigner::value(this->R.m, k.m2_ab, width);
+    }
 
-        T width = mfct::breit_wigner::relativistic_width(this->R.m, this->W,
-							 this->R.J, this->R.r,
-							 m2_ab, this->a.m, 
-							 this->b.m);
+    // Angular part of the amplitude: none
+    template <typename T>
+    T
+    angular(const kinematics_3<T>&) 
+    {
+      return T(1.0);
+    }
 
-	std::vector<T> T_R = mfct::breit_wigner::value(this->R.m,m2_ab,width);
+    // Same as above, as a complex scalar (see stan_pwa/src/complex.hpp)
+    template <typename T>
+    std::vector<T>
+    value(const kinematics_3<T>& k) 
+    {
+      return mc::to_vector(this->complex_value(k));
+    }
 
-	std::vector<T> res(2);
-	res = mc::scalar::mult(F_R, T_R);
-        return res;
-      }
-      else {
-	std::vector<T> res(2, 0.0);
-        return res;
-      }
+    // Same as above, for given Dalitz plot variables
+    template <typename T>
+    std::vector<T>
+    value(const T& m2_ab, const T& m2_bc) 
+    {
+      return this->value(kinematics_3<T>(m2_ab, m2_bc, this->P, this->a,
+					 this->b, this->c));
     }
 
 
@@ -69,8 +92,27 @@ namespace resonances {
     inline
     std::vector<T>
     value_sym(const T& m2_ab, const T& m2_bc) {
-      return mc::scalar::add(this->value(m2_ab, m2_bc),
-			     this->value(m2_bc, m2_ab));
+      const kinematics_3<T> k(m2_ab, m2_bc, this->P, this->a, this->b,
+			      this->c);
+      return this->value_sym(k, k.swapped(this->P, this->a, this->b,
+					  this->c));
+    }
+
+
+    // Same as above; k_sym holds the kinematics with m2_ab <-> m2_bc
+    // (see kinematics_3::swapped)
+    template <typename T>
+    inline
+    mc::number<T>
+    complex_value_sym(const kinematics_3<T>& k, const kinematics_3<T>& k_sym) {
+      return this->complex_value(k) + this->complex_value(k_sym);
+    }
+
+    template <typename T>
+    inline
+    std::vector<T>
+    value_sym(const kinematics_3<T>& k, const kinematics_3<T>& k_sym) {
+      return mc::to_vector(this->complex_value_sym(k, k_sym));
     }
 
   };
@@ -7,6 +7,8 @@
 #include <stan_pwa/src/fct.hpp>
 #include <stan_pwa/src/complex.hpp>
 #include <stan_pwa/src/structures/three_body/base.hpp>
+#include <stan_pwa/src/structures/three_body/kinematics.hpp>
+namespace mc = stan_pwa::complex;
 namespace mfct = stan_pwa::fct;
 namespace mresonances = stan_pwa::resonances;
 
@@ -18,11 +20,23 @@ namespace resonances {
   struct flat_3 : public mresonances::resonance_base_3
   {
     // Constructor
-    flat_3(particle _P, particle _a, particle _b, particle _c) : 
+    flat_3(Particle _P, Particle _a, Particle _b, Particle _c) : 
       resonance_base_3(_P, _a, _b, _c) {};
 
   
     // Returns 1 if we are within Dalitz plot bounds, 0 else.
+    template <typename T>
+    mc::number<T>
+    complex_value(const kinematics_3<T>& k) {
+      return mc::number<T>(k.valid ? 1.0 : 0.0);
+    }
+
+    template <typename T>
+    std::vector<T>
+    value(const kinematics_3<T>& k) {
+      return mc::to_vector(this->complex_value(k));
+    }
+
     template <typename T>
     std::vector<T>
     value(const T& m2_ab, const T& m2_bc) {
@@ -38,6 +52,18 @@ namespace resonances {
     // Returns 1 if we are within Dalitz plot bounds, 0 else.
     // For flat background symmetrized and non-symmetrized functions are
     // the same.
+    template <typename T>
+    mc::number<T>
+    complex_value_sym(const kinematics_3<T>& k, const kinematics_3<T>& k_sym) {
+      return this->complex_value(k);
+    }
+
+    template <typename T>
+    std::vector<T>
+    value_sym(const kinematics_3<T>& k, const kinematics_3<T>& k_sym) {
+      return this->value(k);
+    }
+
     template <typename T>
     std::vector<T>
     value_sym(const T& m2_ab, const T& m2_bc) {
@@ -6,6 +6,7 @@
 #include <stan_pwa/src/complex.hpp>
 #include <stan_pwa/src/fct.hpp>
 #include <stan_pwa/src/structures/three_body/base.hpp>
+#include <stan_pwa/src/structures/three_body/kinematics.hpp>
 namespace mc = stan_pwa::complex;
 namespace mfct = stan_pwa::fct;
 namespace mresonances = stan_pwa::resonances;
@@ -17,49 +18,74 @@ namespace resonances {
   struct flatte : public mresonances::resonance_base_3
   {
     // Flatte has same properties as a particle + 2 widths
-    const particle R;
+    const Particle R;
     const double G_pp;
     const double G_kk;
 
-    flatte(particle _P, particle _a, particle _b, particle _c,
-	   particle _R, double _G_pp, double _G_kk) :
-      resonance_base_3(_P, _a, _b, _c), R(_R), G_pp(_G_pp), G_kk(_G_kk) {};
+    // Constant parts of the form factors, at m_ab = R.m
+    const double F_P_pole; // Blatt-Weisskopf P -> Rc
+    const double F_R_pole; // Blatt-Weisskopf R -> ab
 
-    // Returns the amplitude of the decay P->abc via Flatte resonance.
+    flatte(Particle _P, Particle _a, Particle _b, Particle _c,
+	   Particle _R, double _G_pp, double _G_kk) :
+      resonance_base_3(_P, _a, _b, _c), R(_R), G_pp(_G_pp), G_kk(_G_kk),
+      F_P_pole(mfct::blatt_weisskopf(_R.J, _P.r2, _P.m2, _R.m, _c.m)),
+      F_R_pole(mfct::blatt_weisskopf(_R.J, _R.r2, _R.m2, _a.m, _b.m)) {};
+
+    // Returns the amplitude of the decay P->abc via Flatte resonance,
+    // for the kinematics k of an event.
+    template <typename T>
+    mc::number<T>
+    complex_value(const kinematics_3<T>& k) 
+    {
+      if (k.valid)
+        return this->angular(k) * this->line_shape(k);
+      else
+	return mc::number<T>();
+    }
+
+    // Part of the amplitude that depends on m2_ab only (form factors and
+    // Flatte), for valid kinematics k (see tabulated.hpp)
+    template <typename T>
+    mc::number<T>
+    line_shape(const kinematics_3<T>& k) 
+    {
+      // Form factor P -> Rc
+      T F_P = mfct::blatt_weisskopf_p2(this->R.J, this->P.r2, k.p2_Pc) /
+	this->F_P_pole;
+
+      // Form factor R -> ab
+      T F_R = mfct::blatt_weisskopf_p2(this->R.J, this->R.r2, k.p2_ab)/
+	this->F_R_pole;
+
+      return F_P * F_R * mfct::flatte::value(this->R.m, k.m2_ab,
+					     this->G_pp, this->G_kk);
+    }
+
+    // Angular part of the amplitude, for valid kinematics k
+    template <typename T>
+    T
+    angular(const kinematics_3<T>& k) 
+    {
+      return mfct::zemach(this->R.J, k.m2_ab, k.m2_bc, 
+			  this->P.m, this->a, this->b, this->c);
+    }
+
+    // Same as above, as a complex scalar (see stan_pwa/src/complex.hpp)
+    template <typename T>
+    std::vector<T>
+    value(const kinematics_3<T>& k) 
+    {
+      return mc::to_vector(this->complex_value(k));
+    }
+
+    // Same as above, for given Dalitz plot variables
     template <typename T>
     std::vector<T>
     value(const T& m2_ab, const T& m2_bc) 
     {
-      if (mfct::valid(m2_ab, m2_bc, 
-		      this->P, this->a, this->b, this->c) == true) {
-
-	T m_ab = sqrt(m2_ab);
-
-        // Form factor P -> Rc
-        T F_P = mfct::blatt_weisskopf(this->R.J, this->P.r2, 
-				      this->P.m2, m_ab, this->c.m) /
-	  mfct::blatt_weisskopf(this->R.J, this->P.r2,
-				this->P.m2, this->R.m, this->c.m);
-
-        // Form factor R -> ab
-        T F_R = mfct::blatt_weisskopf(this->R.J, this->R.r2, 
-				      m2_ab, this->a.m, this->b.m)/
-	  mfct::blatt_weisskopf(this->R.J, this->R.r2,
-				this->R.m2, this->a.m, this->b.m);
-
-	std::vector<T> T_R = mfct::flatte::value(this->R.m, m2_ab,
-						 this->G_pp, this->G_kk);
-        T Z = mfct::zemach(this->R.J, m2_ab, m2_bc, 
-			   this->P.m, this->a, this->b, this->c);
-
-	std::vector<T> res(2);
-	res = mc::scalar::mult(F_P * F_R * Z, T_R);
-        return res;
-      }
-      else {
-	std::vector<T> res(2, 0.0);
-        return res;
-      }
+      return this->value(kinematics_3<T>(m2_ab, m2_bc, this->P, this->a,
+					 this->b, this->c));
     }
 
 
@@ -69,8 +95,27 @@ namespace resonances {
     inline
     std::vector<T>
     value_sym(const T& m2_ab, const T& m2_bc) {
-      return mc::scalar::add(this->value(m2_ab, m2_bc),
-			     this->value(m2_bc, m2_ab));
+      const kinematics_3<T> k(m2_ab, m2_bc, this->P, this->a, this->b,
+			      this->c);
+      return this->value_sym(k, k.swapped(this->P, this->a, this->b,
+					  this->c));
+    }
+
+
+    // Same as above; k_sym holds the kinematics with m2_ab <-> m2_bc
+    // (see kinematics_3::swapped)
+    template <typename T>
+    inline
+    mc::number<T>
+    complex_value_sym(const kinematics_3<T>& k, const kinematics_3<T>& k_sym) {
+      return this->complex_value(k) + this->complex_value(k_sym);
+    }
+
+    template <typename T>
+    inline
+    std::vector<T>
+    value_sym(const kinematics_3<T>& k, const kinematics_3<T>& k_sym) {
+      return mc::to_vector(this->complex_value_sym(k, k_sym));
     }
 
   };
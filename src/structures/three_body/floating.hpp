@@ -0,0 +1,433 @@
+#ifndef STAN_PWA__SRC__STRUCTURES__THREE_BODY__FLOATING_HPP
+#define STAN_PWA__SRC__STRUCTURES__THREE_BODY__FLOATING_HPP
+
+#include <cmath> // pow, sqrt
+#include <vector>
+
+#include <stan/math/rev/core.hpp> // var, precomputed_gradients
+#include <boost/math/tools/promotion.hpp>
+
+#include <stan_pwa/src/complex.hpp>
+#include <stan_pwa/src/fct.hpp>
+#include <stan_pwa/src/flat_structures/particles.hpp> // particles::pi, k
+#include <stan_pwa/src/structures/three_body/base.hpp>
+#include <stan_pwa/src/structures/three_body/kinematics.hpp>
+#include <stan_pwa/src/typedefs.h>
+namespace mc = stan_pwa::complex;
+namespace mfct = stan_pwa::fct;
+namespace mresonances = stan_pwa::resonances;
+
+/*
+ *  3-body resonances with floating line-shape parameters.
+ *
+ *  DESCRIPTION
+ *    Same amplitudes as breit_wigner, breit_wigner_only and flatte, with
+ *    the mass and the width(s) passed at every evaluation instead of
+ *    being fixed at construction, so that they can be fitted:
+ *
+ *      floating_breit_wigner       p = (M, W)
+ *      floating_breit_wigner_only  p = (M, W)
+ *      floating_flatte             p = (M, G_pp, G_kk)
+ *
+ *    The particle R given to the constructor only sets the spin and the
+ *    radius. complex_value(k, p, dA) returns the amplitude and, if dA is
+ *    not 0, its derivatives dA[j] = dA / dp_j in closed form: with the
+ *    denominator D of the line shape (T_R = 1 / D) and the form factors
+ *    normalized at m_ab = M,
+ *
+ *      dA / dp_j = - A (d log F_pole / dp_j) - (A / D) dD / dp_j.
+ *
+ *    value(k, M, W) takes stan::math::var parameters, too; the result
+ *    has the analytic derivatives as precomputed gradients, not an
+ *    autodiff tree of the line shape.
+ *
+ *    The amplitudes for the fixed events of a fit are cached by
+ *    likelihood::floating_events (see stan_pwa/src/likelihood/floating.hpp).
+ *
+ *  FUNCTIONS
+ *    number<double> complex_value(k, p, dA)
+ *    number<double> complex_value_sym(k, k_sym, p, dA)
+ *    complex_scalar value(k, M, W) / value(k, M, G_pp, G_kk)
+ *    complex_scalar value(m2_ab, m2_bc, M, W) / value(m2_ab, m2_bc, M, G_pp, G_kk)
+ */
+
+namespace stan_pwa {
+namespace resonances {
+
+  inline double param_value(double x) { return x; }
+  inline double param_value(const stan::math::var& x) { return x.val(); }
+
+
+  /**
+   * complex_scalar floating_amplitude(a, dA, p)
+   *
+   * The amplitude a as a complex scalar; for var parameters p, with the
+   * derivatives dA[j] = dA / dp_j as precomputed gradients.
+   */
+  inline C_t<double>
+  floating_amplitude(const mc::number<double>& a, const mc::number<double>*,
+                     const std::vector<double>&) {
+    return mc::to_vector(a);
+  }
+
+  inline C_t<stan::math::var>
+  floating_amplitude(const mc::number<double>& a,
+                     const mc::number<double>* dA,
+                     const std::vector<stan::math::var>& p) {
+    std::vector<double> d_re(p.size());
+    std::vector<double> d_im(p.size());
+    for (size_t j = 0; j < p.size(); j++) {
+      d_re[j] = dA[j].re;
+      d_im[j] = dA[j].im;
+    }
+    C_t<stan::math::var> res(2);
+    res[0] = stan::math::precomputed_gradients(a.re, p, d_re);
+    res[1] = stan::math::precomputed_gradients(a.im, p, d_im);
+    return res;
+  }
+
+
+  ///> Form factors at the pole m_ab = M and their derivatives w.r.t. M
+  struct pole_form_factors {
+    double p2_R;    // Squared breakup momentum R -> ab at m_ab = M
+    double dp2_R;   // d p2_R / dM
+    double F_R;     // Blatt-Weisskopf R -> ab at m_ab = M
+    double dlog_F_R; // d log(F_R) / dM
+    double F_P;     // Blatt-Weisskopf P -> Rc at m_ab = M
+    double dlog_F_P; // d log(F_P) / dM
+
+    pole_form_factors(const resonance_base_3& r, const Particle& R,
+                      double M) :
+      p2_R(mfct::breakup_momentum::p2(M * M, r.a.m, r.b.m)),
+      dp2_R(2 * M * mfct::breakup_momentum::dp2_dm2_R(M * M, r.a.m, r.b.m)),
+      F_R(mfct::blatt_weisskopf_p2(R.J, R.r2, p2_R)),
+      dlog_F_R(mfct::blatt_weisskopf_dlog_dp2(R.J, R.r2, p2_R) * dp2_R)
+    {
+      const double p2_Pc = mfct::breakup_momentum::p2(r.P.m2, M, r.c.m);
+      F_P = mfct::blatt_weisskopf_p2(R.J, r.P.r2, p2_Pc);
+      dlog_F_P = mfct::blatt_weisskopf_dlog_dp2(R.J, r.P.r2, p2_Pc)
+        * mfct::breakup_momentum::dp2_dm_a(r.P.m2, M, r.c.m);
+    };
+  };
+
+
+  ///> Relativistic Breit-Wigner T_R = 1 / D with the width W gamma1,
+  ///> and the derivatives of D w.r.t. M and W
+  struct floating_bw_denominator {
+    mc::number<double> D;
+    mc::number<double> dD_dM;
+    mc::number<double> dD_dW;
+
+    floating_bw_denominator(const Particle& R, const pole_form_factors& pole,
+                            const kinematics_3<double>& k, double M,
+                            double W) {
+      // Width per unit W, as in breit_wigner::relativistic_width
+      const double F = mfct::blatt_weisskopf_p2(R.J, R.r2, k.p2_ab) / pole.F_R;
+      const double gamma1 = M / k.m_ab * std::pow(k.p2_ab / pole.p2_R,
+                                                  R.J + 0.5) * F * F;
+      const double dlog_gamma = 1.0 / M
+        - (R.J + 0.5) * pole.dp2_R / pole.p2_R - 2.0 * pole.dlog_F_R;
+      D = mc::number<double>(M * M - k.m2_ab, -M * W * gamma1);
+      dD_dM = mc::number<double>(2 * M, -W * gamma1 * (1.0 + M * dlog_gamma));
+      dD_dW = mc::number<double>(0.0, -M * gamma1);
+    };
+  };
+
+
+  ///> Common part of the floating resonances: the symmetrized value and
+  ///> the value for given parameters (see above)
+  template <typename Derived, int N>
+  struct floating_base_3 : public mresonances::resonance_base_3
+  {
+    ///> Number of parameters
+    static const int num_params = N;
+
+    const Particle R; // Spin and radius of the resonance
+
+    floating_base_3(Particle _P, Particle _a, Particle _b, Particle _c,
+                    Particle _R) :
+      resonance_base_3(_P, _a, _b, _c), R(_R) {};
+
+    // Same as complex_value, symmetrized; k_sym holds the kinematics
+    // with m2_ab <-> m2_bc (see kinematics_3::swapped)
+    mc::number<double>
+    complex_value_sym(const kinematics_3<double>& k,
+                      const kinematics_3<double>& k_sym,
+                      const double* p, mc::number<double>* dA) const {
+      const Derived& self = static_cast<const Derived&>(*this);
+      if (dA == 0)
+        return self.complex_value(k, p, 0) + self.complex_value(k_sym, p, 0);
+      mc::number<double> dA_sym[N];
+      const mc::number<double> res = self.complex_value(k, p, dA)
+        + self.complex_value(k_sym, p, dA_sym);
+      for (int j = 0; j < N; j++)
+        dA[j] += dA_sym[j];
+      return res;
+    }
+
+  protected:
+    ///> Value at the parameters p (double or var)
+    template <typename T>
+    C_t<T>
+    value_at(const kinematics_3<double>& k, const std::vector<T>& p) const {
+      double p_d[N];
+      for (int j = 0; j < N; j++)
+        p_d[j] = param_value(p[j]);
+      mc::number<double> dA[N];
+      const mc::number<double> a =
+        static_cast<const Derived&>(*this).complex_value(k, p_d, dA);
+      return floating_amplitude(a, dA, p);
+    }
+
+    ///> Same as above, symmetrized
+    template <typename T>
+    C_t<T>
+    value_sym_at(const kinematics_3<double>& k, const std::vector<T>& p)
+      const {
+      double p_d[N];
+      for (int j = 0; j < N; j++)
+        p_d[j] = param_value(p[j]);
+      mc::number<double> dA[N];
+      const mc::number<double> a = this->complex_value_sym(
+        k, k.swapped(this->P, this->a, this->b, this->c), p_d, dA);
+      return floating_amplitude(a, dA, p);
+    }
+
+    kinematics_3<double> event(double m2_ab, double m2_bc) const {
+      return kinematics_3<double>(m2_ab, m2_bc, this->P, this->a, this->b,
+                                  this->c);
+    }
+  };
+
+
+  // Breit-Wigner resonance with floating mass and width, 3-body decay
+  struct floating_breit_wigner :
+    public floating_base_3<floating_breit_wigner, 2>
+  {
+    floating_breit_wigner(Particle _P, Particle _a, Particle _b, Particle _c,
+                          Particle _R) :
+      floating_base_3(_P, _a, _b, _c, _R) {};
+
+    // Value at the kinematics k of an event (not symmetrized), for
+    // p = (M, W); dA (if not 0) receives dA/dM, dA/dW
+    mc::number<double>
+    complex_value(const kinematics_3<double>& k, const double* p,
+                  mc::number<double>* dA) const {
+      if (!k.valid) {
+        if (dA != 0)
+          dA[0] = dA[1] = mc::number<double>();
+        return mc::number<double>();
+      }
+      const double M = p[0];
+      const double W = p[1];
+      const pole_form_factors pole(*this, this->R, M);
+
+      // Form factors P -> Rc, R -> ab and Zemach
+      const double F = mfct::blatt_weisskopf_p2(this->R.J, this->P.r2,
+                                                k.p2_Pc) / pole.F_P
+        * mfct::blatt_weisskopf_p2(this->R.J, this->R.r2, k.p2_ab) / pole.F_R
+        * mfct::zemach(this->R.J, k.m2_ab, k.m2_bc, this->P.m, this->a,
+                       this->b, this->c);
+
+      const floating_bw_denominator den(this->R, pole, k, M, W);
+      const mc::number<double> T_R = mc::inverse(den.D);
+      const mc::number<double> A = F * T_R;
+      if (dA != 0) {
+        const mc::number<double> A_over_D = A * T_R;
+        dA[0] = -(pole.dlog_F_P + pole.dlog_F_R) * A - A_over_D * den.dD_dM;
+        dA[1] = -A_over_D * den.dD_dW;
+      }
+      return A;
+    }
+
+    // Value at the kinematics k or at (m2_ab, m2_bc), for the mass M and
+    // the width W (double or var)
+    template <typename T0, typename T1>
+    C_t<typename boost::math::tools::promote_args<T0,T1>::type>
+    value(const kinematics_3<double>& k, const T0& M, const T1& W) const {
+      typedef typename boost::math::tools::promote_args<T0,T1>::type T_res;
+      std::vector<T_res> p;
+      p.push_back(M);
+      p.push_back(W);
+      return this->value_at(k, p);
+    }
+
+    template <typename T0, typename T1>
+    C_t<typename boost::math::tools::promote_args<T0,T1>::type>
+    value(double m2_ab, double m2_bc, const T0& M, const T1& W) const {
+      return this->value(this->event(m2_ab, m2_bc), M, W);
+    }
+
+    // Same as above, symmetrized (i.e. A==C)
+    template <typename T0, typename T1>
+    C_t<typename boost::math::tools::promote_args<T0,T1>::type>
+    value_sym(double m2_ab, double m2_bc, const T0& M, const T1& W) const {
+      typedef typename boost::math::tools::promote_args<T0,T1>::type T_res;
+      std::vector<T_res> p;
+      p.push_back(M);
+      p.push_back(W);
+      return this->value_sym_at(this->event(m2_ab, m2_bc), p);
+    }
+  };
+
+
+  // Breit-Wigner only (no P -> Rc form factor, no Zemach) with floating
+  // mass and width, 3-body decay
+  struct floating_breit_wigner_only :
+    public floating_base_3<floating_breit_wigner_only, 2>
+  {
+    floating_breit_wigner_only(Particle _P, Particle _a, Particle _b,
+                               Particle _c, Particle _R) :
+      floating_base_3(_P, _a, _b, _c, _R) {};
+
+    // Value at the kinematics k of an event (not symmetrized), for
+    // p = (M, W); dA (if not 0) receives dA/dM, dA/dW
+    mc::number<double>
+    complex_value(const kinematics_3<double>& k, const double* p,
+                  mc::number<double>* dA) const {
+      if (!k.valid) {
+        if (dA != 0)
+          dA[0] = dA[1] = mc::number<double>();
+        return mc::number<double>();
+      }
+      const double M = p[0];
+      const double W = p[1];
+      const pole_form_factors pole(*this, this->R, M);
+
+      // Form factor R -> ab
+      const double F = mfct::blatt_weisskopf_p2(this->R.J, this->R.r2,
+                                                k.p2_ab) / pole.F_R;
+
+      const floating_bw_denominator den(this->R, pole, k, M, W);
+      const mc::number<double> T_R = mc::inverse(den.D);
+      const mc::number<double> A = F * T_R;
+      if (dA != 0) {
+        const mc::number<double> A_over_D = A * T_R;
+        dA[0] = -pole.dlog_F_R * A - A_over_D * den.dD_dM;
+        dA[1] = -A_over_D * den.dD_dW;
+      }
+      return A;
+    }
+
+    // Value at the kinematics k or at (m2_ab, m2_bc), for the mass M and
+    // the width W (double or var)
+    template <typename T0, typename T1>
+    C_t<typename boost::math::tools::promote_args<T0,T1>::type>
+    value(const kinematics_3<double>& k, const T0& M, const T1& W) const {
+      typedef typename boost::math::tools::promote_args<T0,T1>::type T_res;
+      std::vector<T_res> p;
+      p.push_back(M);
+      p.push_back(W);
+      return this->value_at(k, p);
+    }
+
+    template <typename T0, typename T1>
+    C_t<typename boost::math::tools::promote_args<T0,T1>::type>
+    value(double m2_ab, double m2_bc, const T0& M, const T1& W) const {
+      return this->value(this->event(m2_ab, m2_bc), M, W);
+    }
+
+    // Same as above, symmetrized (i.e. A==C)
+    template <typename T0, typename T1>
+    C_t<typename boost::math::tools::promote_args<T0,T1>::type>
+    value_sym(double m2_ab, double m2_bc, const T0& M, const T1& W) const {
+      typedef typename boost::math::tools::promote_args<T0,T1>::type T_res;
+      std::vector<T_res> p;
+      p.push_back(M);
+      p.push_back(W);
+      return this->value_sym_at(this->event(m2_ab, m2_bc), p);
+    }
+  };
+
+
+  // Flatte resonance with floating mass and couplings, 3-body decay
+  struct floating_flatte : public floating_base_3<floating_flatte, 3>
+  {
+    floating_flatte(Particle _P, Particle _a, Particle _b, Particle _c,
+                    Particle _R) :
+      floating_base_3(_P, _a, _b, _c, _R) {};
+
+    // Value at the kinematics k of an event (not symmetrized), for
+    // p = (M, G_pp, G_kk); dA (if not 0) receives the derivatives
+    mc::number<double>
+    complex_value(const kinematics_3<double>& k, const double* p,
+                  mc::number<double>* dA) const {
+      if (!k.valid) {
+        if (dA != 0)
+          dA[0] = dA[1] = dA[2] = mc::number<double>();
+        return mc::number<double>();
+      }
+      const double M = p[0];
+      const double G_pp = p[1];
+      const double G_kk = p[2];
+      const pole_form_factors pole(*this, this->R, M);
+
+      // Form factors P -> Rc, R -> ab and Zemach
+      const double F = mfct::blatt_weisskopf_p2(this->R.J, this->P.r2,
+                                                k.p2_Pc) / pole.F_P
+        * mfct::blatt_weisskopf_p2(this->R.J, this->R.r2, k.p2_ab) / pole.F_R
+        * mfct::zemach(this->R.J, k.m2_ab, k.m2_bc, this->P.m, this->a,
+                       this->b, this->c);
+
+      // D = M**2 - m2_ab - 2 / m_ab i (G_pp**2 p_pipi + G_kk**2 p_KK),
+      // as in fct::flatte::value
+      const mc::number<double> p_pp = mfct::breakup_momentum::complex_p(
+        k.m2_ab, particles::pi.m, particles::pi.m);
+      const mc::number<double> p_kk = mfct::breakup_momentum::complex_p(
+        k.m2_ab, particles::k.m, particles::k.m);
+      const mc::number<double> g = G_pp * G_pp * p_pp + G_kk * G_kk * p_kk;
+      const double c = 2. / sqrt(k.m2_ab);
+      const mc::number<double> D((M * M - k.m2_ab) + c * g.im, -c * g.re);
+
+      const mc::number<double> T_R = mc::inverse(D);
+      const mc::number<double> A = F * T_R;
+      if (dA != 0) {
+        // dD / dG = -c i 2 G p
+        const mc::number<double> A_over_D = A * T_R;
+        dA[0] = -(pole.dlog_F_P + pole.dlog_F_R) * A - 2 * M * A_over_D;
+        dA[1] = -A_over_D * mc::number<double>(2 * c * G_pp * p_pp.im,
+                                               -2 * c * G_pp * p_pp.re);
+        dA[2] = -A_over_D * mc::number<double>(2 * c * G_kk * p_kk.im,
+                                               -2 * c * G_kk * p_kk.re);
+      }
+      return A;
+    }
+
+    // Value at the kinematics k or at (m2_ab, m2_bc), for the mass M and
+    // the couplings G_pp, G_kk (double or var)
+    template <typename T0, typename T1, typename T2>
+    C_t<typename boost::math::tools::promote_args<T0,T1,T2>::type>
+    value(const kinematics_3<double>& k, const T0& M, const T1& G_pp,
+          const T2& G_kk) const {
+      typedef typename boost::math::tools::promote_args<T0,T1,T2>::type T_res;
+      std::vector<T_res> p;
+      p.push_back(M);
+      p.push_back(G_pp);
+      p.push_back(G_kk);
+      return this->value_at(k, p);
+    }
+
+    template <typename T0, typename T1, typename T2>
+    C_t<typename boost::math::tools::promote_args<T0,T1,T2>::type>
+    value(double m2_ab, double m2_bc, const T0& M, const T1& G_pp,
+          const T2& G_kk) const {
+      return this->value(this->event(m2_ab, m2_bc), M, G_pp, G_kk);
+    }
+
+    // Same as above, symmetrized (i.e. A==C)
+    template <typename T0, typename T1, typename T2>
+    C_t<typename boost::math::tools::promote_args<T0,T1,T2>::type>
+    value_sym(double m2_ab, double m2_bc, const T0& M, const T1& G_pp,
+              const T2& G_kk) const {
+      typedef typename boost::math::tools::promote_args<T0,T1,T2>::type T_res;
+      std::vector<T_res> p;
+      p.push_back(M);
+      p.push_back(G_pp);
+      p.push_back(G_kk);
+      return this->value_sym_at(this->event(m2_ab, m2_bc), p);
+    }
+  };
+
+}
+}
+#endif
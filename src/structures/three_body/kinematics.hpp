@@ -0,0 +1,88 @@
+#ifndef STAN_PWA__SRC__STRUCTURES__THREE_BODY__KINEMATICS_HPP
+#define STAN_PWA__SRC__STRUCTURES__THREE_BODY__KINEMATICS_HPP
+
+#include <cmath> // sqrt
+
+#include <stan_pwa/src/flat_structures/particles_def.hpp>
+#include <stan_pwa/src/fct/breakup_momentum.hpp>
+#include <stan_pwa/src/fct/valid.hpp>
+
+namespace mfct = stan_pwa::fct;
+
+namespace stan_pwa {
+namespace resonances {
+
+  /**
+   * Kinematics of one event of the decay P -> abc, shared by all
+   * resonances in the ab channel.
+   *
+   * Computed once per event (see resonance_list::make_event) instead of once
+   * per resonance: the validity check, m_ab = sqrt(m2_ab) and the squared
+   * breakup momenta of R -> ab and P -> Rc at m_R = m_ab.
+   *
+   * @tparam T Scalar type
+   */
+  template <typename T>
+  struct kinematics_3 {
+    T m2_ab;
+    T m2_bc;
+    bool valid; ///> Whether (m2_ab, m2_bc) is inside the Dalitz plot
+
+    T m_ab;
+    T p2_ab; ///> Squared breakup momentum (ab) -> a b
+    T p2_Pc; ///> Squared breakup momentum P -> (ab) c
+
+    kinematics_3(const T& _m2_ab, const T& _m2_bc, const Particle& P,
+                 const Particle& a, const Particle& b, const Particle& c) :
+      kinematics_3(_m2_ab, _m2_bc,
+                   mfct::valid(_m2_ab, _m2_bc, P.m2, a.m2, b.m2, c.m2),
+                   P, a, b, c) {};
+
+    ///> Kinematics with the members already computed (e.g. stored in
+    ///> the columns of resonance_list::kinematics_columns)
+    kinematics_3(const T& _m2_ab, const T& _m2_bc, bool _valid,
+                 const T& _m_ab, const T& _p2_ab, const T& _p2_Pc) :
+      m2_ab(_m2_ab), m2_bc(_m2_bc), valid(_valid),
+      m_ab(_m_ab), p2_ab(_p2_ab), p2_Pc(_p2_Pc) {};
+
+    /**
+     * Kinematics at the swapped point (m2_bc, m2_ab), for the second
+     * term of the symmetrized amplitude. For m_a == m_c (as in value_sym)
+     * the Dalitz plot is symmetric, and the validity check is reused.
+     */
+    kinematics_3 swapped(const Particle& P, const Particle& a,
+                         const Particle& b, const Particle& c) const {
+      if (a.m == c.m)
+        return kinematics_3(m2_bc, m2_ab, valid, P, a, b, c);
+      return kinematics_3(m2_bc, m2_ab, P, a, b, c);
+    }
+
+    /**
+     * Kinematics of the ab channel alone, at m2_ab between
+     * (m_a + m_b)**2 and (m_P - m_c)**2, for the parts of the amplitudes
+     * that depend on m2_ab only (see tabulated.hpp); m2_bc is 0.
+     */
+    static kinematics_3 channel_ab(const T& m2_ab, const Particle& P,
+                                   const Particle& a, const Particle& b,
+                                   const Particle& c) {
+      return kinematics_3(m2_ab, T(0.0), true, P, a, b, c);
+    }
+
+  private:
+    kinematics_3(const T& _m2_ab, const T& _m2_bc, bool _valid,
+                 const Particle& P, const Particle& a, const Particle& b,
+                 const Particle& c) :
+      m2_ab(_m2_ab), m2_bc(_m2_bc), valid(_valid),
+      m_ab(0.0), p2_ab(0.0), p2_Pc(0.0)
+    {
+      if (valid) {
+        m_ab = sqrt(m2_ab);
+        p2_ab = mfct::breakup_momentum::p2(m2_ab, a.m, b.m);
+        p2_Pc = mfct::breakup_momentum::p2(P.m2, m_ab, c.m);
+      }
+    };
+  };
+
+}
+}
+#endif
@@ -0,0 +1,332 @@
+#ifndef STAN_PWA__SRC__STRUCTURES__THREE_BODY__LINE_SHAPE_TABLE_HPP
+#define STAN_PWA__SRC__STRUCTURES__THREE_BODY__LINE_SHAPE_TABLE_HPP
+
+#include <algorithm> // max, max_element, sort, unique, upper_bound
+#include <cmath> // pow, sqrt
+#include <cstddef> // size_t
+#include <sstream>
+#include <stdexcept> // domain_error
+#include <vector>
+
+#include <stan_pwa/src/complex.hpp>
+namespace mc = stan_pwa::complex;
+
+/*
+ *  Lookup table of a complex function of one variable.
+ *
+ *  DESCRIPTION
+ *    Tabulates a line shape f(m2_ab) over [x_min, x_max] by piecewise
+ *    cubic Hermite interpolation of its real and imaginary parts.
+ *
+ *    Near a threshold, a line shape goes like sqrt(x - x_0) (e.g. the
+ *    width of a spin 0 Breit-Wigner at x_min, or the K K channel of a
+ *    Flatte inside the range), which no polynomial in x approximates.
+ *    The range is therefore cut into segments with a threshold x_0 at
+ *    one end (x_min, or a kink given in the hints; between two
+ *    thresholds, the segment is halved), and f is tabulated as a function
+ *    of t in [0, 1] with x = x_0 + (x_1 - x_0) t**2, x_1 the other end.
+ *    The slope at a node is the one of the parabola through the node and
+ *    its neighbours (through the next two nodes at the ends).
+ *
+ *    The nodes are placed adaptively. The initial ones are uniform in t,
+ *    plus, for every pole m2 with width w (in m2, i.e. M * Gamma), the
+ *    points m2 +- w * 2**k for k = -3 .. 6. Then every interval whose
+ *    interpolant is further than max_error * scale from f at 1/4, 1/2 or
+ *    3/4 of its length is split in halves, until there are none (scale
+ *    is the largest |f| seen). The check of the last round is the
+ *    verification: error() is the largest deviation it found, relative
+ *    to scale. If max_error cannot be reached with max_nodes nodes, the
+ *    constructor throws std::domain_error.
+ *
+ *    A lookup finds the segment, t (one sqrt) and the interval, with a
+ *    uniform index over t (and a binary search inside a bin of the
+ *    index), and evaluates two cubic polynomials.
+ *
+ *  FUNCTIONS
+ *    line_shape_table(f, x_min, x_max, hints, max_error, max_nodes)
+ *    number<double> line_shape_table::operator()(x)
+ */
+
+namespace stan_pwa {
+namespace resonances {
+
+  ///> Features of a line shape that the nodes of its table must resolve
+  struct line_shape_hints {
+    std::vector<double> poles;  ///> m2 of the poles
+    std::vector<double> widths; ///> Their widths in m2, M * Gamma
+    std::vector<double> kinks;  ///> Thresholds inside the range
+  };
+
+
+  class line_shape_table {
+  public:
+    /**
+     * Tabulates f, a functor double -> complex::number<double>, over
+     * [x_min, x_max] (see above).
+     */
+    template <typename F>
+    line_shape_table(F f, double x_min, double x_max,
+                     const line_shape_hints& hints, double max_error = 1e-6,
+                     size_t max_nodes = 1 << 16) :
+      scale_(0), error_(0)
+    {
+      if (!(x_max > x_min))
+        throw std::domain_error("line_shape_table: empty range");
+
+      // Segments, between x_min, the kinks and x_max
+      std::vector<double> ends(1, x_min);
+      for (size_t k = 0; k < hints.kinks.size(); k++) {
+        if (hints.kinks[k] > x_min && hints.kinks[k] < x_max)
+          ends.push_back(hints.kinks[k]);
+      }
+      std::sort(ends.begin(), ends.end());
+      ends.erase(std::unique(ends.begin(), ends.end()), ends.end());
+      for (size_t j = 0; j < ends.size(); j++) {
+        if (j + 1 < ends.size()) {
+          const double mid = 0.5 * (ends[j] + ends[j + 1]);
+          segments_.push_back(segment(ends[j], mid));
+          segments_.push_back(segment(ends[j + 1], mid));
+        } else {
+          segments_.push_back(segment(ends[j], x_max));
+        }
+      }
+
+      // Initial nodes
+      std::vector<double> x_hints;
+      for (size_t p = 0; p < hints.poles.size(); p++) {
+        x_hints.push_back(hints.poles[p]);
+        for (int k = -3; k <= 6; k++) {
+          const double dx = hints.widths[p] * std::pow(2.0, k);
+          x_hints.push_back(hints.poles[p] - dx);
+          x_hints.push_back(hints.poles[p] + dx);
+        }
+      }
+      for (size_t s = 0; s < segments_.size(); s++)
+        segments_[s].init(f, x_hints);
+
+      // Refinement
+      for (;;) {
+        size_t nodes = 0;
+        for (size_t s = 0; s < segments_.size(); s++)
+          segments_[s].check(f, scale_);
+        error_ = 0;
+        bool split = false;
+        for (size_t s = 0; s < segments_.size(); s++) {
+          error_ = std::max(error_, segments_[s].max_error() / scale_);
+          split = segments_[s].split(f, max_error * scale_, max_error)
+            || split;
+          nodes += segments_[s].t.size();
+        }
+        if (!split)
+          break;
+        if (nodes > max_nodes) {
+          std::ostringstream msg;
+          msg << "line_shape_table: error " << max_error
+              << " not reached with " << nodes << " nodes";
+          throw std::domain_error(msg.str());
+        }
+      }
+      for (size_t s = 0; s < segments_.size(); s++)
+        segments_[s].build_index();
+    };
+
+    ///> Interpolated f(x); x is clamped to the range
+    mc::number<double> operator()(double x) const {
+      size_t s = 0;
+      while (s + 1 < segments_.size() && !segments_[s].contains(x))
+        s++;
+      return segments_[s](x);
+    }
+
+    ///> Number of nodes
+    size_t size() const {
+      size_t res = 0;
+      for (size_t s = 0; s < segments_.size(); s++)
+        res += segments_[s].t.size();
+      return res;
+    }
+
+    ///> Largest deviation from f found by the verification, relative to
+    ///> scale()
+    double error() const { return error_; }
+
+    ///> Largest |f| found
+    double scale() const { return scale_; }
+
+  private:
+    ///> |z|
+    static double abs(const mc::number<double>& z) {
+      return std::sqrt(z.re * z.re + z.im * z.im);
+    }
+
+
+    ///> Part of the range from the threshold x_0 to x_1, tabulated over
+    ///> t with x = x_0 + (x_1 - x_0) t**2
+    struct segment {
+      double x_0;
+      double span;                        ///> x_1 - x_0
+      double inv_span;
+      std::vector<double> t;              ///> Nodes
+      std::vector<mc::number<double> > y; ///> f at the nodes
+      std::vector<double> coef;           ///> 4 re, 4 im per interval
+      std::vector<double> errors;         ///> Of the intervals
+      std::vector<size_t> index;
+      double inv_bin;
+
+      segment(double _x_0, double x_1) :
+        x_0(_x_0), span(x_1 - _x_0), inv_span(1.0 / span) {};
+
+      double x(double _t) const { return x_0 + span * _t * _t; }
+
+      ///> Whether _x is not above the segment (they are in ascending order)
+      bool contains(double _x) const {
+        return _x <= (span > 0 ? x_0 + span : x_0);
+      }
+
+      template <typename F>
+      void init(F f, const std::vector<double>& x_hints) {
+        const size_t n_uniform = 16;
+        for (size_t i = 0; i <= n_uniform; i++)
+          t.push_back(1.0 * i / n_uniform);
+        for (size_t h = 0; h < x_hints.size(); h++) {
+          const double u = (x_hints[h] - x_0) / span;
+          if (u > 0 && u < 1)
+            t.push_back(std::sqrt(u));
+        }
+        std::sort(t.begin(), t.end());
+        t.erase(std::unique(t.begin(), t.end()), t.end());
+        for (size_t i = 0; i < t.size(); i++)
+          y.push_back(f(x(t[i])));
+      }
+
+      ///> Slope at t[i] of the parabola through the nodes i, j, l
+      mc::number<double> slope(size_t i, size_t j, size_t l) const {
+        const double h1 = t[j] - t[i];
+        const double h2 = t[l] - t[i];
+        const mc::number<double> d1 = (y[j] - y[i]) / h1;
+        const mc::number<double> d2 = (y[l] - y[i]) / h2;
+        return (d1 * h2 - d2 * h1) / (h2 - h1);
+      }
+
+      ///> Hermite coefficients of all intervals
+      void fit() {
+        const size_t n = t.size();
+        coef.assign(8 * (n - 1), 0.0);
+        std::vector<mc::number<double> > d(n);
+        d[0] = slope(0, 1, 2);
+        for (size_t i = 1; i + 1 < n; i++)
+          d[i] = slope(i, i - 1, i + 1);
+        d[n - 1] = slope(n - 1, n - 2, n - 3);
+        for (size_t i = 0; i + 1 < n; i++) {
+          const double h = t[i + 1] - t[i];
+          const mc::number<double> delta = (y[i + 1] - y[i]) / h;
+          const mc::number<double> c2 = (3.0 * delta - 2.0 * d[i] - d[i + 1])
+            / h;
+          const mc::number<double> c3 = (d[i] + d[i + 1] - 2.0 * delta)
+            / (h * h);
+          double* c = &coef[8 * i];
+          c[0] = y[i].re; c[1] = d[i].re; c[2] = c2.re; c[3] = c3.re;
+          c[4] = y[i].im; c[5] = d[i].im; c[6] = c2.im; c[7] = c3.im;
+        }
+      }
+
+      ///> Interpolant of interval i at _t
+      mc::number<double> eval(size_t i, double _t) const {
+        const double s = _t - t[i];
+        const double* c = &coef[8 * i];
+        return mc::number<double>(c[0] + s * (c[1] + s * (c[2] + s * c[3])),
+                                  c[4] + s * (c[5] + s * (c[6] + s * c[7])));
+      }
+
+      ///> Errors of the intervals at 1/4, 1/2, 3/4; updates scale
+      template <typename F>
+      void check(F f, double& scale) {
+        fit();
+        errors.assign(t.size() - 1, 0.0);
+        for (size_t i = 0; i + 1 < t.size(); i++) {
+          for (int q = 1; q <= 3; q++) {
+            const double _t = t[i] + 0.25 * q * (t[i + 1] - t[i]);
+            const mc::number<double> exact = f(x(_t));
+            scale = std::max(scale, abs(exact));
+            errors[i] = std::max(errors[i], abs(eval(i, _t) - exact));
+          }
+        }
+      }
+
+      double max_error() const {
+        return *std::max_element(errors.begin(), errors.end());
+      }
+
+      ///> Halves the intervals with errors above bound; whether any
+      template <typename F>
+      bool split(F f, double bound, double max_error) {
+        std::vector<double> t_new;
+        std::vector<mc::number<double> > y_new;
+        for (size_t i = 0; i + 1 < t.size(); i++) {
+          t_new.push_back(t[i]);
+          y_new.push_back(y[i]);
+          if (errors[i] > bound) {
+            if (t[i + 1] - t[i] < 1e-12) {
+              std::ostringstream msg;
+              msg << "line_shape_table: error " << max_error
+                  << " not reached at m2 = " << x(t[i])
+                  << ", the resolution limit";
+              throw std::domain_error(msg.str());
+            }
+            const double _t = 0.5 * (t[i] + t[i + 1]);
+            t_new.push_back(_t);
+            y_new.push_back(f(x(_t)));
+          }
+        }
+        t_new.push_back(t.back());
+        y_new.push_back(y.back());
+        const bool res = t_new.size() > t.size();
+        t.swap(t_new);
+        y.swap(y_new);
+        return res;
+      }
+
+      ///> index[b]: interval of the lower edge of bin b of 4 (nodes) bins
+      void build_index() {
+        fit();
+        const size_t bins = 4 * t.size();
+        inv_bin = bins;
+        index.resize(bins + 1);
+        size_t i = 0;
+        for (size_t b = 0; b <= bins; b++) {
+          const double edge = b / inv_bin;
+          while (i + 2 < t.size() && t[i + 1] <= edge)
+            i++;
+          index[b] = i;
+        }
+      }
+
+      ///> Interpolated f(_x); _x is clamped to the segment
+      mc::number<double> operator()(double _x) const {
+        const double u = (_x - x_0) * inv_span;
+        const double _t = u <= 0 ? 0.0 : (u >= 1 ? 1.0 : std::sqrt(u));
+        size_t b = static_cast<size_t>(_t * inv_bin);
+        if (b >= index.size() - 1)
+          b = index.size() - 2;
+        // Last node <= _t among the nodes of the bin
+        size_t i = index[b];
+        const size_t last = index[b + 1];
+        if (last - i > 8) {
+          i = std::upper_bound(&t[i], &t[last] + 1, _t) - &t[0] - 1;
+        } else {
+          while (i < last && t[i + 1] <= _t)
+            i++;
+        }
+        return eval(std::min(i, t.size() - 2), _t);
+      }
+    };
+
+
+    double scale_;
+    double error_;
+    std::vector<segment> segments_;
+  };
+
+}
+}
+#endif
@@ -0,0 +1,159 @@
+#ifndef STAN_PWA__SRC__STRUCTURES__THREE_BODY__TABULATED_HPP
+#define STAN_PWA__SRC__STRUCTURES__THREE_BODY__TABULATED_HPP
+
+#include <cstddef> // size_t
+#include <vector>
+
+#include <stan_pwa/src/complex.hpp>
+#include <stan_pwa/src/flat_structures/particles.hpp> // particles::k
+#include <stan_pwa/src/structures/three_body/base.hpp>
+#include <stan_pwa/src/structures/three_body/bw.hpp>
+#include <stan_pwa/src/structures/three_body/bw_only.hpp>
+#include <stan_pwa/src/structures/three_body/flatte.hpp>
+#include <stan_pwa/src/structures/three_body/kinematics.hpp>
+#include <stan_pwa/src/structures/three_body/line_shape_table.hpp>
+namespace mc = stan_pwa::complex;
+namespace mresonances = stan_pwa::resonances;
+
+namespace stan_pwa {
+namespace resonances {
+
+  ///> Poles and thresholds of the line shapes, for line_shape_table
+  inline line_shape_hints
+  hints(const breit_wigner& r) {
+    line_shape_hints res;
+    res.poles.push_back(r.R.m2);
+    res.widths.push_back(r.R.m * r.W);
+    return res;
+  }
+
+  inline line_shape_hints
+  hints(const breit_wigner_only& r) {
+    line_shape_hints res;
+    res.poles.push_back(r.R.m2);
+    res.widths.push_back(r.R.m * r.W);
+    return res;
+  }
+
+  inline line_shape_hints
+  hints(const flatte& r) {
+    line_shape_hints res;
+    res.poles.push_back(r.R.m2);
+    res.widths.push_back(r.R.m * r.G_pp);
+    res.kinks.push_back(4 * particles::k.m2); // K K threshold
+    return res;
+  }
+
+
+  /**
+   * 3-body resonance R (breit_wigner, breit_wigner_only or flatte) with
+   * its line shape, the part of the amplitude that depends on m2_ab only,
+   * tabulated over the Dalitz plot at construction (see
+   * line_shape_table.hpp). For double kinematics, the amplitude is a
+   * lookup in the table times the angular (Zemach) term; for other
+   * scalar types (stan::math::var), R is evaluated exactly.
+   *
+   * E.g. for the normalization integrals over many points:
+   *
+   *   mresonances::tabulated<mresonances::breit_wigner> rho(rho_770);
+   *
+   * rho can be used in a model instead of rho_770; it has other
+   * fingerprints (the values differ by up to max_error).
+   */
+  template <typename R>
+  struct tabulated : public mresonances::resonance_base_3
+  {
+    R res;
+    const line_shape_table table;
+
+    tabulated(const R& _res, double max_error = 1e-6,
+              size_t max_nodes = 1 << 16) :
+      resonance_base_3(_res.P, _res.a, _res.b, _res.c), res(_res),
+      table(line_shape(res), (_res.a.m + _res.b.m) * (_res.a.m + _res.b.m),
+            (_res.P.m - _res.c.m) * (_res.P.m - _res.c.m), hints(_res),
+            max_error, max_nodes) {};
+
+
+    // Evaluates the resonance for the kinematics k of an event
+    // of the decay P -> ABC (not symmetrized)
+    mc::number<double>
+    complex_value(const kinematics_3<double>& k)
+    {
+      if (k.valid)
+        return this->res.angular(k) * this->table(k.m2_ab);
+      else
+        return mc::number<double>();
+    }
+
+    // Same as above, exact (not for double)
+    template <typename T>
+    mc::number<T>
+    complex_value(const kinematics_3<T>& k)
+    {
+      return this->res.complex_value(k);
+    }
+
+    // Same as above, as a complex scalar (see stan_pwa/src/complex.hpp)
+    template <typename T>
+    std::vector<T>
+    value(const kinematics_3<T>& k)
+    {
+      return mc::to_vector(this->complex_value(k));
+    }
+
+    // Same as above, for given Dalitz plot variables
+    template <typename T>
+    std::vector<T>
+    value(const T& m2_ab, const T& m2_bc)
+    {
+      return this->value(kinematics_3<T>(m2_ab, m2_bc, this->P, this->a,
+                                         this->b, this->c));
+    }
+
+
+    // Evaluates the resonance at the given point in the Dalitz plot
+    // for the decay P -> ABC (symmetrized, i.e. A==C)
+    template <typename T>
+    inline
+    std::vector<T>
+    value_sym(const T& m2_ab, const T& m2_bc) {
+      const kinematics_3<T> k(m2_ab, m2_bc, this->P, this->a, this->b,
+                              this->c);
+      return this->value_sym(k, k.swapped(this->P, this->a, this->b,
+                                          this->c));
+    }
+
+
+    // Same as above; k_sym holds the kinematics with m2_ab <-> m2_bc
+    // (see kinematics_3::swapped)
+    template <typename T>
+    inline
+    mc::number<T>
+    complex_value_sym(const kinematics_3<T>& k, const kinematics_3<T>& k_sym) {
+      return this->complex_value(k) + this->complex_value(k_sym);
+    }
+
+    template <typename T>
+    inline
+    std::vector<T>
+    value_sym(const kinematics_3<T>& k, const kinematics_3<T>& k_sym) {
+      return mc::to_vector(this->complex_value_sym(k, k_sym));
+    }
+
+  private:
+    ///> Exact line shape of r as a function of m2_ab
+    struct line_shape {
+      R& r;
+
+      explicit line_shape(R& _r) : r(_r) {};
+
+      mc::number<double> operator()(double m2_ab) const {
+        return r.line_shape(kinematics_3<double>::channel_ab(m2_ab, r.P, r.a,
+                                                             r.b, r.c));
+      }
+    };
+  };
+
+}
+}
+#endif
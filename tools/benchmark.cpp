@@ -0,0 +1,731 @@
+// benchmark.cpp
+//
+// NAME
+//    benchmark - time the kernels in stan_pwa/src/fct and the resonances.
+//
+// SYNOPSIS
+//    benchmark [--events=N] [--repeat=R] [--filter=TEXT] [--json=FILE]
+//
+// DESCRIPTION
+//    Evaluates every kernel of stan_pwa/src/fct (breit_wigner, flatte,
+//    blatt_weisskopf, both zemach, valid, valid_5d, P_V1V2_angles,
+//    P_R1d_R2cd_theta_z), every 3-body resonance of
+//    stan_pwa/src/structures/three_body and both 4-body resonances of
+//    stan_pwa/src/structures/four_body (value and value_sym) at N events
+//    (default 10000) of D -> pi pi pi (uniform in the Dalitz plot), resp.
+//    D0 -> pi pi pi pi (physical points, see draw_four_body). Only the
+//    cases whose name contains TEXT are run.
+//
+//    Each case is run with T = double (value) and T = stan::math::var
+//    (value and gradient w.r.t. the kinematic variables, as in a fit with
+//    floating event variables); valid and valid_5d only with T = double,
+//    they have no gradient. For each, it prints
+//
+//      ns/event     fastest of R passes over all events (default R = 5),
+//      allocs/event heap allocations (operator new, new[]) per event,
+//      tape/event   bytes of the autodiff arena per event (var only),
+//
+//    and, with --json, writes the same numbers to FILE for regression
+//    tracking (e.g. compare the files of two commits). Run it on an idle
+//    machine; it uses one thread.
+//
+//    First, the vectorized line shapes of stan_pwa/src/fct/simd.hpp are
+//    compared with the scalar templates for every instruction set of the
+//    CPU (spins 0, 1, 2; points below threshold included). The program
+//    fails if they differ by more than 1e-12 (relative), or if two
+//    4-body resonances that only differ in a mass have the same
+//    fingerprint (resonance_list::resonance_hash).
+//
+//    Built by build_tools.sh.
+
+#include <algorithm> // min
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath> // sqrt, cos, sin
+#include <cstdint> // uint64_t
+#include <cstdio> // printf, fprintf
+#include <cstdlib> // malloc, free, strtoul
+#include <iostream>
+#include <limits>
+#include <new> // bad_alloc
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <stan/math/rev/mat.hpp> // var, grad, recover_memory
+
+#include <stan_pwa/src/complex.hpp>
+#include <stan_pwa/src/fct.hpp>
+#include <stan_pwa/src/fct/simd.hpp>
+#include <stan_pwa/src/flat_structures/particles.hpp>
+#include <stan_pwa/src/generate/phase_space.hpp>
+#include <stan_pwa/src/resonance_list/fingerprint.hpp> // resonance_hash
+#include <stan_pwa/src/structures/three_body/bw.hpp>
+#include <stan_pwa/src/structures/three_body/bw_only.hpp>
+#include <stan_pwa/src/structures/three_body/flat.hpp>
+#include <stan_pwa/src/structures/three_body/flatte.hpp>
+#include <stan_pwa/src/structures/four_body/P_R1R2_abcd.hpp>
+#include <stan_pwa/src/structures/four_body/P_R1d_R2cd_abcd.hpp>
+
+namespace mc = stan_pwa::complex;
+namespace mfct = stan_pwa::fct;
+namespace mresonances = stan_pwa::resonances;
+namespace particles = stan_pwa::particles;
+
+///> Number of heap allocations so far (counted by operator new below)
+std::atomic<size_t> num_allocations(0);
+
+// All forms of operator new and delete are replaced, so that every
+// allocation is counted and freed by the matching function. new and
+// delete are not inlined: GCC would otherwise see malloc'ed pointers
+// passed to delete, resp. new'ed pointers passed to free, in the callers
+// (-Wmismatched-new-delete).
+#ifdef __GNUC__
+#define BENCHMARK_NOINLINE __attribute__((noinline))
+#else
+#define BENCHMARK_NOINLINE
+#endif
+
+BENCHMARK_NOINLINE void* operator new(std::size_t size) {
+  num_allocations++;
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == 0)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+BENCHMARK_NOINLINE void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+  operator delete(p);
+}
+
+namespace {
+
+  using stan::math::var;
+
+  // Resonances of D -> pi pi pi, as in structures/three_body_resonances.hpp
+  mresonances::flat_3 flat_D3pi(particles::d, particles::pi, particles::pi,
+                                particles::pi);
+  mresonances::breit_wigner rho_770(particles::d, particles::pi,
+                                    particles::pi, particles::pi,
+                                    particles::rho_770, 0.1491);
+  mresonances::breit_wigner_only rho_770_bw_only(particles::d, particles::pi,
+                                                 particles::pi, particles::pi,
+                                                 particles::rho_770, 0.1491);
+  mresonances::flatte f0_980(particles::d, particles::pi, particles::pi,
+                             particles::pi, particles::f0_980, 0.329,
+                             2 * 0.329);
+  mresonances::breit_wigner f2_1270(particles::d, particles::pi,
+                                    particles::pi, particles::pi,
+                                    particles::f2_1270, 0.1852);
+
+  // Resonances of D0 -> pi pi pi pi, as in
+  // structures/four_body_resonances.hpp
+  mresonances::P_R1d_R2cd_abcd a1_rho(particles::D0, particles::pi,
+                                      particles::pi, particles::pi,
+                                      particles::pi, 1, 0, 1, particles::a1,
+                                      particles::rho_770, 0.1, 0.1491);
+  mresonances::P_R1R2_abcd rho_rho(particles::D0, particles::pi,
+                                   particles::pi, particles::pi,
+                                   particles::pi, 1, 1, 1,
+                                   particles::rho_770, particles::rho_770,
+                                   0.1491, 0.1491,
+                                   mresonances::polarization::longitudinal);
+
+  const mfct::breit_wigner::width_constants
+  rho_width(particles::rho_770.m, 0.1491, 1, particles::rho_770.r,
+            particles::pi.m, particles::pi.m);
+
+
+  // Sum of the components of a result, as one scalar to differentiate
+  template <typename T>
+  T reduce(const T& x) { return x; }
+
+  template <typename T>
+  T reduce(const mc::number<T>& z) { return z.re + z.im; }
+
+  template <typename T>
+  T reduce(const std::vector<T>& v) {
+    T res(0.0);
+    for (size_t i = 0; i < v.size(); i++)
+      res += v[i];
+    return res;
+  }
+
+  template <typename T>
+  T reduce(const mfct::helicity_angles<T>& a) {
+    return a.theta_1 + a.theta_2 + a.chi;
+  }
+
+  template <typename T>
+  T reduce(const mfct::theta_z_values<T>& v) {
+    return v.cos2_theta_1 + v.z2_1 + v.cos2_theta_2 + v.z2_2;
+  }
+
+
+  /**
+   * Defines a kernel NAME: a functor that evaluates EXPR for one event
+   * y[0], y[1], ... of type T (DIM = 2: (m2_ab, m2_bc) in the Dalitz plot
+   * of D -> pi pi pi; DIM = 5: (m2_12, m2_14, m2_23, m2_34, m2_13) of
+   * D0 -> pi pi pi pi) and reduces the result to one scalar.
+   */
+#define STAN_PWA_KERNEL(NAME, DIM, EXPR)                        \
+  struct NAME {                                                 \
+    static const int dim = DIM;                                 \
+    static const bool differentiable = true;                    \
+    template <typename T>                                       \
+    T operator()(const T* y) const { return reduce<T>(EXPR); }  \
+  };
+
+  /**
+   * Defines a predicate NAME, as STAN_PWA_KERNEL, that is 1 if EXPR is
+   * true; it is only run with T = double, its gradient is 0.
+   */
+#define STAN_PWA_PREDICATE(NAME, DIM, EXPR)                     \
+  struct NAME {                                                 \
+    static const int dim = DIM;                                 \
+    static const bool differentiable = false;                   \
+    template <typename T>                                       \
+    T operator()(const T* y) const {                            \
+      return (EXPR) ? 1.0 : 0.0;                                \
+    }                                                           \
+  };
+
+  STAN_PWA_KERNEL(breit_wigner_value, 2,
+    mfct::breit_wigner::value(particles::rho_770.m, y[0], T(0.1491)))
+  STAN_PWA_KERNEL(breit_wigner_width, 2,
+    mfct::breit_wigner::relativistic_width(rho_width, T(sqrt(y[0])),
+      T(mfct::breakup_momentum::p2(y[0], particles::pi.m, particles::pi.m))))
+  STAN_PWA_KERNEL(flatte_value, 2,
+    mfct::flatte::value(particles::f0_980.m, y[0], 0.329, 2 * 0.329))
+  STAN_PWA_KERNEL(blatt_weisskopf_1, 2,
+    mfct::blatt_weisskopf(1, particles::rho_770.r2, y[0],
+                          particles::pi.m, particles::pi.m))
+  STAN_PWA_KERNEL(blatt_weisskopf_2, 2,
+    mfct::blatt_weisskopf(2, particles::f2_1270.r2, y[0],
+                          particles::pi.m, particles::pi.m))
+  STAN_PWA_KERNEL(zemach_3, 2,
+    mfct::zemach(2, y[0], y[1], particles::d.m, particles::pi,
+                 particles::pi, particles::pi))
+  STAN_PWA_KERNEL(zemach_4, 5,
+    mfct::zemach(2, 1, 1, y[0] / particles::D0.m2, y[1] / (y[1] + y[3])))
+  STAN_PWA_PREDICATE(valid, 2,
+    mfct::valid(y[0], y[1], particles::d.m2, particles::pi.m2,
+                particles::pi.m2, particles::pi.m2))
+  STAN_PWA_PREDICATE(valid_5d, 5,
+    mfct::valid_5d(y[0], y[1], y[2], y[3], y[4], particles::D0,
+                   particles::pi, particles::pi, particles::pi,
+                   particles::pi))
+  STAN_PWA_KERNEL(P_V1V2_angles, 5,
+    mfct::P_V1V2_angles(y[0], y[1], y[2], y[3], y[4], particles::D0,
+                        particles::pi, particles::pi, particles::pi,
+                        particles::pi))
+  STAN_PWA_KERNEL(P_R1d_R2cd_theta_z, 5,
+    mfct::P_R1d_R2cd_theta_z(y[0], y[1], y[2], y[3], y[4], particles::D0,
+                             particles::pi, particles::pi, particles::pi,
+                             particles::pi))
+  STAN_PWA_KERNEL(flat_3_value, 2, flat_D3pi.value(y[0], y[1]))
+  STAN_PWA_KERNEL(flat_3_value_sym, 2, flat_D3pi.value_sym(y[0], y[1]))
+  STAN_PWA_KERNEL(breit_wigner_1_value, 2, rho_770.value(y[0], y[1]))
+  STAN_PWA_KERNEL(breit_wigner_1_value_sym, 2, rho_770.value_sym(y[0], y[1]))
+  STAN_PWA_KERNEL(breit_wigner_2_value, 2, f2_1270.value(y[0], y[1]))
+  STAN_PWA_KERNEL(breit_wigner_2_value_sym, 2, f2_1270.value_sym(y[0], y[1]))
+  STAN_PWA_KERNEL(breit_wigner_only_value, 2,
+    rho_770_bw_only.value(y[0], y[1]))
+  STAN_PWA_KERNEL(breit_wigner_only_value_sym, 2,
+    rho_770_bw_only.value_sym(y[0], y[1]))
+  STAN_PWA_KERNEL(flatte_3_value, 2, f0_980.value(y[0], y[1]))
+  STAN_PWA_KERNEL(flatte_3_value_sym, 2, f0_980.value_sym(y[0], y[1]))
+  STAN_PWA_KERNEL(P_R1d_R2cd_value, 5,
+    a1_rho.value(y[0], y[1], y[2], y[3], y[4]))
+  STAN_PWA_KERNEL(P_R1d_R2cd_value_sym, 5,
+    a1_rho.value_sym(y[0], y[1], y[2], y[3], y[4]))
+  STAN_PWA_KERNEL(P_R1R2_value, 5,
+    rho_rho.value(y[0], y[1], y[2], y[3], y[4]))
+  STAN_PWA_KERNEL(P_R1R2_value_sym, 5,
+    rho_rho.value_sym(y[0], y[1], y[2], y[3], y[4]))
+
+#undef STAN_PWA_PREDICATE
+#undef STAN_PWA_KERNEL
+
+
+  ///> Timing of one kernel for one scalar type
+  struct result {
+    std::string name;
+    std::string scalar;
+    double ns_per_event;
+    double allocs_per_event;
+    double tape_bytes_per_event;
+  };
+
+
+  ///> Events of one phase space, event i at y[i * dim]
+  struct events {
+    int dim;
+    size_t size;
+    std::vector<double> y;
+  };
+
+  ///> N events drawn uniformly in the Dalitz plot of P -> a b c
+  events
+  draw_dalitz(const stan_pwa::Particle& P, const stan_pwa::Particle& a,
+              const stan_pwa::Particle& b, const stan_pwa::Particle& c,
+              size_t n, unsigned long seed) {
+    const stan_pwa::generate::dalitz_space space(P.m, a.m, b.m, c.m);
+    events res = {2, n, std::vector<double>()};
+    std::mt19937_64 rng(seed);
+    Eigen::VectorXd y;
+    while (res.y.size() < 2 * n) {
+      if (stan_pwa::generate::draw_uniform(space, rng, y))
+        res.y.insert(res.y.end(), y.data(), y.data() + 2);
+    }
+    return res;
+  }
+
+
+  ///> Four-momentum (E, p_x, p_y, p_z)
+  typedef std::array<double, 4> four_vector;
+
+  double
+  mass2(const four_vector& p, const four_vector& q) {
+    const double E = p[0] + q[0];
+    double p2 = 0;
+    for (int i = 1; i < 4; i++)
+      p2 += (p[i] + q[i]) * (p[i] + q[i]);
+    return E * E - p2;
+  }
+
+  ///> p, given in the rest frame of a particle with momentum frame
+  four_vector
+  boost(const four_vector& p, const four_vector& frame) {
+    const double m = std::sqrt(mass2(frame, four_vector()));
+    const double gamma = frame[0] / m;
+    double bp = 0; // gamma * beta . p
+    for (int i = 1; i < 4; i++)
+      bp += frame[i] * p[i] / m;
+    four_vector res;
+    res[0] = gamma * p[0] + bp;
+    for (int i = 1; i < 4; i++)
+      res[i] = p[i] + frame[i] / m * (bp / (gamma + 1) + p[0]);
+    return res;
+  }
+
+  ///> Decay of a particle with momentum frame to masses m_1, m_2,
+  ///> isotropic in its rest frame
+  template <typename RNG>
+  void
+  two_body(const four_vector& frame, double m_1, double m_2, RNG& rng,
+           four_vector& p_1, four_vector& p_2) {
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    const double M2 = mass2(frame, four_vector());
+    const double q = std::sqrt(
+      stan_pwa::fct::breakup_momentum::p2(M2, m_1, m_2));
+    const double cos_theta = 2 * u(rng) - 1;
+    const double sin_theta = std::sqrt(1 - cos_theta * cos_theta);
+    const double phi = 2 * 3.14159265358979323846 * u(rng);
+    const four_vector p = {{std::sqrt(m_1 * m_1 + q * q),
+                            q * sin_theta * std::cos(phi),
+                            q * sin_theta * std::sin(phi), q * cos_theta}};
+    const four_vector r = {{std::sqrt(m_2 * m_2 + q * q),
+                            -p[1], -p[2], -p[3]}};
+    p_1 = boost(p, frame);
+    p_2 = boost(r, frame);
+  }
+
+  /**
+   * N physical events of P -> a b c d, y = (m2_12, m2_14, m2_23, m2_34,
+   * m2_13), as the sequential decays P -> (ab)(cd), (ab) -> a b,
+   * (cd) -> c d with uniform masses of (ab), (cd) and uniform angles.
+   * (Rejection from the box of generate::four_body_space would accept
+   * unphysical points, see fct::valid_5d.)
+   */
+  events
+  draw_four_body(const stan_pwa::Particle& P, const stan_pwa::Particle& a,
+                 const stan_pwa::Particle& b, const stan_pwa::Particle& c,
+                 const stan_pwa::Particle& d, size_t n, unsigned long seed) {
+    events res = {5, n, std::vector<double>(5 * n)};
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    const four_vector p_P = {{P.m, 0, 0, 0}};
+    for (size_t i = 0; i < n; i++) {
+      const double m_ab = a.m + b.m + u(rng) * (P.m - a.m - b.m - c.m - d.m);
+      const double m_cd = c.m + d.m + u(rng) * (P.m - m_ab - c.m - d.m);
+      four_vector p_ab, p_cd, p_a, p_b, p_c, p_d;
+      two_body(p_P, m_ab, m_cd, rng, p_ab, p_cd);
+      two_body(p_ab, a.m, b.m, rng, p_a, p_b);
+      two_body(p_cd, c.m, d.m, rng, p_c, p_d);
+      double* y = &res.y[5 * i];
+      y[0] = mass2(p_a, p_b);
+      y[1] = mass2(p_a, p_d);
+      y[2] = mass2(p_b, p_c);
+      y[3] = mass2(p_c, p_d);
+      y[4] = mass2(p_a, p_c);
+    }
+    return res;
+  }
+
+
+  ///> Keeps the results alive, so that the kernels are not optimized away
+  volatile double sink = 0;
+
+  typedef std::chrono::steady_clock bench_clock;
+
+  double
+  seconds_since(bench_clock::time_point start) {
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+  }
+
+
+  ///> One pass over the events with T = double; returns the seconds
+  template <typename K>
+  double
+  pass_double(const K& kernel, const events& ev) {
+    const bench_clock::time_point start = bench_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < ev.size; i++)
+      sum += kernel(&ev.y[i * ev.dim]);
+    const double t = seconds_since(start);
+    sink = sink + sum;
+    return t;
+  }
+
+
+  /**
+   * One pass over the events with T = var: value and gradient for each
+   * event, then the arena is freed. Returns the seconds; adds the bytes
+   * of the arena to tape_bytes.
+   */
+  template <typename K>
+  double
+  pass_var(const K& kernel, const events& ev, double& tape_bytes) {
+    std::vector<var> x(ev.dim);
+    const bench_clock::time_point start = bench_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < ev.size; i++) {
+      for (int d = 0; d < ev.dim; d++)
+        x[d] = ev.y[i * ev.dim + d];
+      var f = kernel(x.data());
+      stan::math::grad(f.vi_);
+      sum += f.val();
+      for (int d = 0; d < ev.dim; d++)
+        sum += x[d].adj();
+      tape_bytes += stan::math::ChainableStack::memalloc_.bytes_allocated();
+      stan::math::recover_memory();
+    }
+    const double t = seconds_since(start);
+    sink = sink + sum;
+    return t;
+  }
+
+
+  /**
+   * Runs the kernel K with T = double and, if it is differentiable, with
+   * T = var; adds the results to res
+   */
+  template <typename K>
+  void
+  run(const std::string& name, const events& ev, int repeat,
+      std::vector<result>& res) {
+    const K kernel = K();
+    const int num_scalars = K::differentiable ? 2 : 1;
+    double tape_bytes = 0;
+
+    // First pass: warm-up and allocations
+    size_t allocs = num_allocations;
+    pass_double(kernel, ev);
+    const double allocs_double = num_allocations - allocs;
+    double allocs_var = 0;
+    if (K::differentiable) {
+      allocs = num_allocations;
+      pass_var(kernel, ev, tape_bytes);
+      allocs_var = num_allocations - allocs;
+    }
+
+    double t_double = std::numeric_limits<double>::infinity();
+    double t_var = std::numeric_limits<double>::infinity();
+    double ignored = 0;
+    for (int r = 0; r < repeat; r++) {
+      t_double = std::min(t_double, pass_double(kernel, ev));
+      if (K::differentiable)
+        t_var = std::min(t_var, pass_var(kernel, ev, ignored));
+    }
+
+    const result r_double = {name, "double", 1e9 * t_double / ev.size,
+                             allocs_double / ev.size, 0.0};
+    res.push_back(r_double);
+    if (K::differentiable) {
+      const result r_var = {name, "var", 1e9 * t_var / ev.size,
+                            allocs_var / ev.size, tape_bytes / ev.size};
+      res.push_back(r_var);
+    }
+    for (int i = num_scalars; i > 0; i--) {
+      const result& r = res[res.size() - i];
+      std::printf("%-28s %-7s %10.1f %12.2f %12.1f\n", r.name.c_str(),
+                  r.scalar.c_str(), r.ns_per_event, r.allocs_per_event,
+                  r.tape_bytes_per_event);
+    }
+  }
+
+
+  ///> Relative difference of a and b; a NaN on either side counts as 1
+  double
+  rel_diff(double a, double b) {
+    if (a == b)
+      return 0.0;
+    const double d = std::fabs(a - b)
+      / std::max(std::fabs(a), std::fabs(b));
+    return d == d ? d : 1.0;
+  }
+
+
+  /**
+   * Compares the vectorized line shapes of fct/simd.hpp with the scalar
+   * templates of fct, for every instruction set of this CPU, at n values
+   * of m2_ab of pi pi, a quarter of them below threshold (p2_ab < 0),
+   * and for spins 0, 1 and 2. Prints and returns the largest relative
+   * difference. Below threshold the relativistic width is 0 (the
+   * template gives NaN there).
+   */
+  double
+  check_simd(size_t n) {
+    namespace simd = stan_pwa::fct::simd;
+    std::mt19937_64 rng(3);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    const double threshold = 4 * particles::pi.m2;
+    std::vector<double> m2(n), m(n), p2(n);
+    for (size_t i = 0; i < n; i++) {
+      m2[i] = i % 4 == 0 ? 0.01 + (threshold - 0.01) * u(rng)
+        : threshold + (3.0 - threshold) * u(rng);
+      m[i] = std::sqrt(m2[i]);
+      p2[i] = mfct::breakup_momentum::p2(m2[i], particles::pi.m,
+                                         particles::pi.m);
+    }
+
+    double max_diff = 0;
+    std::vector<double> out(n), re(n), im(n);
+    for (int isa = simd::isa_scalar; isa <= simd::detected_isa(); isa++) {
+      const simd::instruction_set set = simd::instruction_set(isa);
+      double diff = 0;
+      for (int J = 0; J <= 2; J++) {
+        // Resonances of D0 -> pi pi pi pi, as in
+  // structures/four_body_resonances.hpp
+  mresonances::P_R1d_R2cd_abcd a1_rho(particles::D0, particles::pi,
+                                      particles::pi, particles::pi,
+                                      particles::pi, 1, 0, 1, particles::a1,
+                                      particles::rho_770, 0.1, 0.1491);
+  mresonances::P_R1R2_abcd rho_rho(particles::D0, particles::pi,
+                                   particles::pi, particles::pi,
+                                   particles::pi, 1, 1, 1,
+                                   particles::rho_770, particles::rho_770,
+                                   0.1491, 0.1491,
+                                   mresonances::polarization::longitudinal);
+
+  const mfct::breit_wigner::width_constants R(particles::rho_770.m,
+                                                    0.1491, J,
+                                                    particles::rho_770.r,
+                                                    particles::pi.m,
+                                                    particles::pi.m);
+        simd::blatt_weisskopf_p2(J, R.r2_R, p2.data(), out.data(), n, set);
+        for (size_t i = 0; i < n; i++)
+          diff = std::max(diff, rel_diff(out[i],
+            mfct::blatt_weisskopf_p2(J, R.r2_R, p2[i])));
+
+        simd::relativistic_width(R, m.data(), p2.data(), out.data(), n,
+                                 set);
+        for (size_t i = 0; i < n; i++)
+          diff = std::max(diff, rel_diff(out[i], p2[i] < 0 ? 0.0
+            : mfct::breit_wigner::relativistic_width(R, m[i], p2[i])));
+
+        simd::breit_wigner_value(R.M_R, m2.data(), out.data(), re.data(),
+                                 im.data(), n, set);
+        for (size_t i = 0; i < n; i++) {
+          const mc::number<double> z
+            = mfct::breit_wigner::value(R.M_R, m2[i], out[i]);
+          diff = std::max(diff, std::max(rel_diff(re[i], z.re),
+                                         rel_diff(im[i], z.im)));
+        }
+      }
+
+      simd::flatte_value(particles::f0_980.m, 0.329, 2 * 0.329, m2.data(),
+                         re.data(), im.data(), n, set);
+      for (size_t i = 0; i < n; i++) {
+        const mc::number<double> z
+          = mfct::flatte::value(particles::f0_980.m, m2[i], 0.329,
+                                2 * 0.329);
+        diff = std::max(diff, std::max(rel_diff(re[i], z.re),
+                                       rel_diff(im[i], z.im)));
+      }
+
+      std::printf("simd check %-7s max. relative difference to the "
+                  "templates %.2e\n", simd::isa_name(set), diff);
+      max_diff = std::max(max_diff, diff);
+    }
+    return max_diff;
+  }
+
+
+  /**
+   * Checks that the fingerprints of 4-body resonances (see
+   * resonance_list::resonance_hash) tell apart two resonances that only
+   * differ in the mass of one intermediate particle, plain and
+   * symmetrized. Returns whether they do.
+   */
+  bool
+  check_fingerprints() {
+    const stan_pwa::Particle a1_heavier(particles::a1.m + 0.01,
+                                        particles::a1.r, particles::a1.J);
+    mresonances::P_R1d_R2cd_abcd a1_rho_heavier(particles::D0,
+                                                particles::pi, particles::pi,
+                                                particles::pi, particles::pi,
+                                                1, 0, 1, a1_heavier,
+                                                particles::rho_770, 0.1,
+                                                0.1491);
+    bool ok = true;
+    for (int sym = 0; sym < 2; sym++) {
+      const uint64_t h = stan_pwa::resonance_list::resonance_hash(a1_rho,
+                                                                  sym);
+      const uint64_t h_heavier
+        = stan_pwa::resonance_list::resonance_hash(a1_rho_heavier, sym);
+      std::printf("fingerprint check %s: %016llx, heavier a1 %016llx\n",
+                  sym ? "value_sym" : "value", (unsigned long long)h,
+                  (unsigned long long)h_heavier);
+      ok = ok && h != h_heavier;
+    }
+    return ok;
+  }
+
+
+  void
+  write_json(const std::string& path, size_t num_events, int repeat,
+             const std::vector<result>& res) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (f == 0)
+      throw std::domain_error("cannot open " + path);
+    std::fprintf(f, "{\n  \"events\": %zu,\n  \"repeat\": %d,\n"
+                 "  \"benchmarks\": [\n", num_events, repeat);
+    for (size_t i = 0; i < res.size(); i++) {
+      std::fprintf(f, "    {\"name\": \"%s\", \"scalar\": \"%s\", "
+                   "\"ns_per_event\": %.3f, \"allocs_per_event\": %.3f, "
+                   "\"tape_bytes_per_event\": %.3f}%s\n",
+                   res[i].name.c_str(), res[i].scalar.c_str(),
+                   res[i].ns_per_event, res[i].allocs_per_event,
+                   res[i].tape_bytes_per_event,
+                   i + 1 < res.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+    if (std::fclose(f) != 0)
+      throw std::domain_error("cannot write " + path);
+  }
+
+}
+
+int main(int argc, char* argv[]) {
+
+  size_t num_events = 10000;
+  int repeat = 5;
+  std::string filter;
+  std::string json;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg.compare(0, 9, "--events=") == 0)
+      num_events = std::strtoul(arg.c_str() + 9, 0, 10);
+    else if (arg.compare(0, 9, "--repeat=") == 0)
+      repeat = std::strtoul(arg.c_str() + 9, 0, 10);
+    else if (arg.compare(0, 9, "--filter=") == 0)
+      filter = arg.substr(9);
+    else if (arg.compare(0, 7, "--json=") == 0)
+      json = arg.substr(7);
+    else {
+      std::cerr << "Usage: " << argv[0] << " [--events=N] [--repeat=R]"
+                << " [--filter=TEXT] [--json=FILE]" << std::endl;
+      return 1;
+    }
+  }
+  if (num_events == 0 || repeat < 1) {
+    std::cerr << argv[0] << ": N and R must be positive" << std::endl;
+    return 1;
+  }
+
+  // The vectorized kernels must agree with the templates they replace
+  // in resonance_list::amplitude_batch
+  if (check_simd(num_events) > 1e-12) {
+    std::cerr << argv[0] << ": the vectorized line shapes differ from "
+              << "the templates" << std::endl;
+    return 1;
+  }
+  if (!check_fingerprints()) {
+    std::cerr << argv[0] << ": 4-body resonances of different masses have "
+              << "the same fingerprint" << std::endl;
+    return 1;
+  }
+
+  const events dalitz = draw_dalitz(particles::d, particles::pi,
+                                    particles::pi, particles::pi,
+                                    num_events, 1);
+  const events four_body = draw_four_body(particles::D0, particles::pi,
+                                          particles::pi, particles::pi,
+                                          particles::pi, num_events, 2);
+
+  std::printf("%-28s %-7s %10s %12s %12s\n", "kernel", "T", "ns/event",
+              "allocs/event", "tape/event");
+  std::vector<result> res;
+
+#define STAN_PWA_RUN(NAME)                                              \
+  if (std::string(#NAME).find(filter) != std::string::npos)             \
+    run<NAME>(#NAME, NAME::dim == 2 ? dalitz : four_body, repeat, res);
+
+  STAN_PWA_RUN(breit_wigner_value)
+  STAN_PWA_RUN(breit_wigner_width)
+  STAN_PWA_RUN(flatte_value)
+  STAN_PWA_RUN(blatt_weisskopf_1)
+  STAN_PWA_RUN(blatt_weisskopf_2)
+  STAN_PWA_RUN(zemach_3)
+  STAN_PWA_RUN(zemach_4)
+  STAN_PWA_RUN(valid)
+  STAN_PWA_RUN(valid_5d)
+  STAN_PWA_RUN(P_V1V2_angles)
+  STAN_PWA_RUN(P_R1d_R2cd_theta_z)
+  STAN_PWA_RUN(flat_3_value)
+  STAN_PWA_RUN(flat_3_value_sym)
+  STAN_PWA_RUN(breit_wigner_1_value)
+  STAN_PWA_RUN(breit_wigner_1_value_sym)
+  STAN_PWA_RUN(breit_wigner_2_value)
+  STAN_PWA_RUN(breit_wigner_2_value_sym)
+  STAN_PWA_RUN(breit_wigner_only_value)
+  STAN_PWA_RUN(breit_wigner_only_value_sym)
+  STAN_PWA_RUN(flatte_3_value)
+  STAN_PWA_RUN(flatte_3_value_sym)
+  STAN_PWA_RUN(P_R1d_R2cd_value)
+  STAN_PWA_RUN(P_R1d_R2cd_value_sym)
+  STAN_PWA_RUN(P_R1R2_value)
+  STAN_PWA_RUN(P_R1R2_value_sym)
+
+#undef STAN_PWA_RUN
+
+  if (!json.empty()) {
+    try {
+      write_json(json, num_events, repeat, res);
+    } catch (const std::exception& e) {
+      std::cerr << argv[0] << ": " << e.what() << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
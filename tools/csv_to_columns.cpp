@@ -0,0 +1,187 @@
+// csv_to_columns.cpp
+//
+// NAME
+//    csv_to_columns - convert CmdStan output files to columnar tables.
+//
+// SYNOPSIS
+//    csv_to_columns [--root] [--tree_name=NAME] CSV...
+//
+// DESCRIPTION
+//    Converts every CmdStan output file CSV (e.g. output/output1.csv, or
+//    the output of generate_events) to a binary columnar table, saved
+//    with the extension .col instead of .csv (see
+//    stan_pwa/src/io/columns.hpp; read it in Python with
+//    lib/py/utils/columns.py). Lines starting with '#' (configuration,
+//    adaptation info, timing) are skipped.
+//
+//    The files are read in one pass, in blocks of rows, so the memory
+//    does not depend on their size. A single file is parsed on
+//    STAN_PWA_NUM_THREADS threads (default: all cores); several files are
+//    converted concurrently, one per thread.
+//
+//    With --root, each file is also written to a ROOT file (.root, with
+//    the tree NAME, default t), as by bin/csv_to_root.py. This needs
+//    ROOT: build_tools.sh compiles it in if root-config is found.
+//
+//    Built by build_tools.sh.
+
+#include <algorithm> // min
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef STAN_PWA_WITH_ROOT
+#include <TFile.h>
+#include <TROOT.h>
+#include <TTree.h>
+#endif
+
+#include <stan_pwa/src/io.hpp>
+#include <stan_pwa/src/parallel.hpp>
+
+namespace {
+
+  std::mutex log_mutex;
+
+
+  ///> Output file name: CSV with the extension ext instead of .csv
+  std::string output_name(const std::string& csv, const std::string& ext) {
+    const size_t n = csv.size();
+    if (n > 4 && csv.compare(n - 4, 4, ".csv") == 0)
+      return csv.substr(0, n - 4) + ext;
+    return csv + ext;
+  }
+
+
+  void convert(const std::string& csv, bool root, const std::string& tree_name,
+               bool threaded) {
+    std::ifstream in(csv.c_str());
+    if (!in)
+      throw std::domain_error("cannot open " + csv);
+    stan_pwa::io::stan_csv_reader reader(in, threaded);
+    const size_t C = reader.num_cols();
+
+    stan_pwa::io::column_writer out(output_name(csv, ".col"), reader.header());
+
+#ifndef STAN_PWA_WITH_ROOT
+    // Without ROOT, main rejects --root
+    (void)root;
+    (void)tree_name;
+#else
+    TFile* f_root = 0;
+    TTree* tree = 0;
+    std::vector<double> branch(C);
+    if (root) {
+      f_root = TFile::Open(output_name(csv, ".root").c_str(), "recreate");
+      if (f_root == 0 || f_root->IsZombie())
+        throw std::domain_error("cannot open " + output_name(csv, ".root"));
+      tree = new TTree(tree_name.c_str(), tree_name.c_str());
+      for (size_t c = 0; c < C; c++)
+        tree->Branch(reader.header()[c].c_str(), &branch[c],
+                     (reader.header()[c] + "/D").c_str());
+    }
+#endif
+
+    std::vector<double> rows;
+    size_t n;
+    while ((n = reader.read(rows, 65536)) > 0) {
+      out.append(rows.data(), n);
+#ifdef STAN_PWA_WITH_ROOT
+      if (tree != 0) {
+        for (size_t r = 0; r < n; r++) {
+          std::copy(&rows[r * C], &rows[r * C] + C, branch.begin());
+          tree->Fill();
+        }
+      }
+#endif
+    }
+    out.close();
+
+#ifdef STAN_PWA_WITH_ROOT
+    if (f_root != 0) {
+      f_root->Write();
+      f_root->Close();
+      delete f_root;
+    }
+#endif
+
+    std::lock_guard<std::mutex> lock(log_mutex);
+    std::cout << "csv_to_columns: " << csv << ": " << out.num_rows()
+              << " rows, " << C << " columns." << std::endl;
+  }
+
+}
+
+int main(int argc, char* argv[]) {
+
+  bool root = false;
+  std::string tree_name = "t";
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--root")
+      root = true;
+    else if (arg.compare(0, 12, "--tree_name=") == 0)
+      tree_name = arg.substr(12);
+    else
+      files.push_back(arg);
+  }
+  if (files.empty()) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--root] [--tree_name=NAME] CSV..." << std::endl;
+    return 1;
+  }
+#ifndef STAN_PWA_WITH_ROOT
+  if (root) {
+    std::cerr << argv[0] << ": built without ROOT, --root is not available"
+              << std::endl;
+    return 1;
+  }
+#endif
+
+  // One file: parse its blocks on the thread pool. Several files: one
+  // file per thread.
+  if (files.size() == 1) {
+    try {
+      convert(files[0], root, tree_name, true);
+    } catch (const std::exception& e) {
+      std::cerr << argv[0] << ": " << e.what() << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+#ifdef STAN_PWA_WITH_ROOT
+  if (root)
+    ROOT::EnableThreadSafety();
+#endif
+
+  std::atomic<size_t> next(0);
+  std::atomic<int> status(0);
+  const auto work = [&]() {
+    for (size_t i = next++; i < files.size(); i = next++) {
+      try {
+        convert(files[i], root, tree_name, false);
+      } catch (const std::exception& e) {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        std::cerr << argv[0] << ": " << e.what() << std::endl;
+        status = 1;
+      }
+    }
+  };
+  const size_t num_workers = std::min<size_t>(files.size(),
+                                              stan_pwa::parallel::num_threads());
+  std::vector<std::thread> workers;
+  for (size_t w = 1; w < num_workers; w++)
+    workers.push_back(std::thread(work));
+  work();
+  for (size_t w = 0; w < workers.size(); w++)
+    workers[w].join();
+
+  return status;
+}
@@ -0,0 +1,114 @@
+// event_store.cpp
+//
+// NAME
+//    event_store - write the events and amplitudes of the linked model to
+//    a binary event store.
+//
+// SYNOPSIS
+//    event_store EVENTS_CSV OUTPUT_PWA
+//
+// DESCRIPTION
+//    Reads the events y.1 .. y.<num_variables()> from the CmdStan output
+//    file EVENTS_CSV (e.g. of generate_events or of the data generator),
+//    computes their amplitudes with amplitude_batch of the model linked
+//    by relink_model.sh (symmetrized if the model is), and writes the
+//    events and the amplitudes to OUTPUT_PWA in the format of
+//    stan_pwa/src/io/event_store.hpp, together with the model hash.
+//
+//    The fit STAN_amplitude_fitting_mapped.stan maps the file named by
+//    the environment variable STAN_PWA_EVENT_STORE (default:
+//    amplitudes.pwa) instead of reading amplitude_vector_data from a
+//    *.data.R file; it refuses stores written for another model.
+//
+//    For STAN_amplitude_fitting_floating.stan, a second store of points
+//    uniformly distributed over the phase space (e.g. of generate_events
+//    --weighted) is named by STAN_PWA_NORM_STORE (default:
+//    normalization.pwa) for the normalization integral.
+//
+//    Built by build_tools.sh.
+
+#include <algorithm> // min
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <stan_pwa/src/io.hpp>
+#include <stan_pwa/src/model_wrapper.hpp>
+
+int main(int argc, char* argv[]) {
+
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " EVENTS_CSV OUTPUT_PWA" << std::endl;
+    return 1;
+  }
+
+  // Read the events
+  std::ifstream f_in(argv[1]);
+  if (!f_in) {
+    std::cerr << argv[0] << ": cannot open " << argv[1] << std::endl;
+    return 1;
+  }
+  const stan_pwa::io::stan_csv csv = stan_pwa::io::read_stan_csv(f_in);
+
+  const int num_var = stan::math::num_variables();
+  const int num_res = stan::math::num_resonances();
+  std::vector<int> cols(num_var);
+  for (int i = 0; i < num_var; i++) {
+    std::stringstream name;
+    name << "y." << i + 1;
+    cols[i] = csv.column(name.str());
+    if (cols[i] < 0) {
+      std::cerr << argv[0] << ": no column " << name.str() << " in "
+                << argv[1] << std::endl;
+      return 1;
+    }
+  }
+
+  const size_t D = csv.rows.size();
+  std::cout << "event_store: " << D << " events, " << num_res
+            << " resonances..." << std::endl;
+
+  try {
+    stan_pwa::io::mapped_event_store store(
+      argv[2], stan_pwa::io::event_store_header(D, num_res, num_var,
+                                                stan::math::model_hash()));
+
+    // Variables
+    for (int i = 0; i < num_var; i++) {
+      double* y = store.column(i);
+      for (size_t n = 0; n < D; n++)
+        y[n] = csv.rows[n][cols[i]];
+    }
+
+    // Amplitudes, batch by batch
+    const size_t batch = 65536;
+    Eigen::MatrixXd y;
+    stan_pwa::resonance_list::soa_matrix re, im;
+    for (size_t begin = 0; begin < D; begin += batch) {
+      const size_t N = std::min(batch, D - begin);
+      y.resize(N, num_var);
+      for (int i = 0; i < num_var; i++)
+        y.col(i) = Eigen::Map<const Eigen::VectorXd>(store.y(i) + begin, N);
+
+      stan::math::amplitude_batch(y, re, im);
+      for (int r = 0; r < num_res; r++) {
+        Eigen::Map<Eigen::VectorXd>(store.column(num_var + r) + begin, N)
+          = re.row(r).transpose();
+        Eigen::Map<Eigen::VectorXd>(store.column(num_var + num_res + r)
+                                    + begin, N)
+          = im.row(r).transpose();
+      }
+    }
+    store.commit();
+  } catch (const std::exception& e) {
+    std::cerr << argv[0] << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::cout << "event_store: Done. Events and amplitudes saved in "
+            << argv[2] << "." << std::endl;
+  return 0;
+}
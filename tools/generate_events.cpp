@@ -0,0 +1,181 @@
+// generate_events.cpp
+//
+// NAME
+//    generate_events - generate toy events of the linked model.
+//
+// SYNOPSIS
+//    generate_events DATA_R NUM_EVENTS OUTPUT_CSV M_P M_A M_B M_C [M_D]
+//                    [--seed=SEED] [--explore=NUM_POINTS] [--weighted]
+//
+// DESCRIPTION
+//    Draws NUM_EVENTS events of the decay P -> a b c (Dalitz plot,
+//    y = (m2_ab, m2_bc)) or P -> a b c d (y = (m2_12, m2_14, m2_23, m2_34,
+//    m2_13)) with masses M_P, M_A, ... in GeV, distributed according to
+//
+//        f_genfit(amplitude_vector(y), theta),
+//
+//    where theta is read from DATA_R (e.g. stan/STAN_data_generator.data.R)
+//    and amplitude_vector is the one of the model linked by
+//    relink_model.sh. The events are independent draws (accept-reject
+//    against an envelope estimated from NUM_POINTS uniform points,
+//    default 100 per event but at most 10^8); with --weighted, they are
+//    uniformly distributed over the phase space instead.
+//
+//    The events are written to OUTPUT_CSV in the format of the CmdStan
+//    output, with columns lp__ (log of f_genfit; for weighted events,
+//    the weight is exp(lp__)) and y.1, y.2, ..., so that csv_to_root.py and
+//    the other tools can read them.
+//
+//    Uses STAN_PWA_NUM_THREADS threads (default: all cores); for a given
+//    SEED (default 1), the events do not depend on the number of threads.
+//
+//    Built by build_tools.sh.
+
+#include <algorithm> // min
+#include <cmath> // log
+#include <cstdio> // fprintf
+#include <cstdlib> // atof, strtoul
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stan/io/dump.hpp>
+
+#include <stan_pwa/src/generate.hpp>
+#include <stan_pwa/src/model_wrapper.hpp>
+
+namespace {
+
+  // Writes the events of one block as CSV rows
+  struct csv_sink {
+    FILE* out;
+    stan_pwa::generate::generation_stats stats;
+    size_t num_events;
+
+    void operator()(const stan_pwa::generate::event_block& b) {
+      for (size_t e = 0; e < b.y.size(); e++) {
+        std::fprintf(out, "%.17g", std::log(b.f[e]));
+        for (int i = 0; i < b.y[e].rows(); i++)
+          std::fprintf(out, ",%.17g", b.y[e](i));
+        std::fprintf(out, "\n");
+      }
+      stats.add(b.stats);
+      num_events += b.y.size();
+    }
+  };
+
+
+  template <typename S>
+  int generate(const S& space, const stan::math::CV_t<double>& theta,
+               size_t num_events, size_t num_explore, unsigned long seed,
+               bool weighted, FILE* out) {
+
+    const auto density = [&theta](const Eigen::VectorXd& y) {
+      return stan::math::f_genfit(stan::math::amplitude_vector(y), theta);
+    };
+
+    stan_pwa::generate::envelope<S> env(space);
+    if (!weighted)
+      env.explore(density, num_explore, seed);
+
+    std::fprintf(out, "# generate_events: %s events, seed = %lu\n",
+                 weighted ? "weighted" : "unweighted", seed);
+    std::fprintf(out, "lp__");
+    for (int i = 0; i < space.dim(); i++)
+      std::fprintf(out, ",y.%d", i + 1);
+    std::fprintf(out, "\n");
+
+    csv_sink sink = {out, stan_pwa::generate::generation_stats(), 0};
+    stan_pwa::generate::generate_events(space, density, weighted ? 0 : &env,
+                                        num_events, seed, sink);
+
+    std::cout << "generate_events: " << sink.num_events << " events from "
+              << sink.stats.num_trials << " trials." << std::endl;
+    if (sink.stats.num_violations > 0) {
+      std::cerr << "generate_events: WARNING: the density exceeded the "
+                << "envelope " << sink.stats.num_violations << " times; "
+                << "increase --explore." << std::endl;
+    }
+    return 0;
+  }
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+  std::vector<std::string> args;
+  unsigned long seed = 1;
+  size_t num_explore = 0;
+  bool weighted = false;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    if (arg.compare(0, 7, "--seed=") == 0)
+      seed = std::strtoul(arg.c_str() + 7, 0, 10);
+    else if (arg.compare(0, 10, "--explore=") == 0)
+      num_explore = std::strtoul(arg.c_str() + 10, 0, 10);
+    else if (arg == "--weighted")
+      weighted = true;
+    else
+      args.push_back(arg);
+  }
+
+  const int num_var = stan::math::num_variables();
+  const size_t num_masses = (num_var == 2) ? 4 : 5;
+  if (args.size() != 3 + num_masses) {
+    std::cerr << "Usage: " << argv[0]
+              << " DATA_R NUM_EVENTS OUTPUT_CSV M_P M_A M_B M_C"
+              << (num_masses == 5 ? " M_D" : "")
+              << " [--seed=SEED] [--explore=NUM_POINTS] [--weighted]"
+              << std::endl;
+    return 1;
+  }
+
+  // theta, declared as 'vector[num_resonances()] theta[2]'
+  std::ifstream data_stream(args[0].c_str());
+  if (!data_stream) {
+    std::cerr << argv[0] << ": cannot open " << args[0] << std::endl;
+    return 1;
+  }
+  stan::io::dump data(data_stream);
+  if (!data.contains_r("theta")) {
+    std::cerr << argv[0] << ": no theta in " << args[0] << std::endl;
+    return 1;
+  }
+  const std::vector<double> theta_vals = data.vals_r("theta");
+  const int R = theta_vals.size() / 2;
+  stan::math::CV_t<double> theta(2, Eigen::VectorXd(R));
+  for (int r = 0; r < R; r++) {
+    theta[0](r) = theta_vals[2 * r];
+    theta[1](r) = theta_vals[2 * r + 1];
+  }
+
+  const size_t num_events = std::strtoul(args[1].c_str(), 0, 10);
+  if (num_explore == 0)
+    num_explore = std::min(100 * num_events, (size_t)100000000);
+
+  std::vector<double> m(num_masses);
+  for (size_t i = 0; i < num_masses; i++)
+    m[i] = std::atof(args[3 + i].c_str());
+
+  FILE* out = std::fopen(args[2].c_str(), "w");
+  if (out == 0) {
+    std::cerr << argv[0] << ": cannot open " << args[2] << std::endl;
+    return 1;
+  }
+
+  int res;
+  if (num_var == 2) {
+    const stan_pwa::generate::dalitz_space space(m[0], m[1], m[2], m[3]);
+    res = generate(space, theta, num_events, num_explore, seed, weighted, out);
+  } else {
+    const stan_pwa::generate::four_body_space space(m[0], m[1], m[2], m[3], m[4]);
+    res = generate(space, theta, num_events, num_explore, seed, weighted, out);
+  }
+  std::fclose(out);
+
+  std::cout << "generate_events: Done. Events saved in " << args[2] << "."
+            << std::endl;
+  return res;
+}
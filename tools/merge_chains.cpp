@@ -0,0 +1,324 @@
+// merge_chains.cpp
+//
+// NAME
+//    merge_chains - merge the output of several chains and check their
+//    convergence.
+//
+// SYNOPSIS
+//    merge_chains [--csv] [--root] [--prefix=NAME] [--max_lag=L] OUTPUT CSV...
+//    merge_chains --has_root
+//
+// DESCRIPTION
+//    Merges the CmdStan output files CSV (e.g. output/output?.csv) of
+//    several chains to the columnar table OUTPUT (e.g. output/output.col,
+//    see stan_pwa/src/io/columns.hpp), with the additional column chain__
+//    (1 for the first file, 2 for the second, ...). All files must have
+//    the same columns. The chains are merged one after the other, in the
+//    order of the files, and their lines are parsed on the threads of
+//    parallel::thread_pool. (Reading the chains concurrently would either
+//    interleave them in the output or buffer all but one chain.)
+//
+//    In the same pass, the convergence of the parameters whose names
+//    start with NAME (default: theta) is checked: their mean, standard
+//    deviation, effective sample size and split R-hat over all chains
+//    are printed at the end (see stan_pwa/src/diagnostics.hpp). The
+//    autocorrelations are computed up to the lag L (default: 1000); an
+//    effective sample size marked with '*' was truncated there and is an
+//    upper bound, increase L. The draws are not kept in memory.
+//
+//    With --csv, the merged draws are also written to a CSV file (the
+//    name of OUTPUT with the extension .csv): the line of column names
+//    and all draws, as merged by grep and sed in merge_output_chains.sh.
+//    With --root, they are also written to a ROOT file (the name of
+//    OUTPUT with the extension .root, tree t), as by bin/csv_to_root.py.
+//    Both have the columns of the CSV files only, without chain__.
+//
+//    --root needs ROOT: build_tools.sh compiles it in if root-config is
+//    found. merge_chains --has_root exits with 0 if it did, 1 otherwise.
+//
+//    Used by merge_output_chains.sh. Built by build_tools.sh.
+
+#include <algorithm> // copy
+#include <cmath> // sqrt
+#include <cstdio> // printf
+#include <cstdlib> // strtoul
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef STAN_PWA_WITH_ROOT
+#include <TFile.h>
+#include <TTree.h>
+#endif
+
+#include <stan_pwa/src/diagnostics.hpp>
+#include <stan_pwa/src/io.hpp>
+
+namespace {
+
+  ///> Rows read from a chain at once
+  const size_t block_rows = 65536;
+
+
+  ///> path with its extension (if any) replaced by ext
+  std::string with_extension(std::string path, const std::string& ext) {
+    const size_t dot = path.rfind('.');
+    if (dot != std::string::npos && path.find('/', dot) == std::string::npos)
+      path.erase(dot);
+    return path + ext;
+  }
+
+
+  ///> Output of all chains: the columnar table, and optionally the CSV
+  ///> and ROOT files (without chain__)
+  class merged_output {
+  public:
+    merged_output(const std::string& path,
+                  const std::vector<std::string>& names, bool csv, bool root) :
+      C_(names.size()), out_(path, column_names(names))
+#ifdef STAN_PWA_WITH_ROOT
+      , f_root_(0), tree_(0), branch_(names.size())
+#endif
+    {
+#ifndef STAN_PWA_WITH_ROOT
+      // Without ROOT, main rejects --root
+      (void)root;
+#endif
+      if (csv) {
+        const std::string csv_path = with_extension(path, ".csv");
+        csv_.open(csv_path.c_str());
+        for (size_t c = 0; c < C_; c++)
+          csv_ << (c == 0 ? "" : ",") << names[c];
+        csv_ << '\n';
+        if (!csv_)
+          throw std::domain_error("cannot write " + csv_path);
+      }
+#ifdef STAN_PWA_WITH_ROOT
+      if (root) {
+        const std::string root_path = with_extension(path, ".root");
+        f_root_ = TFile::Open(root_path.c_str(), "recreate");
+        if (f_root_ == 0 || f_root_->IsZombie())
+          throw std::domain_error("cannot open " + root_path);
+        tree_ = new TTree("t", "t");
+        for (size_t c = 0; c < C_; c++)
+          tree_->Branch(names[c].c_str(), &branch_[c],
+                        (names[c] + "/D").c_str());
+      }
+#endif
+    };
+
+    ///> Appends n rows of chain
+    void append(const double* rows, size_t n, double chain) {
+      merged_.resize(n * (C_ + 1));
+      for (size_t r = 0; r < n; r++) {
+        std::copy(&rows[r * C_], &rows[r * C_] + C_, &merged_[r * (C_ + 1)]);
+        merged_[r * (C_ + 1) + C_] = chain;
+      }
+      out_.append(merged_.data(), n);
+
+      if (csv_.is_open()) {
+        std::string line;
+        char value[stan_pwa::io::value_chars];
+        for (size_t r = 0; r < n; r++) {
+          line.clear();
+          for (size_t c = 0; c < C_; c++) {
+            if (c > 0)
+              line += ',';
+            line.append(value,
+                        stan_pwa::io::format_value(rows[r * C_ + c], value));
+          }
+          line += '\n';
+          csv_ << line;
+        }
+        if (!csv_)
+          throw std::domain_error("cannot write the CSV file");
+      }
+#ifdef STAN_PWA_WITH_ROOT
+      if (tree_ != 0) {
+        for (size_t r = 0; r < n; r++) {
+          std::copy(&rows[r * C_], &rows[r * C_] + C_, branch_.begin());
+          tree_->Fill();
+        }
+      }
+#endif
+    }
+
+    uint64_t close() {
+      out_.close();
+      if (csv_.is_open()) {
+        csv_.close();
+        if (!csv_)
+          throw std::domain_error("cannot write the CSV file");
+      }
+#ifdef STAN_PWA_WITH_ROOT
+      if (f_root_ != 0) {
+        f_root_->Write();
+        f_root_->Close();
+        delete f_root_;
+        f_root_ = 0;
+      }
+#endif
+      return out_.num_rows();
+    }
+
+  private:
+    static std::vector<std::string>
+    column_names(std::vector<std::string> names) {
+      names.push_back("chain__");
+      return names;
+    }
+
+    const size_t C_;
+    stan_pwa::io::column_writer out_;
+    std::ofstream csv_;
+    std::vector<double> merged_;
+#ifdef STAN_PWA_WITH_ROOT
+    TFile* f_root_;
+    TTree* tree_;
+    std::vector<double> branch_;
+#endif
+  };
+
+
+  /**
+   * Appends the rows of one chain to out and adds the draws of the
+   * columns params to stats (one per column).
+   */
+  void merge_chain(stan_pwa::io::stan_csv_reader& reader, double chain,
+                   const std::vector<size_t>& params,
+                   std::vector<stan_pwa::diagnostics::chain_stats>& stats,
+                   merged_output& out) {
+    const size_t C = reader.num_cols();
+    std::vector<double> rows, draws;
+    size_t n;
+    while ((n = reader.read(rows, block_rows)) > 0) {
+      out.append(rows.data(), n, chain);
+
+      draws.resize(n);
+      for (size_t p = 0; p < params.size(); p++) {
+        for (size_t r = 0; r < n; r++)
+          draws[r] = rows[r * C + params[p]];
+        stats[p].add(draws.data(), n);
+      }
+    }
+  }
+
+}
+
+int main(int argc, char* argv[]) {
+  namespace diag = stan_pwa::diagnostics;
+
+  bool csv = false;
+  bool root = false;
+  std::string prefix = "theta";
+  size_t max_lag = 1000;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--has_root") {
+#ifdef STAN_PWA_WITH_ROOT
+      return 0;
+#else
+      return 1;
+#endif
+    }
+    if (arg == "--csv")
+      csv = true;
+    else if (arg == "--root")
+      root = true;
+    else if (arg.compare(0, 9, "--prefix=") == 0)
+      prefix = arg.substr(9);
+    else if (arg.compare(0, 10, "--max_lag=") == 0)
+      max_lag = std::strtoul(arg.c_str() + 10, 0, 10);
+    else
+      files.push_back(arg);
+  }
+  if (files.size() < 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--csv] [--root] [--prefix=NAME] [--max_lag=L] OUTPUT CSV..."
+              << std::endl;
+    return 1;
+  }
+#ifndef STAN_PWA_WITH_ROOT
+  if (root) {
+    std::cerr << argv[0] << ": built without ROOT, --root is not available"
+              << std::endl;
+    return 1;
+  }
+#endif
+  const std::string output = files[0];
+  files.erase(files.begin());
+  const size_t M = files.size();
+
+  std::vector<std::string> names;
+  std::vector<size_t> params;
+  // chain_major[m][p]: parameter p in chain m
+  std::vector<std::vector<diag::chain_stats> > chain_major(M);
+  uint64_t num_rows = 0;
+  try {
+    std::vector<std::unique_ptr<std::ifstream> > in(M);
+    std::vector<std::unique_ptr<stan_pwa::io::stan_csv_reader> > readers(M);
+    for (size_t m = 0; m < M; m++) {
+      in[m].reset(new std::ifstream(files[m].c_str()));
+      if (!*in[m])
+        throw std::domain_error("cannot open " + files[m]);
+      readers[m].reset(new stan_pwa::io::stan_csv_reader(*in[m]));
+      if (m > 0 && readers[m]->header() != readers[0]->header())
+        throw std::domain_error(files[m] + " has other columns than "
+                                + files[0]);
+    }
+
+    names = readers[0]->header();
+    for (size_t c = 0; c < names.size(); c++) {
+      if (names[c].compare(0, prefix.size(), prefix) == 0)
+        params.push_back(c);
+    }
+    for (size_t m = 0; m < M; m++)
+      chain_major[m].assign(params.size(), diag::chain_stats(max_lag));
+
+    merged_output out(output, names, csv, root);
+    for (size_t m = 0; m < M; m++) {
+      try {
+        merge_chain(*readers[m], m + 1, params, chain_major[m], out);
+      } catch (const std::exception& e) {
+        throw std::domain_error(files[m] + ": " + e.what());
+      }
+    }
+    num_rows = out.close();
+  } catch (const std::exception& e) {
+    std::cerr << argv[0] << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::cout << "merge_chains: " << output << ": " << num_rows << " rows of "
+            << M << " chains." << std::endl;
+  if (params.empty()) {
+    std::cout << "merge_chains: no parameters " << prefix << "*." << std::endl;
+    return 0;
+  }
+
+  bool truncated = false;
+  std::printf("\n%-16s %14s %14s %10s %10s\n",
+              "", "Mean", "SD", "N_Eff", "R_hat");
+  for (size_t p = 0; p < params.size(); p++) {
+    std::vector<diag::chain_stats> chains;
+    diag::moments all;
+    for (size_t m = 0; m < M; m++) {
+      chains.push_back(chain_major[m][p]);
+      all.add(chains[m].all());
+    }
+    const diag::effective_sample_size n_eff = diag::ess(chains);
+    truncated = truncated || n_eff.truncated;
+    std::printf("%-16s %14.6g %14.6g %9.0f%c %10.4f\n",
+                names[params[p]].c_str(), all.mean,
+                std::sqrt(all.variance()), n_eff.value,
+                n_eff.truncated ? '*' : ' ', diag::split_rhat(chains));
+  }
+  if (truncated)
+    std::printf("\n* truncated at the lag %zu, an upper bound.\n", max_lag);
+
+  return 0;
+}
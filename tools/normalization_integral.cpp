@@ -0,0 +1,175 @@
+// normalization_integral.cpp
+//
+// NAME
+//    normalization_integral - compute the normalization matrix I of the
+//    linked model.
+//
+// SYNOPSIS
+//    normalization_integral POINTS_CSV VOLUME OUTPUT_DATA_R [--append]
+//                           [--store DIR] [--cache DIR]
+//
+// DESCRIPTION
+//    Reads the phase space points y.1 .. y.<num_variables()> from the
+//    CmdStan output file POINTS_CSV (e.g. of STAN_phase_space_gen; the
+//    points must be uniformly distributed over a phase space of volume
+//    VOLUME), computes
+//
+//        I[i,j] = int conj(A_i(y)) A_j(y) dy
+//
+//    with amplitude_vector of the model linked by relink_model.sh, and
+//    writes I and its standard error I_err to OUTPUT_DATA_R in the
+//    format of STAN_amplitude_fitting.data.R. With --append, they are
+//    appended to an existing data file instead. I is the complex
+//    conjugate of the matrix of integral_of_tensor_product_w_pts in
+//    lib/py/utils/mcint.py, whose element [i,j] is int A_i conj(A_j) dy.
+//
+//    With --store, the values of every resonance at the points and the
+//    sums of every pair of resonances are kept in the directory DIR and
+//    reused by later runs over the same points (see
+//    stan_pwa/src/integrate/integral_store.hpp): after adding a resonance
+//    to the model, only its amplitudes and its row of I are computed.
+//
+//    With --cache (default: the directory named by the environment
+//    variable STAN_PWA_INTEGRAL_CACHE, if set), I is looked up in the
+//    cache DIR by the fingerprint of the model, the hash of the points
+//    and VOLUME, and read from there if it was computed before; else it
+//    is computed and added to the cache (see
+//    stan_pwa/src/integrate/integral_cache.hpp). Parallel runs may share
+//    the cache; a missing I is computed by one of them only.
+//
+//    Uses STAN_PWA_NUM_THREADS threads (default: all cores); the result
+//    does not depend on the number of threads.
+//
+//    Built by build_tools.sh.
+
+#include <cstdlib> // atof, getenv
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <stan_pwa/src/integrate.hpp>
+#include <stan_pwa/src/io.hpp>
+#include <stan_pwa/src/model_wrapper.hpp>
+
+int main(int argc, char* argv[]) {
+
+  bool append = false;
+  std::string store_dir;
+  const char* cache_env = std::getenv("STAN_PWA_INTEGRAL_CACHE");
+  std::string cache_dir = cache_env != 0 ? cache_env : "";
+  bool usage = argc < 4;
+  for (int a = 4; a < argc && !usage; a++) {
+    if (std::string(argv[a]) == "--append")
+      append = true;
+    else if (std::string(argv[a]) == "--store" && a + 1 < argc)
+      store_dir = argv[++a];
+    else if (std::string(argv[a]) == "--cache" && a + 1 < argc)
+      cache_dir = argv[++a];
+    else
+      usage = true;
+  }
+  if (usage) {
+    std::cerr << "Usage: " << argv[0]
+              << " POINTS_CSV VOLUME OUTPUT_DATA_R [--append] [--store DIR]"
+              << " [--cache DIR]"
+              << std::endl;
+    return 1;
+  }
+
+  // Read the phase space points by columns (for the store and the hash
+  // of the sample); the CSV rows are released once they are copied
+  const int num_var = stan::math::num_variables();
+  std::vector<std::vector<double> > y(num_var);
+  {
+    std::ifstream f_in(argv[1]);
+    if (!f_in) {
+      std::cerr << argv[0] << ": cannot open " << argv[1] << std::endl;
+      return 1;
+    }
+    const stan_pwa::io::stan_csv csv = stan_pwa::io::read_stan_csv(f_in);
+
+    for (int i = 0; i < num_var; i++) {
+      std::stringstream name;
+      name << "y." << i + 1;
+      const int col = csv.column(name.str());
+      if (col < 0) {
+        std::cerr << argv[0] << ": no column " << name.str() << " in "
+                  << argv[1] << std::endl;
+        return 1;
+      }
+      y[i].resize(csv.rows.size());
+      for (size_t n = 0; n < csv.rows.size(); n++)
+        y[i][n] = csv.rows[n][col];
+    }
+  }
+  const size_t N = num_var > 0 ? y[0].size() : 0;
+  std::vector<const double*> y_cols(num_var);
+  for (int i = 0; i < num_var; i++)
+    y_cols[i] = y[i].data();
+
+  std::cout << "normalization_integral: " << N << " points, "
+            << stan_pwa::parallel::thread_pool::instance().size()
+            << " threads..." << std::endl;
+
+  // Integrate
+  const double volume = std::atof(argv[2]);
+  const auto compute = [&]() -> stan_pwa::integrate::normalization {
+    if (store_dir.empty())
+      return stan_pwa::integrate::normalization_integral(
+        [](const Eigen::VectorXd& p) {
+          return stan::math::amplitude_vector(p);
+        },
+        y_cols.data(), num_var, N, volume);
+
+    stan_pwa::integrate::integral_store store(store_dir, y_cols.data(),
+                                              num_var, N);
+    const stan_pwa::integrate::normalization res =
+      stan::math::stored_normalization_integral(store, volume);
+    std::cout << "normalization_integral: " << store.columns_computed()
+              << " of " << stan::math::num_resonances()
+              << " amplitude columns and " << store.pairs_computed()
+              << " elements of I computed, the others read from "
+              << store_dir << "." << std::endl;
+    return res;
+  };
+
+  stan_pwa::integrate::normalization res;
+  try {
+    if (cache_dir.empty()) {
+      res = compute();
+    } else {
+      const uint64_t key = stan_pwa::integrate::integral_key(
+        stan::math::model_hash(),
+        stan_pwa::integrate::sample_hash(y_cols.data(), num_var, N),
+        volume);
+      bool computed = false;
+      res = stan_pwa::integrate::integral_cache(cache_dir).get(
+        key, stan::math::num_resonances(),
+        [&]() -> stan_pwa::integrate::normalization {
+          computed = true;
+          return compute();
+        });
+      std::cout << "normalization_integral: I "
+                << (computed ? "computed and added to" : "read from")
+                << " the cache " << cache_dir << "." << std::endl;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << argv[0] << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  // Write I, I_err
+  std::ofstream f_out(argv[3], append ? std::ios::app : std::ios::trunc);
+  if (!f_out) {
+    std::cerr << argv[0] << ": cannot open " << argv[3] << std::endl;
+    return 1;
+  }
+  stan_pwa::io::write_rdump_array(f_out, "I", res.I);
+  stan_pwa::io::write_rdump_array(f_out, "I_err", res.err);
+
+  std::cout << "normalization_integral: Done. I saved in " << argv[3]
+            << "." << std::endl;
+  return 0;
+}
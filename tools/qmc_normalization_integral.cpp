@@ -0,0 +1,112 @@
+// qmc_normalization_integral.cpp
+//
+// NAME
+//    qmc_normalization_integral - compute the normalization matrix I of
+//    the linked model by quasi-Monte Carlo integration over the Dalitz
+//    plot.
+//
+// SYNOPSIS
+//    qmc_normalization_integral NUM_POINTS OUTPUT_DATA_R M_P M_A M_B M_C
+//                               [--replicas=K] [--seed=SEED] [--append]
+//
+// DESCRIPTION
+//    Computes
+//
+//        I[i,j] = int conj(A_i(y)) A_j(y) dy
+//
+//    over the Dalitz plot y = (m2_ab, m2_bc) of the decay P -> a b c with
+//    masses M_P, M_A, M_B, M_C in GeV, with amplitude_vector of the model
+//    linked by relink_model.sh (3-body decays only), and writes I and its
+//    standard error I_err to OUTPUT_DATA_R in the format of
+//    STAN_amplitude_fitting.data.R. With --append, they are appended to
+//    an existing data file instead.
+//
+//    No sample of points is needed: K (default 8) independently
+//    scrambled Sobol sequences of NUM_POINTS points each (a power of 2,
+//    e.g. 65536) are mapped onto the Dalitz plot without rejection; I is
+//    the mean of the K estimates and I_err follows from their spread
+//    (see stan_pwa/src/integrate/qmc.hpp). For smooth amplitudes, this
+//    reaches a given precision with far fewer amplitude evaluations than
+//    normalization_integral over uniform random points.
+//
+//    Uses STAN_PWA_NUM_THREADS threads (default: all cores); for a given
+//    SEED (default 1), the result does not depend on the number of
+//    threads.
+//
+//    Built by build_tools.sh.
+
+#include <cstdlib> // atof, strtoul
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stan_pwa/src/integrate.hpp>
+#include <stan_pwa/src/io.hpp>
+#include <stan_pwa/src/model_wrapper.hpp>
+
+int main(int argc, char* argv[]) {
+
+  std::vector<std::string> args;
+  unsigned long seed = 1;
+  size_t num_replicas = 8;
+  bool append = false;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    if (arg.compare(0, 7, "--seed=") == 0)
+      seed = std::strtoul(arg.c_str() + 7, 0, 10);
+    else if (arg.compare(0, 11, "--replicas=") == 0)
+      num_replicas = std::strtoul(arg.c_str() + 11, 0, 10);
+    else if (arg == "--append")
+      append = true;
+    else
+      args.push_back(arg);
+  }
+
+  if (args.size() != 6) {
+    std::cerr << "Usage: " << argv[0]
+              << " NUM_POINTS OUTPUT_DATA_R M_P M_A M_B M_C [--replicas=K]"
+              << " [--seed=SEED] [--append]" << std::endl;
+    return 1;
+  }
+  if (stan::math::num_variables() != 2) {
+    std::cerr << argv[0] << ": only 3-body decays (2 variables) are "
+              << "supported" << std::endl;
+    return 1;
+  }
+
+  const size_t num_points = std::strtoul(args[0].c_str(), 0, 10);
+  const stan_pwa::generate::dalitz_space space(std::atof(args[2].c_str()),
+                                               std::atof(args[3].c_str()),
+                                               std::atof(args[4].c_str()),
+                                               std::atof(args[5].c_str()));
+
+  std::cout << "qmc_normalization_integral: " << num_replicas
+            << " replicas of " << num_points << " points, "
+            << stan_pwa::parallel::thread_pool::instance().size()
+            << " threads..." << std::endl;
+
+  // Integrate
+  stan_pwa::integrate::normalization res;
+  try {
+    res = stan_pwa::integrate::qmc_normalization_integral(
+      [](const Eigen::VectorXd& y) { return stan::math::amplitude_vector(y); },
+      space, num_points, num_replicas, seed);
+  } catch (const std::exception& e) {
+    std::cerr << argv[0] << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  // Write I, I_err
+  std::ofstream f_out(args[1].c_str(), append ? std::ios::app : std::ios::trunc);
+  if (!f_out) {
+    std::cerr << argv[0] << ": cannot open " << args[1] << std::endl;
+    return 1;
+  }
+  stan_pwa::io::write_rdump_array(f_out, "I", res.I);
+  stan_pwa::io::write_rdump_array(f_out, "I_err", res.err);
+
+  std::cout << "qmc_normalization_integral: Done. I saved in " << args[1]
+            << "." << std::endl;
+  return 0;
+}
@@ -0,0 +1,411 @@
+// time_loglik.cpp
+//
+// NAME
+//    time_loglik - time the log-likelihood of the linked model and its
+//    gradient.
+//
+// SYNOPSIS
+//    time_loglik DATA_R THETA_DATA_R [--store=FILE] [--repeat=N]
+//                [--no_autodiff] [--json=FILE]
+//
+// DESCRIPTION
+//    Evaluates the log-likelihood of the fit (STAN_amplitude_fitting.stan)
+//
+//        sum_d log( f_genfit(A_d, theta) / norm(theta, I) )
+//
+//    and its gradient w.r.t. theta N times (default 10) at the fixed theta
+//    of THETA_DATA_R (e.g. stan/STAN_data_generator.data.R), without
+//    running CmdStan. The amplitudes A_d and I are read from DATA_R (e.g.
+//    stan/STAN_amplitude_fitting.data.R); with --store, the amplitudes
+//    are mapped from the event store FILE instead (see tools/event_store.cpp)
+//    and only I is read from DATA_R.
+//
+//    Two evaluations are timed:
+//
+//      autodiff  the loop over f_genfit of the STAN model, with the
+//                functions of the linked model (Model::f_genfit and
+//                Model::norm), one autodiff node per operation, by
+//                phases: f_genfit (|sum_r theta_r A_dr|^2), log, norm
+//                (theta^H I theta) and gradient (the reverse pass), which
+//                add up to the evaluation. Skipped with --no_autodiff
+//                (its tape grows with the number of events);
+//
+//      analytic  pwa_loglik_threaded (pwa_loglik_mapped with --store), as
+//                used by the fit: the fused event sum on
+//                STAN_PWA_NUM_THREADS threads, norm and the single node
+//                with precomputed gradient. Its phases event_sum and norm
+//                are timed on their own, in double precision.
+//
+//    Each is evaluated once before the timed repetitions, so that the
+//    start of the threads and the first reads of the mapped store do not
+//    count. For each, it prints the time per evaluation, its phases (and
+//    their fraction of the evaluation), the events per second, the size
+//    of the autodiff tape (nodes and bytes of the arena) and the largest
+//    relative difference of the two gradients.
+//    At the end, the peak resident memory of the process. With --json,
+//    the numbers are also written to FILE.
+//
+//    Built by build_tools.sh.
+
+#include <algorithm> // max
+#include <chrono>
+#include <cmath> // fabs, log
+#include <cstdio> // printf, fprintf
+#include <cstdlib> // strtoul
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h> // getrusage
+
+#include <stan/io/dump.hpp>
+
+#include <stan_pwa/src/io.hpp>
+#include <stan_pwa/src/likelihood.hpp>
+#include <stan_pwa/src/model_wrapper.hpp>
+
+namespace {
+
+  using stan::math::var;
+  typedef std::chrono::steady_clock timer_clock;
+
+  double
+  seconds_since(timer_clock::time_point start) {
+    return std::chrono::duration<double>(timer_clock::now() - start).count();
+  }
+
+
+  ///> Seconds of the evaluations and of their phases
+  struct timing {
+    std::string name;
+    double evaluation; ///> Summed over the repetitions
+    std::vector<std::string> phases;
+    std::vector<double> seconds; ///> Summed over the repetitions
+    double value;
+    Eigen::VectorXd grad; ///> (d/dRe(theta), d/dIm(theta))
+    double tape_nodes;
+    double tape_bytes;
+
+    timing(const std::string& _name, const char* const* _phases, int n) :
+      name(_name), evaluation(0), phases(_phases, _phases + n),
+      seconds(n, 0.0), value(0), tape_nodes(0), tape_bytes(0) {};
+  };
+
+
+  ///> theta as a complex vector of vars
+  stan::math::CV_t<var>
+  to_var(const stan::math::CV_t<double>& theta) {
+    stan::math::CV_t<var> res(2, Eigen::Matrix<var, Eigen::Dynamic, 1>(
+                                theta[0].rows()));
+    for (int k = 0; k < 2; k++) {
+      for (int r = 0; r < theta[0].rows(); r++)
+        res[k](r) = theta[k](r);
+    }
+    return res;
+  }
+
+
+  ///> Gradient w.r.t. (Re(theta), Im(theta)) after the reverse pass;
+  ///> records the size of the tape and frees it
+  void
+  finish(const var& lp, const stan::math::CV_t<var>& theta, timing& t) {
+    const int R = theta[0].rows();
+    t.value = lp.val();
+    t.grad.resize(2 * R);
+    for (int k = 0; k < 2; k++) {
+      for (int r = 0; r < R; r++)
+        t.grad(k * R + r) = theta[k](r).adj();
+    }
+    t.tape_nodes = stan::math::ChainableStack::var_stack_.size()
+      + stan::math::ChainableStack::var_nochain_stack_.size();
+    t.tape_bytes = stan::math::ChainableStack::memalloc_.bytes_allocated();
+    stan::math::recover_memory();
+  }
+
+
+  ///> One evaluation with the functions of the model, phase by phase
+  void
+  time_autodiff(const std::vector<stan::math::CV_t<double> >& A,
+                const stan::math::CV_t<double>& theta_d,
+                const std::vector<Eigen::MatrixXd>& I, timing& t) {
+    const stan::math::CV_t<var> theta = to_var(theta_d);
+    const size_t D = A.size();
+    double seconds[4];
+
+    timer_clock::time_point start = timer_clock::now();
+    std::vector<var> f(D);
+    for (size_t d = 0; d < D; d++)
+      f[d] = stan::math::f_genfit(A[d], theta);
+    seconds[0] = seconds_since(start);
+
+    start = timer_clock::now();
+    var sum = 0;
+    for (size_t d = 0; d < D; d++)
+      sum += log(f[d]);
+    seconds[1] = seconds_since(start);
+
+    start = timer_clock::now();
+    const var lp = sum - (double)D * log(stan::math::norm(theta, I));
+    seconds[2] = seconds_since(start);
+
+    start = timer_clock::now();
+    stan::math::grad(lp.vi_);
+    seconds[3] = seconds_since(start);
+
+    for (int i = 0; i < 4; i++) {
+      t.seconds[i] += seconds[i];
+      t.evaluation += seconds[i];
+    }
+    finish(lp, theta, t);
+  }
+
+
+  /**
+   * One evaluation as in the fit, and its two phases on their own: the
+   * event sum and norm in double precision.
+   */
+  template <typename E, typename F>
+  void
+  time_analytic(const E& events, const F& loglik,
+                const stan::math::CV_t<double>& theta_d,
+                const std::vector<Eigen::MatrixXd>& I, timing& t) {
+    const int R = theta_d[0].rows();
+    Eigen::VectorXd grad_re = Eigen::VectorXd::Zero(R);
+    Eigen::VectorXd grad_im = Eigen::VectorXd::Zero(R);
+
+    timer_clock::time_point start = timer_clock::now();
+    stan_pwa::likelihood::event_sum_parallel(events, theta_d, grad_re,
+                                             grad_im);
+    t.seconds[0] += seconds_since(start);
+
+    start = timer_clock::now();
+    stan_pwa::likelihood::norm(theta_d, I, grad_re, grad_im);
+    t.seconds[1] += seconds_since(start);
+
+    const stan::math::CV_t<var> theta = to_var(theta_d);
+    start = timer_clock::now();
+    const var lp = loglik(theta);
+    stan::math::grad(lp.vi_);
+    t.evaluation += seconds_since(start);
+
+    finish(lp, theta, t);
+  }
+
+
+  ///> Values of the variable name of data, checked against its size
+  std::vector<double>
+  read_values(stan::io::dump& data, const std::string& name, size_t size,
+              const std::string& path) {
+    if (!data.contains_r(name))
+      throw std::domain_error("no " + name + " in " + path);
+    const std::vector<double> res = data.vals_r(name);
+    if (res.size() != size)
+      throw std::domain_error(name + " in " + path + " has the wrong size");
+    return res;
+  }
+
+
+  ///> Peak resident memory of the process in MB
+  double
+  peak_rss_mb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0; // kB on Linux
+  }
+
+
+  void
+  print(const timing& t, size_t D, int repeat) {
+    const double evaluation = t.evaluation / repeat;
+    std::printf("%s: %.3f ms per evaluation, %.3g events/s, tape %.0f nodes"
+                " (%.1f MB)\n", t.name.c_str(), 1e3 * evaluation,
+                D / evaluation, t.tape_nodes, t.tape_bytes / (1 << 20));
+    for (size_t i = 0; i < t.phases.size(); i++) {
+      std::printf("  %-10s %10.3f ms %6.1f %%\n", t.phases[i].c_str(),
+                  1e3 * t.seconds[i] / repeat,
+                  100 * t.seconds[i] / t.evaluation);
+    }
+  }
+
+
+  void
+  write_json(FILE* f, const timing& t, size_t D, int repeat) {
+    const double evaluation = t.evaluation / repeat;
+    std::fprintf(f, "    {\"name\": \"%s\", \"seconds\": %.6g, "
+                 "\"events_per_second\": %.6g, \"tape_nodes\": %.0f, "
+                 "\"tape_bytes\": %.0f, \"phases\": {", t.name.c_str(),
+                 evaluation, D / evaluation, t.tape_nodes, t.tape_bytes);
+    for (size_t i = 0; i < t.phases.size(); i++) {
+      std::fprintf(f, "%s\"%s\": %.6g", i > 0 ? ", " : "",
+                   t.phases[i].c_str(), t.seconds[i] / repeat);
+    }
+    std::fprintf(f, "}}");
+  }
+
+}
+
+int main(int argc, char* argv[]) {
+
+  std::vector<std::string> args;
+  std::string store_path;
+  std::string json;
+  int repeat = 10;
+  bool autodiff = true;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    if (arg.compare(0, 8, "--store=") == 0)
+      store_path = arg.substr(8);
+    else if (arg.compare(0, 9, "--repeat=") == 0)
+      repeat = std::strtoul(arg.c_str() + 9, 0, 10);
+    else if (arg == "--no_autodiff")
+      autodiff = false;
+    else if (arg.compare(0, 7, "--json=") == 0)
+      json = arg.substr(7);
+    else
+      args.push_back(arg);
+  }
+  if (args.size() != 2 || repeat < 1) {
+    std::cerr << "Usage: " << argv[0] << " DATA_R THETA_DATA_R [--store=FILE]"
+              << " [--repeat=N] [--no_autodiff] [--json=FILE]" << std::endl;
+    return 1;
+  }
+
+  const int R = stan::math::num_resonances();
+  stan::math::CV_t<double> theta(2, Eigen::VectorXd(R));
+  std::vector<Eigen::MatrixXd> I(2, Eigen::MatrixXd(R, R));
+  std::vector<stan::math::CV_t<double> > A;
+  try {
+    // theta, declared as 'vector[num_resonances()] theta[2]'
+    std::ifstream theta_stream(args[1].c_str());
+    if (!theta_stream)
+      throw std::domain_error("cannot open " + args[1]);
+    stan::io::dump theta_data(theta_stream);
+    const std::vector<double> t = read_values(theta_data, "theta", 2 * R,
+                                              args[1]);
+    for (int r = 0; r < R; r++) {
+      theta[0](r) = t[2 * r];
+      theta[1](r) = t[2 * r + 1];
+    }
+
+    // I, declared as 'matrix[R, R] I[2]', and the amplitudes, declared
+    // as 'vector[R] amplitude_vector_data[D, 2]' (column-major)
+    std::ifstream data_stream(args[0].c_str());
+    if (!data_stream)
+      throw std::domain_error("cannot open " + args[0]);
+    stan::io::dump data(data_stream);
+    const std::vector<double> i_vals = read_values(data, "I", 2 * R * R,
+                                                   args[0]);
+    for (int k = 0; k < 2; k++) {
+      for (int i = 0; i < R; i++) {
+        for (int j = 0; j < R; j++)
+          I[k](i, j) = i_vals[k + 2 * i + 2 * R * j];
+      }
+    }
+
+    if (store_path.empty()) {
+      const size_t D = read_values(data, "D", 1, args[0])[0];
+      const std::vector<double> a = read_values(data, "amplitude_vector_data",
+                                                2 * R * D, args[0]);
+      A.assign(D, stan::math::CV_t<double>(2, Eigen::VectorXd(R)));
+      for (size_t d = 0; d < D; d++) {
+        for (int k = 0; k < 2; k++) {
+          for (int r = 0; r < R; r++)
+            A[d][k](r) = a[d + D * k + 2 * D * r];
+        }
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << argv[0] << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  const char* autodiff_phases[] = {"f_genfit", "log", "norm", "gradient"};
+  const char* analytic_phases[] = {"event_sum", "norm"};
+  timing t_autodiff("autodiff", autodiff_phases, 4);
+  timing t_analytic("analytic", analytic_phases, 2);
+  // The first evaluation of each is not timed (see above)
+  timing warm_up_autodiff = t_autodiff, warm_up_analytic = t_analytic;
+  size_t D = A.size();
+
+  try {
+    if (!store_path.empty()) {
+      const stan_pwa::io::mapped_event_store store(store_path);
+      if (store.num_res() != (size_t)R
+          || store.model_hash() != stan::math::model_hash())
+        throw std::domain_error(store_path + " was written for another model");
+      const stan_pwa::likelihood::column_events events(store.size(), R,
+                                                       store.re(0),
+                                                       store.im(0));
+      D = events.size();
+      if (autodiff) {
+        A.assign(D, stan::math::CV_t<double>(2, Eigen::VectorXd(R)));
+        for (size_t d = 0; d < D; d++) {
+          for (int r = 0; r < R; r++) {
+            A[d][0](r) = events.re_column(r)[d];
+            A[d][1](r) = events.im_column(r)[d];
+          }
+        }
+      }
+      const auto loglik = [&](const stan::math::CV_t<var>& theta_v) {
+        return stan_pwa::likelihood::pwa_loglik_columns(events, theta_v, I);
+      };
+      for (int n = 0; n <= repeat; n++)
+        time_analytic(events, loglik, theta, I,
+                      n ? t_analytic : warm_up_analytic);
+    } else {
+      const auto loglik = [&](const stan::math::CV_t<var>& theta_v) {
+        return stan::math::pwa_loglik_threaded(A, theta_v, I);
+      };
+      for (int n = 0; n <= repeat; n++)
+        time_analytic(stan_pwa::likelihood::stan_events(A), loglik, theta, I,
+                      n ? t_analytic : warm_up_analytic);
+    }
+
+    for (int n = 0; autodiff && n <= repeat; n++)
+      time_autodiff(A, theta, I, n ? t_autodiff : warm_up_autodiff);
+  } catch (const std::exception& e) {
+    std::cerr << argv[0] << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::printf("time_loglik: %zu events, %d resonances, %d evaluations, "
+              "%d threads, log-likelihood %.10g\n\n", D, R, repeat,
+              stan_pwa::parallel::thread_pool::instance().size(),
+              t_analytic.value);
+  print(t_analytic, D, repeat);
+  if (autodiff) {
+    print(t_autodiff, D, repeat);
+    double diff = 0;
+    for (int i = 0; i < 2 * R; i++) {
+      diff = std::max(diff, std::fabs(t_autodiff.grad(i) - t_analytic.grad(i))
+                      / std::max(std::fabs(t_analytic.grad(i)), 1e-300));
+    }
+    std::printf("\nlargest relative difference of the gradients: %.3g\n",
+                diff);
+  }
+  std::printf("peak resident memory: %.1f MB\n", peak_rss_mb());
+
+  if (!json.empty()) {
+    FILE* f = std::fopen(json.c_str(), "w");
+    if (f == 0) {
+      std::cerr << argv[0] << ": cannot open " << json << std::endl;
+      return 1;
+    }
+    std::fprintf(f, "{\n  \"events\": %zu,\n  \"resonances\": %d,\n"
+                 "  \"repeat\": %d,\n  \"threads\": %d,\n"
+                 "  \"peak_rss_mb\": %.1f,\n  \"evaluations\": [\n",
+                 D, R, repeat,
+                 stan_pwa::parallel::thread_pool::instance().size(),
+                 peak_rss_mb());
+    write_json(f, t_analytic, D, repeat);
+    if (autodiff) {
+      std::fprintf(f, ",\n");
+      write_json(f, t_autodiff, D, repeat);
+    }
+    std::fprintf(f, "\n  ]\n}\n");
+    std::fclose(f);
+  }
+  return 0;
+}
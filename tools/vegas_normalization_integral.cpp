@@ -0,0 +1,147 @@
+// vegas_normalization_integral.cpp
+//
+// NAME
+//    vegas_normalization_integral - compute the normalization matrix I of
+//    the linked model by adaptive (VEGAS) Monte Carlo integration.
+//
+// SYNOPSIS
+//    vegas_normalization_integral NUM_POINTS OUTPUT_DATA_R M_P M_A M_B M_C
+//                                 [M_D] [--rel-tol=EPS] [--warmup=W]
+//                                 [--max-iterations=T] [--bins=B]
+//                                 [--seed=SEED] [--append]
+//
+// DESCRIPTION
+//    Computes
+//
+//        I[i,j] = int conj(A_i(y)) A_j(y) dy
+//
+//    over the phase space of the decay P -> a b c (Dalitz plot,
+//    y = (m2_ab, m2_bc)) or P -> a b c d (y = (m2_12, m2_14, m2_23, m2_34,
+//    m2_13)) with masses M_P, M_A, ... in GeV, with amplitude_vector of
+//    the model linked by relink_model.sh, and writes I and its standard
+//    error I_err to OUTPUT_DATA_R in the format of
+//    STAN_amplitude_fitting.data.R. With --append, they are appended to
+//    an existing data file instead.
+//
+//    The points are drawn in iterations of NUM_POINTS points from a VEGAS
+//    grid of B bins per variable (default 100), which adapts to the peaks
+//    of narrow resonances such as omega_782 (see
+//    stan_pwa/src/integrate/vegas.hpp). After W warmup iterations
+//    (default 3), the estimates are combined until the error of every
+//    element is at most EPS sqrt(I[i,i] I[j,j]) (default 1e-3), or for at
+//    most T iterations in total (default 50).
+//
+//    Uses STAN_PWA_NUM_THREADS threads (default: all cores); for a given
+//    SEED (default 1), the result does not depend on the number of
+//    threads.
+//
+//    Built by build_tools.sh.
+
+#include <cstdlib> // atof, atoi, strtoul
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stan_pwa/src/integrate.hpp>
+#include <stan_pwa/src/io.hpp>
+#include <stan_pwa/src/model_wrapper.hpp>
+
+namespace {
+
+  template <typename S>
+  stan_pwa::integrate::normalization
+  integrate(const S& space, const stan_pwa::integrate::vegas_options& options,
+            stan_pwa::integrate::vegas_info& info) {
+    return stan_pwa::integrate::vegas_normalization_integral(
+      [](const Eigen::VectorXd& y) { return stan::math::amplitude_vector(y); },
+      space, options, info);
+  }
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+  std::vector<std::string> args;
+  stan_pwa::integrate::vegas_options options;
+  bool append = false;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    if (arg.compare(0, 10, "--rel-tol=") == 0)
+      options.rel_tol = std::atof(arg.c_str() + 10);
+    else if (arg.compare(0, 9, "--warmup=") == 0)
+      options.warmup_iterations = std::strtoul(arg.c_str() + 9, 0, 10);
+    else if (arg.compare(0, 17, "--max-iterations=") == 0)
+      options.max_iterations = std::strtoul(arg.c_str() + 17, 0, 10);
+    else if (arg.compare(0, 7, "--bins=") == 0)
+      options.num_bins = std::atoi(arg.c_str() + 7);
+    else if (arg.compare(0, 7, "--seed=") == 0)
+      options.seed = std::strtoul(arg.c_str() + 7, 0, 10);
+    else if (arg == "--append")
+      append = true;
+    else
+      args.push_back(arg);
+  }
+
+  const int num_var = stan::math::num_variables();
+  const size_t num_masses = (num_var == 2) ? 4 : 5;
+  if (args.size() != 2 + num_masses) {
+    std::cerr << "Usage: " << argv[0]
+              << " NUM_POINTS OUTPUT_DATA_R M_P M_A M_B M_C"
+              << (num_masses == 5 ? " M_D" : "")
+              << " [--rel-tol=EPS] [--warmup=W] [--max-iterations=T]"
+              << " [--bins=B] [--seed=SEED] [--append]" << std::endl;
+    return 1;
+  }
+
+  options.points_per_iteration = std::strtoul(args[0].c_str(), 0, 10);
+  std::vector<double> m(num_masses);
+  for (size_t i = 0; i < num_masses; i++)
+    m[i] = std::atof(args[2 + i].c_str());
+
+  std::cout << "vegas_normalization_integral: " << options.points_per_iteration
+            << " points per iteration, "
+            << stan_pwa::parallel::thread_pool::instance().size()
+            << " threads..." << std::endl;
+
+  // Integrate
+  stan_pwa::integrate::normalization res;
+  stan_pwa::integrate::vegas_info info;
+  try {
+    if (num_var == 2) {
+      const stan_pwa::generate::dalitz_space space(m[0], m[1], m[2], m[3]);
+      res = integrate(space, options, info);
+    } else {
+      const stan_pwa::generate::four_body_space space(m[0], m[1], m[2], m[3],
+                                                      m[4]);
+      res = integrate(space, options, info);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << argv[0] << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::cout << "vegas_normalization_integral: " << info.iterations
+            << " iterations, " << res.num_points << " points, largest "
+            << "relative error " << info.max_rel_err << ", chi2/dof "
+            << info.chi2_dof << "." << std::endl;
+  if (!info.converged) {
+    std::cerr << "vegas_normalization_integral: WARNING: --rel-tol="
+              << options.rel_tol << " not reached; increase NUM_POINTS or "
+              << "--max-iterations." << std::endl;
+  }
+
+  // Write I, I_err
+  std::ofstream f_out(args[1].c_str(), append ? std::ios::app : std::ios::trunc);
+  if (!f_out) {
+    std::cerr << argv[0] << ": cannot open " << args[1] << std::endl;
+    return 1;
+  }
+  stan_pwa::io::write_rdump_array(f_out, "I", res.I);
+  stan_pwa::io::write_rdump_array(f_out, "I_err", res.err);
+
+  std::cout << "vegas_normalization_integral: Done. I saved in " << args[1]
+            << "." << std::endl;
+  return 0;
+}